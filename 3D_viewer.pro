@@ -1,10 +1,11 @@
-QT       += core gui opengl
+QT       += core gui opengl concurrent
 
 greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 greaterThan(QT_MAJOR_VERSION, 5): QT += openglwidgets
 
 CONFIG += c++17
 LIBS += -lglu32 -lopengl32 # -lstdc++fs
+unix: LIBS += -lpthread
 
 # You can make your code fail to compile if it uses deprecated APIs.
 # In order to do so, uncomment the following line.
@@ -13,16 +14,55 @@ LIBS += -lglu32 -lopengl32 # -lstdc++fs
 SOURCES += \
     ui/gl/viewerwindow.cpp \
     ui/gl/openglwindow.cpp \
+    ui/gl/modelloader.cpp \
+    ui/gl/frameprofiler.cpp \
+    ui/gl/rendersettings.cpp \
+    ui/gl/thumbnailrenderer.cpp \
     ui/main/mainwindow.cpp \
+    ui/main/thumbnailbatch.cpp \
     ui/main.cpp \
-    parser/s21_parser.c
+    parser/s21_parser.c \
+    parser/s21_mapping.c \
+    parser/s21_number.c \
+    parser/s21_parallel.c \
+    parser/s21_mesh.c \
+    parser/s21_cache.c \
+    parser/s21_bvh.c \
+    parser/s21_simplify.c \
+    parser/s21_simd.c \
+    parser/s21_quantize.c \
+    parser/s21_optimize.c \
+    parser/s21_stream.c \
+    parser/s21_raster.c \
+    parser/s21_export.c \
+    parser/s21_model.c \
+    parser/s21_triangulate.c
 
 HEADERS += \
     ui/gl/viewerwindow.h \
     ui/gl/viewerwindow.h \
     ui/gl/openglwindow.h \
+    ui/gl/modelloader.h \
+    ui/gl/frameprofiler.h \
+    ui/gl/rendersettings.h \
+    ui/gl/thumbnailrenderer.h \
     ui/main/mainwindow.h \
-    parser/s21_parser.h
+    ui/main/thumbnailbatch.h \
+    parser/s21_parser.h \
+    parser/s21_mapping.h \
+    parser/s21_number.h \
+    parser/s21_mesh.h \
+    parser/s21_cache.h \
+    parser/s21_bvh.h \
+    parser/s21_simplify.h \
+    parser/s21_simd.h \
+    parser/s21_quantize.h \
+    parser/s21_optimize.h \
+    parser/s21_stream.h \
+    parser/s21_raster.h \
+    parser/s21_export.h \
+    parser/s21_model.h \
+    parser/s21_triangulate.h
 
 FORMS += \
     ui/mainwindow.ui
@@ -0,0 +1,592 @@
+// Times every loader stage over the models directory and over generated
+// grids, writes a JSON report with one case per line and compares it with a
+// baseline report.
+//
+//   bench [--models DIR] [--faces N,N,...] [--repeat N] [--out FILE]
+//         [--baseline FILE] [--threshold FRACTION] [--tmp DIR]
+#define _DEFAULT_SOURCE
+
+#include <dirent.h>
+#include <sys/resource.h>
+#include <time.h>
+
+#include "../parser/s21_export.h"
+#include "../parser/s21_mesh.h"
+#include "../parser/s21_model.h"
+#include "../parser/s21_raster.h"
+#include "../parser/s21_simd.h"
+#include "../parser/s21_stream.h"
+
+#define MAX_NAME 256
+#define MAX_LINE 4096
+// timer noise on the small models is ignored below this difference
+#define MIN_REGRESSION_SECONDS 0.002
+// the memory budget of the streaming stage
+#define STREAM_BUDGET (16 * 1024 * 1024)
+// the image of the rasterizer stages
+#define RASTER_WIDTH 1920
+#define RASTER_HEIGHT 1080
+
+typedef enum Stage {
+  STAGE_PARSE,
+  STAGE_PARSE_PARALLEL,
+  STAGE_STREAM,
+  STAGE_TRIANGULATE,
+  STAGE_VERTEX_BUFFER,
+  STAGE_MESH,
+  STAGE_BOUNDS,
+  STAGE_BOUNDS_SCALAR,
+  STAGE_OPTIMIZE,
+  STAGE_RASTER,
+  STAGE_RASTER_SINGLE,
+  STAGE_EXPORT_OBJ,
+  STAGE_EXPORT_PLY,
+  STAGE_EXPORT_STL,
+  STAGE_PARSE_PLY,
+  STAGE_PARSE_STL,
+  STAGE_COUNT
+} Stage;
+
+static const char *stage_names[STAGE_COUNT] = {
+    "parse_obj",           "parse_obj_parallel",   "read_obj_stream",
+    "triangulate",         "create_vertex_buffer", "create_mesh",
+    "compute_bounds",      "compute_bounds_scalar", "optimize_vertex_cache",
+    "rasterize_wireframe", "rasterize_wireframe_single", "export_obj",
+    "export_ply",          "export_stl",                "parse_ply",
+    "parse_stl"};
+
+typedef struct StageResult {
+  double seconds;
+  long allocations;
+  // the size of the file written or read by the export and binary stages
+  long long bytes;
+} StageResult;
+
+typedef struct BenchCase {
+  char name[MAX_NAME];
+  long long bytes;
+  int faces;
+  StageResult stages[STAGE_COUNT];
+  CacheStats original_cache;
+  CacheStats optimized_cache;
+  size_t stream_memory;
+  long peak_rss_kb;
+  int error;
+} BenchCase;
+
+typedef struct BenchOptions {
+  const char *models;
+  const char *faces;
+  const char *out;
+  const char *baseline;
+  const char *tmp;
+  double threshold;
+  int repeat;
+} BenchOptions;
+
+#ifdef BENCH_WRAP_MALLOC
+// linked with -Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc
+static long allocation_count = 0;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+
+void *__wrap_malloc(size_t size) {
+  __atomic_add_fetch(&allocation_count, 1, __ATOMIC_RELAXED);
+  return __real_malloc(size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  __atomic_add_fetch(&allocation_count, 1, __ATOMIC_RELAXED);
+  return __real_calloc(count, size);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  __atomic_add_fetch(&allocation_count, 1, __ATOMIC_RELAXED);
+  return __real_realloc(ptr, size);
+}
+
+static long allocations() {
+  return __atomic_load_n(&allocation_count, __ATOMIC_RELAXED);
+}
+#else
+static long allocations() { return -1; }
+#endif
+
+static double now() {
+  struct timespec time;
+  clock_gettime(CLOCK_MONOTONIC, &time);
+  return time.tv_sec + time.tv_nsec / 1e9;
+}
+
+// Linux can reset the peak so every case reports its own, elsewhere the peak
+// of the whole run is reported.
+static void reset_peak_rss() {
+  FILE *file = fopen("/proc/self/clear_refs", "w");
+  if (file != NULL) {
+    fputs("5", file);
+    fclose(file);
+  }
+}
+
+static long peak_rss_kb() {
+  long peak = -1;
+  FILE *file = fopen("/proc/self/status", "r");
+  char line[MAX_LINE];
+  while (file != NULL && fgets(line, sizeof(line), file) != NULL)
+    if (strncmp(line, "VmHWM:", 6) == 0) peak = atol(line + 6);
+  if (file != NULL) fclose(file);
+  if (peak < 0) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    peak = usage.ru_maxrss / 1024;
+#else
+    peak = usage.ru_maxrss;
+#endif
+  }
+  return peak;
+}
+
+static long long file_size(const char *path) {
+  FILE *file = fopen(path, "rb");
+  long long size = -1;
+  if (file != NULL && fseek(file, 0, SEEK_END) == 0) size = ftell(file);
+  if (file != NULL) fclose(file);
+  return size;
+}
+
+static void record(BenchCase *bench, Stage stage, double start,
+                   long start_allocations, int round) {
+  double seconds = now() - start;
+  StageResult *result = &bench->stages[stage];
+  if (round == 0 || seconds < result->seconds) result->seconds = seconds;
+  result->allocations = allocations() < 0
+                            ? -1
+                            : allocations() - start_allocations;
+}
+
+static void rasterize_mesh(BenchCase *bench, const Mesh *mesh, int single,
+                           int round) {
+  uint32_t *pixels = malloc(sizeof(uint32_t) * RASTER_WIDTH * RASTER_HEIGHT);
+  Rasterizer *rasterizer = create_rasterizer(single, &bench->error);
+  if (pixels == NULL || rasterizer == NULL) bench->error = 1;
+  if (!bench->error) {
+    float matrix[16];
+    Bounds bounds = compute_bounds(mesh->positions, 3, mesh->vertex_count);
+    fit_bounds(&bounds, matrix);
+    Wireframe wireframe = {mesh->positions, mesh->vertex_count, mesh->edges,
+                           mesh->edge_count, mesh->points, mesh->point_count,
+                           matrix};
+    RasterStyle style = {0xFF000000u, 0xFFFFFFFFu, 1.0f, 0xFFFF,
+                         0xFFFFFFFFu, 1.0f, RASTER_POINT_NONE};
+    RasterImage image = {pixels, RASTER_WIDTH, RASTER_HEIGHT, RASTER_WIDTH};
+    double start = now();
+    long start_allocations = allocations();
+    rasterize_wireframe(rasterizer, &wireframe, &style, image, &bench->error);
+    record(bench, single ? STAGE_RASTER_SINGLE : STAGE_RASTER, start,
+           start_allocations, round);
+  }
+  destroy_rasterizer(rasterizer);
+  safe_free(pixels);
+}
+
+// The binary file of an export stage read back by parse_model.
+static void parse_export(BenchCase *bench, Stage stage, const char *path,
+                         int round) {
+  ParseOptions options = {0, NULL, NULL};
+  double start = now();
+  long start_allocations = allocations();
+  Obj *obj = parse_model(path, options);
+  record(bench, stage, start, start_allocations, round);
+  bench->stages[stage].bytes = file_size(path);
+  if (obj == NULL) bench->error = 1;
+  destroy_obj(obj);
+}
+
+// The parsed model and its triangles written into the temporary directory.
+static void export_model(BenchCase *bench, const Obj *obj,
+                         const VertexBuffer *buffer, const char *tmp,
+                         int round) {
+  static const char *extensions[] = {"obj", "ply", "stl"};
+  char path[MAX_LINE];
+  for (int i = 0; i < 3 && !bench->error; i++) {
+    Stage stage = STAGE_EXPORT_OBJ + i;
+    snprintf(path, sizeof(path), "%s/bench_export.%s", tmp, extensions[i]);
+    double start = now();
+    long start_allocations = allocations();
+    if (stage == STAGE_EXPORT_OBJ)
+      export_obj(path, obj, &bench->error);
+    else if (stage == STAGE_EXPORT_PLY)
+      export_ply(path, obj, &bench->error);
+    else
+      export_stl(path, buffer, &bench->error);
+    record(bench, stage, start, start_allocations, round);
+    bench->stages[stage].bytes = file_size(path);
+    if (!bench->error && stage == STAGE_EXPORT_PLY)
+      parse_export(bench, STAGE_PARSE_PLY, path, round);
+    if (!bench->error && stage == STAGE_EXPORT_STL)
+      parse_export(bench, STAGE_PARSE_STL, path, round);
+    remove(path);
+  }
+}
+
+// Keeps the fastest of several rounds, allocation counts do not change.
+static void run_case(const char *path, const char *tmp, BenchCase *bench,
+                     int repeat) {
+  bench->bytes = file_size(path);
+  reset_peak_rss();
+  for (int round = 0; round < repeat && !bench->error; round++) {
+    double start = now();
+    long start_allocations = allocations();
+    Obj *obj = parse_obj(path);
+    record(bench, STAGE_PARSE, start, start_allocations, round);
+    if (obj == NULL) {
+      bench->error = 1;
+      break;
+    }
+    destroy_obj(obj);
+
+    // the vertices and outlines alone, within a fixed budget
+    StreamOptions options = {0, STREAM_BUDGET, NULL, NULL};
+    start = now();
+    start_allocations = allocations();
+    ObjStream *stream = open_obj_stream(path, options, &bench->error);
+    StreamBatch batch;
+    while (stream != NULL && read_obj_stream(stream, &batch, &bench->error)) {
+    }
+    record(bench, STAGE_STREAM, start, start_allocations, round);
+    if (stream != NULL) bench->stream_memory = obj_stream_memory(stream);
+    close_obj_stream(stream);
+    if (bench->error) break;
+
+    start = now();
+    start_allocations = allocations();
+    obj = parse_obj_parallel(path, 0);
+    record(bench, STAGE_PARSE_PARALLEL, start, start_allocations, round);
+    if (obj == NULL) {
+      bench->error = 1;
+      break;
+    }
+    bench->faces = obj->faces->count;
+
+    start = now();
+    start_allocations = allocations();
+    Triangles triangles = triangulate(obj, &bench->error);
+    record(bench, STAGE_TRIANGULATE, start, start_allocations, round);
+
+    VertexBuffer buffer = {0};
+    start = now();
+    start_allocations = allocations();
+    if (!bench->error) buffer = create_vertex_buffer(obj, triangles,
+                                                     &bench->error);
+    record(bench, STAGE_VERTEX_BUFFER, start, start_allocations, round);
+    export_model(bench, obj, &buffer, tmp, round);
+    safe_free(buffer.data);
+
+    Mesh mesh = {0};
+    start = now();
+    start_allocations = allocations();
+    if (!bench->error) mesh = create_mesh(obj, triangles, &bench->error);
+    record(bench, STAGE_MESH, start, start_allocations, round);
+
+    // the vertex kernels against their scalar fallback
+    for (int scalar = 0; scalar < 2 && !bench->error; scalar++) {
+      limit_simd(scalar ? SIMD_SCALAR : SIMD_AVX2);
+      start = now();
+      start_allocations = allocations();
+      Bounds bounds = compute_bounds(mesh.positions, 3, mesh.vertex_count);
+      record(bench, scalar ? STAGE_BOUNDS_SCALAR : STAGE_BOUNDS, start,
+             start_allocations, round);
+      (void)bounds;
+    }
+    limit_simd(SIMD_AVX2);
+
+    // the edges fitted into a full HD image, on every core and on one
+    for (int single = 0; single < 2 && !bench->error; single++)
+      rasterize_mesh(bench, &mesh, single, round);
+    bench->original_cache = mesh.original_cache;
+    bench->optimized_cache = mesh.optimized_cache;
+    destroy_mesh(&mesh);
+
+    // the passes of create_mesh alone, over the triangles in file order
+    int vertex_count = obj->vertices->count;
+    uint32_t *indices = malloc(sizeof(uint32_t) * (triangles.count * 3 + 1));
+    uint32_t *remap = malloc(sizeof(uint32_t) * (vertex_count + 1));
+    if (indices == NULL || remap == NULL) bench->error = 1;
+    for (int i = 0; i < triangles.count * 3 && !bench->error; i++) {
+      int vertex = triangles.triangles[i / 3].vertex_indices[i % 3];
+      indices[i] = vertex > 0 && vertex <= vertex_count ? vertex - 1 : 0;
+    }
+    start = now();
+    start_allocations = allocations();
+    if (!bench->error) {
+      optimize_vertex_cache(&obj->vertices->vertices[0].x, indices,
+                            triangles.count * 3, vertex_count, 0,
+                            &bench->error);
+      optimize_vertex_fetch(indices, triangles.count * 3, vertex_count,
+                            remap);
+    }
+    record(bench, STAGE_OPTIMIZE, start, start_allocations, round);
+    safe_free(indices);
+    safe_free(remap);
+
+    safe_free(triangles.triangles);
+    destroy_obj(obj);
+  }
+  bench->peak_rss_kb = peak_rss_kb();
+}
+
+// A square grid of quads with positions, texture coordinates and one normal.
+static int write_grid(const char *path, long faces) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL) return 0;
+  long side = 1;
+  while (side * side < faces) side++;
+  for (long y = 0; y <= side; y++)
+    for (long x = 0; x <= side; x++)
+      fprintf(file, "v %.4f %.4f %.4f\n", (double)x / side, (double)y / side,
+              (double)((x * 7 + y * 13) % 17) / 170.0);
+  for (long y = 0; y <= side; y++)
+    for (long x = 0; x <= side; x++)
+      fprintf(file, "vt %.4f %.4f\n", (double)x / side, (double)y / side);
+  fprintf(file, "vn 0 0 1\n");
+  for (long i = 0; i < faces; i++) {
+    long x = i % side, y = i / side;
+    long a = y * (side + 1) + x + 1;
+    long b = a + 1, c = a + side + 2, d = a + side + 1;
+    fprintf(file, "f %ld/%ld/1 %ld/%ld/1 %ld/%ld/1 %ld/%ld/1\n", a, a, b, b, c,
+            c, d, d);
+  }
+  return fclose(file) == 0;
+}
+
+static void write_case(FILE *file, const BenchCase *bench) {
+  double megabytes = bench->bytes / (1024.0 * 1024.0);
+  fprintf(file, "{\"name\": \"%s\", \"bytes\": %lld, \"faces\": %d",
+          bench->name, bench->bytes, bench->faces);
+  for (int i = 0; i < STAGE_COUNT; i++) {
+    const StageResult *stage = &bench->stages[i];
+    double seconds = stage->seconds > 0 ? stage->seconds : 1e-9;
+    fprintf(file, ", \"%s_s\": %.6f, \"%s_faces_per_s\": %.0f",
+            stage_names[i], stage->seconds, stage_names[i],
+            bench->faces / seconds);
+    if (i == STAGE_PARSE || i == STAGE_PARSE_PARALLEL || i == STAGE_STREAM)
+      fprintf(file, ", \"%s_mb_per_s\": %.2f", stage_names[i],
+              megabytes / seconds);
+    else if (stage->bytes > 0)
+      fprintf(file, ", \"%s_mb_per_s\": %.2f", stage_names[i],
+              stage->bytes / (1024.0 * 1024.0) / seconds);
+    fprintf(file, ", \"%s_allocations\": %ld", stage_names[i],
+            stage->allocations);
+  }
+  fprintf(file,
+          ", \"acmr\": %.4f, \"acmr_optimized\": %.4f, \"atvr\": %.4f, "
+          "\"atvr_optimized\": %.4f",
+          bench->original_cache.acmr, bench->optimized_cache.acmr,
+          bench->original_cache.atvr, bench->optimized_cache.atvr);
+  fprintf(file, ", \"stream_memory_kb\": %zu", bench->stream_memory / 1024);
+  fprintf(file, ", \"peak_rss_kb\": %ld, \"error\": %d}", bench->peak_rss_kb,
+          bench->error);
+}
+
+// The reports are written one case per line, so the baseline is read by
+// looking the keys up in the line of each case.
+static int json_number(const char *line, const char *key, double *value) {
+  char pattern[MAX_NAME + 8];
+  snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+  const char *found = strstr(line, pattern);
+  if (found == NULL) return 0;
+  *value = strtod(found + strlen(pattern), NULL);
+  return 1;
+}
+
+static int find_baseline(FILE *file, const char *name, char *line) {
+  char pattern[MAX_NAME + 16];
+  snprintf(pattern, sizeof(pattern), "{\"name\": \"%s\",", name);
+  rewind(file);
+  while (fgets(line, MAX_LINE, file) != NULL)
+    if (strstr(line, pattern) != NULL) return 1;
+  return 0;
+}
+
+static int is_regression(const char *name, const char *key, double current,
+                         double baseline, double threshold, double noise) {
+  int regressed = baseline > 0 && current > baseline * (1.0 + threshold) &&
+                  current - baseline > noise;
+  if (regressed)
+    printf("REGRESSION %s %s: %.6g vs baseline %.6g (+%.1f%%)\n", name, key,
+           current, baseline, (current / baseline - 1.0) * 100.0);
+  return regressed;
+}
+
+// Times are compared with the threshold. Allocation counts are exact, so
+// they get no threshold and even one new allocation per run is flagged.
+static int compare_baseline(const BenchCase *cases, int count,
+                            const char *path, double threshold) {
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    printf("No baseline at %s, skipping the comparison\n", path);
+    return 0;
+  }
+  int regressions = 0;
+  char line[MAX_LINE];
+  char key[MAX_NAME];
+  for (int i = 0; i < count; i++) {
+    if (cases[i].error || !find_baseline(file, cases[i].name, line)) continue;
+    for (int j = 0; j < STAGE_COUNT; j++) {
+      double baseline = 0;
+      snprintf(key, sizeof(key), "%s_s", stage_names[j]);
+      if (json_number(line, key, &baseline))
+        regressions += is_regression(cases[i].name, key,
+                                     cases[i].stages[j].seconds, baseline,
+                                     threshold, MIN_REGRESSION_SECONDS);
+      snprintf(key, sizeof(key), "%s_allocations", stage_names[j]);
+      if (json_number(line, key, &baseline))
+        regressions += is_regression(cases[i].name, key,
+                                     cases[i].stages[j].allocations, baseline,
+                                     0, 0);
+    }
+    double baseline = 0;
+    if (json_number(line, "acmr_optimized", &baseline))
+      regressions += is_regression(cases[i].name, "acmr_optimized",
+                                   cases[i].optimized_cache.acmr, baseline,
+                                   threshold, 0);
+  }
+  fclose(file);
+  return regressions;
+}
+
+static int is_obj(const char *name) {
+  size_t length = strlen(name);
+  return length > 4 && strcmp(name + length - 4, ".obj") == 0;
+}
+
+static int compare_names(const void *a, const void *b) {
+  return strcmp(((const BenchCase *)a)->name, ((const BenchCase *)b)->name);
+}
+
+static BenchCase *add_case(BenchCase **cases, int *count, int *capacity) {
+  if (*count == *capacity) {
+    int grown = *capacity > 0 ? *capacity * 2 : 16;
+    BenchCase *resized = realloc(*cases, sizeof(BenchCase) * grown);
+    if (resized == NULL) return NULL;
+    *cases = resized;
+    *capacity = grown;
+  }
+  BenchCase *bench = &(*cases)[(*count)++];
+  memset(bench, 0, sizeof(BenchCase));
+  return bench;
+}
+
+static int collect_models(const char *dir, BenchCase **cases, int *count,
+                          int *capacity) {
+  DIR *models = opendir(dir);
+  if (models == NULL) {
+    printf("Error: Could not open models directory %s\n", dir);
+    return 0;
+  }
+  struct dirent *entry;
+  while ((entry = readdir(models)) != NULL) {
+    if (!is_obj(entry->d_name)) continue;
+    BenchCase *bench = add_case(cases, count, capacity);
+    if (bench == NULL) break;
+    snprintf(bench->name, sizeof(bench->name), "%s", entry->d_name);
+  }
+  closedir(models);
+  qsort(*cases, *count, sizeof(BenchCase), compare_names);
+  return 1;
+}
+
+static void parse_options(int argc, char **argv, BenchOptions *options) {
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "--models") == 0)
+      options->models = argv[i + 1];
+    else if (strcmp(argv[i], "--faces") == 0)
+      options->faces = argv[i + 1];
+    else if (strcmp(argv[i], "--out") == 0)
+      options->out = argv[i + 1];
+    else if (strcmp(argv[i], "--baseline") == 0)
+      options->baseline = argv[i + 1];
+    else if (strcmp(argv[i], "--tmp") == 0)
+      options->tmp = argv[i + 1];
+    else if (strcmp(argv[i], "--threshold") == 0)
+      options->threshold = atof(argv[i + 1]);
+    else if (strcmp(argv[i], "--repeat") == 0)
+      options->repeat = atoi(argv[i + 1]);
+    else
+      printf("Unknown option %s\n", argv[i]);
+  }
+  if (options->repeat < 1) options->repeat = 1;
+}
+
+int main(int argc, char **argv) {
+  BenchOptions options = {"models", "1000000", "bench_report.json", NULL,
+                          ".",      0.10,      3};
+  parse_options(argc, argv, &options);
+
+  BenchCase *cases = NULL;
+  int count = 0, capacity = 0;
+  if (!collect_models(options.models, &cases, &count, &capacity))
+    return EXIT_FAILURE;
+  char path[MAX_LINE];
+  for (int i = 0; i < count; i++) {
+    snprintf(path, sizeof(path), "%s/%s", options.models, cases[i].name);
+    run_case(path, options.tmp, &cases[i], options.repeat);
+    printf("%-28s %8.1f MB/s parse, %8.3f s total, ACMR %.3f -> %.3f\n",
+           cases[i].name,
+           cases[i].bytes / (1024.0 * 1024.0) /
+               (cases[i].stages[STAGE_PARSE].seconds + 1e-9),
+           cases[i].stages[STAGE_PARSE].seconds +
+               cases[i].stages[STAGE_TRIANGULATE].seconds +
+               cases[i].stages[STAGE_VERTEX_BUFFER].seconds,
+           cases[i].original_cache.acmr, cases[i].optimized_cache.acmr);
+  }
+
+  char *faces = (char *)options.faces;
+  while (*faces != '\0') {
+    long face_count = strtol(faces, &faces, 10);
+    if (*faces == ',') faces++;
+    if (face_count <= 0) break;
+    BenchCase *bench = add_case(&cases, &count, &capacity);
+    if (bench == NULL) break;
+    snprintf(bench->name, sizeof(bench->name), "grid_%ld", face_count);
+    snprintf(path, sizeof(path), "%s/bench_grid_%ld.obj", options.tmp,
+             face_count);
+    if (write_grid(path, face_count)) {
+      run_case(path, options.tmp, bench, options.repeat);
+    } else {
+      printf("Error: Could not write %s\n", path);
+      bench->error = 1;
+    }
+    remove(path);
+    printf("%-28s %8.1f MB/s parse, %d faces\n", bench->name,
+           bench->bytes / (1024.0 * 1024.0) /
+               (bench->stages[STAGE_PARSE].seconds + 1e-9),
+           bench->faces);
+  }
+
+  FILE *report = fopen(options.out, "w");
+  if (report == NULL) {
+    printf("Error: Could not write %s\n", options.out);
+    free(cases);
+    return EXIT_FAILURE;
+  }
+  fprintf(report, "[\n");
+  for (int i = 0; i < count; i++) {
+    write_case(report, &cases[i]);
+    fprintf(report, i + 1 < count ? ",\n" : "\n");
+  }
+  fprintf(report, "]\n");
+  fclose(report);
+  printf("Report written to %s\n", options.out);
+
+  int failed = 0;
+  for (int i = 0; i < count; i++) failed |= cases[i].error;
+  if (options.baseline != NULL &&
+      compare_baseline(cases, count, options.baseline, options.threshold) > 0)
+    failed = 1;
+  free(cases);
+  return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,206 @@
+#include "s21_bvh.h"
+
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BVH_MAX_DEPTH 64
+
+typedef struct BvhBuild {
+  const float *bounds;
+  int *order;
+  BvhNode *nodes;
+  int node_count;
+} BvhBuild;
+
+static float centroid(const BvhBuild *build, int primitive, int axis) {
+  const float *bounds = &build->bounds[primitive * 6];
+  return (bounds[axis] + bounds[axis + 3]) * 0.5f;
+}
+
+// Quickselect on order so that position nth holds the median along axis.
+static void select_nth(BvhBuild *build, int first, int count, int nth,
+                       int axis) {
+  int *order = build->order;
+  int low = first, high = first + count - 1;
+  nth += first;
+  while (low < high) {
+    float pivot = centroid(build, order[low + (high - low) / 2], axis);
+    int i = low, j = high;
+    while (i <= j) {
+      while (centroid(build, order[i], axis) < pivot) i++;
+      while (centroid(build, order[j], axis) > pivot) j--;
+      if (i <= j) {
+        int swap = order[i];
+        order[i++] = order[j];
+        order[j--] = swap;
+      }
+    }
+    if (nth <= j)
+      high = j;
+    else if (nth >= i)
+      low = i;
+    else
+      break;
+  }
+}
+
+static int build_node(BvhBuild *build, int first, int count, int depth) {
+  int index = build->node_count++;
+  BvhNode node = {{FLT_MAX, FLT_MAX, FLT_MAX},
+                  {-FLT_MAX, -FLT_MAX, -FLT_MAX},
+                  first,
+                  count,
+                  -1,
+                  -1};
+  float low[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float high[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (int i = first; i < first + count; i++) {
+    const float *bounds = &build->bounds[build->order[i] * 6];
+    for (int axis = 0; axis < 3; axis++) {
+      if (bounds[axis] < node.min[axis]) node.min[axis] = bounds[axis];
+      if (bounds[axis + 3] > node.max[axis])
+        node.max[axis] = bounds[axis + 3];
+      float center = centroid(build, build->order[i], axis);
+      if (center < low[axis]) low[axis] = center;
+      if (center > high[axis]) high[axis] = center;
+    }
+  }
+
+  int axis = 0;
+  for (int i = 1; i < 3; i++)
+    if (high[i] - low[i] > high[axis] - low[axis]) axis = i;
+  // primitives that share one centroid cannot be told apart by a split
+  if (count > BVH_LEAF_SIZE && high[axis] > low[axis] &&
+      depth < BVH_MAX_DEPTH - 1) {
+    int half = count / 2;
+    select_nth(build, first, count, half, axis);
+    node.left = build_node(build, first, half, depth + 1);
+    node.right = build_node(build, first + half, count - half, depth + 1);
+  }
+  build->nodes[index] = node;
+  return index;
+}
+
+Bvh create_bvh(const float *bounds, int count, int *order, int *error) {
+  Bvh bvh = {0};
+  if (count <= 0) return bvh;
+  // a split node holds more than BVH_LEAF_SIZE primitives and halves them,
+  // so every leaf below the root holds at least BVH_LEAF_SIZE / 2
+  int leaves = count / (BVH_LEAF_SIZE / 2) + 1;
+  bvh.nodes = malloc(sizeof(BvhNode) * (2 * leaves - 1));
+  if (bvh.nodes == NULL) {
+    printf("Error: Could not allocate memory for bvh\n");
+    *error = 1;
+    return bvh;
+  }
+  for (int i = 0; i < count; i++) order[i] = i;
+  BvhBuild build = {bounds, order, bvh.nodes, 0};
+  build_node(&build, 0, count, 0);
+  bvh.node_count = build.node_count;
+  return bvh;
+}
+
+void destroy_bvh(Bvh *bvh) {
+  if (bvh->nodes != NULL) free(bvh->nodes);
+  bvh->nodes = NULL;
+  bvh->node_count = 0;
+}
+
+int bvh_range_capacity(const Bvh *bvh) { return (bvh->node_count + 1) / 2; }
+
+typedef enum Visibility { OUTSIDE, INTERSECTS, INSIDE } Visibility;
+
+// Planes a * x + b * y + c * z + d >= 0 of the clip volume, taken from the
+// rows of the matrix (Gribb and Hartmann).
+static void frustum_planes(const float *mvp, float planes[6][4]) {
+  for (int i = 0; i < 3; i++) {
+    for (int j = 0; j < 4; j++) {
+      float row = mvp[j * 4 + i];
+      float w = mvp[j * 4 + 3];
+      planes[i * 2][j] = w + row;
+      planes[i * 2 + 1][j] = w - row;
+    }
+  }
+}
+
+static Visibility classify(const BvhNode *node, float planes[6][4]) {
+  Visibility visibility = INSIDE;
+  for (int i = 0; i < 6; i++) {
+    const float *plane = planes[i];
+    // the corners farthest along and against the plane normal
+    float farthest = plane[3], nearest = plane[3];
+    for (int axis = 0; axis < 3; axis++) {
+      float low = plane[axis] * node->min[axis];
+      float high = plane[axis] * node->max[axis];
+      farthest += low > high ? low : high;
+      nearest += low < high ? low : high;
+    }
+    if (farthest < 0) return OUTSIDE;
+    if (nearest < 0) visibility = INTERSECTS;
+  }
+  return visibility;
+}
+
+// A full range list extends its last range, which only draws more.
+static int add_range(BvhRange *ranges, int count, int capacity,
+                     const BvhNode *node) {
+  BvhRange *last = count > 0 ? &ranges[count - 1] : NULL;
+  if (last != NULL &&
+      (last->first + last->count == node->first || count == capacity)) {
+    if (node->first + node->count > last->first + last->count)
+      last->count = node->first + node->count - last->first;
+    return count;
+  }
+  ranges[count].first = node->first;
+  ranges[count].count = node->count;
+  return count + 1;
+}
+
+int cull_bvh(const Bvh *bvh, const float *mvp, BvhRange *ranges,
+             int capacity) {
+  if (bvh->node_count == 0 || capacity <= 0) return 0;
+  float planes[6][4];
+  frustum_planes(mvp, planes);
+
+  // the right child is pushed first so ranges come out in order and merge
+  int stack[BVH_MAX_DEPTH + 1];
+  int top = 0, count = 0;
+  stack[top++] = 0;
+  while (top > 0) {
+    const BvhNode *node = &bvh->nodes[stack[--top]];
+    Visibility visibility = classify(node, planes);
+    if (visibility == OUTSIDE) continue;
+    if (visibility == INSIDE || node->left < 0 || top + 2 > BVH_MAX_DEPTH) {
+      count = add_range(ranges, count, capacity, node);
+    } else {
+      stack[top++] = node->right;
+      stack[top++] = node->left;
+    }
+  }
+  return count;
+}
+
+int is_valid_bvh(const Bvh *bvh, int count) {
+  int valid = bvh->node_count == 0 ? count == 0
+                                   : bvh->nodes[0].first == 0 &&
+                                         bvh->nodes[0].count == count;
+  for (int i = 0; valid && i < bvh->node_count; i++) {
+    const BvhNode *node = &bvh->nodes[i];
+    valid = node->first >= 0 && node->count >= 0 &&
+            node->first <= count - node->count &&
+            (node->left < 0) == (node->right < 0);
+    if (valid && node->left >= 0)
+      valid = node->left > i && node->right > i &&
+              node->left < bvh->node_count && node->right < bvh->node_count;
+    if (valid && node->left >= 0) {
+      const BvhNode *left = &bvh->nodes[node->left];
+      const BvhNode *right = &bvh->nodes[node->right];
+      valid = left->count > 0 && right->count > 0 &&
+              left->first == node->first &&
+              right->first == left->first + left->count &&
+              right->first + right->count == node->first + node->count;
+    }
+  }
+  return valid;
+}
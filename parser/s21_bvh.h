@@ -0,0 +1,67 @@
+#ifndef INC_3DT_BVH_H
+#define INC_3DT_BVH_H
+
+/// Primitives per leaf, a leaf is the unit that is culled.
+#define BVH_LEAF_SIZE 512
+
+/// A node of a bounding volume hierarchy. The primitives of every subtree
+/// are contiguous, so a node covers the primitives from first to
+/// first + count whether it is a leaf or not.
+typedef struct BvhNode {
+    float min[3];
+    float max[3];
+    int first;
+    int count;
+    int left;
+    int right;
+} BvhNode;
+
+/// Nodes in depth-first order, children always come after their parent.
+typedef struct Bvh {
+    BvhNode *nodes;
+    int node_count;
+} Bvh;
+
+/// A run of primitives to draw.
+typedef struct BvhRange {
+    int first;
+    int count;
+} BvhRange;
+
+/// \brief Build a hierarchy by splitting at the median of the longest axis.
+/// \param bounds The min x, y, z and max x, y, z of every primitive.
+/// \param count The number of primitives.
+/// \param order Filled with the primitive to store at every position, the
+/// primitives have to be reordered by it for the node ranges to hold.
+/// \param error The error code.
+/// \return The hierarchy, without nodes when there are no primitives.
+Bvh create_bvh(const float *bounds, int count, int *order, int *error);
+
+/// \brief Free the nodes of a hierarchy and reset it.
+/// \param bvh The hierarchy to destroy.
+void destroy_bvh(Bvh *bvh);
+
+/// \brief The most ranges cull_bvh can return for a hierarchy.
+/// \param bvh The hierarchy.
+/// \return The number of leaves bound.
+int bvh_range_capacity(const Bvh *bvh);
+
+/// \brief Find the primitives whose nodes intersect the view frustum.
+/// Adjacent visible nodes are merged into one range, ranges come out in
+/// ascending order.
+/// \param bvh The hierarchy.
+/// \param mvp The column-major model-view-projection matrix.
+/// \param ranges The ranges to fill.
+/// \param capacity The number of ranges, bvh_range_capacity is always enough
+/// for a hierarchy built by create_bvh. With fewer the last range grows.
+/// \return The number of ranges.
+int cull_bvh(const Bvh *bvh, const float *mvp, BvhRange *ranges,
+             int capacity);
+
+/// \brief Check that the nodes form a tree over count primitives.
+/// \param bvh The hierarchy.
+/// \param count The number of primitives.
+/// \return 1 if the hierarchy is valid, 0 otherwise.
+int is_valid_bvh(const Bvh *bvh, int count);
+
+#endif //INC_3DT_BVH_H
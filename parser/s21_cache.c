@@ -0,0 +1,286 @@
+#define _POSIX_C_SOURCE 200809L
+// st_mtimespec is only declared for Darwin extensions
+#define _DARWIN_C_SOURCE
+
+#include "s21_cache.h"
+
+#include <inttypes.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#define CACHE_MAGIC "S21MESH"
+#define CACHE_PATH_SIZE 4096
+
+// The model path follows the header, padded to 8 bytes, then the vertex
+// streams, indices, edges, points, edge nodes and point nodes of the mesh
+// and the edges and nodes of every level of detail in native byte order.
+typedef struct CacheHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t path_size;
+  int64_t model_size;
+  int64_t model_mtime;
+  int64_t model_mtime_nsec;
+  int32_t vertex_count;
+  int32_t has_position_w;
+  int32_t has_texture_w;
+  int32_t index_count;
+  int32_t edge_count;
+  int32_t point_count;
+  int32_t edge_node_count;
+  int32_t point_node_count;
+  int32_t lod_count;
+  int32_t lod_edge_count[MESH_LOD_LEVELS];
+  int32_t lod_node_count[MESH_LOD_LEVELS];
+  CacheStats original_cache;
+  CacheStats optimized_cache;
+} CacheHeader;
+
+static uint64_t hash_path(const char *path) {
+  uint64_t hash = 14695981039346656037ULL;
+  for (const unsigned char *c = (const unsigned char *)path; *c; c++) {
+    hash ^= *c;
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+static size_t padded(size_t size) { return (size + 7) & ~(size_t)7; }
+
+// Whole seconds miss an edit that keeps the size within the same second.
+static int64_t mtime_nsec(const struct stat *st) {
+#if defined(_WIN32)
+  (void)st;
+  return 0;
+#elif defined(__APPLE__)
+  return st->st_mtimespec.tv_nsec;
+#else
+  return st->st_mtim.tv_nsec;
+#endif
+}
+
+static int stat_model(const char *model_path, CacheHeader *header) {
+  struct stat st;
+  if (stat(model_path, &st) != 0) return 0;
+  memcpy(header->magic, CACHE_MAGIC, sizeof(header->magic));
+  header->version = PARSER_VERSION;
+  header->path_size = strlen(model_path);
+  header->model_size = st.st_size;
+  header->model_mtime = st.st_mtime;
+  header->model_mtime_nsec = mtime_nsec(&st);
+  return 1;
+}
+
+// The floats per vertex of all streams.
+static size_t vertex_floats(const CacheHeader *header) {
+  return MESH_VERTEX_FLOATS + (header->has_position_w != 0) +
+         (header->has_texture_w != 0);
+}
+
+static size_t cache_size(const CacheHeader *header) {
+  size_t size = sizeof(CacheHeader) + padded(header->path_size) +
+                sizeof(float) * vertex_floats(header) *
+                    (size_t)header->vertex_count +
+                sizeof(uint32_t) * (size_t)header->index_count +
+                sizeof(uint32_t) * 2 * (size_t)header->edge_count +
+                sizeof(float) * 3 * (size_t)header->point_count +
+                sizeof(BvhNode) * (size_t)header->edge_node_count +
+                sizeof(BvhNode) * (size_t)header->point_node_count;
+  for (int i = 0; i < header->lod_count; i++)
+    size += sizeof(uint32_t) * 2 * (size_t)header->lod_edge_count[i] +
+            sizeof(BvhNode) * (size_t)header->lod_node_count[i];
+  return size;
+}
+
+static int has_valid_counts(const CacheHeader *header) {
+  int valid = header->vertex_count >= 0 && header->index_count >= 0 &&
+              header->edge_count >= 0 && header->point_count >= 0 &&
+              header->edge_node_count >= 0 &&
+              header->point_node_count >= 0 && header->lod_count >= 0 &&
+              header->lod_count <= MESH_LOD_LEVELS;
+  for (int i = 0; valid && i < header->lod_count; i++)
+    valid = header->lod_edge_count[i] >= 0 && header->lod_node_count[i] >= 0;
+  return valid;
+}
+
+static int has_valid_indices(const uint32_t *indices, int count,
+                             int vertex_count) {
+  for (int i = 0; i < count; i++)
+    if (indices[i] >= (uint32_t)vertex_count) return 0;
+  return 1;
+}
+
+int mesh_cache_path(const char *cache_dir, const char *model_path, char *out,
+                    size_t out_size) {
+  int written = snprintf(out, out_size, "%s/%016" PRIx64 ".mesh", cache_dir,
+                         hash_path(model_path));
+  return written >= 0 && (size_t)written < out_size;
+}
+
+int load_mesh_cache(const char *cache_dir, const char *model_path,
+                    Mesh *mesh) {
+  char path[CACHE_PATH_SIZE];
+  CacheHeader expected = {0};
+  struct stat st;
+  if (!mesh_cache_path(cache_dir, model_path, path, sizeof(path)) ||
+      !stat_model(model_path, &expected) || stat(path, &st) != 0 ||
+      (size_t)st.st_size < sizeof(CacheHeader))
+    return 0;
+
+  int error = 0;
+  FileMapping mapping = map_file(path, &error);
+  const CacheHeader *header = (const CacheHeader *)mapping.data;
+  int hit = !error && mapping.size >= sizeof(CacheHeader) &&
+            memcmp(header, &expected, offsetof(CacheHeader, vertex_count)) ==
+                0 &&
+            has_valid_counts(header) && mapping.size == cache_size(header) &&
+            memcmp(mapping.data + sizeof(CacheHeader), model_path,
+                   header->path_size) == 0;
+
+  if (hit) {
+    char *data = (char *)mapping.data + sizeof(CacheHeader) +
+                 padded(header->path_size);
+    float **streams[] = {&mesh->positions, &mesh->normals, &mesh->textures,
+                         &mesh->position_w, &mesh->texture_w};
+    const int widths[] = {3, 3, 2, header->has_position_w != 0,
+                          header->has_texture_w != 0};
+    for (int i = 0; i < 5; i++) {
+      *streams[i] = widths[i] > 0 ? (float *)data : NULL;
+      data += sizeof(float) * widths[i] * header->vertex_count;
+    }
+    mesh->indices = (uint32_t *)data;
+    data += sizeof(uint32_t) * header->index_count;
+    mesh->edges = (uint32_t *)data;
+    data += sizeof(uint32_t) * 2 * header->edge_count;
+    mesh->points = (float *)data;
+    data += sizeof(float) * 3 * header->point_count;
+    mesh->edge_bvh.nodes = (BvhNode *)data;
+    data += sizeof(BvhNode) * header->edge_node_count;
+    mesh->point_bvh.nodes = (BvhNode *)data;
+    data += sizeof(BvhNode) * header->point_node_count;
+    for (int i = 0; i < header->lod_count; i++) {
+      MeshLod *lod = &mesh->lods[i];
+      lod->edges = (uint32_t *)data;
+      data += sizeof(uint32_t) * 2 * header->lod_edge_count[i];
+      lod->bvh.nodes = (BvhNode *)data;
+      data += sizeof(BvhNode) * header->lod_node_count[i];
+      lod->edge_count = header->lod_edge_count[i];
+      lod->bvh.node_count = header->lod_node_count[i];
+    }
+    mesh->lod_count = header->lod_count;
+    mesh->original_cache = header->original_cache;
+    mesh->optimized_cache = header->optimized_cache;
+    mesh->edge_bvh.node_count = header->edge_node_count;
+    mesh->point_bvh.node_count = header->point_node_count;
+    mesh->vertex_count = header->vertex_count;
+    mesh->index_count = header->index_count;
+    mesh->edge_count = header->edge_count;
+    mesh->point_count = header->point_count;
+    mesh->mapping = mapping;
+    // a damaged entry must not send out of range indices to the renderer
+    hit = has_valid_indices(mesh->indices, mesh->index_count,
+                            mesh->vertex_count) &&
+          has_valid_indices(mesh->edges, mesh->edge_count * 2,
+                            mesh->vertex_count) &&
+          is_valid_bvh(&mesh->edge_bvh, mesh->edge_count) &&
+          is_valid_bvh(&mesh->point_bvh, mesh->point_count);
+    for (int i = 0; hit && i < mesh->lod_count; i++)
+      hit = has_valid_indices(mesh->lods[i].edges, mesh->lods[i].edge_count * 2,
+                              mesh->vertex_count) &&
+            is_valid_bvh(&mesh->lods[i].bvh, mesh->lods[i].edge_count);
+    if (!hit) destroy_mesh(mesh);
+  } else {
+    unmap_file(&mapping);
+  }
+  return hit;
+}
+
+static void write_records(FILE *file, const void *records, size_t count,
+                          size_t size, int *error) {
+  if (!*error && count > 0 && fwrite(records, size, count, file) != count)
+    *error = 1;
+}
+
+void save_mesh_cache(const char *cache_dir, const char *model_path,
+                     const Mesh *mesh, int *error) {
+  char path[CACHE_PATH_SIZE];
+  char temp[CACHE_PATH_SIZE + 32];
+  CacheHeader header = {0};
+  if (!mesh_cache_path(cache_dir, model_path, path, sizeof(path)) ||
+      !stat_model(model_path, &header)) {
+    printf("Error: Could not build the cache path of %s\n", model_path);
+    *error = 1;
+    return;
+  }
+  header.vertex_count = mesh->vertex_count;
+  header.has_position_w = mesh->position_w != NULL;
+  header.has_texture_w = mesh->texture_w != NULL;
+  header.index_count = mesh->index_count;
+  header.edge_count = mesh->edge_count;
+  header.point_count = mesh->point_count;
+  header.edge_node_count = mesh->edge_bvh.node_count;
+  header.point_node_count = mesh->point_bvh.node_count;
+  header.lod_count = mesh->lod_count;
+  header.original_cache = mesh->original_cache;
+  header.optimized_cache = mesh->optimized_cache;
+  for (int i = 0; i < mesh->lod_count; i++) {
+    header.lod_edge_count[i] = mesh->lods[i].edge_count;
+    header.lod_node_count[i] = mesh->lods[i].bvh.node_count;
+  }
+  // another viewer may be writing the cache of the same model
+  snprintf(temp, sizeof(temp), "%s.%ld.tmp", path, (long)getpid());
+
+  FILE *file = fopen(temp, "wb");
+  if (file == NULL) {
+    printf("Error: Could not create cache file %s\n", temp);
+    *error = 1;
+    return;
+  }
+  const char padding[8] = {0};
+  write_records(file, &header, 1, sizeof(header), error);
+  write_records(file, model_path, header.path_size, 1, error);
+  write_records(file, padding, padded(header.path_size) - header.path_size, 1,
+                error);
+  write_records(file, mesh->positions, mesh->vertex_count * 3, sizeof(float),
+                error);
+  write_records(file, mesh->normals, mesh->vertex_count * 3, sizeof(float),
+                error);
+  write_records(file, mesh->textures, mesh->vertex_count * 2, sizeof(float),
+                error);
+  if (mesh->position_w != NULL)
+    write_records(file, mesh->position_w, mesh->vertex_count, sizeof(float),
+                  error);
+  if (mesh->texture_w != NULL)
+    write_records(file, mesh->texture_w, mesh->vertex_count, sizeof(float),
+                  error);
+  write_records(file, mesh->indices, mesh->index_count, sizeof(uint32_t),
+                error);
+  write_records(file, mesh->edges, mesh->edge_count * 2, sizeof(uint32_t),
+                error);
+  write_records(file, mesh->points, mesh->point_count * 3, sizeof(float),
+                error);
+  write_records(file, mesh->edge_bvh.nodes, mesh->edge_bvh.node_count,
+                sizeof(BvhNode), error);
+  write_records(file, mesh->point_bvh.nodes, mesh->point_bvh.node_count,
+                sizeof(BvhNode), error);
+  for (int i = 0; i < mesh->lod_count; i++) {
+    write_records(file, mesh->lods[i].edges, mesh->lods[i].edge_count * 2,
+                  sizeof(uint32_t), error);
+    write_records(file, mesh->lods[i].bvh.nodes, mesh->lods[i].bvh.node_count,
+                  sizeof(BvhNode), error);
+  }
+  if (fclose(file) != 0) *error = 1;
+#ifdef _WIN32
+  if (!*error) remove(path);
+#endif
+  if (!*error && rename(temp, path) != 0) *error = 1;
+  if (*error) {
+    printf("Error: Could not write cache file %s\n", path);
+    remove(temp);
+  }
+}
@@ -0,0 +1,42 @@
+#ifndef INC_3DT_CACHE_H
+#define INC_3DT_CACHE_H
+
+#include "s21_mesh.h"
+
+/// Bump whenever the parser or create_mesh change their output or the cache
+/// header changes, so meshes cached by an older build are rebuilt.
+#define PARSER_VERSION 8
+
+/// \brief Build the name of the cache file of a model.
+/// The name is a hash of the model path, the file itself records the model
+/// size, mtime and parser version it was built from.
+/// \param cache_dir The cache directory.
+/// \param model_path The path of the model file.
+/// \param out The buffer for the name.
+/// \param out_size The size of the buffer.
+/// \return 1 if the name fits into the buffer, 0 otherwise.
+int mesh_cache_path(const char *cache_dir, const char *model_path, char *out,
+                    size_t out_size);
+
+/// \brief Map the cached mesh of a model.
+/// A cache built from another version of the model or by another parser
+/// version is ignored. The arrays of a loaded mesh point into the mapping
+/// and are read only, destroy_mesh unmaps them.
+/// \param cache_dir The cache directory.
+/// \param model_path The path of the model file.
+/// \param mesh The mesh to fill on a hit.
+/// \return 1 on a hit, 0 if there is no valid cache entry.
+int load_mesh_cache(const char *cache_dir, const char *model_path,
+                    Mesh *mesh);
+
+/// \brief Write the mesh of a model to the cache.
+/// The file is written next to its final name and renamed, so readers never
+/// see a partial entry.
+/// \param cache_dir The cache directory, it has to exist.
+/// \param model_path The path of the model file.
+/// \param mesh The mesh to store.
+/// \param error The error code.
+void save_mesh_cache(const char *cache_dir, const char *model_path,
+                     const Mesh *mesh, int *error);
+
+#endif //INC_3DT_CACHE_H
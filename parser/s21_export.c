@@ -0,0 +1,305 @@
+#include "s21_export.h"
+
+#include <math.h>
+#include <stdint.h>
+
+#include "s21_number.h"
+
+// The most bytes one record is formatted into at once, like a tag and four
+// floats, one face corner or the stl header.
+#define RECORD_MAX 128
+#define STL_HEADER_SIZE 80
+#define PLY_UCHAR_MAX 255
+
+// Records are formatted straight into one large buffer that is handed to
+// the unbuffered file whenever the next record might not fit, so the file
+// sees few large sequential writes.
+typedef struct Writer {
+  FILE *file;
+  char *buffer;
+  size_t used;
+  int failed;
+} Writer;
+
+static int open_writer(Writer *writer, const char *filename, int *error) {
+  writer->file = fopen(filename, "wb");
+  writer->buffer = malloc(EXPORT_BUFFER_SIZE);
+  writer->used = 0;
+  writer->failed = 0;
+  if (writer->file == NULL || writer->buffer == NULL) {
+    printf("Error: Could not create file %s\n", filename);
+    if (writer->file != NULL) fclose(writer->file);
+    safe_free(writer->buffer);
+    *error = 1;
+    return 0;
+  }
+  setvbuf(writer->file, NULL, _IONBF, 0);
+  return 1;
+}
+
+static void flush_writer(Writer *writer) {
+  if (!writer->failed && writer->used > 0 &&
+      fwrite(writer->buffer, 1, writer->used, writer->file) != writer->used)
+    writer->failed = 1;
+  writer->used = 0;
+}
+
+// Room for at least RECORD_MAX bytes, finished with commit.
+static char *reserve(Writer *writer) {
+  if (EXPORT_BUFFER_SIZE - writer->used < RECORD_MAX) flush_writer(writer);
+  return writer->buffer + writer->used;
+}
+
+static void commit(Writer *writer, const char *end) {
+  writer->used = end - writer->buffer;
+}
+
+// A partial file is removed, so a failed export leaves nothing behind.
+static void close_writer(Writer *writer, const char *filename, int *error) {
+  flush_writer(writer);
+  if (fclose(writer->file) != 0) writer->failed = 1;
+  safe_free(writer->buffer);
+  if (writer->failed) {
+    printf("Error: Could not write file %s\n", filename);
+    remove(filename);
+    *error = 1;
+  }
+}
+
+static void write_text(Writer *writer, const char *text) {
+  for (size_t length = strlen(text); length > 0;) {
+    size_t part = length < RECORD_MAX ? length : RECORD_MAX;
+    char *out = reserve(writer);
+    memcpy(out, text, part);
+    commit(writer, out + part);
+    text += part;
+    length -= part;
+  }
+}
+
+static void write_count(Writer *writer, const char *prefix, int count) {
+  write_text(writer, prefix);
+  char *out = format_int(count, reserve(writer));
+  *out++ = '\n';
+  commit(writer, out);
+}
+
+static char *put_float(char *out, float value) {
+  *out++ = ' ';
+  return format_float(value, out);
+}
+
+static char *put_corner(char *out, int vertex, int texture, int normal) {
+  *out++ = ' ';
+  out = format_int(vertex, out);
+  if (texture != 0 || normal != 0) {
+    *out++ = '/';
+    if (texture != 0) out = format_int(texture, out);
+    if (normal != 0) {
+      *out++ = '/';
+      out = format_int(normal, out);
+    }
+  }
+  return out;
+}
+
+static char *put_u16(char *out, uint16_t value) {
+  out[0] = (char)(value & 0xFF);
+  out[1] = (char)(value >> 8);
+  return out + 2;
+}
+
+static char *put_u32(char *out, uint32_t value) {
+  out[0] = (char)(value & 0xFF);
+  out[1] = (char)(value >> 8 & 0xFF);
+  out[2] = (char)(value >> 16 & 0xFF);
+  out[3] = (char)(value >> 24);
+  return out + 4;
+}
+
+static char *put_f32(char *out, float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return put_u32(out, bits);
+}
+
+static char *put_position(char *out, const Vertex *vertex) {
+  out = put_f32(out, vertex->x);
+  out = put_f32(out, vertex->y);
+  return put_f32(out, vertex->z);
+}
+
+static void write_vertex(Writer *writer, const Vertex *vertex) {
+  char *out = reserve(writer);
+  *out++ = 'v';
+  out = put_float(out, vertex->x);
+  out = put_float(out, vertex->y);
+  out = put_float(out, vertex->z);
+  if (vertex->w != 1.0f) out = put_float(out, vertex->w);
+  *out++ = '\n';
+  commit(writer, out);
+}
+
+static void write_texture(Writer *writer, const Texture *texture) {
+  char *out = reserve(writer);
+  *out++ = 'v';
+  *out++ = 't';
+  out = put_float(out, texture->u);
+  out = put_float(out, texture->v);
+  if (texture->w != 0.0f || signbit(texture->w))
+    out = put_float(out, texture->w);
+  *out++ = '\n';
+  commit(writer, out);
+}
+
+static void write_normal(Writer *writer, const Normal *normal) {
+  char *out = reserve(writer);
+  *out++ = 'v';
+  *out++ = 'n';
+  out = put_float(out, normal->x);
+  out = put_float(out, normal->y);
+  out = put_float(out, normal->z);
+  *out++ = '\n';
+  commit(writer, out);
+}
+
+void export_obj(const char *filename, const Obj *obj, int *error) {
+  Writer writer;
+  if (!open_writer(&writer, filename, error)) return;
+  const Vertices *vertices = obj->vertices;
+  const Textures *textures = obj->textures;
+  const Normals *normals = obj->normals;
+  const Faces *faces = obj->faces;
+  for (int i = 0; i < vertices->count && !writer.failed; i++)
+    write_vertex(&writer, &vertices->vertices[i]);
+  for (int i = 0; i < textures->count && !writer.failed; i++)
+    write_texture(&writer, &textures->textures[i]);
+  for (int i = 0; i < normals->count && !writer.failed; i++)
+    write_normal(&writer, &normals->normals[i]);
+  for (int i = 0; i < faces->count && !writer.failed; i++) {
+    char *out = reserve(&writer);
+    *out++ = 'f';
+    commit(&writer, out);
+    for (int j = faces->offsets[i]; j < faces->offsets[i + 1]; j++) {
+      out = put_corner(reserve(&writer), faces->vertex_indices[j],
+                       faces->texture_indices[j], faces->normal_indices[j]);
+      commit(&writer, out);
+    }
+    out = reserve(&writer);
+    *out++ = '\n';
+    commit(&writer, out);
+  }
+  close_writer(&writer, filename, error);
+}
+
+void export_obj_buffer(const char *filename, const VertexBuffer *buffer,
+                       int *error) {
+  Writer writer;
+  if (!open_writer(&writer, filename, error)) return;
+  for (int i = 0; i < buffer->count && !writer.failed; i++) {
+    write_vertex(&writer, &buffer->data[i].position);
+    write_texture(&writer, &buffer->data[i].texture);
+    write_normal(&writer, &buffer->data[i].normal);
+  }
+  for (int i = 0; i + 2 < buffer->count && !writer.failed; i += 3) {
+    char *out = reserve(&writer);
+    *out++ = 'f';
+    commit(&writer, out);
+    for (int j = i + 1; j <= i + 3; j++) {
+      out = put_corner(reserve(&writer), j, j, j);
+      commit(&writer, out);
+    }
+    out = reserve(&writer);
+    *out++ = '\n';
+    commit(&writer, out);
+  }
+  close_writer(&writer, filename, error);
+}
+
+void export_ply(const char *filename, const Obj *obj, int *error) {
+  const Vertices *vertices = obj->vertices;
+  const Faces *faces = obj->faces;
+  int wide_counts = 0;
+  for (int i = 0; i < faces->count && !wide_counts; i++)
+    wide_counts = faces->offsets[i + 1] - faces->offsets[i] > PLY_UCHAR_MAX;
+  // ply has no missing corner, an index past the vertex element would be
+  // rejected by other readers
+  for (int j = 0; j < faces->index_count; j++) {
+    if (faces->vertex_indices[j] < 1 ||
+        faces->vertex_indices[j] > vertices->count) {
+      printf("Error: Face corner %d refers to no vertex, %s not written\n",
+             j, filename);
+      *error = 1;
+      return;
+    }
+  }
+
+  Writer writer;
+  if (!open_writer(&writer, filename, error)) return;
+  write_text(&writer, "ply\nformat binary_little_endian 1.0\n");
+  write_count(&writer, "element vertex ", vertices->count);
+  write_text(&writer, "property float x\nproperty float y\n"
+                      "property float z\n");
+  write_count(&writer, "element face ", faces->count);
+  write_text(&writer, wide_counts ? "property list int int vertex_indices\n"
+                                  : "property list uchar int vertex_indices\n");
+  write_text(&writer, "end_header\n");
+  for (int i = 0; i < vertices->count && !writer.failed; i++)
+    commit(&writer, put_position(reserve(&writer), &vertices->vertices[i]));
+  for (int i = 0; i < faces->count && !writer.failed; i++) {
+    int first = faces->offsets[i], count = faces->offsets[i + 1] - first;
+    char *out = reserve(&writer);
+    if (wide_counts)
+      out = put_u32(out, (uint32_t)count);
+    else
+      *out++ = (char)count;
+    commit(&writer, out);
+    for (int j = first; j < first + count; j++)
+      commit(&writer, put_u32(reserve(&writer),
+                              (uint32_t)(faces->vertex_indices[j] - 1)));
+  }
+  close_writer(&writer, filename, error);
+}
+
+static Normal facet_normal(const Vertex *a, const Vertex *b,
+                           const Vertex *c) {
+  float ux = b->x - a->x, uy = b->y - a->y, uz = b->z - a->z;
+  float vx = c->x - a->x, vy = c->y - a->y, vz = c->z - a->z;
+  Normal normal = {uy * vz - uz * vy, uz * vx - ux * vz, ux * vy - uy * vx};
+  float length = sqrtf(normal.x * normal.x + normal.y * normal.y +
+                       normal.z * normal.z);
+  if (length > 0.0f && isfinite(length)) {
+    normal.x /= length;
+    normal.y /= length;
+    normal.z /= length;
+  } else {
+    normal.x = normal.y = normal.z = 0.0f;
+  }
+  return normal;
+}
+
+void export_stl(const char *filename, const VertexBuffer *buffer, int *error) {
+  Writer writer;
+  if (!open_writer(&writer, filename, error)) return;
+  // the header must not start with "solid", readers take that for text
+  char *out = reserve(&writer);
+  memset(out, 0, STL_HEADER_SIZE);
+  memcpy(out, "binary stl", strlen("binary stl"));
+  out = put_u32(out + STL_HEADER_SIZE, (uint32_t)(buffer->count / 3));
+  commit(&writer, out);
+  for (int i = 0; i + 2 < buffer->count && !writer.failed; i += 3) {
+    const Vertex *a = &buffer->data[i].position;
+    const Vertex *b = &buffer->data[i + 1].position;
+    const Vertex *c = &buffer->data[i + 2].position;
+    Normal normal = facet_normal(a, b, c);
+    out = reserve(&writer);
+    out = put_f32(out, normal.x);
+    out = put_f32(out, normal.y);
+    out = put_f32(out, normal.z);
+    out = put_position(out, a);
+    out = put_position(out, b);
+    out = put_position(out, c);
+    commit(&writer, put_u16(out, 0));
+  }
+  close_writer(&writer, filename, error);
+}
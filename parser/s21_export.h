@@ -0,0 +1,46 @@
+#ifndef INC_3DT_EXPORT_H
+#define INC_3DT_EXPORT_H
+
+#include "s21_parser.h"
+
+/// The size of the buffer the exporters fill before each write.
+#define EXPORT_BUFFER_SIZE (4 << 20)
+
+/// \brief Write an obj file with the vertices, textures, normals and faces
+/// of an obj struct.
+/// Floats are written as the shortest decimals that parse back to the same
+/// bits, so parsing the file gives the same obj. The w of a vertex is only
+/// written when it is not 1, the w of a texture only when it is not 0.
+/// \param filename The file to write.
+/// \param obj The obj struct to export.
+/// \param error The error code.
+void export_obj(const char *filename, const Obj *obj, int *error);
+
+/// \brief Write an obj file with the triangles of a vertex buffer.
+/// Every vertex gets its own v, vt and vn record and every three vertices
+/// form a face.
+/// \param filename The file to write.
+/// \param buffer The vertex buffer to export.
+/// \param error The error code.
+void export_obj_buffer(const char *filename, const VertexBuffer *buffer,
+                       int *error);
+
+/// \brief Write a binary little endian ply file with the vertex positions
+/// and faces of an obj struct.
+/// The face lists count their corners in an uchar, or in an int when a face
+/// has more than 255 corners. A corner without a vertex in the obj struct
+/// is an error and no file is written.
+/// \param filename The file to write.
+/// \param obj The obj struct to export.
+/// \param error The error code.
+void export_ply(const char *filename, const Obj *obj, int *error);
+
+/// \brief Write a binary stl file with the triangles of a vertex buffer.
+/// The facet normals are computed from the positions, vertices after the
+/// last whole triangle are left out.
+/// \param filename The file to write.
+/// \param buffer The vertex buffer to export.
+/// \param error The error code.
+void export_stl(const char *filename, const VertexBuffer *buffer, int *error);
+
+#endif //INC_3DT_EXPORT_H
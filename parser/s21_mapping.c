@@ -0,0 +1,77 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "s21_mapping.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifndef _WIN32
+FileMapping map_file(const char *filename, int *error) {
+  FileMapping mapping = {0};
+  int fd = open(filename, O_RDONLY);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    printf("Error: Could not open file %s\n", filename);
+    *error = 1;
+  }
+  if (!*error && st.st_size > 0) {
+    void *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data == MAP_FAILED) {
+      printf("Error: Could not map file %s\n", filename);
+      *error = 1;
+    } else {
+      posix_madvise(data, st.st_size, POSIX_MADV_SEQUENTIAL);
+      mapping.data = data;
+      mapping.size = st.st_size;
+      mapping.mapped = 1;
+    }
+  }
+  if (fd >= 0) close(fd);
+  return mapping;
+}
+
+void unmap_file(FileMapping *mapping) {
+  if (mapping->mapped) munmap((void *)mapping->data, mapping->size);
+  mapping->data = NULL;
+  mapping->size = 0;
+  mapping->mapped = 0;
+}
+#else
+FileMapping map_file(const char *filename, int *error) {
+  FileMapping mapping = {0};
+  FILE *file = fopen(filename, "rb");
+  long size = 0;
+  if (file == NULL || fseek(file, 0, SEEK_END) != 0 ||
+      (size = ftell(file)) < 0 || fseek(file, 0, SEEK_SET) != 0) {
+    printf("Error: Could not open file %s\n", filename);
+    *error = 1;
+  }
+  if (!*error && size > 0) {
+    char *data = malloc(size);
+    if (data == NULL || fread(data, 1, size, file) != (size_t)size) {
+      printf("Error: Could not read file %s\n", filename);
+      free(data);
+      *error = 1;
+    } else {
+      mapping.data = data;
+      mapping.size = size;
+    }
+  }
+  if (file != NULL) fclose(file);
+  return mapping;
+}
+
+void unmap_file(FileMapping *mapping) {
+  free((void *)mapping->data);
+  mapping->data = NULL;
+  mapping->size = 0;
+  mapping->mapped = 0;
+}
+#endif
@@ -0,0 +1,23 @@
+#ifndef INC_3DT_MAPPING_H
+#define INC_3DT_MAPPING_H
+
+#include <stddef.h>
+
+typedef struct FileMapping {
+    const char *data;
+    size_t size;
+    int mapped;
+} FileMapping;
+
+/// \brief Map a whole file into memory for reading.
+/// Uses mmap where available and falls back to a single read into one buffer.
+/// \param filename The file to map.
+/// \param error The error code.
+/// \return The mapping, data is NULL for empty files or on error.
+FileMapping map_file(const char *filename, int *error);
+
+/// \brief Release a mapping created by map_file.
+/// \param mapping The mapping to release.
+void unmap_file(FileMapping *mapping);
+
+#endif //INC_3DT_MAPPING_H
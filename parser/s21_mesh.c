@@ -0,0 +1,486 @@
+#include "s21_mesh.h"
+
+#include "s21_simplify.h"
+
+#define EMPTY_SLOT UINT32_MAX
+// every level keeps about 1 / LOD_REDUCTION of the triangles of the last,
+// levels that would be smaller than LOD_MIN_TRIANGLES are not built
+#define LOD_REDUCTION 4
+#define LOD_MIN_TRIANGLES 1024
+// the viewer draws no depth tested faces yet, and sorting the clusters
+// against overdraw costs cache misses at their boundaries
+#define OPTIMIZE_OVERDRAW 0
+
+typedef struct CornerKey {
+  int vertex;
+  int texture;
+  int normal;
+} CornerKey;
+
+typedef struct CornerTable {
+  uint32_t *slots;
+  CornerKey *keys;
+  uint32_t mask;
+  uint32_t count;
+} CornerTable;
+
+static uint32_t hash_corner(CornerKey key) {
+  uint32_t hash = (uint32_t)key.vertex * 0x9E3779B1u;
+  hash ^= (uint32_t)key.texture * 0x85EBCA77u + (hash << 6) + (hash >> 2);
+  hash ^= (uint32_t)key.normal * 0xC2B2AE3Du + (hash << 6) + (hash >> 2);
+  return hash ^ (hash >> 15);
+}
+
+// The table is at most half full, corner_count bounds the unique corners.
+static CornerTable create_corner_table(int corner_count, int *error) {
+  CornerTable table = {0};
+  uint32_t size = 16;
+  while (size < (uint32_t)corner_count * 2) size *= 2;
+  table.slots = malloc(sizeof(uint32_t) * size);
+  table.keys =
+      malloc(sizeof(CornerKey) * (corner_count > 0 ? corner_count : 1));
+  if (table.slots == NULL || table.keys == NULL) {
+    printf("Error: Could not allocate memory for corner table\n");
+    *error = 1;
+  } else {
+    memset(table.slots, 0xFF, sizeof(uint32_t) * size);
+    table.mask = size - 1;
+  }
+  return table;
+}
+
+static uint32_t find_corner(CornerTable *table, CornerKey key) {
+  uint32_t slot = hash_corner(key) & table->mask;
+  while (table->slots[slot] != EMPTY_SLOT) {
+    CornerKey *found = &table->keys[table->slots[slot]];
+    if (found->vertex == key.vertex && found->texture == key.texture &&
+        found->normal == key.normal)
+      return table->slots[slot];
+    slot = (slot + 1) & table->mask;
+  }
+  return EMPTY_SLOT;
+}
+
+static uint32_t insert_corner(CornerTable *table, CornerKey key) {
+  uint32_t slot = hash_corner(key) & table->mask;
+  while (table->slots[slot] != EMPTY_SLOT) {
+    CornerKey *found = &table->keys[table->slots[slot]];
+    if (found->vertex == key.vertex && found->texture == key.texture &&
+        found->normal == key.normal)
+      return table->slots[slot];
+    slot = (slot + 1) & table->mask;
+  }
+  table->slots[slot] = table->count;
+  table->keys[table->count] = key;
+  return table->count++;
+}
+
+static uint32_t hash_edge(uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xFF51AFD7ED558CCDULL;
+  key ^= key >> 33;
+  return (uint32_t)key;
+}
+
+static uint32_t corner_vertex(CornerTable *table, Face *face, int i) {
+  CornerKey key = {face->vertex_indices[i], face->texture_indices[i],
+                   face->normal_indices[i]};
+  return find_corner(table, key);
+}
+
+// Edges are keyed on the sorted pair of position indices, so corners with
+// different texture or normal indices still share an edge.
+static void create_edges(Obj *obj, CornerTable *table, Mesh *mesh,
+                         int *error) {
+  Faces *faces = obj->faces;
+  uint32_t size = 16;
+  while (size < (uint32_t)faces->index_count * 2) size *= 2;
+  uint64_t *slots = calloc(sizeof(uint64_t), size);
+  mesh->edges = malloc(sizeof(uint32_t) * 2 *
+                       (faces->index_count > 0 ? faces->index_count : 1));
+  if (slots == NULL || mesh->edges == NULL) {
+    printf("Error: Could not allocate memory for edges\n");
+    *error = 1;
+  }
+
+  for (int i = 0; i < faces->count && !*error; i++) {
+    Face *face = &faces->faces[i];
+    for (int j = 0; j < face->vertex_count; j++) {
+      int k = (j + 1) % face->vertex_count;
+      int a = face->vertex_indices[j];
+      int b = face->vertex_indices[k];
+      if (a == b || a <= 0 || b <= 0) continue;
+      uint64_t key = a < b ? ((uint64_t)a << 32) | (uint32_t)b
+                           : ((uint64_t)b << 32) | (uint32_t)a;
+      uint32_t slot = hash_edge(key) & (size - 1);
+      while (slots[slot] != 0 && slots[slot] != key)
+        slot = (slot + 1) & (size - 1);
+      if (slots[slot] == key) continue;
+      uint32_t from = corner_vertex(table, face, j);
+      uint32_t to = corner_vertex(table, face, k);
+      if (from == EMPTY_SLOT || to == EMPTY_SLOT) continue;
+      slots[slot] = key;
+      mesh->edges[mesh->edge_count * 2] = from;
+      mesh->edges[mesh->edge_count * 2 + 1] = to;
+      mesh->edge_count++;
+    }
+  }
+  safe_free(slots);
+}
+
+// The w streams are only allocated when a w differs from its default.
+static void create_vertices(Obj *obj, CornerTable *table, Mesh *mesh,
+                            int *error) {
+  size_t count = table->count > 0 ? table->count : 1;
+  int has_position_w = 0, has_texture_w = 0;
+  for (int i = 0; i < obj->vertices->count && !has_position_w; i++)
+    has_position_w = obj->vertices->vertices[i].w != 1.0f;
+  for (int i = 0; i < obj->textures->count && !has_texture_w; i++)
+    has_texture_w = obj->textures->textures[i].w != 0.0f;
+  mesh->positions = malloc(sizeof(float) * 3 * count);
+  mesh->normals = malloc(sizeof(float) * 3 * count);
+  mesh->textures = malloc(sizeof(float) * 2 * count);
+  if (has_position_w) mesh->position_w = malloc(sizeof(float) * count);
+  if (has_texture_w) mesh->texture_w = malloc(sizeof(float) * count);
+  if (mesh->positions == NULL || mesh->normals == NULL ||
+      mesh->textures == NULL || (has_position_w && mesh->position_w == NULL) ||
+      (has_texture_w && mesh->texture_w == NULL)) {
+    printf("Error: Could not allocate memory for vertex data\n");
+    *error = 1;
+    return;
+  }
+
+  for (uint32_t i = 0; i < table->count; i++) {
+    VertexData data = {0};
+    fill_vertex_data(obj, table->keys[i].vertex, table->keys[i].texture,
+                     table->keys[i].normal, &data);
+    memcpy(&mesh->positions[i * 3], &data.position.x, sizeof(float) * 3);
+    memcpy(&mesh->normals[i * 3], &data.normal.x, sizeof(float) * 3);
+    memcpy(&mesh->textures[i * 2], &data.texture.u, sizeof(float) * 2);
+    if (has_position_w) mesh->position_w[i] = data.position.w;
+    if (has_texture_w) mesh->texture_w[i] = data.texture.w;
+  }
+  mesh->vertex_count = table->count;
+}
+
+static void create_points(Obj *obj, Mesh *mesh, int *error) {
+  int count = obj->vertices->count;
+  mesh->points = malloc(sizeof(float) * 3 * (count > 0 ? count : 1));
+  if (mesh->points == NULL) {
+    printf("Error: Could not allocate memory for points\n");
+    *error = 1;
+    return;
+  }
+  for (int i = 0; i < count; i++) {
+    Vertex *vertex = &obj->vertices->vertices[i];
+    mesh->points[i * 3] = vertex->x;
+    mesh->points[i * 3 + 1] = vertex->y;
+    mesh->points[i * 3 + 2] = vertex->z;
+  }
+  mesh->point_count = count;
+}
+
+static void reorder(void *items, const int *order, int count, size_t size,
+                    int *error) {
+  char *copy = malloc(size * (count > 0 ? count : 1));
+  if (copy == NULL) {
+    printf("Error: Could not allocate memory for reordering\n");
+    *error = 1;
+    return;
+  }
+  for (int i = 0; i < count; i++)
+    memcpy(copy + size * i, (char *)items + size * order[i], size);
+  memcpy(items, copy, size * count);
+  free(copy);
+}
+
+static void remap_stream(float *stream, int width, const int *order,
+                         int count, int *error) {
+  if (stream != NULL)
+    reorder(stream, order, count, sizeof(float) * width, error);
+}
+
+// The edges are drawn and the triangles are not, so the vertices are
+// numbered in the order the ordered edges first use them.
+static void optimize_mesh(Mesh *mesh, int *error) {
+  int count = mesh->vertex_count;
+  uint32_t *remap = malloc(sizeof(uint32_t) * (count > 0 ? count : 1));
+  int *order = malloc(sizeof(int) * (count > 0 ? count : 1));
+  if (remap == NULL || order == NULL) {
+    printf("Error: Could not allocate memory for the vertex order\n");
+    *error = 1;
+  }
+  if (!*error) {
+    optimize_vertex_fetch(mesh->edges, mesh->edge_count * 2, count, remap);
+    for (int i = 0; i < count; i++) order[remap[i]] = i;
+    for (int i = 0; i < mesh->index_count; i++)
+      mesh->indices[i] = remap[mesh->indices[i]];
+    remap_stream(mesh->positions, 3, order, count, error);
+    remap_stream(mesh->normals, 3, order, count, error);
+    remap_stream(mesh->textures, 2, order, count, error);
+    remap_stream(mesh->position_w, 1, order, count, error);
+    remap_stream(mesh->texture_w, 1, order, count, error);
+    mesh->optimized_cache = measure_line_cache(
+        mesh->edges, mesh->edge_count * 2, mesh->vertex_count);
+  }
+  safe_free(remap);
+  safe_free(order);
+}
+
+static void set_bounds(float *bounds, const float *a, const float *b) {
+  for (int axis = 0; axis < 3; axis++) {
+    bounds[axis] = a[axis] < b[axis] ? a[axis] : b[axis];
+    bounds[axis + 3] = a[axis] > b[axis] ? a[axis] : b[axis];
+  }
+}
+
+// the values are non-negative indices, so the difference cannot overflow
+static int compare_ints(const void *a, const void *b) {
+  return *(const int *)a - *(const int *)b;
+}
+
+// The split leaves the edges of a leaf in no particular order. Sorted back
+// into the order they came in, the one optimize_line_cache chose for the
+// mesh, neighbouring edges share vertices again.
+static void sort_leaves(const Bvh *bvh, int *order) {
+  for (int i = 0; i < bvh->node_count; i++) {
+    const BvhNode *node = &bvh->nodes[i];
+    if (node->left < 0)
+      qsort(order + node->first, node->count, sizeof(int), compare_ints);
+  }
+}
+
+static void order_edges(const float *positions, uint32_t *edges, int count,
+                        Bvh *bvh, int *error) {
+  float *bounds = malloc(sizeof(float) * 6 * (count > 0 ? count : 1));
+  int *order = malloc(sizeof(int) * (count > 0 ? count : 1));
+  if (bounds == NULL || order == NULL) {
+    printf("Error: Could not allocate memory for edge bounds\n");
+    *error = 1;
+  }
+  for (int i = 0; i < count && !*error; i++) {
+    set_bounds(&bounds[i * 6], &positions[edges[i * 2] * 3],
+               &positions[edges[i * 2 + 1] * 3]);
+  }
+  if (!*error) *bvh = create_bvh(bounds, count, order, error);
+  if (!*error) sort_leaves(bvh, order);
+  if (!*error) reorder(edges, order, count, sizeof(uint32_t) * 2, error);
+  safe_free(bounds);
+  safe_free(order);
+}
+
+static void order_points(Mesh *mesh, int *error) {
+  int count = mesh->point_count;
+  float *bounds = malloc(sizeof(float) * 6 * (count > 0 ? count : 1));
+  int *order = malloc(sizeof(int) * (count > 0 ? count : 1));
+  if (bounds == NULL || order == NULL) {
+    printf("Error: Could not allocate memory for point bounds\n");
+    *error = 1;
+  }
+  for (int i = 0; i < count && !*error; i++) {
+    float *point = &mesh->points[i * 3];
+    set_bounds(&bounds[i * 6], point, point);
+  }
+  if (!*error) mesh->point_bvh = create_bvh(bounds, count, order, error);
+  if (!*error) reorder(mesh->points, order, count, sizeof(float) * 3, error);
+  safe_free(bounds);
+  safe_free(order);
+}
+
+// Vertices that differ only in texture or normal are welded into one, or
+// the seams between them could not collapse.
+static uint32_t *weld_vertices(Mesh *mesh, float **positions,
+                               uint32_t **origins, int *weld_count,
+                               int *error) {
+  CornerTable table = create_corner_table(mesh->vertex_count, error);
+  uint32_t *welded = malloc(sizeof(uint32_t) * (mesh->vertex_count + 1));
+  *positions = malloc(sizeof(float) * 3 * (mesh->vertex_count + 1));
+  *origins = malloc(sizeof(uint32_t) * (mesh->vertex_count + 1));
+  if (!*error && (welded == NULL || *positions == NULL || *origins == NULL)) {
+    printf("Error: Could not allocate memory for welding\n");
+    *error = 1;
+  }
+  for (int i = 0; i < mesh->vertex_count && !*error; i++) {
+    const float *position = &mesh->positions[i * 3];
+    CornerKey key;
+    memcpy(&key, position, sizeof(float) * 3);
+    uint32_t count = table.count;
+    welded[i] = insert_corner(&table, key);
+    if (table.count > count) {
+      memcpy(&(*positions)[count * 3], position, sizeof(float) * 3);
+      (*origins)[count] = i;
+    }
+  }
+  *weld_count = table.count;
+  safe_free(table.slots);
+  safe_free(table.keys);
+  return welded;
+}
+
+// The unique edges of the triangles, mapped back to mesh vertices.
+static void create_lod_edges(const uint32_t *triangles, int index_count,
+                             const uint32_t *origins, MeshLod *lod,
+                             int *error) {
+  uint32_t size = 16;
+  while (size < (uint32_t)index_count * 2) size *= 2;
+  uint64_t *slots = calloc(sizeof(uint64_t), size);
+  lod->edges = malloc(sizeof(uint32_t) * 2 * (index_count + 1));
+  if (slots == NULL || lod->edges == NULL) {
+    printf("Error: Could not allocate memory for edges\n");
+    *error = 1;
+  }
+  for (int i = 0; i < index_count && !*error; i++) {
+    uint32_t a = triangles[i];
+    uint32_t b = triangles[i % 3 == 2 ? i - 2 : i + 1];
+    // welded indices start at 0, the key is offset so 0 marks empty slots
+    uint64_t key = a < b ? ((uint64_t)a << 32) | (b + 1ULL)
+                         : ((uint64_t)b << 32) | (a + 1ULL);
+    uint32_t slot = hash_edge(key) & (size - 1);
+    while (slots[slot] != 0 && slots[slot] != key)
+      slot = (slot + 1) & (size - 1);
+    if (slots[slot] == key) continue;
+    slots[slot] = key;
+    lod->edges[lod->edge_count * 2] = origins[a];
+    lod->edges[lod->edge_count * 2 + 1] = origins[b];
+    lod->edge_count++;
+  }
+  safe_free(slots);
+}
+
+static void create_lods(Mesh *mesh, int *error) {
+  float *positions = NULL;
+  uint32_t *origins = NULL;
+  int weld_count = 0;
+  uint32_t *welded =
+      weld_vertices(mesh, &positions, &origins, &weld_count, error);
+  uint32_t *triangles = malloc(sizeof(uint32_t) * (mesh->index_count + 1));
+  if (!*error && triangles == NULL) {
+    printf("Error: Could not allocate memory for simplification\n");
+    *error = 1;
+  }
+  int index_count = 0;
+  for (int i = 0; i + 2 < mesh->index_count && !*error; i += 3) {
+    uint32_t a = welded[mesh->indices[i]];
+    uint32_t b = welded[mesh->indices[i + 1]];
+    uint32_t c = welded[mesh->indices[i + 2]];
+    if (a == b || b == c || c == a) continue;
+    triangles[index_count++] = a;
+    triangles[index_count++] = b;
+    triangles[index_count++] = c;
+  }
+
+  for (int level = 0; level < MESH_LOD_LEVELS && !*error; level++) {
+    int target = index_count / 3 / LOD_REDUCTION;
+    if (target < LOD_MIN_TRIANGLES) break;
+    int count = simplify_triangles(positions, weld_count, triangles,
+                                   index_count, target, error);
+    // a surface that resists simplification would repeat the last level
+    if (*error || count > index_count / 2) break;
+    index_count = count;
+    MeshLod *lod = &mesh->lods[mesh->lod_count++];
+    create_lod_edges(triangles, index_count, origins, lod, error);
+    if (!*error)
+      order_edges(mesh->positions, lod->edges, lod->edge_count, &lod->bvh,
+                  error);
+  }
+  safe_free(welded);
+  safe_free(positions);
+  safe_free(origins);
+  safe_free(triangles);
+}
+
+Mesh create_mesh(Obj *obj, Triangles triangles, int *error) {
+  Mesh mesh = {0};
+  int corner_count = triangles.count * 3;
+  CornerTable table = {0};
+  if (!*error) table = create_corner_table(corner_count, error);
+  if (!*error) {
+    mesh.indices =
+        malloc(sizeof(uint32_t) * (corner_count > 0 ? corner_count : 1));
+    if (mesh.indices == NULL) {
+      printf("Error: Could not allocate memory for indices\n");
+      *error = 1;
+    }
+  }
+
+  if (!*error) {
+    for (int i = 0; i < triangles.count; i++) {
+      Triangle *triangle = &triangles.triangles[i];
+      for (int j = 0; j < 3; j++) {
+        CornerKey key = {triangle->vertex_indices[j],
+                         triangle->texture_indices[j],
+                         triangle->normal_indices[j]};
+        mesh.indices[i * 3 + j] = insert_corner(&table, key);
+      }
+    }
+    mesh.index_count = corner_count;
+    create_vertices(obj, &table, &mesh, error);
+  }
+  if (!*error) create_edges(obj, &table, &mesh, error);
+  if (!*error)
+    mesh.original_cache = measure_line_cache(mesh.edges, mesh.edge_count * 2,
+                                             mesh.vertex_count);
+  if (!*error)
+    optimize_line_cache(mesh.edges, mesh.edge_count * 2, mesh.vertex_count,
+                        error);
+  if (!*error) create_points(obj, &mesh, error);
+  if (!*error)
+    order_edges(mesh.positions, mesh.edges, mesh.edge_count, &mesh.edge_bvh,
+                error);
+  if (!*error) optimize_mesh(&mesh, error);
+  if (!*error) order_points(&mesh, error);
+  if (!*error) create_lods(&mesh, error);
+
+  safe_free(table.slots);
+  safe_free(table.keys);
+  if (*error) destroy_mesh(&mesh);
+  return mesh;
+}
+
+void interleave_vertices(const Mesh *mesh, float *out) {
+  for (int i = 0; i < mesh->vertex_count; i++) {
+    float *vertex = &out[i * MESH_VERTEX_FLOATS];
+    memcpy(vertex, &mesh->positions[i * 3], sizeof(float) * 3);
+    memcpy(vertex + 3, &mesh->normals[i * 3], sizeof(float) * 3);
+    memcpy(vertex + 6, &mesh->textures[i * 2], sizeof(float) * 2);
+  }
+}
+
+void destroy_mesh(Mesh *mesh) {
+  if (mesh->mapping.data != NULL) {
+    unmap_file(&mesh->mapping);
+  } else {
+    safe_free(mesh->positions);
+    safe_free(mesh->normals);
+    safe_free(mesh->textures);
+    safe_free(mesh->position_w);
+    safe_free(mesh->texture_w);
+    safe_free(mesh->indices);
+    safe_free(mesh->edges);
+    safe_free(mesh->points);
+    destroy_bvh(&mesh->edge_bvh);
+    destroy_bvh(&mesh->point_bvh);
+    for (int i = 0; i < mesh->lod_count; i++) {
+      safe_free(mesh->lods[i].edges);
+      destroy_bvh(&mesh->lods[i].bvh);
+    }
+  }
+  memset(mesh->lods, 0, sizeof(mesh->lods));
+  mesh->lod_count = 0;
+  mesh->edge_bvh = (Bvh){0};
+  mesh->point_bvh = (Bvh){0};
+  mesh->positions = NULL;
+  mesh->normals = NULL;
+  mesh->textures = NULL;
+  mesh->position_w = NULL;
+  mesh->texture_w = NULL;
+  mesh->indices = NULL;
+  mesh->edges = NULL;
+  mesh->points = NULL;
+  mesh->vertex_count = 0;
+  mesh->index_count = 0;
+  mesh->edge_count = 0;
+  mesh->point_count = 0;
+  mesh->original_cache = (CacheStats){0};
+  mesh->optimized_cache = (CacheStats){0};
+}
@@ -0,0 +1,88 @@
+#ifndef INC_3DT_MESH_H
+#define INC_3DT_MESH_H
+
+#include <stdint.h>
+
+#include "s21_bvh.h"
+#include "s21_mapping.h"
+#include "s21_optimize.h"
+#include "s21_parser.h"
+
+/// The number of coarser levels of detail a mesh can have.
+#define MESH_LOD_LEVELS 3
+
+/// The floats per vertex of the interleaved upload layout: x, y, z, the
+/// normal x, y, z and u, v.
+#define MESH_VERTEX_FLOATS 8
+
+/// The edges of a simplified copy of the mesh triangles. They index the
+/// vertices of the mesh, so every level shares its vertex buffer, and are
+/// ordered by a hierarchy of their own.
+typedef struct MeshLod {
+    uint32_t *edges;
+    int edge_count;
+    Bvh bvh;
+} MeshLod;
+
+/// Indexed triangles over vertices that are unique per (v, vt, vn) triple,
+/// the unique edges of the source polygons as pairs of vertex indices, and
+/// every source position once as packed x, y, z floats for point display.
+/// Edges and points are ordered by a bounding volume hierarchy each, so the
+/// visible ones can be drawn as a few ranges. The levels of detail run from
+/// fine to coarse, each with about a quarter of the triangles of the one
+/// before, and small meshes have none. Only the edges and points are drawn,
+/// so the edges of every hierarchy leaf keep the order of the faces, the
+/// vertices are numbered in the order the edges use them, and the vertex
+/// cache statistics of the edges in file order and in the drawn order are
+/// kept for reports. A mesh loaded from the cache
+/// keeps its arrays in the mapped cache file.
+///
+/// Every vertex attribute is a stream of its own, packed x, y, z positions,
+/// x, y, z normals and u, v texture coordinates, so the passes that only
+/// read positions touch 12 bytes per vertex. The w of positions and textures
+/// only gets a stream when the file sets one to other than the default, 1
+/// for positions and 0 for textures, and is NULL otherwise.
+typedef struct Mesh {
+    float *positions;
+    float *normals;
+    float *textures;
+    float *position_w;
+    float *texture_w;
+    int vertex_count;
+    uint32_t *indices;
+    int index_count;
+    uint32_t *edges;
+    int edge_count;
+    float *points;
+    int point_count;
+    CacheStats original_cache;
+    CacheStats optimized_cache;
+    Bvh edge_bvh;
+    Bvh point_bvh;
+    MeshLod lods[MESH_LOD_LEVELS];
+    int lod_count;
+    FileMapping mapping;
+} Mesh;
+
+/// \brief Create an indexed mesh from the obj struct and the triangles.
+/// Corners that reference the same (v, vt, vn) triple share one vertex.
+/// Edges are taken from the faces of obj, not from the triangles, so fan
+/// diagonals are left out, and an edge shared by two faces is kept once.
+/// The vertices are renumbered by optimize_vertex_fetch over the ordered
+/// edges. The levels of detail are built by simplify_triangles.
+/// \param obj The obj struct with the vertex attributes.
+/// \param triangles The triangles struct containing all the triangles.
+/// \param error The error code.
+/// \return The mesh.
+Mesh create_mesh(Obj *obj, Triangles triangles, int *error);
+
+/// \brief Interleave the vertex streams of a mesh for upload.
+/// \param mesh The mesh.
+/// \param out MESH_VERTEX_FLOATS floats per vertex of the mesh.
+void interleave_vertices(const Mesh *mesh, float *out);
+
+/// \brief Free or unmap the buffers of a mesh and reset it.
+/// \param mesh The mesh to destroy.
+void destroy_mesh(Mesh *mesh);
+
+#endif //INC_3DT_MESH_H
@@ -0,0 +1,629 @@
+#include "s21_model.h"
+
+#include <limits.h>
+#include <stdint.h>
+
+#include "s21_mapping.h"
+
+#define STL_HEADER_SIZE 80
+#define STL_TRIANGLE_SIZE 50
+#define PLY_MAX_ELEMENTS 16
+#define PLY_MAX_PROPERTIES 32
+
+typedef enum PlyType {
+  PLY_NONE,
+  PLY_INT8,
+  PLY_UINT8,
+  PLY_INT16,
+  PLY_UINT16,
+  PLY_INT32,
+  PLY_UINT32,
+  PLY_FLOAT32,
+  PLY_FLOAT64
+} PlyType;
+
+static const int ply_type_sizes[] = {0, 1, 1, 2, 2, 4, 4, 4, 8};
+
+static const struct {
+  const char *name;
+  PlyType type;
+} ply_type_names[] = {
+    {"char", PLY_INT8},     {"int8", PLY_INT8},       {"uchar", PLY_UINT8},
+    {"uint8", PLY_UINT8},   {"short", PLY_INT16},     {"int16", PLY_INT16},
+    {"ushort", PLY_UINT16}, {"uint16", PLY_UINT16},   {"int", PLY_INT32},
+    {"int32", PLY_INT32},   {"uint", PLY_UINT32},     {"uint32", PLY_UINT32},
+    {"float", PLY_FLOAT32}, {"float32", PLY_FLOAT32}, {"double", PLY_FLOAT64},
+    {"float64", PLY_FLOAT64}};
+
+// The vertex attribute or face list a property is read into.
+typedef enum PlyRole {
+  ROLE_NONE,
+  ROLE_X,
+  ROLE_Y,
+  ROLE_Z,
+  ROLE_NX,
+  ROLE_NY,
+  ROLE_NZ,
+  ROLE_U,
+  ROLE_V,
+  ROLE_INDICES,
+  ROLE_COUNT
+} PlyRole;
+
+static const struct {
+  const char *name;
+  PlyRole role;
+} ply_role_names[] = {
+    {"x", ROLE_X},
+    {"y", ROLE_Y},
+    {"z", ROLE_Z},
+    {"nx", ROLE_NX},
+    {"ny", ROLE_NY},
+    {"nz", ROLE_NZ},
+    {"s", ROLE_U},
+    {"u", ROLE_U},
+    {"texture_u", ROLE_U},
+    {"texture_s", ROLE_U},
+    {"t", ROLE_V},
+    {"v", ROLE_V},
+    {"texture_v", ROLE_V},
+    {"texture_t", ROLE_V},
+    {"vertex_indices", ROLE_INDICES},
+    {"vertex_index", ROLE_INDICES}};
+
+typedef struct PlyProperty {
+  PlyType type;
+  // the type of the corner count, PLY_NONE unless it is a list
+  PlyType count_type;
+  PlyRole role;
+} PlyProperty;
+
+typedef struct PlyElement {
+  // 'v' for the vertices, 'f' for the faces, 0 for elements that are skipped
+  char kind;
+  long long count;
+  PlyProperty properties[PLY_MAX_PROPERTIES];
+  int property_count;
+  // the bytes of one record, 0 when it has lists
+  int record_size;
+} PlyElement;
+
+typedef struct PlyHeader {
+  PlyElement elements[PLY_MAX_ELEMENTS];
+  int element_count;
+  int swap;
+  size_t size;
+} PlyHeader;
+
+typedef struct Token {
+  const char *text;
+  size_t length;
+} Token;
+
+static int is_little_endian_host(void) {
+  uint16_t one = 1;
+  unsigned char first;
+  memcpy(&first, &one, 1);
+  return first == 1;
+}
+
+static uint16_t load_u16(const unsigned char *ptr, int swap) {
+  uint16_t value;
+  memcpy(&value, ptr, sizeof(value));
+  return swap ? (uint16_t)(value << 8 | value >> 8) : value;
+}
+
+static uint32_t load_u32(const unsigned char *ptr, int swap) {
+  uint32_t value;
+  memcpy(&value, ptr, sizeof(value));
+  if (swap)
+    value = value << 24 | (value & 0xFF00) << 8 | (value >> 8 & 0xFF00) |
+            value >> 24;
+  return value;
+}
+
+static uint64_t load_u64(const unsigned char *ptr, int swap) {
+  uint32_t low = load_u32(ptr, swap), high = load_u32(ptr + 4, swap);
+  if (swap) return (uint64_t)low << 32 | high;
+  return (uint64_t)high << 32 | low;
+}
+
+static float load_f32(const unsigned char *ptr, int swap) {
+  uint32_t bits = load_u32(ptr, swap);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static double load_value(const unsigned char *ptr, PlyType type, int swap) {
+  switch (type) {
+    case PLY_INT8:
+      return (int8_t)ptr[0];
+    case PLY_UINT8:
+      return ptr[0];
+    case PLY_INT16:
+      return (int16_t)load_u16(ptr, swap);
+    case PLY_UINT16:
+      return load_u16(ptr, swap);
+    case PLY_INT32:
+      return (int32_t)load_u32(ptr, swap);
+    case PLY_UINT32:
+      return load_u32(ptr, swap);
+    case PLY_FLOAT32:
+      return load_f32(ptr, swap);
+    case PLY_FLOAT64: {
+      uint64_t bits = load_u64(ptr, swap);
+      double value;
+      memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+    default:
+      return 0.0;
+  }
+}
+
+// List counts and face indices, the header only lets integer types here.
+static long long load_integer(const unsigned char *ptr, PlyType type,
+                              int swap) {
+  switch (type) {
+    case PLY_INT8:
+      return (int8_t)ptr[0];
+    case PLY_UINT8:
+      return ptr[0];
+    case PLY_INT16:
+      return (int16_t)load_u16(ptr, swap);
+    case PLY_UINT16:
+      return load_u16(ptr, swap);
+    case PLY_INT32:
+      return (int32_t)load_u32(ptr, swap);
+    default:
+      return load_u32(ptr, swap);
+  }
+}
+
+static int is_integer_type(PlyType type) {
+  return type != PLY_NONE && type != PLY_FLOAT32 && type != PLY_FLOAT64;
+}
+
+static const char *next_token(const char *ptr, const char *end, Token *token) {
+  while (ptr < end && (*ptr == ' ' || *ptr == '\t')) ptr++;
+  token->text = ptr;
+  while (ptr < end && *ptr != ' ' && *ptr != '\t') ptr++;
+  token->length = ptr - token->text;
+  return ptr;
+}
+
+static int token_is(Token token, const char *text) {
+  return token.length == strlen(text) &&
+         memcmp(token.text, text, token.length) == 0;
+}
+
+static PlyType type_of(Token token) {
+  for (size_t i = 0; i < sizeof(ply_type_names) / sizeof(ply_type_names[0]);
+       i++)
+    if (token_is(token, ply_type_names[i].name)) return ply_type_names[i].type;
+  return PLY_NONE;
+}
+
+static PlyRole role_of(Token token, char kind) {
+  for (size_t i = 0; i < sizeof(ply_role_names) / sizeof(ply_role_names[0]);
+       i++)
+    if (token_is(token, ply_role_names[i].name)) {
+      PlyRole role = ply_role_names[i].role;
+      if ((kind == 'v' && role != ROLE_INDICES) ||
+          (kind == 'f' && role == ROLE_INDICES))
+        return role;
+    }
+  return ROLE_NONE;
+}
+
+static int parse_count(Token token, long long *count) {
+  *count = 0;
+  for (size_t i = 0; i < token.length; i++) {
+    if (token.text[i] < '0' || token.text[i] > '9' || *count > INT_MAX)
+      return 0;
+    *count = *count * 10 + (token.text[i] - '0');
+  }
+  return token.length > 0 && *count <= INT_MAX;
+}
+
+static int parse_element(const char *ptr, const char *end, PlyHeader *header) {
+  Token name, count;
+  ptr = next_token(ptr, end, &name);
+  next_token(ptr, end, &count);
+  if (header->element_count == PLY_MAX_ELEMENTS) return 0;
+  PlyElement *element = &header->elements[header->element_count++];
+  memset(element, 0, sizeof(*element));
+  if (token_is(name, "vertex")) element->kind = 'v';
+  if (token_is(name, "face")) element->kind = 'f';
+  return parse_count(count, &element->count);
+}
+
+static int parse_property(const char *ptr, const char *end,
+                          PlyHeader *header) {
+  if (header->element_count == 0) return 0;
+  PlyElement *element = &header->elements[header->element_count - 1];
+  if (element->property_count == PLY_MAX_PROPERTIES) return 0;
+  PlyProperty *property = &element->properties[element->property_count++];
+  Token type, name;
+  ptr = next_token(ptr, end, &type);
+  property->count_type = PLY_NONE;
+  if (token_is(type, "list")) {
+    ptr = next_token(ptr, end, &type);
+    property->count_type = type_of(type);
+    ptr = next_token(ptr, end, &type);
+    if (!is_integer_type(property->count_type)) return 0;
+  }
+  property->type = type_of(type);
+  next_token(ptr, end, &name);
+  property->role = role_of(name, element->kind);
+  // only integer lists are face indices, and lists are no coordinates
+  if (property->role == ROLE_INDICES
+          ? property->count_type == PLY_NONE || !is_integer_type(property->type)
+          : property->count_type != PLY_NONE)
+    property->role = ROLE_NONE;
+  return property->type != PLY_NONE;
+}
+
+static int parse_ply_header(const char *data, size_t size, PlyHeader *header) {
+  memset(header, 0, sizeof(*header));
+  const char *ptr = data, *end = data + size;
+  int little_endian = -1, line = 0;
+  while (ptr < end) {
+    const char *newline = memchr(ptr, '\n', end - ptr);
+    if (newline == NULL) return 0;
+    const char *line_end = newline;
+    if (line_end > ptr && line_end[-1] == '\r') line_end--;
+    Token keyword;
+    const char *rest = next_token(ptr, line_end, &keyword);
+    ptr = newline + 1;
+    int ok = 1;
+    if (line++ == 0) {
+      ok = token_is(keyword, "ply");
+    } else if (token_is(keyword, "format")) {
+      Token format;
+      next_token(rest, line_end, &format);
+      if (token_is(format, "binary_little_endian")) little_endian = 1;
+      if (token_is(format, "binary_big_endian")) little_endian = 0;
+      ok = little_endian >= 0;
+    } else if (token_is(keyword, "element")) {
+      ok = parse_element(rest, line_end, header);
+    } else if (token_is(keyword, "property")) {
+      ok = parse_property(rest, line_end, header);
+    } else if (token_is(keyword, "end_header")) {
+      header->size = ptr - data;
+      header->swap = little_endian != is_little_endian_host();
+      return little_endian >= 0;
+    }
+    if (!ok) return 0;
+  }
+  return 0;
+}
+
+static void measure_records(PlyHeader *header) {
+  for (int i = 0; i < header->element_count; i++) {
+    PlyElement *element = &header->elements[i];
+    for (int j = 0; j < element->property_count; j++) {
+      if (element->properties[j].count_type != PLY_NONE) {
+        element->record_size = 0;
+        break;
+      }
+      element->record_size += ply_type_sizes[element->properties[j].type];
+    }
+  }
+}
+
+// The end of a record of an element with lists, NULL if it runs past end.
+// The corners of the face list are returned too.
+static const unsigned char *walk_record(const PlyElement *element,
+                                        const unsigned char *ptr,
+                                        const unsigned char *end, int swap,
+                                        long long *corners,
+                                        const unsigned char **indices) {
+  for (int i = 0; i < element->property_count; i++) {
+    const PlyProperty *property = &element->properties[i];
+    if (property->count_type == PLY_NONE) {
+      if (end - ptr < ply_type_sizes[property->type]) return NULL;
+      ptr += ply_type_sizes[property->type];
+      continue;
+    }
+    int count_size = ply_type_sizes[property->count_type];
+    if (end - ptr < count_size) return NULL;
+    long long count = load_integer(ptr, property->count_type, swap);
+    ptr += count_size;
+    if (count < 0 || count > (end - ptr) / ply_type_sizes[property->type])
+      return NULL;
+    if (property->role == ROLE_INDICES) {
+      *corners = count;
+      *indices = ptr;
+    }
+    ptr += count * ply_type_sizes[property->type];
+  }
+  return ptr;
+}
+
+static const unsigned char *skip_element(const PlyElement *element,
+                                         const unsigned char *ptr,
+                                         const unsigned char *end, int swap) {
+  if (element->record_size > 0)
+    return element->count > (end - ptr) / element->record_size
+               ? NULL
+               : ptr + element->count * element->record_size;
+  for (long long i = 0; i < element->count && ptr != NULL; i++) {
+    long long corners = 0;
+    const unsigned char *indices = NULL;
+    ptr = walk_record(element, ptr, end, swap, &corners, &indices);
+  }
+  return ptr;
+}
+
+static void *allocate_items(int count, size_t size, int *error) {
+  if (count == 0 || *error) return NULL;
+  void *items = malloc(size * count);
+  if (items == NULL) {
+    printf("Error: Could not allocate memory for the model\n");
+    *error = 1;
+  }
+  return items;
+}
+
+static int has_role(const PlyElement *element, PlyRole first, PlyRole last) {
+  for (int i = 0; i < element->property_count; i++)
+    if (element->properties[i].role >= first &&
+        element->properties[i].role <= last)
+      return 1;
+  return 0;
+}
+
+// The bytes a record takes at least, a list counts with an empty one. A
+// record without properties is taken as one byte, so its count is bounded
+// by the data too.
+static int min_record_size(const PlyElement *element) {
+  int size = 0;
+  for (int i = 0; i < element->property_count; i++) {
+    const PlyProperty *property = &element->properties[i];
+    size += ply_type_sizes[property->count_type != PLY_NONE
+                               ? property->count_type
+                               : property->type];
+  }
+  return size > 0 ? size : 1;
+}
+
+// The count is checked against the data before anything is allocated.
+static const unsigned char *read_vertices(const PlyElement *element,
+                                          const unsigned char *ptr,
+                                          const unsigned char *end, int swap,
+                                          Obj *obj, int *error) {
+  if (element->count > (end - ptr) / min_record_size(element)) return NULL;
+  int count = (int)element->count;
+  Vertex *vertices = allocate_items(count, sizeof(Vertex), error);
+  Normal *normals = NULL;
+  Texture *textures = NULL;
+  if (has_role(element, ROLE_NX, ROLE_NZ))
+    normals = allocate_items(count, sizeof(Normal), error);
+  if (has_role(element, ROLE_U, ROLE_V))
+    textures = allocate_items(count, sizeof(Texture), error);
+  obj->vertices->vertices = vertices;
+  obj->vertices->count = obj->vertices->capacity = vertices ? count : 0;
+  obj->normals->normals = normals;
+  obj->normals->count = obj->normals->capacity = normals ? count : 0;
+  obj->textures->textures = textures;
+  obj->textures->count = obj->textures->capacity = textures ? count : 0;
+
+  float values[ROLE_COUNT] = {0};
+  for (int i = 0; i < count && !*error; i++) {
+    for (int j = 0; j < element->property_count && ptr != NULL; j++) {
+      const PlyProperty *property = &element->properties[j];
+      if (property->count_type != PLY_NONE) {
+        long long corners = 0;
+        const unsigned char *indices = NULL;
+        PlyElement list = {0};
+        list.properties[0] = *property;
+        list.property_count = 1;
+        ptr = walk_record(&list, ptr, end, swap, &corners, &indices);
+        continue;
+      }
+      if (end - ptr < ply_type_sizes[property->type]) {
+        ptr = NULL;
+        break;
+      }
+      if (property->role != ROLE_NONE)
+        values[property->role] = (float)load_value(ptr, property->type, swap);
+      ptr += ply_type_sizes[property->type];
+    }
+    if (ptr == NULL) break;
+    vertices[i] = (Vertex){values[ROLE_X], values[ROLE_Y], values[ROLE_Z],
+                           1.0f};
+    if (normals != NULL)
+      normals[i] = (Normal){values[ROLE_NX], values[ROLE_NY], values[ROLE_NZ]};
+    if (textures != NULL)
+      textures[i] = (Texture){values[ROLE_U], values[ROLE_V], 0.0f};
+  }
+  return *error ? NULL : ptr;
+}
+
+// The corners are counted in a first walk over the block, so the index pool
+// is allocated once and filled in a second walk.
+static const unsigned char *read_faces(const PlyElement *element,
+                                       const unsigned char *ptr,
+                                       const unsigned char *end, int swap,
+                                       Obj *obj, int *error) {
+  const unsigned char *start = ptr;
+  long long index_count = 0;
+  for (long long i = 0; i < element->count && ptr != NULL; i++) {
+    long long corners = 0;
+    const unsigned char *indices = NULL;
+    ptr = walk_record(element, ptr, end, swap, &corners, &indices);
+    index_count += corners;
+    if (corners < 3 || index_count > INT_MAX) ptr = NULL;
+  }
+  Faces *faces = obj->faces;
+  int count = (int)element->count;
+  if (ptr == NULL || count == 0) return ptr;
+  reserve_faces(faces, count, (int)index_count, error);
+  if (*error) return NULL;
+  PlyType index_type = PLY_NONE;
+  for (int i = 0; i < element->property_count; i++)
+    if (element->properties[i].role == ROLE_INDICES)
+      index_type = element->properties[i].type;
+  int index_size = ply_type_sizes[index_type];
+  int vertex_count = obj->vertices->count;
+  int has_normals = obj->normals->count > 0;
+  int has_textures = obj->textures->count > 0;
+  int next = 0;
+  ptr = start;
+  for (int i = 0; i < count; i++) {
+    long long corners = 0;
+    const unsigned char *indices = NULL;
+    ptr = walk_record(element, ptr, end, swap, &corners, &indices);
+    faces->offsets[i] = next;
+    for (int j = 0; j < corners; j++, indices += index_size) {
+      long long index = load_integer(indices, index_type, swap);
+      // out of range corners are kept as missing like in obj files
+      int vertex = index >= 0 && index < vertex_count ? (int)index + 1 : 0;
+      faces->vertex_indices[next] = vertex;
+      faces->texture_indices[next] = has_textures ? vertex : 0;
+      faces->normal_indices[next] = has_normals ? vertex : 0;
+      next++;
+    }
+  }
+  faces->offsets[count] = next;
+  faces->count = count;
+  faces->index_count = next;
+  update_face_views(faces);
+  return ptr;
+}
+
+void parse_ply_data(const char *data, size_t size, Obj *obj, int *error) {
+  PlyHeader header;
+  if (data == NULL || !parse_ply_header(data, size, &header)) {
+    printf("Error: Could not parse ply header, only binary ply is read\n");
+    *error = 1;
+    return;
+  }
+  measure_records(&header);
+  const unsigned char *ptr = (const unsigned char *)data + header.size;
+  const unsigned char *end = (const unsigned char *)data + size;
+  int has_vertices = 0;
+  for (int i = 0; i < header.element_count && ptr != NULL && !*error; i++) {
+    const PlyElement *element = &header.elements[i];
+    if (element->kind == 'v' && !has_vertices) {
+      ptr = read_vertices(element, ptr, end, header.swap, obj, error);
+      has_vertices = 1;
+    } else if (element->kind == 'f' && has_vertices &&
+               obj->faces->count == 0 &&
+               has_role(element, ROLE_INDICES, ROLE_INDICES)) {
+      ptr = read_faces(element, ptr, end, header.swap, obj, error);
+    } else {
+      ptr = skip_element(element, ptr, end, header.swap);
+    }
+  }
+  if (!*error && ptr == NULL) {
+    printf("Error: Could not parse ply data\n");
+    *error = 1;
+  }
+}
+
+// The size has to match the triangle count after the 80-byte header.
+static int is_binary_stl(const char *head, size_t head_size,
+                         size_t file_size) {
+  if (head_size < STL_HEADER_SIZE + 4) return 0;
+  uint32_t count = load_u32((const unsigned char *)head + STL_HEADER_SIZE,
+                            !is_little_endian_host());
+  return file_size == STL_HEADER_SIZE + 4 + (uint64_t)count * STL_TRIANGLE_SIZE;
+}
+
+void parse_stl_data(const char *data, size_t size, Obj *obj, int *error) {
+  const unsigned char *ptr = (const unsigned char *)data;
+  int swap = !is_little_endian_host();
+  if (data == NULL || !is_binary_stl(data, size, size) ||
+      load_u32(ptr + STL_HEADER_SIZE, swap) > INT_MAX / 3) {
+    printf("Error: Could not parse stl file, only binary stl is read\n");
+    *error = 1;
+    return;
+  }
+  int triangles = (int)load_u32(ptr + STL_HEADER_SIZE, swap);
+  if (triangles == 0) return;
+  Vertex *vertices = allocate_items(triangles * 3, sizeof(Vertex), error);
+  Normal *normals = allocate_items(triangles, sizeof(Normal), error);
+  Faces *faces = obj->faces;
+  reserve_faces(faces, triangles, triangles * 3, error);
+  obj->vertices->vertices = vertices;
+  obj->normals->normals = normals;
+  if (*error) return;
+  obj->vertices->count = obj->vertices->capacity = triangles * 3;
+  obj->normals->count = obj->normals->capacity = triangles;
+
+  ptr += STL_HEADER_SIZE + 4;
+  for (int i = 0; i < triangles; i++, ptr += STL_TRIANGLE_SIZE) {
+    normals[i] = (Normal){load_f32(ptr, swap), load_f32(ptr + 4, swap),
+                          load_f32(ptr + 8, swap)};
+    for (int j = 0; j < 3; j++) {
+      const unsigned char *corner = ptr + 12 + 12 * j;
+      int index = i * 3 + j;
+      vertices[index] =
+          (Vertex){load_f32(corner, swap), load_f32(corner + 4, swap),
+                   load_f32(corner + 8, swap), 1.0f};
+      faces->vertex_indices[index] = index + 1;
+      faces->texture_indices[index] = 0;
+      faces->normal_indices[index] = i + 1;
+    }
+    faces->offsets[i] = i * 3;
+  }
+  faces->offsets[triangles] = triangles * 3;
+  faces->count = triangles;
+  faces->index_count = triangles * 3;
+  update_face_views(faces);
+}
+
+ModelFormat detect_model_format(const char *head, size_t head_size,
+                                size_t file_size) {
+  if (head_size >= 4 && memcmp(head, "ply", 3) == 0 &&
+      (head[3] == '\n' || head[3] == '\r'))
+    return MODEL_PLY;
+  if (is_binary_stl(head, head_size, file_size)) return MODEL_STL;
+  // an ascii stl file, which parse_stl_data rejects like ascii ply files
+  if (head_size >= 6 && memcmp(head, "solid", 5) == 0 &&
+      (head[5] == ' ' || head[5] == '\t' || head[5] == '\n' ||
+       head[5] == '\r'))
+    return MODEL_STL;
+  return MODEL_OBJ;
+}
+
+ModelFormat model_file_format(const char *filename) {
+  char head[MODEL_SIGNATURE_SIZE];
+  FILE *file = fopen(filename, "rb");
+  if (file == NULL) return MODEL_OBJ;
+  size_t head_size = fread(head, 1, sizeof(head), file);
+  long file_size = -1;
+  if (fseek(file, 0, SEEK_END) == 0) file_size = ftell(file);
+  fclose(file);
+  if (file_size < 0) return MODEL_OBJ;
+  return detect_model_format(head, head_size, (size_t)file_size);
+}
+
+Obj *parse_model(const char *filename, ParseOptions options) {
+  ModelFormat format = model_file_format(filename);
+  if (format == MODEL_OBJ) return parse_obj_ex(filename, options);
+
+  int error = 0;
+  FileMapping mapping = map_file(filename, &error);
+  if (!error && options.progress != NULL &&
+      options.progress(0, mapping.size, options.user))
+    error = 1;
+  Obj *obj = NULL;
+  if (!error) obj = init_obj(&error);
+  if (!error && format == MODEL_PLY)
+    parse_ply_data(mapping.data, mapping.size, obj, &error);
+  else if (!error)
+    parse_stl_data(mapping.data, mapping.size, obj, &error);
+  if (!error && options.progress != NULL &&
+      options.progress(mapping.size, mapping.size, options.user))
+    error = 1;
+  unmap_file(&mapping);
+  if (error && obj != NULL) {
+    destroy_obj(obj);
+    obj = NULL;
+  }
+  return obj;
+}
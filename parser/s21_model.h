@@ -0,0 +1,67 @@
+#ifndef INC_3DT_MODEL_H
+#define INC_3DT_MODEL_H
+
+#include "s21_parser.h"
+
+/// The bytes model_file_format reads from the start of a file.
+#define MODEL_SIGNATURE_SIZE 84
+
+/// The formats a model file can be loaded from.
+typedef enum ModelFormat {
+    MODEL_OBJ,
+    MODEL_PLY,
+    MODEL_STL
+} ModelFormat;
+
+/// \brief Tell the format of a model from the first bytes of its file.
+/// A file starting with a "ply" line is a ply file, a file whose size is
+/// 84 bytes plus 50 for each triangle counted after the 80-byte header is a
+/// binary stl file, even when its header starts with "solid". Any other
+/// file starting with a "solid" line is an ascii stl file, which
+/// parse_stl_data rejects. Anything else is read as an obj file.
+/// \param head The first bytes of the file.
+/// \param head_size The number of bytes in head, at most the file size.
+/// \param file_size The size of the whole file.
+/// \return The format.
+ModelFormat detect_model_format(const char *head, size_t head_size,
+                                size_t file_size);
+
+/// \brief Tell the format of a model file from its signature.
+/// \param filename The model file.
+/// \return The format, MODEL_OBJ when the file cannot be read.
+ModelFormat model_file_format(const char *filename);
+
+/// \brief Parse a model file of any supported format.
+/// Obj files are parsed by parse_obj_ex. Ply and stl files are mapped and
+/// their blocks are read in place on the calling thread, the progress
+/// callback only hears of the start and the end.
+/// \param filename The model file.
+/// \param options The thread count of obj files (0 for every online core)
+/// and an optional progress callback that can cancel the parse.
+/// \return The struct containing the parsed model, NULL on error or when the
+/// parse was cancelled.
+Obj *parse_model(const char *filename, ParseOptions options);
+
+/// \brief Parse the contents of a binary ply file.
+/// Both byte orders and every scalar type are read. The x, y and z of the
+/// vertex element become the vertices, nx, ny and nz the normals and the
+/// s and t (or u and v) the textures, one per vertex each. The faces of
+/// the vertex_indices lists refer to all three with the same index. Other
+/// elements and properties are skipped, ascii ply files are rejected.
+/// \param data The file contents.
+/// \param size The size of the contents in bytes.
+/// \param obj The empty obj struct to store the model in.
+/// \param error The error code.
+void parse_ply_data(const char *data, size_t size, Obj *obj, int *error);
+
+/// \brief Parse the contents of a binary stl file.
+/// Every triangle gets three vertices of its own and its facet normal, the
+/// vertices of neighbouring triangles are not merged. Ascii stl files are
+/// rejected.
+/// \param data The file contents.
+/// \param size The size of the contents in bytes.
+/// \param obj The empty obj struct to store the model in.
+/// \param error The error code.
+void parse_stl_data(const char *data, size_t size, Obj *obj, int *error);
+
+#endif //INC_3DT_MODEL_H
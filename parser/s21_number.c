@@ -0,0 +1,338 @@
+#include "s21_number.h"
+
+#include <float.h>
+#include <limits.h>
+#include <locale.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_MANTISSA_DIGITS 19
+#define MAX_EXACT_MANTISSA (1ULL << 53)
+#define MAX_EXACT_POWER 22
+#define FALLBACK_BUFFER 64
+
+static const double powers_of_ten[MAX_EXACT_POWER + 1] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+static int is_digit(char c) { return c >= '0' && c <= '9'; }
+
+// Both operands are exact doubles, so the division or product is correctly
+// rounded. Rounding that double to float again is exact unless it sits on a
+// midpoint between two floats or in the subnormal range.
+static int fast_path(uint64_t mantissa, int exponent, float *value) {
+  if (mantissa > MAX_EXACT_MANTISSA || exponent < -MAX_EXACT_POWER ||
+      exponent > MAX_EXACT_POWER)
+    return 0;
+  double result = (double)mantissa;
+  if (exponent < 0)
+    result /= powers_of_ten[-exponent];
+  else
+    result *= powers_of_ten[exponent];
+  if (result < FLT_MIN) return 0;
+  uint64_t bits;
+  memcpy(&bits, &result, sizeof(bits));
+  if ((bits & 0x1FFFFFFFULL) == 0x10000000ULL) return 0;
+  *value = (float)result;
+  return 1;
+}
+
+// Rare inputs (long mantissas, huge exponents, subnormals, midpoints) go
+// through strtof with the '.' swapped for the locale decimal point.
+static void slow_path(const char *start, const char *end, float *value) {
+  char local[FALLBACK_BUFFER];
+  size_t length = end - start;
+  char *buffer = length < FALLBACK_BUFFER ? local : malloc(length + 1);
+  if (buffer == NULL) {
+    *value = 0.0f;
+    return;
+  }
+  memcpy(buffer, start, length);
+  buffer[length] = '\0';
+  const char *point = localeconv()->decimal_point;
+  char *dot = memchr(buffer, '.', length);
+  if (dot != NULL && point != NULL && point[0] != '\0' && point[1] == '\0')
+    *dot = point[0];
+  *value = strtof(buffer, NULL);
+  if (buffer != local) free(buffer);
+}
+
+const char *scan_float(const char *ptr, float *value) {
+  const char *start = ptr;
+  int negative = 0;
+  if (*ptr == '-' || *ptr == '+') negative = *ptr++ == '-';
+
+  uint64_t mantissa = 0;
+  int digits = 0, exponent = 0, seen_digit = 0, truncated = 0;
+  for (; is_digit(*ptr); ptr++) {
+    seen_digit = 1;
+    if (digits < MAX_MANTISSA_DIGITS) {
+      mantissa = mantissa * 10 + (*ptr - '0');
+      if (mantissa != 0) digits++;
+    } else {
+      exponent++;
+      truncated |= *ptr != '0';
+    }
+  }
+  if (*ptr == '.') {
+    for (ptr++; is_digit(*ptr); ptr++) {
+      seen_digit = 1;
+      if (digits < MAX_MANTISSA_DIGITS) {
+        mantissa = mantissa * 10 + (*ptr - '0');
+        if (mantissa != 0) digits++;
+        exponent--;
+      } else {
+        truncated |= *ptr != '0';
+      }
+    }
+  }
+  if (!seen_digit) return NULL;
+
+  if (*ptr == 'e' || *ptr == 'E') {
+    const char *exp_ptr = ptr + 1;
+    int exp_negative = 0;
+    if (*exp_ptr == '-' || *exp_ptr == '+') exp_negative = *exp_ptr++ == '-';
+    if (is_digit(*exp_ptr)) {
+      int exp_value = 0;
+      for (; is_digit(*exp_ptr); exp_ptr++)
+        if (exp_value < 100000) exp_value = exp_value * 10 + (*exp_ptr - '0');
+      exponent += exp_negative ? -exp_value : exp_value;
+      ptr = exp_ptr;
+    }
+  }
+
+  float result = 0.0f;
+  if (mantissa == 0 && !truncated)
+    result = 0.0f;
+  else if (truncated || !fast_path(mantissa, exponent, &result))
+    slow_path(negative || *start == '+' ? start + 1 : start, ptr, &result);
+  *value = negative ? -result : result;
+  return ptr;
+}
+
+const char *scan_int(const char *ptr, int *value) {
+  int negative = 0;
+  if (*ptr == '-' || *ptr == '+') negative = *ptr++ == '-';
+  if (!is_digit(*ptr)) return NULL;
+  long long result = 0;
+  for (; is_digit(*ptr); ptr++) {
+    result = result * 10 + (*ptr - '0');
+    if (result > (long long)INT_MAX + 1) return NULL;
+  }
+  if (negative) result = -result;
+  if (result > INT_MAX) return NULL;
+  *value = (int)result;
+  return ptr;
+}
+
+// Shortest decimals of floats with Schubfach (R. Giulietti, "The Schubfach
+// way to render doubles"), for 32-bit floats like ToDecimal32 of Ulf Adams'
+// and Alexander Bolz's implementations. The table holds 10^k for k in
+// [POW10_MIN, POW10_MAX], rounded up to 64 significant bits.
+#define POW10_MIN -31
+#define POW10_MAX 45
+#define SIGNIFICAND_BITS 23
+#define EXPONENT_BIAS 127
+
+static const uint64_t powers_of_ten_64[POW10_MAX - POW10_MIN + 1] = {
+    0x81CEB32C4B43FCF5ULL, 0xA2425FF75E14FC32ULL, 0xCAD2F7F5359A3B3FULL,
+    0xFD87B5F28300CA0EULL, 0x9E74D1B791E07E49ULL, 0xC612062576589DDBULL,
+    0xF79687AED3EEC552ULL, 0x9ABE14CD44753B53ULL, 0xC16D9A0095928A28ULL,
+    0xF1C90080BAF72CB2ULL, 0x971DA05074DA7BEFULL, 0xBCE5086492111AEBULL,
+    0xEC1E4A7DB69561A6ULL, 0x9392EE8E921D5D08ULL, 0xB877AA3236A4B44AULL,
+    0xE69594BEC44DE15CULL, 0x901D7CF73AB0ACDAULL, 0xB424DC35095CD810ULL,
+    0xE12E13424BB40E14ULL, 0x8CBCCC096F5088CCULL, 0xAFEBFF0BCB24AAFFULL,
+    0xDBE6FECEBDEDD5BFULL, 0x89705F4136B4A598ULL, 0xABCC77118461CEFDULL,
+    0xD6BF94D5E57A42BDULL, 0x8637BD05AF6C69B6ULL, 0xA7C5AC471B478424ULL,
+    0xD1B71758E219652CULL, 0x83126E978D4FDF3CULL, 0xA3D70A3D70A3D70BULL,
+    0xCCCCCCCCCCCCCCCDULL, 0x8000000000000000ULL, 0xA000000000000000ULL,
+    0xC800000000000000ULL, 0xFA00000000000000ULL, 0x9C40000000000000ULL,
+    0xC350000000000000ULL, 0xF424000000000000ULL, 0x9896800000000000ULL,
+    0xBEBC200000000000ULL, 0xEE6B280000000000ULL, 0x9502F90000000000ULL,
+    0xBA43B74000000000ULL, 0xE8D4A51000000000ULL, 0x9184E72A00000000ULL,
+    0xB5E620F480000000ULL, 0xE35FA931A0000000ULL, 0x8E1BC9BF04000000ULL,
+    0xB1A2BC2EC5000000ULL, 0xDE0B6B3A76400000ULL, 0x8AC7230489E80000ULL,
+    0xAD78EBC5AC620000ULL, 0xD8D726B7177A8000ULL, 0x878678326EAC9000ULL,
+    0xA968163F0A57B400ULL, 0xD3C21BCECCEDA100ULL, 0x84595161401484A0ULL,
+    0xA56FA5B99019A5C8ULL, 0xCECB8F27F4200F3AULL, 0x813F3978F8940985ULL,
+    0xA18F07D736B90BE6ULL, 0xC9F2C9CD04674EDFULL, 0xFC6F7C4045812297ULL,
+    0x9DC5ADA82B70B59EULL, 0xC5371912364CE306ULL, 0xF684DF56C3E01BC7ULL,
+    0x9A130B963A6C115DULL, 0xC097CE7BC90715B4ULL, 0xF0BDC21ABB48DB21ULL,
+    0x96769950B50D88F5ULL, 0xBC143FA4E250EB32ULL, 0xEB194F8E1AE525FEULL,
+    0x92EFD1B8D0CF37BFULL, 0xB7ABC627050305AEULL, 0xE596B7B0C643C71AULL,
+    0x8F7E32CE7BEA5C70ULL, 0xB35DBF821AE4F38CULL};
+
+static const char digit_pairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536"
+    "37383940414243444546474849505152535455565758596061626364656667686970717273"
+    "7475767778798081828384858687888990919293949596979899";
+
+// floor(value / 2^shift) without relying on the sign of a shifted negative
+static int floor_shift(int32_t value, int shift) {
+  return value >= 0 ? value >> shift : -((-value + (1 << shift) - 1) >> shift);
+}
+
+// The upper 32 bits of g * cp / 2^32 rounded to odd, with g * cp taken as a
+// 96-bit product.
+static uint32_t round_to_odd(uint64_t g, uint32_t cp) {
+  uint64_t low = (g & 0xFFFFFFFFu) * cp;
+  uint64_t high = (g >> 32) * cp + (low >> 32);
+  return (uint32_t)(high >> 32) | ((uint32_t)high > 1);
+}
+
+// The shortest digits of a finite nonzero float that read back to it, the
+// value is digits * 10^exponent. Ties go to the even digits.
+static uint32_t to_decimal(uint32_t significand, uint32_t biased,
+                           int *exponent) {
+  uint32_t c;
+  int32_t q;
+  if (biased != 0) {
+    c = (1u << SIGNIFICAND_BITS) | significand;
+    q = (int32_t)biased - EXPONENT_BIAS - SIGNIFICAND_BITS;
+    if (q <= 0 && q > -SIGNIFICAND_BITS - 1 &&
+        (c & ((1u << -q) - 1)) == 0) {
+      *exponent = 0;
+      return c >> -q;
+    }
+  } else {
+    c = significand;
+    q = 1 - EXPONENT_BIAS - SIGNIFICAND_BITS;
+  }
+
+  int even = (c & 1) == 0;
+  int lower_closer = significand == 0 && biased > 1;
+  uint32_t cbl = 4 * c - 2 + lower_closer;
+  uint32_t cb = 4 * c;
+  uint32_t cbr = 4 * c + 2;
+
+  int k = floor_shift(q * 1262611 - (lower_closer ? 524031 : 0), 22);
+  int h = q + floor_shift(-k * 1741647, 19) + 1;
+  uint64_t g = powers_of_ten_64[-k - POW10_MIN];
+  uint32_t vbl = round_to_odd(g, cbl << h);
+  uint32_t vb = round_to_odd(g, cb << h);
+  uint32_t vbr = round_to_odd(g, cbr << h);
+  uint32_t lower = vbl + !even;
+  uint32_t upper = vbr - !even;
+
+  uint32_t s = vb / 4;
+  if (s >= 10) {
+    uint32_t sp = s / 10;
+    int up_inside = lower <= 40 * sp;
+    int wp_inside = 40 * sp + 40 <= upper;
+    if (up_inside != wp_inside) {
+      *exponent = k + 1;
+      return sp + wp_inside;
+    }
+  }
+  int u_inside = lower <= 4 * s;
+  int w_inside = 4 * s + 4 <= upper;
+  *exponent = k;
+  if (u_inside != w_inside) return s + w_inside;
+  uint32_t mid = 4 * s + 2;
+  return s + (vb > mid || (vb == mid && (s & 1) != 0));
+}
+
+static int decimal_length(uint32_t value) {
+  int length = 1;
+  for (uint32_t bound = 10; length < 10 && value >= bound; bound *= 10)
+    length++;
+  return length;
+}
+
+// Writes the digits of value so that the last one ends right before end.
+static void write_digits(uint32_t value, char *end) {
+  while (value >= 100) {
+    uint32_t pair = value % 100 * 2;
+    value /= 100;
+    *--end = digit_pairs[pair + 1];
+    *--end = digit_pairs[pair];
+  }
+  if (value >= 10) {
+    *--end = digit_pairs[value * 2 + 1];
+    *--end = digit_pairs[value * 2];
+  } else {
+    *--end = (char)('0' + value);
+  }
+}
+
+// Plain notation for a decimal point up to 9 digits right or 3 zeros left of
+// the digits, "1.5e-7" style exponents otherwise.
+static char *write_decimal(uint32_t digits, int exponent, char *out) {
+  while (digits % 10 == 0) {
+    digits /= 10;
+    exponent++;
+  }
+  int length = decimal_length(digits);
+  int point = length + exponent;
+  if (exponent >= 0 && point <= 9) {
+    write_digits(digits, out + length);
+    memset(out + length, '0', exponent);
+    return out + point;
+  }
+  if (exponent < 0 && point > 0) {
+    write_digits(digits, out + length + 1);
+    memmove(out, out + 1, point);
+    out[point] = '.';
+    return out + length + 1;
+  }
+  if (point > -4 && point <= 0) {
+    out[0] = '0';
+    out[1] = '.';
+    memset(out + 2, '0', -point);
+    out += 2 - point + length;
+    write_digits(digits, out);
+    return out;
+  }
+  write_digits(digits, out + length + 1);
+  out[0] = out[1];
+  if (length > 1) {
+    out[1] = '.';
+    out += length + 1;
+  } else {
+    out++;
+  }
+  *out++ = 'e';
+  int power = point - 1;
+  if (power < 0) {
+    *out++ = '-';
+    power = -power;
+  }
+  int power_length = decimal_length((uint32_t)power);
+  write_digits((uint32_t)power, out + power_length);
+  return out + power_length;
+}
+
+char *format_float(float value, char *out) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint32_t significand = bits & ((1u << SIGNIFICAND_BITS) - 1);
+  uint32_t biased = bits >> SIGNIFICAND_BITS & 0xFF;
+  if (biased == 0xFF && significand != 0) {
+    memcpy(out, "nan", 3);
+    return out + 3;
+  }
+  if (bits >> 31) *out++ = '-';
+  if (biased == 0xFF) {
+    memcpy(out, "inf", 3);
+    return out + 3;
+  }
+  if (biased == 0 && significand == 0) {
+    *out = '0';
+    return out + 1;
+  }
+  int exponent = 0;
+  uint32_t digits = to_decimal(significand, biased, &exponent);
+  return write_decimal(digits, exponent, out);
+}
+
+char *format_int(int value, char *out) {
+  uint32_t magnitude = (uint32_t)value;
+  if (value < 0) {
+    *out++ = '-';
+    magnitude = 0u - magnitude;
+  }
+  int length = decimal_length(magnitude);
+  write_digits(magnitude, out + length);
+  return out + length;
+}
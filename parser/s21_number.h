@@ -0,0 +1,38 @@
+#ifndef INC_3DT_NUMBER_H
+#define INC_3DT_NUMBER_H
+
+/// Enough room for any float or int written by format_float or format_int.
+#define NUMBER_TEXT_MAX 16
+
+/// \brief Scan a decimal float, independent of the current locale.
+/// Accepts an optional sign, digits with an optional '.', and an optional
+/// exponent. The result is rounded exactly like strtof in the "C" locale.
+/// \param ptr The text to scan, no leading whitespace is skipped.
+/// \param value The scanned value.
+/// \return The pointer past the number, or NULL if there is no number.
+const char *scan_float(const char *ptr, float *value);
+
+/// \brief Scan a decimal integer with an optional sign.
+/// \param ptr The text to scan, no leading whitespace is skipped.
+/// \param value The scanned value.
+/// \return The pointer past the number, or NULL if there is no number or it
+/// does not fit in an int.
+const char *scan_int(const char *ptr, int *value);
+
+/// \brief Write the shortest decimal that scans back to the same float.
+/// Plain notation is used unless the decimal point is more than 9 digits
+/// right or 3 zeros left of the digits, then an exponent like "1.5e-7" is.
+/// Infinities are "inf" or "-inf", any NaN is "nan". No terminating zero is
+/// written and the current locale is not used.
+/// \param value The float to write.
+/// \param out Room for at least NUMBER_TEXT_MAX characters.
+/// \return The pointer past the written text.
+char *format_float(float value, char *out);
+
+/// \brief Write a decimal integer, with a '-' if it is negative.
+/// \param value The integer to write.
+/// \param out Room for at least NUMBER_TEXT_MAX characters.
+/// \return The pointer past the written text.
+char *format_int(int value, char *out);
+
+#endif //INC_3DT_NUMBER_H
@@ -0,0 +1,354 @@
+#include "s21_optimize.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "s21_parser.h"
+
+// a cluster ends once its running miss ratio is this close to the ratio of
+// the whole run it was split from
+#define OVERDRAW_THRESHOLD 1.05
+
+// The stamps of a FIFO cache: a vertex is cached while fewer than
+// VERTEX_CACHE_SIZE misses happened since its own. Moving time forward by
+// the cache size flushes it.
+typedef struct VertexCache {
+  int *stamps;
+  int time;
+} VertexCache;
+
+typedef struct Tipsify {
+  const uint32_t *indices;
+  // 3 for triangles, 2 for lines
+  int corners;
+  int vertex_count;
+  // the primitives around vertex v are adjacency[offsets[v]] and on
+  int *offsets;
+  int *adjacency;
+  int *live;
+  char *emitted;
+  // the vertices of emitted triangles, the candidates of the next fan
+  int *dead_ends;
+  int dead_end_count;
+  int cursor;
+  VertexCache cache;
+} Tipsify;
+
+typedef struct Cluster {
+  int first;
+  int count;
+  double key;
+} Cluster;
+
+static VertexCache create_cache(int vertex_count, int *error) {
+  VertexCache cache = {calloc(sizeof(int), vertex_count + 1),
+                       VERTEX_CACHE_SIZE + 1};
+  if (cache.stamps == NULL) {
+    printf("Error: Could not allocate memory for the vertex cache\n");
+    *error = 1;
+  }
+  return cache;
+}
+
+static void flush_cache(VertexCache *cache) {
+  cache->time += VERTEX_CACHE_SIZE + 1;
+}
+
+static int cache_miss(VertexCache *cache, uint32_t vertex) {
+  if (cache->time - cache->stamps[vertex] <= VERTEX_CACHE_SIZE) return 0;
+  cache->stamps[vertex] = cache->time++;
+  return 1;
+}
+
+static int triangle_misses(VertexCache *cache, const uint32_t *triangle) {
+  return cache_miss(cache, triangle[0]) + cache_miss(cache, triangle[1]) +
+         cache_miss(cache, triangle[2]);
+}
+
+// Misses per primitive of corners indices each, and per vertex.
+static CacheStats measure_cache(const uint32_t *indices, int index_count,
+                                int corners, int vertex_count) {
+  CacheStats stats = {0.0f, 0.0f};
+  int error = 0;
+  int primitive_count = index_count / corners;
+  VertexCache cache = create_cache(vertex_count, &error);
+  if (error || primitive_count == 0) {
+    safe_free(cache.stamps);
+    return stats;
+  }
+  long misses = 0;
+  for (int i = 0; i < primitive_count * corners; i++)
+    misses += cache_miss(&cache, indices[i]);
+  safe_free(cache.stamps);
+  stats.acmr = (float)misses / primitive_count;
+  stats.atvr = vertex_count > 0 ? (float)misses / vertex_count : 0.0f;
+  return stats;
+}
+
+CacheStats measure_vertex_cache(const uint32_t *indices, int index_count,
+                                int vertex_count) {
+  return measure_cache(indices, index_count, 3, vertex_count);
+}
+
+CacheStats measure_line_cache(const uint32_t *indices, int index_count,
+                              int vertex_count) {
+  return measure_cache(indices, index_count, 2, vertex_count);
+}
+
+static void create_adjacency(Tipsify *t, int primitive_count) {
+  int index_count = primitive_count * t->corners;
+  for (int i = 0; i < index_count; i++) t->live[t->indices[i]]++;
+  t->offsets[0] = 0;
+  for (int v = 0; v < t->vertex_count; v++)
+    t->offsets[v + 1] = t->offsets[v] + t->live[v];
+  // offsets[v] runs ahead while filling and is moved back after
+  for (int i = 0; i < index_count; i++)
+    t->adjacency[t->offsets[t->indices[i]]++] = i / t->corners;
+  for (int v = t->vertex_count; v > 0; v--) t->offsets[v] = t->offsets[v - 1];
+  t->offsets[0] = 0;
+}
+
+// The candidate that is cached and will stay cached while its remaining
+// primitives are fanned, the oldest one first. Otherwise the latest emitted
+// vertex with primitives left, otherwise the next one in index order.
+static int next_fan(Tipsify *t, int first_candidate) {
+  int best = -1, best_priority = -1;
+  for (int i = first_candidate; i < t->dead_end_count; i++) {
+    int v = t->dead_ends[i];
+    if (t->live[v] <= 0) continue;
+    int age = t->cache.time - t->cache.stamps[v];
+    int misses = (t->corners - 1) * t->live[v];
+    int priority = age + misses <= VERTEX_CACHE_SIZE ? age : 0;
+    if (priority > best_priority) {
+      best_priority = priority;
+      best = v;
+    }
+  }
+  while (best < 0 && t->dead_end_count > 0) {
+    int v = t->dead_ends[--t->dead_end_count];
+    if (t->live[v] > 0) best = v;
+  }
+  while (best < 0 && t->cursor < t->vertex_count) {
+    if (t->live[t->cursor] > 0) best = t->cursor;
+    t->cursor++;
+  }
+  return best;
+}
+
+static void tipsify(Tipsify *t, int primitive_count, uint32_t *out) {
+  create_adjacency(t, primitive_count);
+  int count = 0;
+  int fan = next_fan(t, 0);
+  while (fan >= 0) {
+    // the candidates are the vertices pushed by this fan
+    int first_candidate = t->dead_end_count;
+    for (int i = t->offsets[fan]; i < t->offsets[fan + 1]; i++) {
+      int primitive = t->adjacency[i];
+      if (t->emitted[primitive]) continue;
+      t->emitted[primitive] = 1;
+      for (int j = 0; j < t->corners; j++) {
+        uint32_t v = t->indices[primitive * t->corners + j];
+        out[count++] = v;
+        t->dead_ends[t->dead_end_count++] = v;
+        t->live[v]--;
+        cache_miss(&t->cache, v);
+      }
+    }
+    fan = next_fan(t, first_candidate);
+  }
+}
+
+// Hard boundaries start where all three vertices miss, so the cache is
+// as good as flushed. Every hard run is split again where its running miss
+// ratio comes within OVERDRAW_THRESHOLD of the ratio of the whole run.
+static int split_clusters(const uint32_t *indices, int triangle_count,
+                          VertexCache *cache, int *hard, Cluster *clusters) {
+  int hard_count = 0;
+  for (int i = 0; i < triangle_count; i++)
+    if (triangle_misses(cache, &indices[i * 3]) == 3 || i == 0)
+      hard[hard_count++] = i;
+  hard[hard_count] = triangle_count;
+
+  int count = 0;
+  for (int h = 0; h < hard_count; h++) {
+    int first = hard[h], end = hard[h + 1];
+    flush_cache(cache);
+    long misses = 0;
+    for (int i = first; i < end; i++)
+      misses += triangle_misses(cache, &indices[i * 3]);
+    double threshold = OVERDRAW_THRESHOLD * misses / (end - first);
+
+    flush_cache(cache);
+    misses = 0;
+    int start = first;
+    for (int i = first; i < end; i++) {
+      misses += triangle_misses(cache, &indices[i * 3]);
+      if (i + 1 == end || (double)misses / (i - start + 1) <= threshold) {
+        clusters[count].first = start;
+        clusters[count++].count = i - start + 1;
+        flush_cache(cache);
+        misses = 0;
+        start = i + 1;
+      }
+    }
+  }
+  return count;
+}
+
+// The normal of a triangle scaled by twice its area and the sum of its
+// corners, the return value is the length of the normal.
+static double triangle_frame(const float *positions, const uint32_t *triangle,
+                           double *normal, double *corners) {
+  const float *a = &positions[triangle[0] * 3];
+  const float *b = &positions[triangle[1] * 3];
+  const float *c = &positions[triangle[2] * 3];
+  double ab[3], ac[3];
+  for (int axis = 0; axis < 3; axis++) {
+    ab[axis] = (double)b[axis] - a[axis];
+    ac[axis] = (double)c[axis] - a[axis];
+    corners[axis] = (double)a[axis] + b[axis] + c[axis];
+  }
+  normal[0] = ab[1] * ac[2] - ab[2] * ac[1];
+  normal[1] = ab[2] * ac[0] - ab[0] * ac[2];
+  normal[2] = ab[0] * ac[1] - ab[1] * ac[0];
+  return sqrt(normal[0] * normal[0] + normal[1] * normal[1] +
+              normal[2] * normal[2]);
+}
+
+// Clusters whose center lies far out along their normal are likely in
+// front of the rest of the mesh from the directions they face.
+static void rank_clusters(const float *positions, const uint32_t *indices,
+                          int triangle_count, Cluster *clusters, int count) {
+  double center[3] = {0, 0, 0}, total_area = 0;
+  for (int i = 0; i < triangle_count; i++) {
+    double normal[3], corners[3];
+    double area = triangle_frame(positions, &indices[i * 3], normal, corners);
+    for (int axis = 0; axis < 3; axis++) center[axis] += corners[axis] * area;
+    total_area += area;
+  }
+  for (int axis = 0; axis < 3; axis++)
+    center[axis] = total_area > 0 ? center[axis] / (total_area * 3) : 0;
+
+  for (int c = 0; c < count; c++) {
+    double sum[3] = {0, 0, 0}, normal_sum[3] = {0, 0, 0}, area_sum = 0;
+    for (int i = clusters[c].first; i < clusters[c].first + clusters[c].count;
+         i++) {
+      double normal[3], corners[3];
+      double area =
+          triangle_frame(positions, &indices[i * 3], normal, corners);
+      for (int axis = 0; axis < 3; axis++) {
+        sum[axis] += corners[axis] * area;
+        normal_sum[axis] += normal[axis];
+      }
+      area_sum += area;
+    }
+    double length = sqrt(normal_sum[0] * normal_sum[0] +
+                         normal_sum[1] * normal_sum[1] +
+                         normal_sum[2] * normal_sum[2]);
+    double key = 0;
+    for (int axis = 0; axis < 3 && area_sum > 0 && length > 0; axis++)
+      key += (sum[axis] / (area_sum * 3) - center[axis]) * normal_sum[axis] /
+             length;
+    clusters[c].key = key;
+  }
+}
+
+static int compare_clusters(const void *a, const void *b) {
+  const Cluster *x = a, *y = b;
+  if (x->key != y->key) return x->key > y->key ? -1 : 1;
+  return x->first - y->first;
+}
+
+static void sort_clusters(const float *positions, uint32_t *indices,
+                          int triangle_count, VertexCache *cache,
+                          uint32_t *scratch, int *error) {
+  Cluster *clusters = malloc(sizeof(Cluster) * triangle_count);
+  int *hard = malloc(sizeof(int) * (triangle_count + 1));
+  if (clusters == NULL || hard == NULL) {
+    printf("Error: Could not allocate memory for clusters\n");
+    *error = 1;
+    safe_free(clusters);
+    safe_free(hard);
+    return;
+  }
+  int count = split_clusters(indices, triangle_count, cache, hard, clusters);
+  rank_clusters(positions, indices, triangle_count, clusters, count);
+  qsort(clusters, count, sizeof(Cluster), compare_clusters);
+  int written = 0;
+  for (int c = 0; c < count; c++) {
+    memcpy(&scratch[written * 3], &indices[clusters[c].first * 3],
+           sizeof(uint32_t) * 3 * clusters[c].count);
+    written += clusters[c].count;
+  }
+  memcpy(indices, scratch, sizeof(uint32_t) * 3 * triangle_count);
+  free(clusters);
+  free(hard);
+}
+
+// Overdraw only applies to triangles.
+static void optimize_cache(const float *positions, uint32_t *indices,
+                           int index_count, int corners, int vertex_count,
+                           int overdraw, int *error) {
+  int primitive_count = index_count / corners;
+  if (primitive_count == 0) return;
+  index_count = primitive_count * corners;
+  Tipsify t = {0};
+  t.indices = indices;
+  t.corners = corners;
+  t.vertex_count = vertex_count;
+  t.offsets = malloc(sizeof(int) * (vertex_count + 1));
+  t.adjacency = malloc(sizeof(int) * index_count);
+  t.live = calloc(sizeof(int), vertex_count + 1);
+  t.emitted = calloc(1, primitive_count);
+  t.dead_ends = malloc(sizeof(int) * index_count);
+  t.cache = create_cache(vertex_count, error);
+  uint32_t *out = malloc(sizeof(uint32_t) * index_count);
+  if (!*error && (t.offsets == NULL || t.adjacency == NULL ||
+                  t.live == NULL || t.emitted == NULL ||
+                  t.dead_ends == NULL || out == NULL)) {
+    printf("Error: Could not allocate memory for vertex cache optimization\n");
+    *error = 1;
+  }
+
+  if (!*error) {
+    tipsify(&t, primitive_count, out);
+    memcpy(indices, out, sizeof(uint32_t) * index_count);
+    if (overdraw)
+      sort_clusters(positions, indices, primitive_count, &t.cache, out,
+                    error);
+  }
+  safe_free(t.offsets);
+  safe_free(t.adjacency);
+  safe_free(t.live);
+  safe_free(t.emitted);
+  safe_free(t.dead_ends);
+  safe_free(t.cache.stamps);
+  safe_free(out);
+}
+
+void optimize_vertex_cache(const float *positions, uint32_t *indices,
+                           int index_count, int vertex_count, int overdraw,
+                           int *error) {
+  optimize_cache(positions, indices, index_count, 3, vertex_count, overdraw,
+                 error);
+}
+
+void optimize_line_cache(uint32_t *indices, int index_count,
+                         int vertex_count, int *error) {
+  optimize_cache(NULL, indices, index_count, 2, vertex_count, 0, error);
+}
+
+void optimize_vertex_fetch(uint32_t *indices, int index_count,
+                           int vertex_count, uint32_t *remap) {
+  memset(remap, 0xFF, sizeof(uint32_t) * vertex_count);
+  uint32_t next = 0;
+  for (int i = 0; i < index_count; i++) {
+    uint32_t *remapped = &remap[indices[i]];
+    if (*remapped == UINT32_MAX) *remapped = next++;
+    indices[i] = *remapped;
+  }
+  for (int v = 0; v < vertex_count; v++)
+    if (remap[v] == UINT32_MAX) remap[v] = next++;
+}
@@ -0,0 +1,72 @@
+#ifndef INC_3DT_OPTIMIZE_H
+#define INC_3DT_OPTIMIZE_H
+
+#include <stdint.h>
+
+/// The number of entries of the FIFO vertex cache the passes optimize for
+/// and measure with.
+#define VERTEX_CACHE_SIZE 16
+
+/// How well an index order reuses a vertex cache. The average cache miss
+/// ratio is the number of transformed vertices per primitive, for triangles
+/// 0.5 at best and 3 at worst, for lines 2 at worst. The average
+/// transformed vertex ratio is the number per vertex, 1 at best.
+typedef struct CacheStats {
+    float acmr;
+    float atvr;
+} CacheStats;
+
+/// \brief Simulate a FIFO vertex cache of VERTEX_CACHE_SIZE entries.
+/// \param indices The triangles.
+/// \param index_count The number of indices.
+/// \param vertex_count The number of vertices.
+/// \return The miss ratios, 0 for no triangles.
+CacheStats measure_vertex_cache(const uint32_t *indices, int index_count,
+                                int vertex_count);
+
+/// \brief Simulate the same cache for a line list.
+/// \param indices The lines, two indices each.
+/// \param index_count The number of indices.
+/// \param vertex_count The number of vertices.
+/// \return The miss ratios, 0 for no lines.
+CacheStats measure_line_cache(const uint32_t *indices, int index_count,
+                              int vertex_count);
+
+/// \brief Reorder triangles for the post-transform vertex cache with
+/// Tipsify, which fans around the vertex that is most likely still cached.
+/// With overdraw set, the order is then split into clusters where the cache
+/// would be flushed or the miss ratio stays close, and the clusters are
+/// sorted so outward facing ones come first, which lets early depth tests
+/// reject more of what lies behind them.
+/// \param positions The x, y, z of every vertex, only read for overdraw.
+/// \param indices The triangles, reordered in place. The corners of every
+/// triangle keep their order, so the winding is unchanged.
+/// \param index_count The number of indices.
+/// \param vertex_count The number of vertices.
+/// \param overdraw Whether to sort the clusters.
+/// \param error The error code.
+void optimize_vertex_cache(const float *positions, uint32_t *indices,
+                           int index_count, int vertex_count, int overdraw,
+                           int *error);
+
+/// \brief Reorder lines for the vertex cache with the fans of Tipsify, so
+/// the lines around one vertex are drawn together.
+/// \param indices The lines, reordered in place. The ends of every line
+/// keep their order.
+/// \param index_count The number of indices.
+/// \param vertex_count The number of vertices.
+/// \param error The error code.
+void optimize_line_cache(uint32_t *indices, int index_count,
+                         int vertex_count, int *error);
+
+/// \brief Number vertices in the order the primitives first use them, so
+/// the vertex fetch reads memory front to back.
+/// \param indices The triangles or lines, renumbered in place.
+/// \param index_count The number of indices.
+/// \param vertex_count The number of vertices.
+/// \param remap Filled with the new index of every old vertex. Unused
+/// vertices are moved to the end in their old order.
+void optimize_vertex_fetch(uint32_t *indices, int index_count,
+                           int vertex_count, uint32_t *remap);
+
+#endif //INC_3DT_OPTIMIZE_H
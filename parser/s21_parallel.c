@@ -0,0 +1,277 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <pthread.h>
+
+#include "s21_mapping.h"
+#include "s21_parser.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#define MIN_CHUNK_SIZE (512 * 1024)
+
+struct ParseTracker {
+  pthread_mutex_t lock;
+  ParseProgress progress;
+  void *user;
+  size_t done;
+  size_t total;
+  int cancelled;
+};
+
+typedef struct ObjChunk {
+  const char *data;
+  size_t size;
+  ObjCounts counts;
+  ObjCounts base;
+  Obj *obj;
+  ParseTracker *tracker;
+  int error;
+} ObjChunk;
+
+int online_cpu_count(void) {
+#ifdef _WIN32
+  SYSTEM_INFO info;
+  GetSystemInfo(&info);
+  long count = info.dwNumberOfProcessors;
+#else
+  long count = sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+  return count > 0 ? (int)count : 1;
+}
+
+int track_progress(ParseTracker *tracker, size_t bytes) {
+  if (tracker == NULL) return 0;
+  pthread_mutex_lock(&tracker->lock);
+  tracker->done += bytes;
+  if (!tracker->cancelled && tracker->progress != NULL)
+    tracker->cancelled =
+        tracker->progress(tracker->done, tracker->total, tracker->user) != 0;
+  int cancelled = tracker->cancelled;
+  pthread_mutex_unlock(&tracker->lock);
+  return cancelled;
+}
+
+// Classifies line starts exactly like parse_obj_line does.
+static void *count_chunk(void *arg) {
+  ObjChunk *chunk = arg;
+  const char *ptr = chunk->data;
+  const char *end = chunk->data + chunk->size;
+  while (ptr < end) {
+    char first = ptr[0];
+    char second = ptr + 1 < end ? ptr[1] : '\0';
+    if (first == 'v' && second == ' ')
+      chunk->counts.vertices++;
+    else if (first == 'v' && second == 't')
+      chunk->counts.textures++;
+    else if (first == 'v' && second == 'n')
+      chunk->counts.normals++;
+    else if (first == 'f' && second == ' ')
+      chunk->counts.faces++;
+    const char *eol = memchr(ptr, '\n', end - ptr);
+    ptr = eol != NULL ? eol + 1 : end;
+  }
+  return NULL;
+}
+
+static void *parse_chunk(void *arg) {
+  ObjChunk *chunk = arg;
+  chunk->obj = init_obj(&chunk->error);
+  Obj *obj = chunk->obj;
+  if (!chunk->error) {
+    obj->vertices->vertices = malloc(sizeof(Vertex) * chunk->counts.vertices);
+    obj->textures->textures = malloc(sizeof(Texture) * chunk->counts.textures);
+    obj->normals->normals = malloc(sizeof(Normal) * chunk->counts.normals);
+    obj->vertices->capacity = chunk->counts.vertices;
+    obj->textures->capacity = chunk->counts.textures;
+    obj->normals->capacity = chunk->counts.normals;
+    if ((obj->vertices->vertices == NULL && chunk->counts.vertices > 0) ||
+        (obj->textures->textures == NULL && chunk->counts.textures > 0) ||
+        (obj->normals->normals == NULL && chunk->counts.normals > 0)) {
+      printf("Error: Could not allocate memory for obj\n");
+      chunk->error = 1;
+    }
+  }
+  if (!chunk->error)
+    reserve_faces(obj->faces, chunk->counts.faces, 0, &chunk->error);
+  if (!chunk->error)
+    parse_obj_chunk(chunk->data, chunk->size, obj, chunk->base, chunk->tracker,
+                    &chunk->error);
+  return NULL;
+}
+
+// The first chunk is handled by the calling thread.
+static void run_chunks(ObjChunk *chunks, int count, void *(*work)(void *),
+                       int *error) {
+  pthread_t *threads = calloc(sizeof(pthread_t), count);
+  int *started = calloc(sizeof(int), count);
+  if (threads == NULL || started == NULL) {
+    printf("Error: Could not allocate memory for threads\n");
+    *error = 1;
+  }
+  for (int i = 1; i < count && !*error; i++)
+    started[i] = pthread_create(&threads[i], NULL, work, &chunks[i]) == 0;
+  if (!*error) work(&chunks[0]);
+  for (int i = 1; i < count && !*error; i++) {
+    if (started[i])
+      pthread_join(threads[i], NULL);
+    else
+      work(&chunks[i]);
+  }
+  safe_free(threads);
+  safe_free(started);
+}
+
+static int split_chunks(const char *data, size_t size, int threads,
+                        ObjChunk *chunks) {
+  int count = 0;
+  const char *ptr = data;
+  const char *end = data + size;
+  for (int i = 1; i <= threads && ptr < end; i++) {
+    const char *chunk_end = i == threads ? end : data + size / threads * i;
+    if (chunk_end < ptr) chunk_end = ptr;
+    const char *eol = memchr(chunk_end, '\n', end - chunk_end);
+    chunk_end = eol != NULL ? eol + 1 : end;
+    chunks[count].data = ptr;
+    chunks[count].size = chunk_end - ptr;
+    count++;
+    ptr = chunk_end;
+  }
+  return count;
+}
+
+static int has_counted_records(ObjChunk *chunk) {
+  Obj *obj = chunk->obj;
+  return obj != NULL && obj->vertices->count == chunk->counts.vertices &&
+         obj->textures->count == chunk->counts.textures &&
+         obj->normals->count == chunk->counts.normals &&
+         obj->faces->count == chunk->counts.faces;
+}
+
+static void *alloc_records(int count, size_t size, int *error) {
+  void *records = malloc(size * (count > 0 ? count : 1));
+  if (records == NULL) {
+    printf("Error: Could not allocate memory for obj\n");
+    *error = 1;
+  }
+  return records;
+}
+
+static void copy_records(void *to, const void *from, int count, size_t size) {
+  if (count > 0) memcpy(to, from, size * count);
+}
+
+// Copies every chunk to its prefix-sum offset in the joined arrays. Face
+// offsets are shifted by the corners of all previous chunks.
+static void stitch_chunks(ObjChunk *chunks, int count, Obj *obj, int *error) {
+  ObjChunk *last = &chunks[count - 1];
+  int index_count = 0;
+  for (int i = 0; i < count; i++)
+    index_count += chunks[i].obj->faces->index_count;
+  obj->vertices->count = last->base.vertices + last->counts.vertices;
+  obj->textures->count = last->base.textures + last->counts.textures;
+  obj->normals->count = last->base.normals + last->counts.normals;
+  obj->vertices->vertices =
+      alloc_records(obj->vertices->count, sizeof(Vertex), error);
+  obj->textures->textures =
+      alloc_records(obj->textures->count, sizeof(Texture), error);
+  obj->normals->normals =
+      alloc_records(obj->normals->count, sizeof(Normal), error);
+  obj->vertices->capacity = obj->vertices->count;
+  obj->textures->capacity = obj->textures->count;
+  obj->normals->capacity = obj->normals->count;
+  if (!*error)
+    reserve_faces(obj->faces, last->base.faces + last->counts.faces,
+                  index_count, error);
+  if (*error) return;
+
+  Faces *faces = obj->faces;
+  // a file without faces reserves none and has no offsets
+  if (faces->offsets != NULL) faces->offsets[0] = 0;
+  for (int i = 0; i < count; i++) {
+    Obj *part = chunks[i].obj;
+    ObjCounts base = chunks[i].base;
+    copy_records(obj->vertices->vertices + base.vertices,
+                 part->vertices->vertices, part->vertices->count,
+                 sizeof(Vertex));
+    copy_records(obj->textures->textures + base.textures,
+                 part->textures->textures, part->textures->count,
+                 sizeof(Texture));
+    copy_records(obj->normals->normals + base.normals, part->normals->normals,
+                 part->normals->count, sizeof(Normal));
+
+    Faces *part_faces = part->faces;
+    int first = faces->index_count;
+    copy_records(faces->vertex_indices + first, part_faces->vertex_indices,
+                 part_faces->index_count, sizeof(int));
+    copy_records(faces->texture_indices + first, part_faces->texture_indices,
+                 part_faces->index_count, sizeof(int));
+    copy_records(faces->normal_indices + first, part_faces->normal_indices,
+                 part_faces->index_count, sizeof(int));
+    for (int j = 1; j <= part_faces->count; j++)
+      faces->offsets[faces->count + j] = first + part_faces->offsets[j];
+    faces->count += part_faces->count;
+    faces->index_count += part_faces->index_count;
+  }
+  update_face_views(faces);
+}
+
+Obj *parse_obj_parallel(const char *filename, int threads) {
+  ParseOptions options = {threads, NULL, NULL};
+  return parse_obj_ex(filename, options);
+}
+
+Obj *parse_obj_ex(const char *filename, ParseOptions options) {
+  int error = 0;
+  int threads = options.threads;
+  FileMapping mapping = map_file(filename, &error);
+  ParseTracker tracker = {.progress = options.progress, .user = options.user};
+  tracker.total = mapping.size;
+  pthread_mutex_init(&tracker.lock, NULL);
+  if (threads <= 0) threads = online_cpu_count();
+  if (mapping.size / MIN_CHUNK_SIZE + 1 < (size_t)threads)
+    threads = mapping.size / MIN_CHUNK_SIZE + 1;
+
+  ObjChunk *chunks = NULL;
+  int count = 0;
+  if (!error) {
+    chunks = calloc(sizeof(ObjChunk), threads);
+    if (chunks == NULL) {
+      printf("Error: Could not allocate memory for chunks\n");
+      error = 1;
+    }
+  }
+  if (!error) count = split_chunks(mapping.data, mapping.size, threads, chunks);
+  for (int i = 0; i < count; i++) chunks[i].tracker = &tracker;
+
+  // first pass: count records per chunk so every chunk knows how many records
+  // precede it and relative indices resolve against the whole file
+  if (!error && count > 0) run_chunks(chunks, count, count_chunk, &error);
+  for (int i = 1; i < count; i++) {
+    chunks[i].base = chunks[i - 1].base;
+    chunks[i].base.vertices += chunks[i - 1].counts.vertices;
+    chunks[i].base.textures += chunks[i - 1].counts.textures;
+    chunks[i].base.normals += chunks[i - 1].counts.normals;
+    chunks[i].base.faces += chunks[i - 1].counts.faces;
+  }
+  if (!error && track_progress(&tracker, 0)) error = 1;
+  if (!error && count > 0) run_chunks(chunks, count, parse_chunk, &error);
+  for (int i = 0; i < count && !error; i++)
+    error = chunks[i].error || !has_counted_records(&chunks[i]);
+
+  Obj *obj = NULL;
+  if (!error) obj = init_obj(&error);
+  if (!error && count > 0) stitch_chunks(chunks, count, obj, &error);
+  for (int i = 0; i < count; i++) destroy_obj(chunks[i].obj);
+  safe_free(chunks);
+  unmap_file(&mapping);
+  pthread_mutex_destroy(&tracker.lock);
+  if (error && obj != NULL) {
+    destroy_obj(obj);
+    obj = NULL;
+  }
+  return obj;
+}
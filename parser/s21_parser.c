@@ -1,15 +1,21 @@
 #include "s21_parser.h"
 
-void advance(char **ptr) { (*ptr)++; }
+#include "s21_mapping.h"
+#include "s21_number.h"
+#include "s21_triangulate.h"
 
-void advance_n(char **ptr, int n) { (*ptr) += n; }
+#define PROGRESS_STEP (256 * 1024)
 
-void advance_whitespace(char **ptr) {
-  while ((**ptr == ' ' || **ptr == '\t') && **ptr != '\0') advance(ptr);
+void advance(const char **ptr) { (*ptr)++; }
+
+void advance_whitespace(const char **ptr) {
+  while (**ptr == ' ' || **ptr == '\t') advance(ptr);
 }
 
-void advance_to_whitespace(char **ptr) {
-  while (**ptr != ' ' && **ptr != '\t' && **ptr != '\0') advance(ptr);
+static int is_line_end(char c) { return c == '\0' || c == '\n' || c == '\r'; }
+
+static int is_separator(char c) {
+  return c == ' ' || c == '\t' || is_line_end(c);
 }
 
 Obj *init_obj(int *error) {
@@ -40,12 +46,9 @@ void destroy_obj(Obj *obj) {
   if (obj == NULL) return;
   safe_free(obj->vertices->vertices);
   safe_free(obj->vertices);
-  for (int i = 0; i < obj->faces->count; i++) {
-    safe_free(obj->faces->faces[i].vertex_indices);
-    safe_free(obj->faces->faces[i].texture_indices);
-    safe_free(obj->faces->faces[i].normal_indices);
-  }
   safe_free(obj->faces->faces);
+  safe_free(obj->faces->offsets);
+  safe_free(obj->faces->vertex_indices);
   safe_free(obj->faces);
   safe_free(obj->normals->normals);
   safe_free(obj->normals);
@@ -55,17 +58,12 @@ void destroy_obj(Obj *obj) {
 }
 
 Obj *parse_obj(const char *filename) {
-  FILE *file = fopen(filename, "r");
   int error = 0;
-  if (file == NULL) {
-    printf("Error: Could not open file %s\n", filename);
-    error = 1;
-  }
+  FileMapping mapping = map_file(filename, &error);
   Obj *obj = NULL;
   if (!error) obj = init_obj(&error);
-  if (!error) prepare_obj(file, obj, &error);
-  if (!error) parse_obj_file(file, obj, &error);
-  if (file != NULL) fclose(file);
+  if (!error) parse_obj_data(mapping.data, mapping.size, obj, &error);
+  unmap_file(&mapping);
   if (error && obj != NULL) {
     destroy_obj(obj);
     obj = NULL;
@@ -73,233 +71,323 @@ Obj *parse_obj(const char *filename) {
   return obj;
 }
 
-void prepare_obj(FILE *file, Obj *obj, int *error) {
-  if (file == NULL || obj == NULL) {
+static void *grow_items(void *items, int *capacity, int count, size_t size,
+                        int *error) {
+  if (count <= *capacity) return items;
+  int new_capacity = *capacity > 0 ? *capacity : 64;
+  while (new_capacity < count) new_capacity *= 2;
+  void *grown = realloc(items, new_capacity * size);
+  if (grown == NULL) {
+    printf("Error: Could not allocate memory for obj\n");
     *error = 1;
-    return;
+    return items;
   }
+  *capacity = new_capacity;
+  return grown;
+}
 
-  char line[256] = {0};
-  while (fgets(line, 256, file)) {
-    if (line[0] == 'v' && line[1] == ' ') {
-      obj->vertices->count++;
-    } else if (line[0] == 'v' && line[1] == 't') {
-      obj->textures->count++;
-    } else if (line[0] == 'v' && line[1] == 'n') {
-      obj->normals->count++;
-    } else if (line[0] == 'f' && line[1] == ' ') {
-      obj->faces->count++;
-    }
-  }
-  obj->vertices->vertices = calloc(sizeof(Vertex), obj->vertices->count);
-  obj->textures->textures = calloc(sizeof(Texture), obj->textures->count);
-  obj->normals->normals = calloc(sizeof(Normal), obj->normals->count);
-  obj->faces->faces = calloc(sizeof(Face), obj->faces->count);
-  if (obj->vertices->vertices == NULL || obj->textures->textures == NULL ||
-      obj->normals->normals == NULL || obj->faces->faces == NULL) {
-    printf("Error: Could not allocate memory for obj\n");
-    *error = 1;
+void parse_obj_data(const char *data, size_t size, Obj *obj, int *error) {
+  ObjCounts base = {0};
+  parse_obj_chunk(data, size, obj, base, NULL, error);
+}
+
+// Relative (negative) indices count back from the records read so far.
+static void resolve_relative_indices(Face *face, Obj *obj, ObjCounts base) {
+  for (int i = 0; i < face->vertex_count; i++) {
+    if (face->vertex_indices[i] < 0)
+      face->vertex_indices[i] +=
+          base.vertices + obj->vertices->count + 1;
+    if (face->texture_indices[i] < 0)
+      face->texture_indices[i] +=
+          base.textures + obj->textures->count + 1;
+    if (face->normal_indices[i] < 0)
+      face->normal_indices[i] += base.normals + obj->normals->count + 1;
   }
-  rewind(file);
 }
 
-void parse_obj_file(FILE *file, Obj *obj, int *error) {
-  if (file == NULL || obj == NULL) {
+void parse_obj_chunk(const char *data, size_t size, Obj *obj, ObjCounts base,
+                     ParseTracker *tracker, int *error) {
+  if (obj == NULL) {
     *error = 1;
     return;
   }
-  int vertex_index = 0;
-  int texture_index = 0;
-  int normal_index = 0;
-  int face_index = 0;
-  char line[256] = {0};
-  while (fgets(line, 256, file)) {
-    if (line[0] == 'v' && line[1] == ' ') {
-      obj->vertices->vertices[vertex_index] = parse_vertex(line, error);
-      vertex_index++;
-    } else if (line[0] == 'v' && line[1] == 't') {
-      obj->textures->textures[texture_index] = parse_texture(line, error);
-      texture_index++;
-    } else if (line[0] == 'v' && line[1] == 'n') {
-      obj->normals->normals[normal_index] = parse_normal(line, error);
-      normal_index++;
-    } else if (line[0] == 'f' && line[1] == ' ') {
-      obj->faces->faces[face_index] = parse_face(line, error);
-      face_index++;
+  // the line parsers stop at a newline, so lines are read in place; only a
+  // last line without one is copied to get a terminator
+  const char *ptr = data;
+  const char *end = data + size;
+  char *copy = NULL;
+  const char *reported = data;
+  while (ptr < end && !*error) {
+    const char *line = ptr;
+    const char *eol = memchr(ptr, '\n', end - ptr);
+    if (eol != NULL) {
+      ptr = eol + 1;
+    } else {
+      line = copy = calloc(end - ptr + 1, 1);
+      if (copy == NULL) {
+        printf("Error: Could not allocate memory for line\n");
+        *error = 1;
+        break;
+      }
+      memcpy(copy, ptr, end - ptr);
+      ptr = end;
+    }
+    int face_count = obj->faces->count;
+    parse_obj_line(line, obj, error);
+    if (!*error && obj->faces->count != face_count)
+      resolve_relative_indices(&obj->faces->faces[face_count], obj, base);
+    if (ptr - reported >= PROGRESS_STEP || ptr == end) {
+      if (track_progress(tracker, ptr - reported)) *error = 1;
+      reported = ptr;
     }
   }
+  safe_free(copy);
 }
 
-Vertex parse_vertex(char *line, int *error) {
-  char *ptr = line;
-  Vertex vertex;
-  advance(&ptr);
-  advance_whitespace(&ptr);
-  *error = sscanf(ptr, "%f", &vertex.x) != 1;
-  advance_to_whitespace(&ptr);
-  advance_whitespace(&ptr);
-  *error = sscanf(ptr, "%f", &vertex.y) != 1;
-  advance_to_whitespace(&ptr);
-  advance_whitespace(&ptr);
-  *error = sscanf(ptr, "%f", &vertex.z) != 1;
-  ;
-  advance_to_whitespace(&ptr);
+void parse_obj_line(const char *line, Obj *obj, int *error) {
+  if (line[0] == 'v' && line[1] == ' ') {
+    Vertices *vertices = obj->vertices;
+    vertices->vertices =
+        grow_items(vertices->vertices, &vertices->capacity,
+                   vertices->count + 1, sizeof(Vertex), error);
+    if (!*error)
+      vertices->vertices[vertices->count++] = parse_vertex(line, error);
+  } else if (line[0] == 'v' && line[1] == 't') {
+    Textures *textures = obj->textures;
+    textures->textures =
+        grow_items(textures->textures, &textures->capacity,
+                   textures->count + 1, sizeof(Texture), error);
+    if (!*error)
+      textures->textures[textures->count++] = parse_texture(line, error);
+  } else if (line[0] == 'v' && line[1] == 'n') {
+    Normals *normals = obj->normals;
+    normals->normals = grow_items(normals->normals, &normals->capacity,
+                                  normals->count + 1, sizeof(Normal), error);
+    if (!*error) normals->normals[normals->count++] = parse_normal(line, error);
+  } else if (line[0] == 'f' && line[1] == ' ') {
+    parse_face(line, obj->faces, error);
+  }
+}
+
+// Scan a float preceded by whitespace. A failure leaves ptr in place so the
+// following components fail too.
+static const char *scan_component(const char *ptr, float *value,
+                                  int *failed) {
   advance_whitespace(&ptr);
-  if (*ptr != '\0' && *ptr != '\n') {
-    *error = sscanf(ptr, "%f", &vertex.w) != 1;
+  const char *end = scan_float(ptr, value);
+  if (end == NULL || !is_separator(*end)) {
+    *failed = 1;
+    return ptr;
   }
-  if (*error) {
+  return end;
+}
+
+static int has_component(const char *ptr) {
+  advance_whitespace(&ptr);
+  return !is_line_end(*ptr);
+}
+
+Vertex parse_vertex(const char *line, int *error) {
+  const char *ptr = line + 1;
+  Vertex vertex = {0.0f, 0.0f, 0.0f, 1.0f};
+  int failed = 0;
+  ptr = scan_component(ptr, &vertex.x, &failed);
+  ptr = scan_component(ptr, &vertex.y, &failed);
+  ptr = scan_component(ptr, &vertex.z, &failed);
+  if (!failed && has_component(ptr))
+    ptr = scan_component(ptr, &vertex.w, &failed);
+  if (failed) {
     printf("Error: Could not parse vertex\n");
+    *error = 1;
   }
   return vertex;
 }
 
-Texture parse_texture(char *line, int *error) {
-  char *ptr = line;
-  Texture texture;
-  advance(&ptr);
-  advance(&ptr);
-  advance_whitespace(&ptr);
-  *error = sscanf(ptr, "%f", &texture.u) != 1;
-  advance_to_whitespace(&ptr);
-  advance_whitespace(&ptr);
-  *error = sscanf(ptr, "%f", &texture.v) != 1;
-  advance_to_whitespace(&ptr);
-  advance_whitespace(&ptr);
-  if (*ptr != '\0' && *ptr != '\n') {
-    *error = sscanf(ptr, "%f", &texture.w) != 1;
-  }
-  if (*error) {
+Texture parse_texture(const char *line, int *error) {
+  const char *ptr = line + 2;
+  Texture texture = {0.0f, 0.0f, 0.0f};
+  int failed = 0;
+  ptr = scan_component(ptr, &texture.u, &failed);
+  if (!failed && has_component(ptr))
+    ptr = scan_component(ptr, &texture.v, &failed);
+  if (!failed && has_component(ptr))
+    ptr = scan_component(ptr, &texture.w, &failed);
+  if (failed) {
     printf("Error: Could not parse texture\n");
+    *error = 1;
   }
   return texture;
 }
 
-Normal parse_normal(char *line, int *error) {
-  char *ptr = line;
-  Normal normal;
-  advance(&ptr);
-  advance(&ptr);
-  advance_whitespace(&ptr);
-  *error = sscanf(ptr, "%f", &normal.x) != 1;
-  advance_to_whitespace(&ptr);
-  advance_whitespace(&ptr);
-  *error = sscanf(ptr, "%f", &normal.y) != 1;
-  advance_to_whitespace(&ptr);
-  advance_whitespace(&ptr);
-  *error = sscanf(ptr, "%f", &normal.z) != 1;
-  if (*error) {
+Normal parse_normal(const char *line, int *error) {
+  const char *ptr = line + 2;
+  Normal normal = {0.0f, 0.0f, 0.0f};
+  int failed = 0;
+  ptr = scan_component(ptr, &normal.x, &failed);
+  ptr = scan_component(ptr, &normal.y, &failed);
+  ptr = scan_component(ptr, &normal.z, &failed);
+  if (failed) {
     printf("Error: Could not parse normal\n");
+    *error = 1;
   }
   return normal;
 }
 
-Face parse_face(char *line, int *error) {
-  char *ptr = line;
-  Face face = {0};
-  advance(&ptr);
-  advance_whitespace(&ptr);
-  int count = 0;
-  while (*ptr != '\0') {
-    count++;
-    advance_to_whitespace(&ptr);
-    advance_whitespace(&ptr);
+// An index may carry the legacy 'v', 'vt' or 'vn' prefix.
+static const char *scan_index(const char *ptr, char tag, int *index,
+                              int *failed) {
+  if (*ptr == 'v') {
+    advance(&ptr);
+    if (tag != '\0' && *ptr == tag) advance(&ptr);
   }
-  face.vertex_indices = calloc(sizeof(int), count);
-  face.texture_indices = calloc(sizeof(int), count);
-  face.normal_indices = calloc(sizeof(int), count);
-  face.vertex_count = count;
-  if (face.vertex_indices == NULL || face.texture_indices == NULL ||
-      face.normal_indices == NULL) {
-    printf("Error: Could not allocate memory for face\n");
-    *error = 1;
+  const char *end = scan_int(ptr, index);
+  if (end == NULL) {
+    *failed = 1;
+    return ptr;
   }
-  ptr = line;
-
-  //    regex: f(\s(v?)\d+(\/((vt?)\d+)?(\/((vn?)\d+)?)?)?){3,}
+  return end;
+}
 
-  advance(&ptr);
-  for (int i = 0; i < count; i++) {
+//    corner: (v?)\d+(\/((vt?)\d+)?(\/((vn?)\d+)?)?)?
+static const char *scan_face_corner(const char *ptr, int *vertex,
+                                    int *texture, int *normal, int *failed) {
+  ptr = scan_index(ptr, '\0', vertex, failed);
+  if (!*failed && *ptr == '/') {
     advance(&ptr);
-    if (*ptr == 'v') advance(&ptr);
-    int len = 0;
-    *error = sscanf(ptr, "%d%n", &face.vertex_indices[i], &len) != 1;
-    advance_n(&ptr, len);
-    if (*ptr == '/' && !*error) {
+    if (*ptr != '/' && !is_separator(*ptr))
+      ptr = scan_index(ptr, 't', texture, failed);
+    if (!*failed && *ptr == '/') {
       advance(&ptr);
-      if (*ptr == 'v' && *(ptr + 1) == 't') {
-        advance_n(&ptr, 2);
-        *error = sscanf(ptr, "%d%n", &face.texture_indices[i], &len) != 1;
-      } else {
-        len = 0;
-        int scan = sscanf(ptr, "%d%n", &face.texture_indices[i], &len);
-        if (scan != 1) face.texture_indices[i] = 0;
-      }
-      ptr += len;
-      if (*ptr == '/' && !*error) {
-        advance(&ptr);
-        // ((vn?)\d+)?
-        if (*ptr == 'v' && *(ptr + 1)) {
-          advance_n(&ptr, 2);
-          *error = sscanf(ptr, "%d%n", &face.normal_indices[i], &len) != 1;
-        } else {
-          len = 0;
-          int scan = sscanf(ptr, "%d%n", &face.normal_indices[i], &len);
-          if (scan != 1) face.normal_indices[i] = 0;
-        }
-        ptr += len;
-      }
+      if (!is_separator(*ptr)) ptr = scan_index(ptr, 'n', normal, failed);
     }
   }
+  if (!is_separator(*ptr)) *failed = 1;
+  return ptr;
+}
 
-  if (*error) {
+void update_face_views(Faces *faces) {
+  for (int i = 0; i < faces->count; i++) {
+    int offset = faces->offsets[i];
+    faces->faces[i].vertex_indices = faces->vertex_indices + offset;
+    faces->faces[i].texture_indices = faces->texture_indices + offset;
+    faces->faces[i].normal_indices = faces->normal_indices + offset;
+    faces->faces[i].vertex_count = faces->offsets[i + 1] - offset;
+  }
+}
+
+static void grow_index_pool(Faces *faces, int index_count, int *error) {
+  int capacity = faces->index_capacity > 0 ? faces->index_capacity : 256;
+  while (capacity < index_count) capacity *= 2;
+  int *pool = malloc(sizeof(int) * 3 * (size_t)capacity);
+  if (pool == NULL) {
+    printf("Error: Could not allocate memory for face indices\n");
+    *error = 1;
+    return;
+  }
+  if (faces->index_count > 0) {
+    size_t size = sizeof(int) * faces->index_count;
+    memcpy(pool, faces->vertex_indices, size);
+    memcpy(pool + capacity, faces->texture_indices, size);
+    memcpy(pool + 2 * capacity, faces->normal_indices, size);
+  }
+  safe_free(faces->vertex_indices);
+  faces->vertex_indices = pool;
+  faces->texture_indices = pool + capacity;
+  faces->normal_indices = pool + 2 * capacity;
+  faces->index_capacity = capacity;
+  // geometric growth keeps the total cost of refreshing the views linear
+  update_face_views(faces);
+}
+
+void reserve_faces(Faces *faces, int face_count, int index_count, int *error) {
+  if (face_count > faces->capacity) {
+    int capacity = faces->capacity > 0 ? faces->capacity : 64;
+    while (capacity < face_count) capacity *= 2;
+    Face *views = realloc(faces->faces, sizeof(Face) * capacity);
+    if (views != NULL) faces->faces = views;
+    int *offsets =
+        views != NULL ? realloc(faces->offsets, sizeof(int) * (capacity + 1))
+                      : NULL;
+    if (offsets != NULL) faces->offsets = offsets;
+    if (views == NULL || offsets == NULL) {
+      printf("Error: Could not allocate memory for faces\n");
+      *error = 1;
+    } else {
+      faces->capacity = capacity;
+    }
+  }
+  if (!*error && index_count > faces->index_capacity)
+    grow_index_pool(faces, index_count, error);
+}
+
+Face parse_face(const char *line, Faces *faces, int *error) {
+  Face face = {0};
+  const char *ptr = line + 1;
+  int first = faces->index_count;
+  int failed = 0;
+  reserve_faces(faces, faces->count + 1, first, error);
+  advance_whitespace(&ptr);
+  while (!*error && !failed && !is_line_end(*ptr)) {
+    int i = faces->index_count;
+    if (i == faces->index_capacity) reserve_faces(faces, 0, i + 1, error);
+    if (*error) break;
+    faces->texture_indices[i] = 0;
+    faces->normal_indices[i] = 0;
+    ptr = scan_face_corner(ptr, &faces->vertex_indices[i],
+                           &faces->texture_indices[i],
+                           &faces->normal_indices[i], &failed);
+    faces->index_count++;
+    advance_whitespace(&ptr);
+  }
+
+  if (!*error && (failed || faces->index_count - first < 3)) {
     printf("Error: Could not parse face\n");
+    *error = 1;
   }
+  if (*error) {
+    faces->index_count = first;
+    return face;
+  }
+  faces->offsets[faces->count] = first;
+  faces->offsets[faces->count + 1] = faces->index_count;
+  face.vertex_indices = faces->vertex_indices + first;
+  face.texture_indices = faces->texture_indices + first;
+  face.normal_indices = faces->normal_indices + first;
+  face.vertex_count = faces->index_count - first;
+  faces->faces[faces->count++] = face;
   return face;
 }
 
 Triangles triangulate(Obj *obj, int *error) {
-  // if vertex count is greater than 3, triangulate count - 2 triangles
-  //    print_faces(obj->faces);
-  int triangles_count = 0;
-  for (int i = 0; i < obj->faces->count; i++)
-    triangles_count += obj->faces->faces[i].vertex_count - 2;
+  return triangulate_ex(obj, 0, error);
+}
+
+Triangles triangulate_ex(Obj *obj, int threads, int *error) {
   Triangles triangles = {0};
-  triangles.count = triangles_count;
-  triangles.triangles = calloc(sizeof(Triangle), triangles_count);
-  if (triangles.triangles == NULL) {
+  triangles.count = count_triangles(obj->faces);
+  triangles.triangles = malloc(sizeof(Triangle) * triangles.count);
+  if (triangles.triangles == NULL && triangles.count > 0) {
     printf("Error: Could not allocate memory for triangles\n");
     *error = 1;
   }
-  if (!*error) {
-    int index = 0;
-    for (int i = 0; i < obj->faces->count; i++) {
-      for (int j = 0; j < obj->faces->faces[i].vertex_count - 2; j++) {
-        triangles.triangles[index].vertex_indices[0] =
-            obj->faces->faces[i].vertex_indices[0];
-        triangles.triangles[index].vertex_indices[1] =
-            obj->faces->faces[i].vertex_indices[j + 1];
-        triangles.triangles[index].vertex_indices[2] =
-            obj->faces->faces[i].vertex_indices[j + 2];
-        triangles.triangles[index].texture_indices[0] =
-            obj->faces->faces[i].texture_indices[0];
-        triangles.triangles[index].texture_indices[1] =
-            obj->faces->faces[i].texture_indices[j + 1];
-        triangles.triangles[index].texture_indices[2] =
-            obj->faces->faces[i].texture_indices[j + 2];
-        triangles.triangles[index].normal_indices[0] =
-            obj->faces->faces[i].normal_indices[0];
-        triangles.triangles[index].normal_indices[1] =
-            obj->faces->faces[i].normal_indices[j + 1];
-        triangles.triangles[index].normal_indices[2] =
-            obj->faces->faces[i].normal_indices[j + 2];
-        index++;
-      }
-    }
-  }
+  if (!*error && triangles.count > 0)
+    triangulate_faces(obj->faces, obj->vertices, triangles.triangles, threads,
+                      error);
   return triangles;
 }
 
+// faces without texture or normal references store index 0, and those
+// attributes then stay zeroed
+void fill_vertex_data(Obj *obj, int vertex_index, int texture_index,
+                             int normal_index, VertexData *data) {
+  if (vertex_index > 0 && vertex_index <= obj->vertices->count)
+    data->position = obj->vertices->vertices[vertex_index - 1];
+  if (texture_index > 0 && texture_index <= obj->textures->count)
+    data->texture = obj->textures->textures[texture_index - 1];
+  if (normal_index > 0 && normal_index <= obj->normals->count)
+    data->normal = obj->normals->normals[normal_index - 1];
+}
+
 VertexBuffer create_vertex_buffer(Obj *obj, Triangles triangles, int *error) {
   VertexData *vertex_data = calloc(sizeof(VertexData), triangles.count * 3);
   if (vertex_data == NULL) {
@@ -310,14 +398,10 @@ VertexBuffer create_vertex_buffer(Obj *obj, Triangles triangles, int *error) {
   if (!*error) {
     for (int i = 0; i < triangles.count; i++) {
       for (int j = 0; j < 3; j++) {
-        vertex_data[i * 3 + j].position =
-            obj->vertices
-                ->vertices[triangles.triangles[i].vertex_indices[j] - 1];
-        vertex_data[i * 3 + j].texture =
-            obj->textures
-                ->textures[triangles.triangles[i].texture_indices[j] - 1];
-        vertex_data[i * 3 + j].normal =
-            obj->normals->normals[triangles.triangles[i].normal_indices[j] - 1];
+        fill_vertex_data(obj, triangles.triangles[i].vertex_indices[j],
+                         triangles.triangles[i].texture_indices[j],
+                         triangles.triangles[i].normal_indices[j],
+                         &vertex_data[i * 3 + j]);
       }
     }
   }
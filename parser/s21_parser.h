@@ -15,8 +15,10 @@ typedef struct Vertex {
 typedef struct Vertices {
     Vertex *vertices;
     int count;
+    int capacity;
 } Vertices;
 
+/// A view of one face's corners inside the Faces index pool.
 typedef struct Face {
     int *vertex_indices;
     int *texture_indices;
@@ -24,9 +26,19 @@ typedef struct Face {
     int vertex_count;
 } Face;
 
+/// Faces in CSR layout: the corners of face i are the pool entries from
+/// offsets[i] to offsets[i + 1]. The three index arrays share one
+/// allocation of 3 * index_capacity ints.
 typedef struct Faces {
     Face *faces;
     int count;
+    int capacity;
+    int *offsets;
+    int *vertex_indices;
+    int *texture_indices;
+    int *normal_indices;
+    int index_count;
+    int index_capacity;
 } Faces;
 
 
@@ -39,6 +51,7 @@ typedef struct Normal {
 typedef struct Normals {
     Normal *normals;
     int count;
+    int capacity;
 } Normals;
 
 typedef struct Texture {
@@ -50,6 +63,7 @@ typedef struct Texture {
 typedef struct Textures {
     Texture *textures;
     int count;
+    int capacity;
 } Textures;
 
 typedef struct Obj {
@@ -59,6 +73,26 @@ typedef struct Obj {
     Textures *textures;
 } Obj;
 
+typedef struct ObjCounts {
+    int vertices;
+    int textures;
+    int normals;
+    int faces;
+} ObjCounts;
+
+/// \brief Receives the number of bytes parsed so far. Calls are serialized
+/// but may come from any parser thread. Returning nonzero cancels the parse.
+typedef int (*ParseProgress)(size_t done, size_t total, void *user);
+
+typedef struct ParseOptions {
+    int threads;
+    ParseProgress progress;
+    void *user;
+} ParseOptions;
+
+/// Progress and cancellation state shared by the chunks of one parse.
+typedef struct ParseTracker ParseTracker;
+
 typedef struct Triangle {
     int vertex_indices[3];
     int texture_indices[3];
@@ -82,13 +116,13 @@ typedef struct VertexBuffer {
 } VertexBuffer;
 
 
-/// \brief Advance the pointer to the next non-whitespace character.
+/// \brief Advance the pointer to the next character.
 /// \param ptr The pointer to advance.
-void advance(char **ptr);
+void advance(const char **ptr);
 
 /// \brief Advance the pointer to the next non-whitespace character.
 /// \param ptr The pointer to advance.
-void advance_whitespace(char **ptr);
+void advance_whitespace(const char **ptr);
 
 /// \brief initialize an Obj struct.
 /// \param error The error code.
@@ -104,58 +138,122 @@ void destroy_obj(Obj *obj);
 /// \return The struct containing the parsed obj file.
 Obj *parse_obj(const char *filename);
 
+/// \brief Parse an obj file on several threads.
+/// The file is split into newline-aligned chunks that are parsed in parallel
+/// and joined in file order, so the result is identical to parse_obj.
+/// \param filename The filename of the obj file.
+/// \param threads The number of threads, 0 to use every online core.
+/// \return The struct containing the parsed obj file.
+Obj *parse_obj_parallel(const char *filename, int threads);
+
+/// \brief Parse an obj file on several threads, reporting progress.
+/// \param filename The filename of the obj file.
+/// \param options The thread count (0 for every online core) and an optional
+/// progress callback that can cancel the parse.
+/// \return The struct containing the parsed obj file, NULL on error or when
+/// the parse was cancelled.
+Obj *parse_obj_ex(const char *filename, ParseOptions options);
+
+/// \brief Add parsed bytes to the progress of a parse.
+/// \param tracker The progress to update, may be NULL.
+/// \param bytes The number of bytes parsed since the last call.
+/// \return 1 if the parse was cancelled, 0 otherwise.
+int track_progress(ParseTracker *tracker, size_t bytes);
+
+/// \brief The number of online processors.
+/// \return The number of processors, at least 1.
+int online_cpu_count(void);
+
 /// \brief Free a pointer if it is not NULL.
 /// \param ptr The pointer to free.
 void safe_free(void *ptr);
 
-/// \brief Allocate memory for future parsing.
-/// \param file The file to parse.
+/// \brief Parse the contents of an obj file in a single pass.
+/// \param data The file contents, lines may be of any length.
+/// \param size The size of the contents in bytes.
 /// \param obj The obj struct to store the data in.
 /// \param error The error code.
-void prepare_obj(FILE *file, Obj *obj, int *error);
+void parse_obj_data(const char *data, size_t size, Obj *obj, int *error);
 
-/// \brief Parse the obj file.
-/// \param file The file to parse.
+/// \brief Parse a part of an obj file that starts at a line boundary.
+/// \param data The chunk contents.
+/// \param size The size of the chunk in bytes.
 /// \param obj The obj struct to store the data in.
-/// \param error The error code.
-void parse_obj_file(FILE *file, Obj *obj, int *error);
-
-/// \brief Parse a line of the obj file.
-/// \param line The line to parse.
+/// \param base The number of records in the file before this chunk, used to
+/// resolve relative indices.
+/// \param tracker The progress to report to, may be NULL.
+/// \param error The error code, also set when the parse is cancelled.
+void parse_obj_chunk(const char *data, size_t size, Obj *obj, ObjCounts base,
+                     ParseTracker *tracker, int *error);
+
+/// \brief Parse a line of the obj file and append the result to obj.
+/// \param line The line to parse, ended by a newline or a null character.
 /// \param obj The obj struct to store the data in.
 /// \param error The error code.
-void parse_obj_line(char *line, Obj *obj, int *error);
+void parse_obj_line(const char *line, Obj *obj, int *error);
 
 /// \brief Parse a vertex.
 /// \param line The line to parse.
 /// \param error The error code.
 /// \return The vertex.
-Vertex parse_vertex(char *line, int *error);
+Vertex parse_vertex(const char *line, int *error);
 
 /// \brief Parse a normal.
 /// \param line The line to parse.
 /// \param error The error code.
 /// \return The normal.
-Normal parse_normal(char *line, int *error);
+Normal parse_normal(const char *line, int *error);
 
 /// \brief Parse a texture.
 /// \param line The line to parse.
 /// \param error The error code.
 /// \return The texture.
-Texture parse_texture(char *line, int *error);
+Texture parse_texture(const char *line, int *error);
 
-/// \brief Parse a face.
+/// \brief Parse a face and append its corners to the index pool.
+/// The returned view points into the pool and dangles once a later face
+/// grows it, afterwards read the face from faces->faces[i] or the offsets.
 /// \param line The line to parse.
+/// \param faces The faces to append to.
+/// \param error The error code.
+/// \return The view of the appended face.
+Face parse_face(const char *line, Faces *faces, int *error);
+
+/// \brief Make room for faces and corner indices, moving the pool if needed.
+/// \param faces The faces to grow.
+/// \param face_count The number of faces to hold.
+/// \param index_count The number of corners to hold.
 /// \param error The error code.
-/// \return The face.
-Face parse_face(char *line, int *error);
+void reserve_faces(Faces *faces, int face_count, int index_count, int *error);
+
+/// \brief Point every face view at its corners in the index pool.
+/// \param faces The faces to update.
+void update_face_views(Faces *faces);
 
 /// \brief Convert all faces to triangles for rendering.
+/// Concave faces are split by ear clipping, see triangulate_faces.
 /// \param obj The obj struct to store the data in.
 /// \param error The error code.
 /// \return The triangles struct containing all the triangles.
 Triangles triangulate(Obj *obj, int *error);
 
+/// \brief Convert all faces to triangles on a given number of threads.
+/// \param obj The obj struct to store the data in.
+/// \param threads The number of threads, 0 to use every online core.
+/// \param error The error code.
+/// \return The triangles struct containing all the triangles.
+Triangles triangulate_ex(Obj *obj, int threads, int *error);
+
+/// \brief Copy the attributes referenced by one face corner.
+/// Index 0 or an out of range index leaves the attribute untouched.
+/// \param obj The obj struct with the vertex attributes.
+/// \param vertex_index The 1-based vertex index.
+/// \param texture_index The 1-based texture index.
+/// \param normal_index The 1-based normal index.
+/// \param data The vertex data to fill.
+void fill_vertex_data(Obj *obj, int vertex_index, int texture_index,
+                      int normal_index, VertexData *data);
+
 /// \brief Create a vertex buffer from the obj struct and the triangles.
 /// \param obj The obj struct to store the data in.
 /// \param triangles The triangles struct containing all the triangles.
@@ -0,0 +1,203 @@
+#include "s21_quantize.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SNORM16_MAX 32767
+#define RADIANS_TO_DEGREES 57.29577951308232
+
+// The grid of the positions, step is 0 along flat or empty axes.
+typedef struct PositionGrid {
+  float center[3];
+  float step[3];
+} PositionGrid;
+
+uint16_t float_to_half(float value) {
+  uint32_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  uint32_t sign = (bits >> 16) & 0x8000;
+  uint32_t exponent = (bits >> 23) & 0xFF;
+  uint32_t mantissa = bits & 0x7FFFFF;
+  if (exponent == 0xFF) return sign | 0x7C00 | (mantissa != 0 ? 0x200 : 0);
+  int biased = (int)exponent - 127 + 15;
+  if (biased >= 31) return sign | 0x7C00;
+  if (biased <= 0) {
+    // below 2^-25 everything rounds to zero
+    if (biased < -10) return sign;
+    mantissa |= 0x800000;
+    int shift = 14 - biased;
+    uint32_t half = mantissa >> shift;
+    uint32_t rest = mantissa & ((1u << shift) - 1);
+    uint32_t halfway = 1u << (shift - 1);
+    if (rest > halfway || (rest == halfway && (half & 1))) half++;
+    return sign | half;
+  }
+  // a carry out of the mantissa rounds up to the next exponent or infinity
+  uint32_t half = ((uint32_t)biased << 10) | (mantissa >> 13);
+  uint32_t rest = mantissa & 0x1FFF;
+  if (rest > 0x1000 || (rest == 0x1000 && (half & 1))) half++;
+  return sign | half;
+}
+
+float half_to_float(uint16_t half) {
+  uint32_t sign = (uint32_t)(half & 0x8000) << 16;
+  uint32_t exponent = (half >> 10) & 0x1F;
+  uint32_t mantissa = half & 0x3FF;
+  uint32_t bits;
+  if (exponent == 0) {
+    float value = (float)mantissa * 0x1p-24f;
+    memcpy(&bits, &value, sizeof(bits));
+    bits |= sign;
+  } else if (exponent == 31) {
+    bits = sign | 0x7F800000 | (mantissa << 13);
+  } else {
+    bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+  }
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static float sign_of(float value) { return value >= 0.0f ? 1.0f : -1.0f; }
+
+static int16_t to_snorm16(float value) {
+  if (value > 1.0f) value = 1.0f;
+  if (value < -1.0f) value = -1.0f;
+  return (int16_t)lrintf(value * SNORM16_MAX);
+}
+
+void encode_octahedral(const float *normal, int16_t *out) {
+  float sum = fabsf(normal[0]) + fabsf(normal[1]) + fabsf(normal[2]);
+  if (!(sum > 0.0f) || !isfinite(sum)) {
+    out[0] = out[1] = 0;
+    return;
+  }
+  float u = normal[0] / sum, v = normal[1] / sum;
+  // the lower half is folded over the diagonals of the upper one
+  if (normal[2] < 0.0f) {
+    float folded = (1.0f - fabsf(v)) * sign_of(u);
+    v = (1.0f - fabsf(u)) * sign_of(v);
+    u = folded;
+  }
+  out[0] = to_snorm16(u);
+  out[1] = to_snorm16(v);
+}
+
+void decode_octahedral(const int16_t *encoded, float *normal) {
+  float u = fmaxf(encoded[0] / (float)SNORM16_MAX, -1.0f);
+  float v = fmaxf(encoded[1] / (float)SNORM16_MAX, -1.0f);
+  float z = 1.0f - fabsf(u) - fabsf(v);
+  if (z < 0.0f) {
+    float unfolded = (1.0f - fabsf(v)) * sign_of(u);
+    v = (1.0f - fabsf(u)) * sign_of(v);
+    u = unfolded;
+  }
+  float length = sqrtf(u * u + v * v + z * z);
+  normal[0] = u / length;
+  normal[1] = v / length;
+  normal[2] = z / length;
+}
+
+static PositionGrid create_grid(const Bounds *bounds) {
+  PositionGrid grid = {{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+  for (int axis = 0; axis < 3; axis++) {
+    if (!(bounds->min[axis] <= bounds->max[axis])) continue;
+    grid.center[axis] = (bounds->min[axis] + bounds->max[axis]) * 0.5f;
+    grid.step[axis] =
+        (bounds->max[axis] - bounds->min[axis]) / (2.0f * SNORM16_MAX);
+  }
+  return grid;
+}
+
+static void quantize_position(const PositionGrid *grid, const float *position,
+                              int16_t *out, float *error) {
+  for (int axis = 0; axis < 3; axis++) {
+    float step = grid->step[axis];
+    float offset = position[axis] - grid->center[axis];
+    long value = step > 0.0f ? lrintf(offset / step) : 0;
+    if (value > SNORM16_MAX) value = SNORM16_MAX;
+    if (value < -SNORM16_MAX) value = -SNORM16_MAX;
+    out[axis] = (int16_t)value;
+    float decoded = grid->center[axis] + value * step;
+    float difference = fabsf(decoded - position[axis]);
+    if (difference > *error) *error = difference;
+  }
+  out[3] = 0;
+}
+
+// atan2 keeps the precision of small angles that acos of the dot loses
+static float angle_between(const float *a, const float *b) {
+  double cross[3] = {(double)a[1] * b[2] - (double)a[2] * b[1],
+                     (double)a[2] * b[0] - (double)a[0] * b[2],
+                     (double)a[0] * b[1] - (double)a[1] * b[0]};
+  double dot = (double)a[0] * b[0] + (double)a[1] * b[1] + (double)a[2] * b[2];
+  double sine = sqrt(cross[0] * cross[0] + cross[1] * cross[1] +
+                     cross[2] * cross[2]);
+  return (float)(atan2(sine, dot) * RADIANS_TO_DEGREES);
+}
+
+static void quantize_vertex(const Mesh *mesh, const PositionGrid *grid,
+                            int i, QuantizedVertex *out,
+                            QuantizeError *error) {
+  quantize_position(grid, &mesh->positions[i * 3], out->position,
+                    &error->position);
+
+  const float *normal = &mesh->normals[i * 3];
+  encode_octahedral(normal, out->normal);
+  if (normal[0] != 0.0f || normal[1] != 0.0f || normal[2] != 0.0f) {
+    float decoded[3];
+    decode_octahedral(out->normal, decoded);
+    float angle = angle_between(normal, decoded);
+    if (angle > error->normal) error->normal = angle;
+  }
+
+  for (int j = 0; j < 2; j++) {
+    float texture = mesh->textures[i * 2 + j];
+    out->texture[j] = float_to_half(texture);
+    float difference = fabsf(half_to_float(out->texture[j]) - texture);
+    if (difference > error->texture) error->texture = difference;
+  }
+}
+
+QuantizedMesh quantize_mesh(const Mesh *mesh, const Bounds *bounds,
+                            int *error) {
+  QuantizedMesh quantized = {0};
+  int vertex_count = mesh->vertex_count > 0 ? mesh->vertex_count : 1;
+  int point_count = mesh->point_count > 0 ? mesh->point_count : 1;
+  quantized.vertices = malloc(sizeof(QuantizedVertex) * vertex_count);
+  quantized.points = malloc(sizeof(int16_t) * 4 * point_count);
+  if (quantized.vertices == NULL || quantized.points == NULL) {
+    printf("Error: Could not allocate memory for compact vertices\n");
+    *error = 1;
+    destroy_quantized_mesh(&quantized);
+    return quantized;
+  }
+
+  PositionGrid grid = create_grid(bounds);
+  for (int i = 0; i < mesh->vertex_count; i++)
+    quantize_vertex(mesh, &grid, i, &quantized.vertices[i], &quantized.error);
+  for (int i = 0; i < mesh->point_count; i++)
+    quantize_position(&grid, &mesh->points[i * 3], &quantized.points[i * 4],
+                      &quantized.error.position);
+  quantized.vertex_count = mesh->vertex_count;
+  quantized.point_count = mesh->point_count;
+
+  memset(quantized.dequantize, 0, sizeof(quantized.dequantize));
+  for (int axis = 0; axis < 3; axis++) {
+    quantized.dequantize[axis * 5] = grid.step[axis];
+    quantized.dequantize[12 + axis] = grid.center[axis];
+  }
+  quantized.dequantize[15] = 1.0f;
+  return quantized;
+}
+
+void destroy_quantized_mesh(QuantizedMesh *quantized) {
+  safe_free(quantized->vertices);
+  safe_free(quantized->points);
+  quantized->vertices = NULL;
+  quantized->points = NULL;
+  quantized->vertex_count = 0;
+  quantized->point_count = 0;
+}
@@ -0,0 +1,73 @@
+#ifndef INC_3DT_QUANTIZE_H
+#define INC_3DT_QUANTIZE_H
+
+#include <stdint.h>
+
+#include "s21_mesh.h"
+#include "s21_simd.h"
+
+/// A vertex in the compact upload layout, 16 bytes instead of 32. The
+/// position is a signed 16-bit offset from the center of the mesh bounds
+/// followed by a pad, the normal is octahedral encoded in two snorm16 and
+/// the texture coordinates are half floats.
+typedef struct QuantizedVertex {
+    int16_t position[4];
+    int16_t normal[2];
+    uint16_t texture[2];
+} QuantizedVertex;
+
+/// The largest difference between the source and the decoded attributes,
+/// positions and textures in their own units and normals as an angle in
+/// degrees. Zero normals are skipped.
+typedef struct QuantizeError {
+    float position;
+    float normal;
+    float texture;
+} QuantizeError;
+
+/// The compact copy of the vertices and points of a mesh. Both store
+/// positions on the same grid, so one matrix dequantizes them.
+typedef struct QuantizedMesh {
+    QuantizedVertex *vertices;
+    int vertex_count;
+    int16_t *points;
+    int point_count;
+    float dequantize[16];
+    QuantizeError error;
+} QuantizedMesh;
+
+/// \brief Convert a float to a half float, rounding to the nearest even.
+/// \param value The float.
+/// \return The half float bits, infinity for values out of range.
+uint16_t float_to_half(float value);
+
+/// \brief Convert a half float to a float.
+/// \param half The half float bits.
+/// \return The float, exact for every half.
+float half_to_float(uint16_t half);
+
+/// \brief Encode a unit vector on the octahedron.
+/// \param normal The x, y, z of the vector, need not be normalized.
+/// \param out The two snorm16 components, (0, 0) for a zero vector.
+void encode_octahedral(const float *normal, int16_t *out);
+
+/// \brief Decode an octahedral encoded vector.
+/// \param encoded The two snorm16 components.
+/// \param normal The unit x, y, z.
+void decode_octahedral(const int16_t *encoded, float *normal);
+
+/// \brief Pack the vertices and points of a mesh into the compact layout.
+/// \param mesh The mesh.
+/// \param bounds The bounds of the mesh points, positions outside of them
+/// are clamped.
+/// \param error The error code.
+/// \return The compact copy with the column-major matrix that maps its
+/// positions back to model space and the largest error of every attribute.
+QuantizedMesh quantize_mesh(const Mesh *mesh, const Bounds *bounds,
+                            int *error);
+
+/// \brief Free the arrays of a compact mesh and reset it.
+/// \param quantized The compact mesh to destroy.
+void destroy_quantized_mesh(QuantizedMesh *quantized);
+
+#endif //INC_3DT_QUANTIZE_H
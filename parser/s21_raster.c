@@ -0,0 +1,515 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "s21_raster.h"
+
+#include <math.h>
+#include <pthread.h>
+
+#include "s21_parser.h"
+#include "s21_simd.h"
+
+// An edge in window coordinates, y down, with the point its stipple
+// counts from. x0 is NaN when the edge is outside the view volume.
+typedef struct Segment {
+  float x0, y0, x1, y1;
+  float start_x, start_y;
+} Segment;
+
+typedef struct RasterWorker {
+  Rasterizer *rasterizer;
+  int index;
+} RasterWorker;
+
+struct Rasterizer {
+  int threads;
+  pthread_t *workers;
+  RasterWorker *args;
+  pthread_mutex_t lock;
+  pthread_cond_t wake;
+  pthread_cond_t phase_done;
+  int frame;
+  int quit;
+  int arrived;
+  int phase;
+  // the image being drawn, set before the workers are woken, without the
+  // points when they are not drawn
+  Wireframe wireframe;
+  const RasterStyle *style;
+  RasterImage image;
+  int tiles_x;
+  int tile_count;
+  int next_tile;
+  int failed;
+  // clip coordinates of the positions, then of the points
+  float *clip;
+  size_t clip_capacity;
+  Segment *segments;
+  size_t segment_capacity;
+  // window x and y of every point, x is NaN when the point is not drawn
+  float *screen;
+  size_t screen_capacity;
+  // per thread, the entries of each tile and kind, edges before points,
+  // turned into where the thread writes its next entry
+  size_t *counts;
+  size_t count_capacity;
+  // where the entries of each tile and kind start in bins
+  size_t *starts;
+  size_t start_capacity;
+  uint32_t *bins;
+  size_t bin_capacity;
+};
+
+enum { KIND_EDGE, KIND_POINT, KIND_COUNT };
+
+static void *reserve(void *items, size_t *capacity, size_t count, size_t size,
+                     int *error) {
+  if (count <= *capacity) return items;
+  void *grown = realloc(items, size * count);
+  if (grown == NULL) {
+    printf("Error: Could not allocate memory for rasterizer\n");
+    *error = 1;
+    return items;
+  }
+  *capacity = count;
+  return grown;
+}
+
+// The threads wait for each other between the phases of an image.
+static void wait_phase(Rasterizer *rasterizer) {
+  pthread_mutex_lock(&rasterizer->lock);
+  int phase = rasterizer->phase;
+  if (++rasterizer->arrived == rasterizer->threads) {
+    rasterizer->arrived = 0;
+    rasterizer->phase++;
+    pthread_cond_broadcast(&rasterizer->phase_done);
+  } else {
+    while (phase == rasterizer->phase)
+      pthread_cond_wait(&rasterizer->phase_done, &rasterizer->lock);
+  }
+  pthread_mutex_unlock(&rasterizer->lock);
+}
+
+static void share(int count, int index, int threads, int *first, int *last) {
+  *first = (int)((int64_t)count * index / threads);
+  *last = (int)((int64_t)count * (index + 1) / threads);
+}
+
+static void to_window(const float *clip, RasterImage image, float *x,
+                      float *y) {
+  *x = (clip[0] / clip[3] * 0.5f + 0.5f) * image.width;
+  *y = (0.5f - clip[1] / clip[3] * 0.5f) * image.height;
+}
+
+// Liang-Barsky against the six planes of the view volume, -w <= x, y, z
+// <= w. Returns 0 when nothing of the edge is left.
+static int clip_edge(const float *a, const float *b, float *from, float *to) {
+  float t0 = 0.0f, t1 = 1.0f;
+  for (int plane = 0; plane < 6; plane++) {
+    int axis = plane / 2;
+    float sign = plane % 2 ? -1.0f : 1.0f;
+    float da = a[3] + sign * a[axis];
+    float db = b[3] + sign * b[axis];
+    if (da < 0 && db < 0) return 0;
+    if (da < 0)
+      t0 = fmaxf(t0, da / (da - db));
+    else if (db < 0)
+      t1 = fminf(t1, da / (da - db));
+  }
+  if (t0 > t1) return 0;
+  for (int i = 0; i < 4; i++) {
+    from[i] = a[i] + (b[i] - a[i]) * t0;
+    to[i] = a[i] + (b[i] - a[i]) * t1;
+  }
+  return 1;
+}
+
+static int line_pixels(const RasterStyle *style) {
+  int width = (int)(style->line_width + 0.5f);
+  return width > 0 ? width : 1;
+}
+
+static int point_pixels(const RasterStyle *style) {
+  int size = (int)(style->point_size + 0.5f);
+  return size > 0 ? size : 1;
+}
+
+static void project_edge(Rasterizer *rasterizer, int edge) {
+  const uint32_t *pair = &rasterizer->wireframe.edges[edge * 2];
+  const float *a = &rasterizer->clip[pair[0] * 4];
+  const float *b = &rasterizer->clip[pair[1] * 4];
+  Segment *segment = &rasterizer->segments[edge];
+  float from[4], to[4];
+  if (!clip_edge(a, b, from, to)) {
+    segment->x0 = NAN;
+    return;
+  }
+  RasterImage image = rasterizer->image;
+  to_window(from, image, &segment->x0, &segment->y0);
+  to_window(to, image, &segment->x1, &segment->y1);
+  // the stipple runs from the first vertex when it is in front of the eye
+  if (a[3] > 0)
+    to_window(a, image, &segment->start_x, &segment->start_y);
+  else
+    to_window(from, image, &segment->start_x, &segment->start_y);
+}
+
+static void project_point(Rasterizer *rasterizer, int point) {
+  const float *p =
+      &rasterizer->clip[(rasterizer->wireframe.vertex_count + point) * 4];
+  float *screen = &rasterizer->screen[point * 2];
+  int inside = 1;
+  for (int axis = 0; axis < 3; axis++)
+    inside = inside && p[axis] >= -p[3] && p[axis] <= p[3];
+  if (inside && p[3] > 0)
+    to_window(p, rasterizer->image, &screen[0], &screen[1]);
+  else
+    screen[0] = NAN;
+}
+
+// Counts the entry or writes it to the place the thread reached.
+static void add_entry(Rasterizer *rasterizer, int thread, int tile, int kind,
+                      uint32_t id, int fill) {
+  size_t *count = &rasterizer->counts[(size_t)thread * rasterizer->tile_count *
+                                          KIND_COUNT +
+                                      tile * KIND_COUNT + kind];
+  if (fill) rasterizer->bins[*count] = id;
+  (*count)++;
+}
+
+static int tile_index(float value, int tiles) {
+  int tile = (int)floorf(value / RASTER_TILE_SIZE);
+  return tile < 0 ? 0 : tile >= tiles ? tiles - 1 : tile;
+}
+
+// Every tile an edge may draw into, the tiles of its box that are far from
+// the line are skipped.
+static void bin_edge(Rasterizer *rasterizer, int thread, int edge, int fill) {
+  const Segment *s = &rasterizer->segments[edge];
+  if (isnan(s->x0)) return;
+  int tiles_y = rasterizer->tile_count / rasterizer->tiles_x;
+  float reach = line_pixels(rasterizer->style) * 0.5f + 1.0f;
+  int x0 = tile_index(fminf(s->x0, s->x1) - reach, rasterizer->tiles_x);
+  int x1 = tile_index(fmaxf(s->x0, s->x1) + reach, rasterizer->tiles_x);
+  int y0 = tile_index(fminf(s->y0, s->y1) - reach, tiles_y);
+  int y1 = tile_index(fmaxf(s->y0, s->y1) + reach, tiles_y);
+  if (x0 == x1 && y0 == y1) {
+    add_entry(rasterizer, thread, y0 * rasterizer->tiles_x + x0, KIND_EDGE,
+              (uint32_t)edge, fill);
+    return;
+  }
+  float dx = s->x1 - s->x0, dy = s->y1 - s->y0;
+  float length = sqrtf(dx * dx + dy * dy);
+  float limit = (RASTER_TILE_SIZE * 0.7072f + reach) * length;
+  for (int ty = y0; ty <= y1; ty++) {
+    for (int tx = x0; tx <= x1; tx++) {
+      float cx = (tx + 0.5f) * RASTER_TILE_SIZE - s->x0;
+      float cy = (ty + 0.5f) * RASTER_TILE_SIZE - s->y0;
+      if (fabsf(cx * dy - cy * dx) > limit) continue;
+      add_entry(rasterizer, thread, ty * rasterizer->tiles_x + tx, KIND_EDGE,
+                (uint32_t)edge, fill);
+    }
+  }
+}
+
+static void bin_point(Rasterizer *rasterizer, int thread, int point,
+                      int fill) {
+  const float *screen = &rasterizer->screen[point * 2];
+  if (isnan(screen[0])) return;
+  int tiles_y = rasterizer->tile_count / rasterizer->tiles_x;
+  float reach = point_pixels(rasterizer->style) * 0.5f + 1.0f;
+  int x0 = tile_index(screen[0] - reach, rasterizer->tiles_x);
+  int x1 = tile_index(screen[0] + reach, rasterizer->tiles_x);
+  int y0 = tile_index(screen[1] - reach, tiles_y);
+  int y1 = tile_index(screen[1] + reach, tiles_y);
+  for (int ty = y0; ty <= y1; ty++)
+    for (int tx = x0; tx <= x1; tx++)
+      add_entry(rasterizer, thread, ty * rasterizer->tiles_x + tx,
+                KIND_POINT, (uint32_t)point, fill);
+}
+
+// The pixels of a tile, the others are left alone.
+typedef struct TileRect {
+  int x0, y0, x1, y1;
+} TileRect;
+
+static void fill_pixels(RasterImage image, TileRect rect, int x0, int y0,
+                        int x1, int y1, uint32_t color) {
+  if (x0 < rect.x0) x0 = rect.x0;
+  if (y0 < rect.y0) y0 = rect.y0;
+  if (x1 > rect.x1) x1 = rect.x1;
+  if (y1 > rect.y1) y1 = rect.y1;
+  for (int y = y0; y < y1; y++) {
+    uint32_t *row = &image.pixels[(size_t)y * image.stride];
+    for (int x = x0; x < x1; x++) row[x] = color;
+  }
+}
+
+// An aliased line steps along its major axis one pixel center at a time
+// and covers line_pixels pixels across it, like OpenGL.
+static void draw_edge(RasterImage image, TileRect rect, const Segment *s,
+                      const RasterStyle *style) {
+  float dx = s->x1 - s->x0, dy = s->y1 - s->y0;
+  int x_major = fabsf(dx) >= fabsf(dy);
+  float a0 = x_major ? s->x0 : s->y0, a1 = x_major ? s->x1 : s->y1;
+  float b0 = x_major ? s->y0 : s->x0, b1 = x_major ? s->y1 : s->x1;
+  float start = x_major ? s->start_x : s->start_y;
+  if (a0 == a1) return;
+  int lo = x_major ? rect.x0 : rect.y0, hi = x_major ? rect.x1 : rect.y1;
+  int first = (int)ceilf(fminf(a0, a1) - 0.5f);
+  int last = (int)ceilf(fmaxf(a0, a1) - 0.5f);
+  if (first < lo) first = lo;
+  if (last > hi) last = hi;
+  int width = line_pixels(style);
+  float slope = (b1 - b0) / (a1 - a0);
+  for (int m = first; m < last; m++) {
+    float center = m + 0.5f;
+    if (style->line_stipple != 0xFFFF) {
+      int counter = (int)fmodf(fabsf(center - start), 16.0f);
+      if (!((style->line_stipple >> counter) & 1)) continue;
+    }
+    int across = (int)floorf(b0 + (center - a0) * slope) - (width - 1) / 2;
+    if (x_major)
+      fill_pixels(image, rect, m, across, m + 1, across + width,
+                  style->line_color);
+    else
+      fill_pixels(image, rect, across, m, across + width, m + 1,
+                  style->line_color);
+  }
+}
+
+static void draw_point(RasterImage image, TileRect rect, const float *screen,
+                       const RasterStyle *style) {
+  int size = point_pixels(style);
+  if (style->point_shape != RASTER_POINT_CIRCLE) {
+    int x0 = (int)floorf(screen[0] - size * 0.5f + 0.5f);
+    int y0 = (int)floorf(screen[1] - size * 0.5f + 0.5f);
+    fill_pixels(image, rect, x0, y0, x0 + size, y0 + size, style->point_color);
+    return;
+  }
+  float radius = fmaxf(style->point_size * 0.5f, 0.5f);
+  int y0 = (int)floorf(screen[1] - radius);
+  int y1 = (int)ceilf(screen[1] + radius);
+  for (int y = y0; y < y1; y++) {
+    float dy = y + 0.5f - screen[1];
+    float half = radius * radius - dy * dy;
+    if (half < 0) continue;
+    half = sqrtf(half);
+    // the pixels whose centers are inside the circle
+    int x0 = (int)ceilf(screen[0] - half - 0.5f);
+    int x1 = (int)floorf(screen[0] + half - 0.5f) + 1;
+    fill_pixels(image, rect, x0, y, x1, y + 1, style->point_color);
+  }
+}
+
+static void draw_tile(Rasterizer *rasterizer, int tile) {
+  RasterImage image = rasterizer->image;
+  const RasterStyle *style = rasterizer->style;
+  int tx = tile % rasterizer->tiles_x, ty = tile / rasterizer->tiles_x;
+  TileRect rect = {tx * RASTER_TILE_SIZE, ty * RASTER_TILE_SIZE,
+                   (tx + 1) * RASTER_TILE_SIZE, (ty + 1) * RASTER_TILE_SIZE};
+  if (rect.x1 > image.width) rect.x1 = image.width;
+  if (rect.y1 > image.height) rect.y1 = image.height;
+  fill_pixels(image, rect, rect.x0, rect.y0, rect.x1, rect.y1,
+              style->background);
+  const size_t *starts = &rasterizer->starts[tile * KIND_COUNT];
+  for (size_t i = starts[KIND_EDGE]; i < starts[KIND_POINT]; i++)
+    draw_edge(image, rect, &rasterizer->segments[rasterizer->bins[i]], style);
+  for (size_t i = starts[KIND_POINT]; i < starts[KIND_COUNT]; i++)
+    draw_point(image, rect, &rasterizer->screen[rasterizer->bins[i] * 2],
+               style);
+}
+
+// Turns the counts into the places each thread writes its entries, in tile,
+// kind and thread order, so the entries of a tile keep the edge order.
+static void place_bins(Rasterizer *rasterizer) {
+  size_t slots = (size_t)rasterizer->tile_count * KIND_COUNT;
+  size_t total = 0;
+  for (size_t slot = 0; slot < slots; slot++) {
+    rasterizer->starts[slot] = total;
+    for (int t = 0; t < rasterizer->threads; t++) {
+      size_t *count = &rasterizer->counts[t * slots + slot];
+      size_t entries = *count;
+      *count = total;
+      total += entries;
+    }
+  }
+  rasterizer->starts[slots] = total;
+  rasterizer->bins =
+      reserve(rasterizer->bins, &rasterizer->bin_capacity, total,
+              sizeof(uint32_t), &rasterizer->failed);
+}
+
+static void draw_share(Rasterizer *rasterizer, int thread) {
+  const Wireframe *wireframe = &rasterizer->wireframe;
+  int threads = rasterizer->threads;
+  int first, last;
+  share(wireframe->vertex_count, thread, threads, &first, &last);
+  project_positions(wireframe->positions + (size_t)first * 3, 3, last - first,
+                    wireframe->matrix, rasterizer->clip + (size_t)first * 4);
+  share(wireframe->point_count, thread, threads, &first, &last);
+  project_positions(
+      wireframe->points + (size_t)first * 3, 3, last - first,
+      wireframe->matrix,
+      rasterizer->clip + ((size_t)wireframe->vertex_count + first) * 4);
+  size_t slots = (size_t)rasterizer->tile_count * KIND_COUNT;
+  memset(&rasterizer->counts[thread * slots], 0, sizeof(size_t) * slots);
+  wait_phase(rasterizer);
+
+  int edge_first, edge_last, point_first, point_last;
+  share(wireframe->edge_count, thread, threads, &edge_first, &edge_last);
+  share(wireframe->point_count, thread, threads, &point_first, &point_last);
+  for (int i = edge_first; i < edge_last; i++) {
+    project_edge(rasterizer, i);
+    bin_edge(rasterizer, thread, i, 0);
+  }
+  for (int i = point_first; i < point_last; i++) {
+    project_point(rasterizer, i);
+    bin_point(rasterizer, thread, i, 0);
+  }
+  wait_phase(rasterizer);
+  if (thread == 0) place_bins(rasterizer);
+  wait_phase(rasterizer);
+
+  if (!rasterizer->failed) {
+    for (int i = edge_first; i < edge_last; i++)
+      bin_edge(rasterizer, thread, i, 1);
+    for (int i = point_first; i < point_last; i++)
+      bin_point(rasterizer, thread, i, 1);
+  }
+  wait_phase(rasterizer);
+
+  while (!rasterizer->failed) {
+    pthread_mutex_lock(&rasterizer->lock);
+    int tile = rasterizer->next_tile++;
+    pthread_mutex_unlock(&rasterizer->lock);
+    if (tile >= rasterizer->tile_count) break;
+    draw_tile(rasterizer, tile);
+  }
+  wait_phase(rasterizer);
+}
+
+static void *raster_worker(void *arg) {
+  RasterWorker *worker = arg;
+  Rasterizer *rasterizer = worker->rasterizer;
+  int frame = 0;
+  pthread_mutex_lock(&rasterizer->lock);
+  for (;;) {
+    while (frame == rasterizer->frame && !rasterizer->quit)
+      pthread_cond_wait(&rasterizer->wake, &rasterizer->lock);
+    if (rasterizer->quit) break;
+    frame = rasterizer->frame;
+    pthread_mutex_unlock(&rasterizer->lock);
+    draw_share(rasterizer, worker->index);
+    pthread_mutex_lock(&rasterizer->lock);
+  }
+  pthread_mutex_unlock(&rasterizer->lock);
+  return NULL;
+}
+
+Rasterizer *create_rasterizer(int threads, int *error) {
+  if (threads <= 0) threads = online_cpu_count();
+  Rasterizer *rasterizer = calloc(1, sizeof(Rasterizer));
+  if (rasterizer != NULL) {
+    rasterizer->workers = calloc(threads, sizeof(pthread_t));
+    rasterizer->args = calloc(threads, sizeof(RasterWorker));
+  }
+  if (rasterizer == NULL || rasterizer->workers == NULL ||
+      rasterizer->args == NULL) {
+    printf("Error: Could not allocate memory for rasterizer\n");
+    *error = 1;
+    if (rasterizer != NULL) {
+      safe_free(rasterizer->workers);
+      safe_free(rasterizer->args);
+    }
+    safe_free(rasterizer);
+    return NULL;
+  }
+  pthread_mutex_init(&rasterizer->lock, NULL);
+  pthread_cond_init(&rasterizer->wake, NULL);
+  pthread_cond_init(&rasterizer->phase_done, NULL);
+  // the calling thread is the first one, fewer workers start when the
+  // system runs out of threads
+  rasterizer->threads = 1;
+  for (int i = 1; i < threads; i++) {
+    RasterWorker *worker = &rasterizer->args[i];
+    worker->rasterizer = rasterizer;
+    worker->index = i;
+    if (pthread_create(&rasterizer->workers[i], NULL, raster_worker,
+                       worker) != 0)
+      break;
+    rasterizer->threads++;
+  }
+  return rasterizer;
+}
+
+int rasterizer_threads(const Rasterizer *rasterizer) {
+  return rasterizer->threads;
+}
+
+void destroy_rasterizer(Rasterizer *rasterizer) {
+  if (rasterizer == NULL) return;
+  pthread_mutex_lock(&rasterizer->lock);
+  rasterizer->quit = 1;
+  pthread_cond_broadcast(&rasterizer->wake);
+  pthread_mutex_unlock(&rasterizer->lock);
+  for (int i = 1; i < rasterizer->threads; i++)
+    pthread_join(rasterizer->workers[i], NULL);
+  pthread_cond_destroy(&rasterizer->phase_done);
+  pthread_cond_destroy(&rasterizer->wake);
+  pthread_mutex_destroy(&rasterizer->lock);
+  safe_free(rasterizer->workers);
+  safe_free(rasterizer->args);
+  safe_free(rasterizer->clip);
+  safe_free(rasterizer->segments);
+  safe_free(rasterizer->screen);
+  safe_free(rasterizer->counts);
+  safe_free(rasterizer->starts);
+  safe_free(rasterizer->bins);
+  safe_free(rasterizer);
+}
+
+void rasterize_wireframe(Rasterizer *rasterizer, const Wireframe *wireframe,
+                         const RasterStyle *style, RasterImage image,
+                         int *error) {
+  if (image.width <= 0 || image.height <= 0) return;
+  int tiles_x = (image.width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+  int tiles_y = (image.height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+  size_t slots = (size_t)tiles_x * tiles_y * KIND_COUNT;
+  int points =
+      style->point_shape == RASTER_POINT_NONE ? 0 : wireframe->point_count;
+  int err = 0;
+  rasterizer->clip = reserve(
+      rasterizer->clip, &rasterizer->clip_capacity,
+      ((size_t)wireframe->vertex_count + points) * 4,
+      sizeof(float), &err);
+  rasterizer->segments =
+      reserve(rasterizer->segments, &rasterizer->segment_capacity,
+              wireframe->edge_count, sizeof(Segment), &err);
+  rasterizer->screen =
+      reserve(rasterizer->screen, &rasterizer->screen_capacity,
+              (size_t)points * 2, sizeof(float), &err);
+  rasterizer->counts =
+      reserve(rasterizer->counts, &rasterizer->count_capacity,
+              slots * rasterizer->threads, sizeof(size_t), &err);
+  rasterizer->starts = reserve(rasterizer->starts, &rasterizer->start_capacity,
+                               slots + 1, sizeof(size_t), &err);
+  if (err) {
+    *error = 1;
+    return;
+  }
+
+  pthread_mutex_lock(&rasterizer->lock);
+  rasterizer->wireframe = *wireframe;
+  rasterizer->wireframe.point_count = points;
+  rasterizer->style = style;
+  rasterizer->image = image;
+  rasterizer->tiles_x = tiles_x;
+  rasterizer->tile_count = tiles_x * tiles_y;
+  rasterizer->next_tile = 0;
+  rasterizer->failed = 0;
+  rasterizer->frame++;
+  pthread_cond_broadcast(&rasterizer->wake);
+  pthread_mutex_unlock(&rasterizer->lock);
+  draw_share(rasterizer, 0);
+  if (rasterizer->failed) *error = 1;
+}
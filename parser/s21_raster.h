@@ -0,0 +1,85 @@
+#ifndef INC_3DT_RASTER_H
+#define INC_3DT_RASTER_H
+
+#include <stdint.h>
+
+/// The side of the square screen tiles the threads draw, in pixels.
+#define RASTER_TILE_SIZE 64
+
+/// The shape of drawn points.
+typedef enum RasterPoint {
+    RASTER_POINT_NONE,
+    RASTER_POINT_SQUARE,
+    RASTER_POINT_CIRCLE
+} RasterPoint;
+
+/// How edges and points are drawn, the colors are 0xAARRGGBB like the
+/// pixels. The stipple repeats every 16 pixels along an edge from its
+/// first vertex, a set bit draws the pixel, 0xFFFF draws solid edges.
+typedef struct RasterStyle {
+    uint32_t background;
+    uint32_t line_color;
+    float line_width;
+    uint16_t line_stipple;
+    uint32_t point_color;
+    float point_size;
+    RasterPoint point_shape;
+} RasterStyle;
+
+/// 32-bit pixels of an image, row 0 at the top, stride pixels apart.
+typedef struct RasterImage {
+    uint32_t *pixels;
+    int width;
+    int height;
+    int stride;
+} RasterImage;
+
+/// What a wireframe is drawn from. The edges are pairs of indices into the
+/// positions, the points are drawn on their own. The matrix maps positions
+/// to clip coordinates like an OpenGL model-view-projection matrix.
+typedef struct Wireframe {
+    const float *positions;
+    int vertex_count;
+    const uint32_t *edges;
+    int edge_count;
+    const float *points;
+    int point_count;
+    const float *matrix;
+} Wireframe;
+
+/// A software rasterizer for wireframes, it keeps its buffers from one
+/// image to the next.
+typedef struct Rasterizer Rasterizer;
+
+/// \brief Create a rasterizer.
+/// \param threads The number of threads, 0 to use every online core.
+/// \param error The error code.
+/// \return The rasterizer, NULL on error.
+Rasterizer *create_rasterizer(int threads, int *error);
+
+/// \brief Draw a wireframe like the fixed-function pipeline draws aliased
+/// lines and points.
+/// The image is cleared to the background first. The edges are clipped to
+/// the view volume and drawn before the points, whose center has to be
+/// inside it. The threads first project a share of the positions each, then
+/// sort their share of the edges and points into screen tiles, and at last
+/// draw whole tiles, so no two threads write the same pixel.
+/// \param rasterizer The rasterizer.
+/// \param wireframe The wireframe, the edges and points may be empty.
+/// \param style The colors and sizes.
+/// \param image The image to draw into.
+/// \param error The error code.
+void rasterize_wireframe(Rasterizer *rasterizer, const Wireframe *wireframe,
+                         const RasterStyle *style, RasterImage image,
+                         int *error);
+
+/// \brief The number of threads of a rasterizer.
+/// \param rasterizer The rasterizer.
+/// \return The number of threads.
+int rasterizer_threads(const Rasterizer *rasterizer);
+
+/// \brief Free a rasterizer and its buffers.
+/// \param rasterizer The rasterizer to free, may be NULL.
+void destroy_rasterizer(Rasterizer *rasterizer);
+
+#endif //INC_3DT_RASTER_H
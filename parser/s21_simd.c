@@ -0,0 +1,319 @@
+#include "s21_simd.h"
+
+#include <float.h>
+#include <string.h>
+
+// SSE2 is part of x86-64, AVX2 is checked at run time and compiled per
+// function, so the library needs no extra compiler flags.
+#if defined(__x86_64__) || defined(_M_X64)
+#define SIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(SIMD_X86) && defined(__GNUC__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+typedef struct BoundsSum {
+  float min[4];
+  float max[4];
+  double sum[4];
+} BoundsSum;
+
+static SimdLevel simd_limit = SIMD_AVX2;
+
+static SimdLevel supported_level(void) {
+#if defined(SIMD_X86) && defined(__GNUC__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") ? SIMD_AVX2 : SIMD_SSE2;
+#elif defined(SIMD_X86) && defined(_MSC_VER)
+  // AVX2 also needs the system to save the ymm registers
+  int info[4];
+  __cpuid(info, 1);
+  int avx = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+            (_xgetbv(0) & 6) == 6;
+  __cpuidex(info, 7, 0);
+  return avx && (info[1] & (1 << 5)) ? SIMD_AVX2 : SIMD_SSE2;
+#else
+  return SIMD_SCALAR;
+#endif
+}
+
+SimdLevel simd_level(void) {
+  SimdLevel level = supported_level();
+  return level < simd_limit ? level : simd_limit;
+}
+
+void limit_simd(SimdLevel level) { simd_limit = level; }
+
+static void bounds_scalar(const float *positions, size_t stride, int count,
+                          BoundsSum *bounds) {
+  for (int i = 0; i < count; i++) {
+    for (int axis = 0; axis < 3; axis++) {
+      float value = positions[i * stride + axis];
+      if (value < bounds->min[axis]) bounds->min[axis] = value;
+      if (value > bounds->max[axis]) bounds->max[axis] = value;
+      bounds->sum[axis] += value;
+    }
+  }
+}
+
+// Both the positions and the matrix columns are multiplied in the same order
+// as in the vector kernels, so all levels give the same floats.
+static void transform_scalar(float *positions, size_t stride, int count,
+                             const float *matrix) {
+  for (int i = 0; i < count; i++) {
+    float *p = &positions[i * stride];
+    float x = p[0], y = p[1], z = p[2];
+    for (int axis = 0; axis < 3; axis++)
+      p[axis] = (matrix[axis] * x + matrix[4 + axis] * y) +
+                (matrix[8 + axis] * z + matrix[12 + axis]);
+  }
+}
+
+static void project_scalar(const float *positions, size_t stride, int count,
+                           const float *matrix, float *clip) {
+  for (int i = 0; i < count; i++) {
+    const float *p = &positions[i * stride];
+    float x = p[0], y = p[1], z = p[2];
+    for (int axis = 0; axis < 4; axis++)
+      clip[i * 4 + axis] = (matrix[axis] * x + matrix[4 + axis] * y) +
+                           (matrix[8 + axis] * z + matrix[12 + axis]);
+  }
+}
+
+#ifdef SIMD_X86
+// The vector kernels load four floats per position. With a stride below four
+// the last position is left to the scalar code, or the load would run past
+// the end of the array.
+static int vector_count(size_t stride, int count) {
+  return stride >= 4 || count == 0 ? count : count - 1;
+}
+
+// min and max take the accumulator second, so a NaN is skipped as in the
+// scalar comparisons
+static void bounds_sse2(const float *positions, size_t stride, int count,
+                        BoundsSum *bounds) {
+  __m128 low = _mm_loadu_ps(bounds->min);
+  __m128 high = _mm_loadu_ps(bounds->max);
+  __m128d sum_xy = _mm_loadu_pd(bounds->sum);
+  __m128d sum_zw = _mm_loadu_pd(bounds->sum + 2);
+  for (int i = 0; i < count; i++) {
+    __m128 p = _mm_loadu_ps(&positions[i * stride]);
+    low = _mm_min_ps(p, low);
+    high = _mm_max_ps(p, high);
+    sum_xy = _mm_add_pd(sum_xy, _mm_cvtps_pd(p));
+    sum_zw = _mm_add_pd(sum_zw, _mm_cvtps_pd(_mm_movehl_ps(p, p)));
+  }
+  _mm_storeu_ps(bounds->min, low);
+  _mm_storeu_ps(bounds->max, high);
+  _mm_storeu_pd(bounds->sum, sum_xy);
+  _mm_storeu_pd(bounds->sum + 2, sum_zw);
+}
+
+static __m128 transform_sse2_one(__m128 p, const __m128 *columns,
+                                 __m128 keep) {
+  __m128 x = _mm_shuffle_ps(p, p, 0x00);
+  __m128 y = _mm_shuffle_ps(p, p, 0x55);
+  __m128 z = _mm_shuffle_ps(p, p, 0xAA);
+  __m128 xy = _mm_add_ps(_mm_mul_ps(columns[0], x), _mm_mul_ps(columns[1], y));
+  __m128 zw = _mm_add_ps(_mm_mul_ps(columns[2], z), columns[3]);
+  __m128 result = _mm_add_ps(xy, zw);
+  return _mm_or_ps(_mm_andnot_ps(keep, result), _mm_and_ps(keep, p));
+}
+
+static void transform_sse2(float *positions, size_t stride, int count,
+                           const float *matrix) {
+  __m128 columns[4];
+  for (int i = 0; i < 4; i++) columns[i] = _mm_loadu_ps(&matrix[i * 4]);
+  // the fourth float is w or the x of the next position, it is stored back
+  __m128 keep = _mm_castsi128_ps(_mm_set_epi32(-1, 0, 0, 0));
+  for (int i = 0; i < count; i++) {
+    float *p = &positions[i * stride];
+    _mm_storeu_ps(p, transform_sse2_one(_mm_loadu_ps(p), columns, keep));
+  }
+}
+
+static void project_sse2(const float *positions, size_t stride, int count,
+                         const float *matrix, float *clip) {
+  __m128 columns[4];
+  for (int i = 0; i < 4; i++) columns[i] = _mm_loadu_ps(&matrix[i * 4]);
+  for (int i = 0; i < count; i++) {
+    __m128 p = _mm_loadu_ps(&positions[i * stride]);
+    __m128 x = _mm_shuffle_ps(p, p, 0x00);
+    __m128 y = _mm_shuffle_ps(p, p, 0x55);
+    __m128 z = _mm_shuffle_ps(p, p, 0xAA);
+    __m128 xy =
+        _mm_add_ps(_mm_mul_ps(columns[0], x), _mm_mul_ps(columns[1], y));
+    __m128 zw = _mm_add_ps(_mm_mul_ps(columns[2], z), columns[3]);
+    _mm_storeu_ps(&clip[i * 4], _mm_add_ps(xy, zw));
+  }
+}
+
+// Two positions per register, one in each 128-bit lane.
+TARGET_AVX2 static __m256 load_pair(const float *a, const float *b) {
+  return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(a)),
+                              _mm_loadu_ps(b), 1);
+}
+
+TARGET_AVX2 static void bounds_avx2(const float *positions, size_t stride,
+                                    int count, BoundsSum *bounds) {
+  __m256 low = load_pair(bounds->min, bounds->min);
+  __m256 high = load_pair(bounds->max, bounds->max);
+  __m256d sum_even = _mm256_loadu_pd(bounds->sum);
+  __m256d sum_odd = _mm256_setzero_pd();
+  int i = 0;
+  for (; i + 1 < count; i += 2) {
+    __m256 p = load_pair(&positions[i * stride], &positions[(i + 1) * stride]);
+    low = _mm256_min_ps(p, low);
+    high = _mm256_max_ps(p, high);
+    sum_even = _mm256_add_pd(sum_even,
+                             _mm256_cvtps_pd(_mm256_castps256_ps128(p)));
+    sum_odd =
+        _mm256_add_pd(sum_odd, _mm256_cvtps_pd(_mm256_extractf128_ps(p, 1)));
+  }
+  _mm_storeu_ps(bounds->min, _mm_min_ps(_mm256_castps256_ps128(low),
+                                        _mm256_extractf128_ps(low, 1)));
+  _mm_storeu_ps(bounds->max, _mm_max_ps(_mm256_castps256_ps128(high),
+                                        _mm256_extractf128_ps(high, 1)));
+  _mm256_storeu_pd(bounds->sum, _mm256_add_pd(sum_even, sum_odd));
+  if (i < count) bounds_sse2(&positions[i * stride], stride, 1, bounds);
+}
+
+TARGET_AVX2 static void transform_avx2(float *positions, size_t stride,
+                                       int count, const float *matrix) {
+  __m256 columns[4];
+  for (int i = 0; i < 4; i++)
+    columns[i] = load_pair(&matrix[i * 4], &matrix[i * 4]);
+  __m256 keep =
+      _mm256_castsi256_ps(_mm256_set_epi32(-1, 0, 0, 0, -1, 0, 0, 0));
+  int i = 0;
+  for (; i + 1 < count; i += 2) {
+    float *a = &positions[i * stride];
+    float *b = &positions[(i + 1) * stride];
+    __m256 p = load_pair(a, b);
+    __m256 x = _mm256_permute_ps(p, 0x00);
+    __m256 y = _mm256_permute_ps(p, 0x55);
+    __m256 z = _mm256_permute_ps(p, 0xAA);
+    __m256 xy = _mm256_add_ps(_mm256_mul_ps(columns[0], x),
+                              _mm256_mul_ps(columns[1], y));
+    __m256 zw = _mm256_add_ps(_mm256_mul_ps(columns[2], z), columns[3]);
+    __m256 result = _mm256_blendv_ps(_mm256_add_ps(xy, zw), p, keep);
+    // a first, with a stride of 3 its fourth float is the x of b
+    _mm_storeu_ps(a, _mm256_castps256_ps128(result));
+    _mm_storeu_ps(b, _mm256_extractf128_ps(result, 1));
+  }
+  if (i < count) transform_sse2(&positions[i * stride], stride, 1, matrix);
+}
+
+TARGET_AVX2 static void project_avx2(const float *positions, size_t stride,
+                                     int count, const float *matrix,
+                                     float *clip) {
+  __m256 columns[4];
+  for (int i = 0; i < 4; i++)
+    columns[i] = load_pair(&matrix[i * 4], &matrix[i * 4]);
+  int i = 0;
+  for (; i + 1 < count; i += 2) {
+    __m256 p =
+        load_pair(&positions[i * stride], &positions[(i + 1) * stride]);
+    __m256 x = _mm256_permute_ps(p, 0x00);
+    __m256 y = _mm256_permute_ps(p, 0x55);
+    __m256 z = _mm256_permute_ps(p, 0xAA);
+    __m256 xy = _mm256_add_ps(_mm256_mul_ps(columns[0], x),
+                              _mm256_mul_ps(columns[1], y));
+    __m256 zw = _mm256_add_ps(_mm256_mul_ps(columns[2], z), columns[3]);
+    // the clip coordinates of both positions are adjacent
+    _mm256_storeu_ps(&clip[i * 4], _mm256_add_ps(xy, zw));
+  }
+  if (i < count)
+    project_sse2(&positions[i * stride], stride, 1, matrix, &clip[i * 4]);
+}
+#endif
+
+Bounds compute_bounds(const float *positions, size_t stride, int count) {
+  BoundsSum sum = {{FLT_MAX, FLT_MAX, FLT_MAX, FLT_MAX},
+                   {-FLT_MAX, -FLT_MAX, -FLT_MAX, -FLT_MAX},
+                   {0, 0, 0, 0}};
+  int vectors = 0;
+#ifdef SIMD_X86
+  SimdLevel level = simd_level();
+  if (level == SIMD_AVX2) {
+    vectors = vector_count(stride, count);
+    bounds_avx2(positions, stride, vectors, &sum);
+  } else if (level == SIMD_SSE2) {
+    vectors = vector_count(stride, count);
+    bounds_sse2(positions, stride, vectors, &sum);
+  }
+#endif
+  bounds_scalar(positions + vectors * stride, stride, count - vectors, &sum);
+
+  Bounds bounds;
+  for (int axis = 0; axis < 3; axis++) {
+    bounds.min[axis] = sum.min[axis];
+    bounds.max[axis] = sum.max[axis];
+    bounds.centroid[axis] = count > 0 ? (float)(sum.sum[axis] / count) : 0;
+  }
+  return bounds;
+}
+
+void fit_bounds(const Bounds *bounds, float *matrix) {
+  float extent = 0;
+  for (int axis = 0; axis < 3; axis++)
+    if (bounds->max[axis] - bounds->min[axis] > extent)
+      extent = bounds->max[axis] - bounds->min[axis];
+  memset(matrix, 0, sizeof(float) * 16);
+  float scale = extent > 0 ? 2.0f / extent : 1.0f;
+  for (int axis = 0; axis < 3; axis++) {
+    matrix[axis * 5] = scale;
+    if (extent > 0)
+      matrix[12 + axis] =
+          -(bounds->min[axis] + bounds->max[axis]) * 0.5f * scale;
+  }
+  matrix[15] = 1.0f;
+}
+
+void transform_positions(float *positions, size_t stride, int count,
+                         const float *matrix) {
+  int vectors = 0;
+#ifdef SIMD_X86
+  SimdLevel level = simd_level();
+  if (level == SIMD_AVX2) {
+    vectors = vector_count(stride, count);
+    transform_avx2(positions, stride, vectors, matrix);
+  } else if (level == SIMD_SSE2) {
+    vectors = vector_count(stride, count);
+    transform_sse2(positions, stride, vectors, matrix);
+  }
+#endif
+  transform_scalar(positions + vectors * stride, stride, count - vectors,
+                   matrix);
+}
+
+void project_positions(const float *positions, size_t stride, int count,
+                       const float *matrix, float *clip) {
+  int vectors = 0;
+#ifdef SIMD_X86
+  SimdLevel level = simd_level();
+  if (level == SIMD_AVX2) {
+    vectors = vector_count(stride, count);
+    project_avx2(positions, stride, vectors, matrix, clip);
+  } else if (level == SIMD_SSE2) {
+    vectors = vector_count(stride, count);
+    project_sse2(positions, stride, vectors, matrix, clip);
+  }
+#endif
+  project_scalar(positions + vectors * stride, stride, count - vectors,
+                 matrix, clip + vectors * 4);
+}
+
+void normalize_positions(float *positions, size_t stride, int count) {
+  Bounds bounds = compute_bounds(positions, stride, count);
+  float matrix[16];
+  fit_bounds(&bounds, matrix);
+  transform_positions(positions, stride, count, matrix);
+}
@@ -0,0 +1,72 @@
+#ifndef INC_3DT_SIMD_H
+#define INC_3DT_SIMD_H
+
+#include <stddef.h>
+
+/// Instruction sets of the vertex kernels, from the slowest to the fastest.
+typedef enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2
+} SimdLevel;
+
+/// The axis-aligned box around a set of positions and their mean.
+typedef struct Bounds {
+    float min[3];
+    float max[3];
+    float centroid[3];
+} Bounds;
+
+/// \brief The instruction set the kernels use.
+/// The best one the processor supports, capped by limit_simd.
+/// \return The level.
+SimdLevel simd_level(void);
+
+/// \brief Cap the instruction set of the kernels.
+/// Not thread safe, it is meant for comparing the levels in tests and
+/// benchmarks.
+/// \param level The highest level to use.
+void limit_simd(SimdLevel level);
+
+/// \brief Compute the bounds of positions.
+/// \param positions The x of the first position, y and z follow it.
+/// \param stride The number of floats from one position to the next, at
+/// least 3, so the kernels read vertex structs and packed positions alike.
+/// \param count The number of positions.
+/// \return The bounds, min is above max when there are no positions.
+Bounds compute_bounds(const float *positions, size_t stride, int count);
+
+/// \brief Build the matrix that moves the center of the bounds to the origin
+/// and scales their longest side to [-1, 1].
+/// \param bounds The bounds to fit.
+/// \param matrix The column-major 4x4 matrix, the identity for empty or flat
+/// bounds.
+void fit_bounds(const Bounds *bounds, float *matrix);
+
+/// \brief Multiply positions by an affine matrix in place.
+/// Only x, y and z are written, the float after them is left as it is.
+/// \param positions The x of the first position, y and z follow it.
+/// \param stride The number of floats from one position to the next.
+/// \param count The number of positions.
+/// \param matrix The column-major 4x4 matrix.
+void transform_positions(float *positions, size_t stride, int count,
+                         const float *matrix);
+
+/// \brief Multiply positions by a projective matrix into clip coordinates.
+/// \param positions The x of the first position, y and z follow it, w is
+/// taken as 1.
+/// \param stride The number of floats from one position to the next.
+/// \param count The number of positions.
+/// \param matrix The column-major 4x4 matrix.
+/// \param clip The x, y, z and w of every position.
+void project_positions(const float *positions, size_t stride, int count,
+                       const float *matrix, float *clip);
+
+/// \brief Move and scale positions in place so they fit into [-1, 1] with
+/// their center at the origin.
+/// \param positions The x of the first position, y and z follow it.
+/// \param stride The number of floats from one position to the next.
+/// \param count The number of positions.
+void normalize_positions(float *positions, size_t stride, int count);
+
+#endif //INC_3DT_SIMD_H
@@ -0,0 +1,416 @@
+#include "s21_simplify.h"
+
+#include <float.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIMPLIFY_ITERATIONS 100
+#define REBUILD_INTERVAL 5
+#define BORDER_WEIGHT 10.0
+// the cosine of the largest turn of a moved triangle, and the squared sine
+// of its smallest angle at the moved corner
+#define MIN_NORMAL_COS 0.2
+#define MIN_CORNER_SIN2 0.002
+
+// Sum of squared distances to planes a * x + b * y + c * z + d = 0 as the
+// upper half of a symmetric 4x4 matrix: aa ab ac ad bb bc bd cc cd dd.
+typedef struct Quadric {
+  double q[10];
+} Quadric;
+
+typedef struct CollapseTriangle {
+  uint32_t v[3];
+  // the error of edge j from v[j] to v[j + 1], the smallest one last
+  double error[4];
+  // edges up to this error were rejected since the triangle last changed
+  double rejected;
+  int deleted;
+  int dirty;
+} CollapseTriangle;
+
+// The triangles around a vertex are refs[first] to refs[first + count - 1].
+typedef struct CollapseVertex {
+  Quadric quadric;
+  int first;
+  int count;
+} CollapseVertex;
+
+typedef struct Ref {
+  int triangle;
+  int corner;
+} Ref;
+
+typedef struct Simplifier {
+  // scaled into the unit box, so the thresholds suit models of any size
+  double *positions;
+  CollapseVertex *vertices;
+  CollapseTriangle *triangles;
+  int triangle_count;
+  int live;
+  Ref *refs;
+  int ref_count;
+  int ref_capacity;
+  unsigned *marks;
+  unsigned stamp;
+} Simplifier;
+
+static void add_plane(Quadric *quadric, const double *normal, double d,
+                      double weight) {
+  double a = normal[0], b = normal[1], c = normal[2];
+  double *q = quadric->q;
+  q[0] += weight * a * a;
+  q[1] += weight * a * b;
+  q[2] += weight * a * c;
+  q[3] += weight * a * d;
+  q[4] += weight * b * b;
+  q[5] += weight * b * c;
+  q[6] += weight * b * d;
+  q[7] += weight * c * c;
+  q[8] += weight * c * d;
+  q[9] += weight * d * d;
+}
+
+static double quadric_error(const Quadric *quadric, const double *p) {
+  const double *q = quadric->q;
+  double x = p[0], y = p[1], z = p[2];
+  return q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x +
+         q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y + q[7] * z * z +
+         2 * q[8] * z + q[9];
+}
+
+static double dot(const double *a, const double *b) {
+  return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static double normalize(double *v) {
+  double length = sqrt(dot(v, v));
+  if (length > 0)
+    for (int i = 0; i < 3; i++) v[i] /= length;
+  return length;
+}
+
+static void cross(const double *a, const double *b, double *out) {
+  out[0] = a[1] * b[2] - a[2] * b[1];
+  out[1] = a[2] * b[0] - a[0] * b[2];
+  out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// Normal of the triangle a, b, c with twice its area as the length.
+static void triangle_cross(const double *a, const double *b, const double *c,
+                           double *normal) {
+  double u[3], w[3];
+  for (int i = 0; i < 3; i++) {
+    u[i] = b[i] - a[i];
+    w[i] = c[i] - a[i];
+  }
+  cross(u, w, normal);
+}
+
+static const double *position(const Simplifier *s, uint32_t vertex) {
+  return &s->positions[vertex * 3];
+}
+
+static int has_vertex(const CollapseTriangle *triangle, uint32_t vertex) {
+  return triangle->v[0] == vertex || triangle->v[1] == vertex ||
+         triangle->v[2] == vertex;
+}
+
+// The end to keep is the one where the merged quadric is smaller.
+static double edge_error(const Simplifier *s, uint32_t a, uint32_t b,
+                         uint32_t *keep) {
+  Quadric quadric = s->vertices[a].quadric;
+  for (int i = 0; i < 10; i++) quadric.q[i] += s->vertices[b].quadric.q[i];
+  double error_a = quadric_error(&quadric, position(s, a));
+  double error_b = quadric_error(&quadric, position(s, b));
+  *keep = error_a <= error_b ? a : b;
+  return error_a <= error_b ? error_a : error_b;
+}
+
+static void update_errors(const Simplifier *s, CollapseTriangle *triangle) {
+  uint32_t keep;
+  triangle->rejected = -DBL_MAX;
+  triangle->error[3] = DBL_MAX;
+  for (int j = 0; j < 3; j++) {
+    triangle->error[j] =
+        edge_error(s, triangle->v[j], triangle->v[(j + 1) % 3], &keep);
+    if (triangle->error[j] < triangle->error[3])
+      triangle->error[3] = triangle->error[j];
+  }
+}
+
+static int reserve_refs(Simplifier *s, int count, int *error) {
+  if (s->ref_count + count <= s->ref_capacity) return 1;
+  int capacity = s->ref_capacity * 2;
+  if (capacity < s->ref_count + count) capacity = s->ref_count + count;
+  Ref *refs = realloc(s->refs, sizeof(Ref) * capacity);
+  if (refs == NULL) {
+    printf("Error: Could not allocate memory for simplification\n");
+    *error = 1;
+    return 0;
+  }
+  s->refs = refs;
+  s->ref_capacity = capacity;
+  return 1;
+}
+
+// Drops deleted triangles and rebuilds the refs, which collapses leave
+// scattered over the end of the array. Rejected edges get another try, the
+// triangles around them may have changed since.
+static void rebuild_refs(Simplifier *s, int vertex_count) {
+  int count = 0;
+  for (int i = 0; i < s->triangle_count; i++) {
+    if (s->triangles[i].deleted) continue;
+    s->triangles[count] = s->triangles[i];
+    s->triangles[count++].rejected = -DBL_MAX;
+  }
+  s->triangle_count = count;
+
+  for (int i = 0; i < vertex_count; i++) s->vertices[i].count = 0;
+  for (int i = 0; i < s->triangle_count; i++)
+    for (int j = 0; j < 3; j++) s->vertices[s->triangles[i].v[j]].count++;
+  int first = 0;
+  for (int i = 0; i < vertex_count; i++) {
+    s->vertices[i].first = first;
+    first += s->vertices[i].count;
+    s->vertices[i].count = 0;
+  }
+  for (int i = 0; i < s->triangle_count; i++) {
+    for (int j = 0; j < 3; j++) {
+      CollapseVertex *vertex = &s->vertices[s->triangles[i].v[j]];
+      s->refs[vertex->first + vertex->count++] = (Ref){i, j};
+    }
+  }
+  s->ref_count = first;
+}
+
+static int is_border_edge(const Simplifier *s, int triangle, uint32_t a,
+                          uint32_t b) {
+  const CollapseVertex *vertex = &s->vertices[a];
+  for (int i = 0; i < vertex->count; i++) {
+    int other = s->refs[vertex->first + i].triangle;
+    if (other != triangle && has_vertex(&s->triangles[other], b)) return 0;
+  }
+  return 1;
+}
+
+// Every vertex starts with the planes of its triangles. An edge of a
+// single triangle also adds the plane through it perpendicular to the
+// triangle, so open borders only collapse along themselves.
+static void add_planes(Simplifier *s) {
+  for (int i = 0; i < s->triangle_count; i++) {
+    CollapseTriangle *triangle = &s->triangles[i];
+    double normal[3];
+    const double *p0 = position(s, triangle->v[0]);
+    triangle_cross(p0, position(s, triangle->v[1]), position(s, triangle->v[2]),
+                   normal);
+    if (normalize(normal) == 0) continue;
+    for (int j = 0; j < 3; j++)
+      add_plane(&s->vertices[triangle->v[j]].quadric, normal,
+                -dot(normal, p0), 1.0);
+
+    for (int j = 0; j < 3; j++) {
+      uint32_t a = triangle->v[j], b = triangle->v[(j + 1) % 3];
+      if (!is_border_edge(s, i, a, b)) continue;
+      double edge[3], border[3];
+      for (int axis = 0; axis < 3; axis++)
+        edge[axis] = position(s, b)[axis] - position(s, a)[axis];
+      cross(edge, normal, border);
+      if (normalize(border) == 0) continue;
+      double d = -dot(border, position(s, a));
+      add_plane(&s->vertices[a].quadric, border, d, BORDER_WEIGHT);
+      add_plane(&s->vertices[b].quadric, border, d, BORDER_WEIGHT);
+    }
+  }
+}
+
+// Moving drop onto keep must neither flip nor crush the triangles around
+// drop, and the two may share no neighbours besides the third corners of
+// the triangles on their edge, or the surface would fold onto itself.
+static int can_collapse(Simplifier *s, uint32_t keep, uint32_t drop) {
+  const CollapseVertex *from = &s->vertices[drop];
+  unsigned neighbour = ++s->stamp;
+  int shared = 0;
+  for (int i = 0; i < from->count; i++) {
+    Ref ref = s->refs[from->first + i];
+    CollapseTriangle *triangle = &s->triangles[ref.triangle];
+    if (triangle->deleted) continue;
+    uint32_t a = triangle->v[(ref.corner + 1) % 3];
+    uint32_t b = triangle->v[(ref.corner + 2) % 3];
+    s->marks[a] = neighbour;
+    s->marks[b] = neighbour;
+    if (a == keep || b == keep) {
+      shared++;
+      continue;
+    }
+    // compared squared, which saves the square roots of normalizing
+    double before[3], after[3], u[3], w[3];
+    for (int axis = 0; axis < 3; axis++) {
+      u[axis] = position(s, a)[axis] - position(s, keep)[axis];
+      w[axis] = position(s, b)[axis] - position(s, keep)[axis];
+    }
+    cross(u, w, after);
+    double area = dot(after, after);
+    if (area <= MIN_CORNER_SIN2 * dot(u, u) * dot(w, w)) return 0;
+    triangle_cross(position(s, drop), position(s, a), position(s, b), before);
+    double turn = dot(before, after);
+    if (turn < 0 ||
+        turn * turn <
+            MIN_NORMAL_COS * MIN_NORMAL_COS * dot(before, before) * area)
+      return 0;
+  }
+
+  const CollapseVertex *to = &s->vertices[keep];
+  unsigned common = ++s->stamp;
+  int count = 0;
+  for (int i = 0; i < to->count; i++) {
+    CollapseTriangle *triangle = &s->triangles[s->refs[to->first + i].triangle];
+    if (triangle->deleted) continue;
+    for (int j = 0; j < 3; j++) {
+      uint32_t v = triangle->v[j];
+      if (v != keep && v != drop && s->marks[v] == neighbour) {
+        s->marks[v] = common;
+        count++;
+      }
+    }
+  }
+  return count <= shared;
+}
+
+static void collapse(Simplifier *s, uint32_t keep, uint32_t drop,
+                     int *error) {
+  CollapseVertex *from = &s->vertices[drop];
+  CollapseVertex *to = &s->vertices[keep];
+  if (!reserve_refs(s, from->count + to->count, error)) return;
+  for (int i = 0; i < 10; i++) to->quadric.q[i] += from->quadric.q[i];
+
+  // the triangles on the edge go, the others of drop move over to keep
+  int first = s->ref_count;
+  for (int i = 0; i < from->count; i++) {
+    Ref ref = s->refs[from->first + i];
+    CollapseTriangle *triangle = &s->triangles[ref.triangle];
+    if (triangle->deleted) continue;
+    if (has_vertex(triangle, keep)) {
+      triangle->deleted = 1;
+      s->live--;
+    } else {
+      triangle->v[ref.corner] = keep;
+      s->refs[s->ref_count++] = ref;
+    }
+  }
+  for (int i = 0; i < to->count; i++) {
+    Ref ref = s->refs[to->first + i];
+    if (!s->triangles[ref.triangle].deleted) s->refs[s->ref_count++] = ref;
+  }
+  to->first = first;
+  to->count = s->ref_count - first;
+  from->count = 0;
+
+  for (int i = 0; i < to->count; i++) {
+    CollapseTriangle *triangle = &s->triangles[s->refs[to->first + i].triangle];
+    triangle->dirty = 1;
+    update_errors(s, triangle);
+  }
+}
+
+static void scale_positions(Simplifier *s, const float *positions,
+                            int vertex_count) {
+  float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX};
+  float max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+  for (int i = 0; i < vertex_count; i++) {
+    for (int axis = 0; axis < 3; axis++) {
+      float value = positions[i * 3 + axis];
+      if (value < min[axis]) min[axis] = value;
+      if (value > max[axis]) max[axis] = value;
+    }
+  }
+  double extent = 0;
+  for (int axis = 0; axis < 3; axis++)
+    if (max[axis] - min[axis] > extent) extent = max[axis] - min[axis];
+  if (extent == 0) extent = 1;
+  for (int i = 0; i < vertex_count; i++)
+    for (int axis = 0; axis < 3; axis++)
+      s->positions[i * 3 + axis] =
+          (positions[i * 3 + axis] - min[axis]) / extent;
+}
+
+static void destroy_simplifier(Simplifier *s) {
+  free(s->positions);
+  free(s->vertices);
+  free(s->triangles);
+  free(s->refs);
+  free(s->marks);
+}
+
+int simplify_triangles(const float *positions, int vertex_count,
+                       uint32_t *indices, int index_count, int target,
+                       int *error) {
+  Simplifier s = {0};
+  s.triangle_count = index_count / 3;
+  if (s.triangle_count <= target || vertex_count <= 0) return index_count;
+  s.positions = malloc(sizeof(double) * 3 * vertex_count);
+  s.vertices = calloc(sizeof(CollapseVertex), vertex_count);
+  s.marks = calloc(sizeof(unsigned), vertex_count);
+  s.triangles = malloc(sizeof(CollapseTriangle) * s.triangle_count);
+  s.ref_capacity = s.triangle_count * 3;
+  s.refs = malloc(sizeof(Ref) * s.ref_capacity);
+  if (s.positions == NULL || s.vertices == NULL || s.marks == NULL ||
+      s.triangles == NULL || s.refs == NULL) {
+    printf("Error: Could not allocate memory for simplification\n");
+    *error = 1;
+    destroy_simplifier(&s);
+    return index_count;
+  }
+  scale_positions(&s, positions, vertex_count);
+  for (int i = 0; i < s.triangle_count; i++) {
+    CollapseTriangle *triangle = &s.triangles[i];
+    memcpy(triangle->v, &indices[i * 3], sizeof(triangle->v));
+    triangle->deleted = triangle->v[0] == triangle->v[1] ||
+                        triangle->v[1] == triangle->v[2] ||
+                        triangle->v[2] == triangle->v[0];
+    if (!triangle->deleted) s.live++;
+  }
+  rebuild_refs(&s, vertex_count);
+  add_planes(&s);
+  for (int i = 0; i < s.triangle_count; i++)
+    update_errors(&s, &s.triangles[i]);
+
+  // the threshold grows every pass, so the cheapest collapses go first
+  for (int iteration = 0; iteration < SIMPLIFY_ITERATIONS && s.live > target;
+       iteration++) {
+    if (iteration % REBUILD_INTERVAL == REBUILD_INTERVAL - 1)
+      rebuild_refs(&s, vertex_count);
+    for (int i = 0; i < s.triangle_count; i++) s.triangles[i].dirty = 0;
+    double threshold = 1e-9 * pow(iteration + 3, 7);
+    for (int i = 0; i < s.triangle_count && s.live > target && !*error;
+         i++) {
+      CollapseTriangle *triangle = &s.triangles[i];
+      if (triangle->deleted || triangle->dirty ||
+          triangle->error[3] > threshold)
+        continue;
+      int collapsed = 0;
+      for (int j = 0; j < 3 && !collapsed; j++) {
+        if (triangle->error[j] > threshold ||
+            triangle->error[j] <= triangle->rejected)
+          continue;
+        uint32_t a = triangle->v[j], b = triangle->v[(j + 1) % 3], keep;
+        edge_error(&s, a, b, &keep);
+        uint32_t drop = keep == a ? b : a;
+        collapsed = can_collapse(&s, keep, drop);
+        if (collapsed) collapse(&s, keep, drop, error);
+      }
+      if (!collapsed) triangle->rejected = threshold;
+    }
+    if (*error) break;
+  }
+
+  int count = 0;
+  for (int i = 0; i < s.triangle_count && !*error; i++) {
+    if (s.triangles[i].deleted) continue;
+    memcpy(&indices[count], s.triangles[i].v, sizeof(uint32_t) * 3);
+    count += 3;
+  }
+  destroy_simplifier(&s);
+  return *error ? index_count : count;
+}
@@ -0,0 +1,23 @@
+#ifndef INC_3DT_SIMPLIFY_H
+#define INC_3DT_SIMPLIFY_H
+
+#include <stdint.h>
+
+/// \brief Simplify indexed triangles by quadric error edge collapses.
+/// Every collapse moves one end of an edge onto the other, so the remaining
+/// triangles reference a subset of the input vertices and no vertex is
+/// created. Collapses that would flip a triangle or make the surface
+/// non-manifold are skipped, so the target may not be reached.
+/// \param positions The x, y, z of every vertex, shared by all corners that
+/// meet at one point.
+/// \param vertex_count The number of vertices.
+/// \param indices The triangles, compacted in place.
+/// \param index_count The number of indices.
+/// \param target The number of triangles to stop at.
+/// \param error The error code.
+/// \return The number of remaining indices.
+int simplify_triangles(const float *positions, int vertex_count,
+                       uint32_t *indices, int index_count, int target,
+                       int *error);
+
+#endif //INC_3DT_SIMPLIFY_H
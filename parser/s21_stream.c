@@ -0,0 +1,328 @@
+#include "s21_stream.h"
+
+#include <sys/stat.h>
+
+// the smallest chunk a budget can shrink the reads to
+#define STREAM_MIN_CHUNK 4096
+
+struct ObjStream {
+  FILE *file;
+  StreamOptions options;
+  size_t total;
+  size_t done;
+  // buffer_size bytes of the file and a terminator for a last line without
+  // a newline, the lines from start to length are not parsed yet
+  char *buffer;
+  size_t buffer_size;
+  size_t length;
+  size_t start;
+  int eof;
+  // the vertices of the previous batches
+  int vertex_count;
+  // the lines of one batch, emptied before the next one
+  Obj *scratch;
+  float *positions;
+  int position_capacity;
+  uint32_t *edges;
+  int edge_capacity;
+  uint64_t *slots;
+  uint32_t slot_capacity;
+};
+
+static uint32_t hash_edge(uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xFF51AFD7ED558CCDULL;
+  key ^= key >> 33;
+  return (uint32_t)key;
+}
+
+static uint32_t slot_count(int index_count) {
+  uint32_t size = 16;
+  while (size < (uint32_t)index_count * 2) size *= 2;
+  return size;
+}
+
+void close_obj_stream(ObjStream *stream) {
+  if (stream == NULL) return;
+  if (stream->file != NULL) fclose(stream->file);
+  safe_free(stream->buffer);
+  destroy_obj(stream->scratch);
+  safe_free(stream->positions);
+  safe_free(stream->edges);
+  safe_free(stream->slots);
+  safe_free(stream);
+}
+
+size_t obj_stream_memory(const ObjStream *stream) {
+  const Obj *obj = stream->scratch;
+  return stream->buffer_size + 1 +
+         sizeof(Vertex) * obj->vertices->capacity +
+         (sizeof(Face) + sizeof(int)) * obj->faces->capacity +
+         sizeof(int) * 3 * obj->faces->index_capacity +
+         sizeof(float) * 3 * stream->position_capacity +
+         sizeof(uint32_t) * 2 * stream->edge_capacity +
+         sizeof(uint64_t) * stream->slot_capacity;
+}
+
+static void *reserve(void *items, int *capacity, int count, size_t size,
+                     int *error) {
+  if (count <= *capacity) return items;
+  void *grown = realloc(items, size * count);
+  if (grown == NULL) {
+    printf("Error: Could not allocate memory for stream\n");
+    *error = 1;
+    return items;
+  }
+  *capacity = count;
+  return grown;
+}
+
+static int power_of_two_below(size_t limit, int least) {
+  int count = least;
+  while ((size_t)count * 2 <= limit && count < (1 << 29)) count *= 2;
+  return count;
+}
+
+// With a budget the batch buffers are allocated once, half of what the read
+// buffer leaves for the vertices and half for the face corners, and a batch
+// ends when they are full. Counts are powers of two so the parser's own
+// growth lands on them exactly.
+static void reserve_batch(ObjStream *stream, int *error) {
+  size_t budget = stream->options.memory_budget;
+  size_t used = stream->buffer_size + 1;
+  size_t rest = budget > used ? (budget - used) / 2 : 0;
+  size_t vertex_size = sizeof(Vertex) + sizeof(float) * 3;
+  // a corner owns three pool ints, an edge, two hash slots and a quarter of
+  // a face
+  size_t corner_size = sizeof(int) * 3 + sizeof(uint32_t) * 2 +
+                       sizeof(uint64_t) * 2 + (sizeof(Face) + sizeof(int)) / 4;
+  int vertices = power_of_two_below(rest / vertex_size, 64);
+  int corners = power_of_two_below(rest / corner_size, 256);
+  Obj *obj = stream->scratch;
+  obj->vertices->vertices = malloc(sizeof(Vertex) * vertices);
+  obj->vertices->capacity = obj->vertices->vertices != NULL ? vertices : 0;
+  if (obj->vertices->vertices == NULL) {
+    printf("Error: Could not allocate memory for stream\n");
+    *error = 1;
+  }
+  if (!*error) reserve_faces(obj->faces, corners / 4, corners, error);
+  stream->positions = reserve(stream->positions, &stream->position_capacity,
+                              vertices, sizeof(float) * 3, error);
+  stream->edges = reserve(stream->edges, &stream->edge_capacity, corners,
+                          sizeof(uint32_t) * 2, error);
+  stream->slots = malloc(sizeof(uint64_t) * slot_count(corners));
+  stream->slot_capacity = stream->slots != NULL ? slot_count(corners) : 0;
+  if (!*error && stream->slots == NULL) {
+    printf("Error: Could not allocate memory for stream\n");
+    *error = 1;
+  }
+}
+
+// Whether the batch buffers hold one more line without growing, a face line
+// of n bytes has at most n / 2 corners.
+static int has_room(const ObjStream *stream, const char *line, size_t size) {
+  if (stream->options.memory_budget == 0) return 1;
+  const Obj *obj = stream->scratch;
+  if (line[0] == 'v' && line[1] == ' ')
+    return obj->vertices->count < obj->vertices->capacity;
+  if (line[0] == 'f' && line[1] == ' ')
+    return obj->faces->count < obj->faces->capacity &&
+           obj->faces->index_count + size / 2 + 1 <=
+               (size_t)obj->faces->index_capacity;
+  return 1;
+}
+
+ObjStream *open_obj_stream(const char *filename, StreamOptions options,
+                           int *error) {
+  ObjStream *stream = calloc(sizeof(ObjStream), 1);
+  if (stream == NULL) {
+    printf("Error: Could not allocate memory for stream\n");
+    *error = 1;
+    return NULL;
+  }
+  stream->options = options;
+  struct stat st;
+  stream->file = fopen(filename, "rb");
+  if (stream->file == NULL || stat(filename, &st) != 0) {
+    printf("Error: Could not open file %s\n", filename);
+    *error = 1;
+  } else {
+    stream->total = st.st_size;
+  }
+
+  // the read buffer takes a quarter of the budget at most, the rest is left
+  // for the lines parsed out of it
+  size_t chunk =
+      options.chunk_size > 0 ? options.chunk_size : STREAM_CHUNK_SIZE;
+  if (options.memory_budget > 0 && chunk > options.memory_budget / 4)
+    chunk = options.memory_budget / 4;
+  if (chunk < STREAM_MIN_CHUNK) chunk = STREAM_MIN_CHUNK;
+  if (!*error) {
+    stream->buffer = malloc(chunk + 1);
+    stream->buffer_size = chunk;
+    if (stream->buffer == NULL) {
+      printf("Error: Could not allocate memory for stream\n");
+      *error = 1;
+    }
+  }
+  if (!*error) stream->scratch = init_obj(error);
+  if (!*error && options.memory_budget > 0) reserve_batch(stream, error);
+  if (*error) {
+    close_obj_stream(stream);
+    return NULL;
+  }
+  return stream;
+}
+
+// Moves the lines that are not parsed yet to the front and reads after them.
+static void fill_buffer(ObjStream *stream, int *error) {
+  size_t rest = stream->length - stream->start;
+  memmove(stream->buffer, stream->buffer + stream->start, rest);
+  stream->length = rest;
+  stream->start = 0;
+  size_t wanted = stream->buffer_size - stream->length;
+  if (!stream->eof && wanted > 0) {
+    size_t read =
+        fread(stream->buffer + stream->length, 1, wanted, stream->file);
+    stream->length += read;
+    if (read < wanted) {
+      if (ferror(stream->file)) {
+        printf("Error: Could not read file\n");
+        *error = 1;
+      }
+      stream->eof = 1;
+    }
+  }
+  stream->buffer[stream->length] = '\0';
+}
+
+static void grow_buffer(ObjStream *stream, int *error) {
+  size_t size = stream->buffer_size * 2;
+  char *grown = realloc(stream->buffer, size + 1);
+  if (grown == NULL) {
+    printf("Error: Could not allocate memory for line\n");
+    *error = 1;
+    return;
+  }
+  stream->buffer = grown;
+  stream->buffer_size = size;
+}
+
+// Only vertices and faces are parsed, relative indices count back from the
+// vertices of every batch so far.
+static void parse_stream_line(ObjStream *stream, const char *line,
+                              int *error) {
+  Obj *obj = stream->scratch;
+  if (line[0] == 'v' && line[1] == ' ') {
+    parse_obj_line(line, obj, error);
+  } else if (line[0] == 'f' && line[1] == ' ') {
+    int face_count = obj->faces->count;
+    parse_obj_line(line, obj, error);
+    if (*error || obj->faces->count == face_count) return;
+    Face *face = &obj->faces->faces[face_count];
+    for (int i = 0; i < face->vertex_count; i++)
+      if (face->vertex_indices[i] < 0)
+        face->vertex_indices[i] +=
+            stream->vertex_count + obj->vertices->count + 1;
+  }
+}
+
+// Returns the number of bytes parsed, 0 at the end of the file.
+static size_t parse_batch(ObjStream *stream, int *error) {
+  Obj *obj = stream->scratch;
+  obj->vertices->count = 0;
+  obj->faces->count = 0;
+  obj->faces->index_count = 0;
+  size_t parsed = 0;
+  fill_buffer(stream, error);
+  while (!*error && stream->start < stream->length) {
+    char *line = stream->buffer + stream->start;
+    char *eol = memchr(line, '\n', stream->length - stream->start);
+    if (eol == NULL && !stream->eof) {
+      // the rest of the line comes with the next chunk, unless it is longer
+      // than the whole buffer
+      if (parsed > 0) break;
+      grow_buffer(stream, error);
+      if (!*error) fill_buffer(stream, error);
+      continue;
+    }
+    size_t next = eol != NULL ? (size_t)(eol + 1 - stream->buffer)
+                              : stream->length;
+    // a single line too large for the budget is still parsed
+    if (parsed > 0 && !has_room(stream, line, next - stream->start)) break;
+    parse_stream_line(stream, line, error);
+    parsed += next - stream->start;
+    stream->start = next;
+  }
+  return parsed;
+}
+
+// Edges are keyed on the sorted pair of positions like the edges of a mesh,
+// but only within the batch.
+static void create_batch(ObjStream *stream, StreamBatch *batch, int *error) {
+  Obj *obj = stream->scratch;
+  Faces *faces = obj->faces;
+  int vertices = obj->vertices->count;
+  stream->positions = reserve(stream->positions, &stream->position_capacity,
+                              vertices, sizeof(float) * 3, error);
+  stream->edges = reserve(stream->edges, &stream->edge_capacity,
+                          faces->index_count, sizeof(uint32_t) * 2, error);
+  uint32_t size = slot_count(faces->index_count);
+  if (!*error && size > stream->slot_capacity) {
+    safe_free(stream->slots);
+    stream->slots = malloc(sizeof(uint64_t) * size);
+    stream->slot_capacity = stream->slots != NULL ? size : 0;
+    if (stream->slots == NULL) {
+      printf("Error: Could not allocate memory for edges\n");
+      *error = 1;
+    }
+  }
+  if (*error) return;
+
+  for (int i = 0; i < vertices; i++) {
+    const Vertex *vertex = &obj->vertices->vertices[i];
+    stream->positions[i * 3] = vertex->x;
+    stream->positions[i * 3 + 1] = vertex->y;
+    stream->positions[i * 3 + 2] = vertex->z;
+  }
+  memset(stream->slots, 0, sizeof(uint64_t) * size);
+  int total = stream->vertex_count + vertices;
+  int edge_count = 0;
+  for (int i = 0; i < faces->count; i++) {
+    Face *face = &faces->faces[i];
+    for (int j = 0; j < face->vertex_count; j++) {
+      int a = face->vertex_indices[j];
+      int b = face->vertex_indices[(j + 1) % face->vertex_count];
+      if (a == b || a <= 0 || b <= 0 || a > total || b > total) continue;
+      uint64_t key = a < b ? ((uint64_t)a << 32) | (uint32_t)b
+                           : ((uint64_t)b << 32) | (uint32_t)a;
+      uint32_t slot = hash_edge(key) & (size - 1);
+      while (stream->slots[slot] != 0 && stream->slots[slot] != key)
+        slot = (slot + 1) & (size - 1);
+      if (stream->slots[slot] == key) continue;
+      stream->slots[slot] = key;
+      stream->edges[edge_count * 2] = a - 1;
+      stream->edges[edge_count * 2 + 1] = b - 1;
+      edge_count++;
+    }
+  }
+
+  batch->positions = stream->positions;
+  batch->first_vertex = stream->vertex_count;
+  batch->vertex_count = vertices;
+  batch->edges = stream->edges;
+  batch->edge_count = edge_count;
+  stream->vertex_count = total;
+}
+
+int read_obj_stream(ObjStream *stream, StreamBatch *batch, int *error) {
+  size_t parsed = parse_batch(stream, error);
+  if (*error || parsed == 0) return 0;
+  create_batch(stream, batch, error);
+  stream->done += parsed;
+  StreamOptions *options = &stream->options;
+  if (!*error && options->progress != NULL &&
+      options->progress(stream->done, stream->total, options->user))
+    *error = 1;
+  return !*error;
+}
@@ -0,0 +1,64 @@
+#ifndef INC_3DT_STREAM_H
+#define INC_3DT_STREAM_H
+
+#include <stdint.h>
+
+#include "s21_parser.h"
+
+/// The bytes a stream reads per batch unless told otherwise.
+#define STREAM_CHUNK_SIZE (4 * 1024 * 1024)
+
+typedef struct StreamOptions {
+    size_t chunk_size;
+    size_t memory_budget;
+    ParseProgress progress;
+    void *user;
+} StreamOptions;
+
+/// What one batch of lines added to the model. Both arrays belong to the
+/// stream and are overwritten by the next read.
+typedef struct StreamBatch {
+    const float *positions;
+    int first_vertex;
+    int vertex_count;
+    const uint32_t *edges;
+    int edge_count;
+} StreamBatch;
+
+/// An obj file read in batches of lines, only the vertices and the face
+/// outlines are kept.
+typedef struct ObjStream ObjStream;
+
+/// \brief Open an obj file for reading in batches.
+/// \param filename The filename of the obj file.
+/// \param options The bytes to read per batch, 0 for STREAM_CHUNK_SIZE, the
+/// bytes of memory the stream may hold, 0 for no limit, and an optional
+/// progress callback that can cancel the read.
+/// \param error The error code.
+/// \return The stream, NULL on error.
+ObjStream *open_obj_stream(const char *filename, StreamOptions options,
+                           int *error);
+
+/// \brief Parse the next batch of lines.
+/// A batch ends at the end of the chunk or earlier when its vertices and
+/// edges would take the stream over its memory budget. Only edges between
+/// vertices read so far are kept, an edge shared by faces of different
+/// batches is reported by each of them.
+/// \param stream The stream to read.
+/// \param batch Filled with the positions of the new vertices, x, y, z
+/// each, and the unique edges of the new faces as pairs of 0-based vertex
+/// indices.
+/// \param error The error code, also set when the read is cancelled.
+/// \return 1 if a batch was read, 0 at the end of the file or on error.
+int read_obj_stream(ObjStream *stream, StreamBatch *batch, int *error);
+
+/// \brief The bytes of memory a stream holds.
+/// \param stream The stream.
+/// \return The bytes of its buffers.
+size_t obj_stream_memory(const ObjStream *stream);
+
+/// \brief Close a stream and free its buffers.
+/// \param stream The stream to close, may be NULL.
+void close_obj_stream(ObjStream *stream);
+
+#endif //INC_3DT_STREAM_H
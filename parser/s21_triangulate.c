@@ -0,0 +1,257 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include "s21_triangulate.h"
+
+#include <math.h>
+#include <pthread.h>
+
+// Faces with up to this many corners are projected into stack buffers.
+#define STACK_CORNERS 64
+
+typedef struct Point2 {
+  double x;
+  double y;
+} Point2;
+
+typedef struct TriangulateJob {
+  const Faces *faces;
+  const Vertices *vertices;
+  Triangle *triangles;
+  int first_face;
+  int last_face;
+  int error;
+} TriangulateJob;
+
+int count_triangles(const Faces *faces) {
+  return faces->index_count - 2 * faces->count;
+}
+
+int first_triangle(const Faces *faces, int face) {
+  return faces->offsets[face] - 2 * face;
+}
+
+static void emit(const Faces *faces, int first, int a, int b, int c,
+                 Triangle *out) {
+  const int corners[3] = {first + a, first + b, first + c};
+  for (int k = 0; k < 3; k++) {
+    out->vertex_indices[k] = faces->vertex_indices[corners[k]];
+    out->texture_indices[k] = faces->texture_indices[corners[k]];
+    out->normal_indices[k] = faces->normal_indices[corners[k]];
+  }
+}
+
+static void fan(const Faces *faces, int first, int count, Triangle *out) {
+  for (int j = 1; j + 1 < count; j++) emit(faces, first, 0, j, j + 1, out++);
+}
+
+// Twice the signed area of abc, positive when it turns counterclockwise.
+static double cross(Point2 a, Point2 b, Point2 c) {
+  return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+static double coordinate(const Vertex *vertex, int axis) {
+  return axis == 0 ? vertex->x : axis == 1 ? vertex->y : vertex->z;
+}
+
+static int same_point(Point2 a, Point2 b) { return a.x == b.x && a.y == b.y; }
+
+// Drops the largest component of the Newell normal and mirrors the plane
+// if needed, so the projected face winds counterclockwise. Returns 0 for a
+// corner outside the vertices or a face without area.
+static int project_face(const Faces *faces, const Vertices *vertices,
+                        int first, int count, Point2 *points) {
+  const int *indices = faces->vertex_indices + first;
+  for (int j = 0; j < count; j++)
+    if (indices[j] < 1 || indices[j] > vertices->count) return 0;
+  double normal[3] = {0.0, 0.0, 0.0};
+  for (int j = 0; j < count; j++) {
+    const Vertex *p = &vertices->vertices[indices[j] - 1];
+    const Vertex *q =
+        &vertices->vertices[indices[j + 1 < count ? j + 1 : 0] - 1];
+    normal[0] += ((double)p->y - q->y) * ((double)p->z + q->z);
+    normal[1] += ((double)p->z - q->z) * ((double)p->x + q->x);
+    normal[2] += ((double)p->x - q->x) * ((double)p->y + q->y);
+  }
+  int axis = 2;
+  if (fabs(normal[0]) > fabs(normal[axis])) axis = 0;
+  if (fabs(normal[1]) > fabs(normal[axis])) axis = 1;
+  if (!(fabs(normal[axis]) > 0.0) || !isfinite(normal[axis])) return 0;
+  // (y, z), (z, x) and (x, y) wind counterclockwise around +x, +y and +z
+  int u = (axis + 1) % 3, v = (axis + 2) % 3;
+  if (normal[axis] < 0.0) {
+    int swap = u;
+    u = v;
+    v = swap;
+  }
+  for (int j = 0; j < count; j++) {
+    const Vertex *p = &vertices->vertices[indices[j] - 1];
+    points[j].x = coordinate(p, u);
+    points[j].y = coordinate(p, v);
+  }
+  return 1;
+}
+
+// A quad splits along the diagonal through its reflex corner, if it has
+// one. The fan diagonal from corner 0 is kept unless the two triangles it
+// makes face opposite ways, then the other diagonal is taken.
+static void split_quad(const Faces *faces, const Vertices *vertices,
+                       int first, Triangle *out) {
+  const int *indices = faces->vertex_indices + first;
+  for (int j = 0; j < 4; j++) {
+    if (indices[j] < 1 || indices[j] > vertices->count) {
+      fan(faces, first, 4, out);
+      return;
+    }
+  }
+  const Vertex *a = &vertices->vertices[indices[0] - 1];
+  const Vertex *b = &vertices->vertices[indices[1] - 1];
+  const Vertex *c = &vertices->vertices[indices[2] - 1];
+  const Vertex *d = &vertices->vertices[indices[3] - 1];
+  // the edges are differences of nearby floats and only the sign of the
+  // product of the two normals counts, so float is precise enough here
+  float bx = b->x - a->x, by = b->y - a->y, bz = b->z - a->z;
+  float cx = c->x - a->x, cy = c->y - a->y, cz = c->z - a->z;
+  float dx = d->x - a->x, dy = d->y - a->y, dz = d->z - a->z;
+  float facing = (by * cz - bz * cy) * (cy * dz - cz * dy) +
+                 (bz * cx - bx * cz) * (cz * dx - cx * dz) +
+                 (bx * cy - by * cx) * (cx * dy - cy * dx);
+  if (facing < 0.0f) {
+    emit(faces, first, 1, 2, 3, out);
+    emit(faces, first, 3, 0, 1, out + 1);
+  } else {
+    fan(faces, first, 4, out);
+  }
+}
+
+static int is_convex(const Point2 *points, int count) {
+  for (int j = 0; j < count; j++) {
+    Point2 prev = points[j > 0 ? j - 1 : count - 1];
+    Point2 next = points[j + 1 < count ? j + 1 : 0];
+    if (cross(prev, points[j], next) < 0.0) return 0;
+  }
+  return 1;
+}
+
+// A corner is an ear when it turns counterclockwise and no other remaining
+// corner lies in the triangle it cuts off.
+static int is_ear(const Point2 *points, const int *next, int a, int b,
+                  int c) {
+  Point2 pa = points[a], pb = points[b], pc = points[c];
+  if (cross(pa, pb, pc) <= 0.0) return 0;
+  for (int j = next[c]; j != a; j = next[j]) {
+    Point2 p = points[j];
+    if (same_point(p, pa) || same_point(p, pb) || same_point(p, pc)) continue;
+    if (cross(pa, pb, p) >= 0.0 && cross(pb, pc, p) >= 0.0 &&
+        cross(pc, pa, p) >= 0.0)
+      return 0;
+  }
+  return 1;
+}
+
+// Cuts off ears until one triangle is left, in O(n^2) for n corners. After
+// a whole round without an ear, which only a self-intersecting face can
+// have, the current corner is cut off anyway, so every face still gives
+// count - 2 triangles.
+static void clip_ears(const Faces *faces, int first, int count,
+                      const Point2 *points, int *next, int *prev,
+                      Triangle *out) {
+  for (int j = 0; j < count; j++) {
+    next[j] = j + 1 < count ? j + 1 : 0;
+    prev[j] = j > 0 ? j - 1 : count - 1;
+  }
+  int corner = 0, misses = 0;
+  for (int remaining = count; remaining > 3;) {
+    int a = prev[corner], c = next[corner];
+    if (misses < remaining && !is_ear(points, next, a, corner, c)) {
+      corner = c;
+      misses++;
+      continue;
+    }
+    emit(faces, first, a, corner, c, out++);
+    next[a] = c;
+    prev[c] = a;
+    remaining--;
+    corner = a;
+    misses = 0;
+  }
+  emit(faces, first, prev[corner], corner, next[corner], out);
+}
+
+static void *triangulate_range(void *arg) {
+  TriangulateJob *job = arg;
+  const Faces *faces = job->faces;
+  Point2 stack_points[STACK_CORNERS];
+  int stack_links[2 * STACK_CORNERS];
+  Point2 *points = stack_points;
+  int *links = stack_links;
+  int capacity = STACK_CORNERS;
+  for (int i = job->first_face; i < job->last_face; i++) {
+    int first = faces->offsets[i], count = faces->offsets[i + 1] - first;
+    Triangle *out = job->triangles + first - 2 * i;
+    if (count == 3) {
+      emit(faces, first, 0, 1, 2, out);
+      continue;
+    }
+    if (count == 4) {
+      split_quad(faces, job->vertices, first, out);
+      continue;
+    }
+    if (count > capacity) {
+      if (points != stack_points) safe_free(points);
+      if (links != stack_links) safe_free(links);
+      capacity = count;
+      points = malloc(sizeof(Point2) * capacity);
+      links = malloc(sizeof(int) * 2 * capacity);
+      if (points == NULL || links == NULL) {
+        printf("Error: Could not allocate memory for triangulation\n");
+        job->error = 1;
+        break;
+      }
+    }
+    if (!project_face(faces, job->vertices, first, count, points) ||
+        is_convex(points, count))
+      fan(faces, first, count, out);
+    else
+      clip_ears(faces, first, count, points, links, links + count, out);
+  }
+  if (points != stack_points) safe_free(points);
+  if (links != stack_links) safe_free(links);
+  return NULL;
+}
+
+// The first range is handled by the calling thread, a range whose thread
+// could not be started as well.
+void triangulate_faces(const Faces *faces, const Vertices *vertices,
+                       Triangle *triangles, int threads, int *error) {
+  if (threads <= 0) threads = online_cpu_count();
+  if (faces->count / TRIANGULATE_MIN_FACES + 1 < threads)
+    threads = faces->count / TRIANGULATE_MIN_FACES + 1;
+  TriangulateJob *jobs = calloc(sizeof(TriangulateJob), threads);
+  pthread_t *workers = calloc(sizeof(pthread_t), threads);
+  int *started = calloc(sizeof(int), threads);
+  if (jobs == NULL || workers == NULL || started == NULL) {
+    printf("Error: Could not allocate memory for threads\n");
+    *error = 1;
+  }
+  for (int i = 0; i < threads && !*error; i++) {
+    jobs[i].faces = faces;
+    jobs[i].vertices = vertices;
+    jobs[i].triangles = triangles;
+    jobs[i].first_face = (int)((long long)faces->count * i / threads);
+    jobs[i].last_face = (int)((long long)faces->count * (i + 1) / threads);
+  }
+  for (int i = 1; i < threads && !*error; i++)
+    started[i] =
+        pthread_create(&workers[i], NULL, triangulate_range, &jobs[i]) == 0;
+  if (!*error) triangulate_range(&jobs[0]);
+  for (int i = 1; i < threads && !*error; i++) {
+    if (started[i])
+      pthread_join(workers[i], NULL);
+    else
+      triangulate_range(&jobs[i]);
+  }
+  for (int i = 0; i < threads && !*error; i++) *error = jobs[i].error;
+  safe_free(jobs);
+  safe_free(workers);
+  safe_free(started);
+}
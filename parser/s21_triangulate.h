@@ -0,0 +1,40 @@
+#ifndef INC_3DT_TRIANGULATE_H
+#define INC_3DT_TRIANGULATE_H
+
+#include "s21_parser.h"
+
+/// Fewer faces than this per thread are triangulated on fewer threads.
+#define TRIANGULATE_MIN_FACES 65536
+
+/// \brief The number of triangles the faces split into.
+/// A face of n corners gives n - 2 triangles, so the count follows from
+/// the corner counts the parser records without a pass over the faces.
+/// \param faces The faces.
+/// \return The number of triangles.
+int count_triangles(const Faces *faces);
+
+/// \brief The first triangle of a face in the output of triangulate_faces.
+/// The offsets of the corner pool are a prefix sum of the corner counts,
+/// so the triangles of face i start at offsets[i] - 2 * i.
+/// \param faces The faces.
+/// \param face The index of the face.
+/// \return The index of its first triangle.
+int first_triangle(const Faces *faces, int face);
+
+/// \brief Split every face into triangles of its corners.
+/// A face is projected onto the plane of the largest component of its
+/// Newell normal. Convex faces are fanned from their first corner, concave
+/// ones are split by ear clipping, both keep the winding of the face.
+/// Faces with corners outside the vertices or without area are fanned.
+/// The threads take contiguous ranges of faces and write their triangles
+/// at the offsets from first_triangle, so the result does not depend on the
+/// thread count.
+/// \param faces The faces.
+/// \param vertices The vertices the faces refer to.
+/// \param triangles Room for count_triangles(faces) triangles.
+/// \param threads The number of threads, 0 to use every online core.
+/// \param error The error code.
+void triangulate_faces(const Faces *faces, const Vertices *vertices,
+                       Triangle *triangles, int threads, int *error);
+
+#endif //INC_3DT_TRIANGULATE_H
@@ -2,11 +2,37 @@
 #include <stdlib.h>
 
 int test_parser();
+int test_number();
+int test_mesh();
+int test_cache();
+int test_bvh();
+int test_simplify();
+int test_simd();
+int test_quantize();
+int test_optimize();
+int test_stream();
+int test_raster();
+int test_export();
+int test_model();
+int test_triangulate();
 
 int main() {
   int no_failed = 0;
 
   no_failed |= test_parser();
+  no_failed |= test_number();
+  no_failed |= test_mesh();
+  no_failed |= test_cache();
+  no_failed |= test_bvh();
+  no_failed |= test_simplify();
+  no_failed |= test_simd();
+  no_failed |= test_quantize();
+  no_failed |= test_optimize();
+  no_failed |= test_stream();
+  no_failed |= test_raster();
+  no_failed |= test_export();
+  no_failed |= test_model();
+  no_failed |= test_triangulate();
 
   return (no_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,124 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parser/s21_mesh.h"
+#include "test_helpers.h"
+
+// Column-major matrix mapping the box [min, max] onto the clip cube.
+static void fit_matrix(const float* min, const float* max, float* mvp) {
+  memset(mvp, 0, sizeof(float) * 16);
+  for (int axis = 0; axis < 3; axis++) {
+    float scale = 2.0f / (max[axis] - min[axis]);
+    mvp[axis * 5] = scale;
+    mvp[12 + axis] = -1.0f - min[axis] * scale;
+  }
+  mvp[15] = 1.0f;
+}
+
+static int point_inside(const float* point, const float* mvp) {
+  for (int axis = 0; axis < 3; axis++) {
+    float clip = point[axis] * mvp[axis * 5] + mvp[12 + axis];
+    if (clip < -1.0f || clip > 1.0f) return 0;
+  }
+  return 1;
+}
+
+START_TEST(test_bvh_orders_mesh) {
+  int error = 0;
+  Mesh mesh = build_mesh("models/Mickey Mouse_2.obj", &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_gt(mesh.point_bvh.node_count, 1);
+  ck_assert_int_eq(is_valid_bvh(&mesh.edge_bvh, mesh.edge_count), 1);
+  ck_assert_int_eq(is_valid_bvh(&mesh.point_bvh, mesh.point_count), 1);
+
+  // every point lies inside the box of its leaf
+  for (int i = 0; i < mesh.point_bvh.node_count; i++) {
+    BvhNode* node = &mesh.point_bvh.nodes[i];
+    for (int j = node->first; j < node->first + node->count; j++)
+      for (int axis = 0; axis < 3; axis++) {
+        ck_assert(mesh.points[j * 3 + axis] >= node->min[axis]);
+        ck_assert(mesh.points[j * 3 + axis] <= node->max[axis]);
+      }
+  }
+  destroy_mesh(&mesh);
+}
+END_TEST
+
+START_TEST(test_bvh_culls_frustum) {
+  int error = 0;
+  Mesh mesh = build_mesh("models/Mickey Mouse_2.obj", &error);
+  ck_assert_int_eq(error, 0);
+  Bvh* bvh = &mesh.point_bvh;
+  int capacity = bvh_range_capacity(bvh);
+  BvhRange* ranges = malloc(sizeof(BvhRange) * capacity);
+  float mvp[16];
+  float min[3], max[3];
+  memcpy(min, bvh->nodes[0].min, sizeof(min));
+  memcpy(max, bvh->nodes[0].max, sizeof(max));
+
+  fit_matrix(min, max, mvp);
+  ck_assert_int_eq(cull_bvh(bvh, mvp, ranges, capacity), 1);
+  ck_assert_int_eq(ranges[0].first, 0);
+  ck_assert_int_eq(ranges[0].count, mesh.point_count);
+
+  mvp[12] += 10.0f;
+  ck_assert_int_eq(cull_bvh(bvh, mvp, ranges, capacity), 0);
+
+  // a view of the left half keeps every point inside it and drops some
+  max[0] = (min[0] + max[0]) * 0.5f;
+  fit_matrix(min, max, mvp);
+  int count = cull_bvh(bvh, mvp, ranges, capacity);
+  ck_assert_int_gt(count, 0);
+  int drawn = 0;
+  char* visible = calloc(mesh.point_count, 1);
+  for (int i = 0; i < count; i++) {
+    drawn += ranges[i].count;
+    memset(visible + ranges[i].first, 1, ranges[i].count);
+  }
+  ck_assert_int_lt(drawn, mesh.point_count);
+  for (int i = 0; i < mesh.point_count; i++)
+    if (point_inside(&mesh.points[i * 3], mvp)) ck_assert_int_eq(visible[i], 1);
+
+  // with a single range the visible ones still get drawn
+  ck_assert_int_eq(cull_bvh(bvh, mvp, ranges, 1), 1);
+  ck_assert_int_ge(ranges[0].count, drawn);
+
+  free(visible);
+  free(ranges);
+  destroy_mesh(&mesh);
+}
+END_TEST
+
+Suite*
+
+bvh_suite(void) {
+  Suite* s;
+  TCase* tc_pos;
+
+  s = suite_create("bvh");
+
+  tc_pos = tcase_create("positives");
+
+  tcase_add_test(tc_pos, test_bvh_orders_mesh);
+  tcase_add_test(tc_pos, test_bvh_culls_frustum);
+  suite_add_tcase(s, tc_pos);
+
+  return s;
+}
+
+int test_bvh() {
+  int no_failed = 0;
+  Suite* s;
+  SRunner* sr;
+
+  s = bvh_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  no_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return no_failed;
+}
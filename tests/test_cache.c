@@ -0,0 +1,143 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <check.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "../parser/s21_cache.h"
+#include "test_helpers.h"
+
+START_TEST(test_cache_round_trip) {
+  const char* path = "models/Mickey Mouse_2.obj";
+  int error = 0;
+  Mesh mesh = build_mesh(path, &error);
+  ck_assert_int_eq(error, 0);
+  save_mesh_cache(".", path, &mesh, &error);
+  ck_assert_int_eq(error, 0);
+
+  Mesh cached = {0};
+  ck_assert_int_eq(load_mesh_cache(".", path, &cached), 1);
+  ck_assert_ptr_ne(cached.mapping.data, NULL);
+  ck_assert_int_eq(cached.vertex_count, mesh.vertex_count);
+  ck_assert_int_eq(cached.index_count, mesh.index_count);
+  ck_assert_int_eq(cached.edge_count, mesh.edge_count);
+  ck_assert_int_eq(cached.point_count, mesh.point_count);
+  ck_assert_float_eq(cached.optimized_cache.acmr, mesh.optimized_cache.acmr);
+  ck_assert_float_eq(cached.original_cache.atvr, mesh.original_cache.atvr);
+  ck_assert_int_eq(memcmp(cached.positions, mesh.positions,
+                          sizeof(float) * 3 * mesh.vertex_count),
+                   0);
+  ck_assert_int_eq(memcmp(cached.normals, mesh.normals,
+                          sizeof(float) * 3 * mesh.vertex_count),
+                   0);
+  ck_assert_int_eq(memcmp(cached.textures, mesh.textures,
+                          sizeof(float) * 2 * mesh.vertex_count),
+                   0);
+  ck_assert_ptr_eq(cached.position_w, NULL);
+  ck_assert_ptr_eq(cached.texture_w, NULL);
+  ck_assert_int_eq(
+      memcmp(cached.indices, mesh.indices, sizeof(uint32_t) * mesh.index_count),
+      0);
+  ck_assert_int_eq(memcmp(cached.edges, mesh.edges,
+                          sizeof(uint32_t) * 2 * mesh.edge_count),
+                   0);
+  ck_assert_int_eq(
+      memcmp(cached.points, mesh.points, sizeof(float) * 3 * mesh.point_count),
+      0);
+  ck_assert_int_gt(mesh.lod_count, 0);
+  ck_assert_int_eq(cached.lod_count, mesh.lod_count);
+  for (int i = 0; i < mesh.lod_count; i++) {
+    ck_assert_int_eq(cached.lods[i].edge_count, mesh.lods[i].edge_count);
+    ck_assert_int_eq(memcmp(cached.lods[i].edges, mesh.lods[i].edges,
+                            sizeof(uint32_t) * 2 * mesh.lods[i].edge_count),
+                     0);
+    ck_assert_int_eq(cached.lods[i].bvh.node_count,
+                     mesh.lods[i].bvh.node_count);
+  }
+
+  char cache_path[4096];
+  ck_assert_int_eq(mesh_cache_path(".", path, cache_path, sizeof(cache_path)),
+                   1);
+  destroy_mesh(&cached);
+  ck_assert_ptr_eq(cached.positions, NULL);
+  destroy_mesh(&mesh);
+  remove(cache_path);
+}
+END_TEST
+
+START_TEST(test_cache_misses_changed_model) {
+  const char* path = "test_cache.obj";
+  FILE* file = fopen(path, "w");
+  ck_assert_ptr_ne(file, NULL);
+  fprintf(file, "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\n");
+  fclose(file);
+  struct timespec times[2] = {{1000000000, 100}, {1000000000, 100}};
+  ck_assert_int_eq(utimensat(AT_FDCWD, path, times, 0), 0);
+
+  int error = 0;
+  Mesh mesh = build_mesh(path, &error);
+  ck_assert_int_eq(error, 0);
+  save_mesh_cache(".", path, &mesh, &error);
+  ck_assert_int_eq(error, 0);
+  destroy_mesh(&mesh);
+
+  Mesh cached = {0};
+  ck_assert_int_eq(load_mesh_cache(".", path, &cached), 1);
+  destroy_mesh(&cached);
+
+  // an edit that keeps the size within the same second
+  times[1].tv_nsec = 200;
+  ck_assert_int_eq(utimensat(AT_FDCWD, path, times, 0), 0);
+  ck_assert_int_eq(load_mesh_cache(".", path, &cached), 0);
+
+  // a different size invalidates the entry even within the same second
+  file = fopen(path, "a");
+  ck_assert_ptr_ne(file, NULL);
+  fprintf(file, "v 1 1 0\nf 2 4 3\n");
+  fclose(file);
+  ck_assert_int_eq(load_mesh_cache(".", path, &cached), 0);
+  ck_assert_ptr_eq(cached.positions, NULL);
+  ck_assert_int_eq(load_mesh_cache(".", "models/does_not_exist.obj", &cached),
+                   0);
+
+  char cache_path[4096];
+  mesh_cache_path(".", path, cache_path, sizeof(cache_path));
+  remove(cache_path);
+  remove(path);
+}
+END_TEST
+
+Suite*
+
+cache_suite(void) {
+  Suite* s;
+  TCase* tc_pos;
+
+  s = suite_create("cache");
+
+  tc_pos = tcase_create("positives");
+
+  tcase_add_test(tc_pos, test_cache_round_trip);
+  tcase_add_test(tc_pos, test_cache_misses_changed_model);
+  suite_add_tcase(s, tc_pos);
+
+  return s;
+}
+
+int test_cache() {
+  int no_failed = 0;
+  Suite* s;
+  SRunner* sr;
+
+  s = cache_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  no_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return no_failed;
+}
@@ -0,0 +1,278 @@
+#include <check.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parser/s21_export.h"
+
+static const char* model_path = "models/Taurus.obj";
+
+static char* read_file(const char* path, long* size) {
+  FILE* file = fopen(path, "rb");
+  if (file == NULL) return NULL;
+  fseek(file, 0, SEEK_END);
+  *size = ftell(file);
+  fseek(file, 0, SEEK_SET);
+  char* data = malloc(*size + 1);
+  if (data != NULL && fread(data, 1, *size, file) != (size_t)*size) {
+    free(data);
+    data = NULL;
+  }
+  if (data != NULL) data[*size] = '\0';
+  fclose(file);
+  return data;
+}
+
+static uint32_t read_u32(const char* data) {
+  const unsigned char* bytes = (const unsigned char*)data;
+  return bytes[0] | bytes[1] << 8 | bytes[2] << 16 | (uint32_t)bytes[3] << 24;
+}
+
+static float read_f32(const char* data) {
+  uint32_t bits = read_u32(data);
+  float value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+static VertexBuffer build_buffer(Obj* obj, int* error) {
+  VertexBuffer buffer = {0};
+  Triangles triangles = triangulate(obj, error);
+  if (!*error) buffer = create_vertex_buffer(obj, triangles, error);
+  safe_free(triangles.triangles);
+  return buffer;
+}
+
+START_TEST(test_export_obj_round_trip) {
+  Obj* obj = parse_obj(model_path);
+  ck_assert_ptr_ne(obj, NULL);
+  int error = 0;
+  export_obj("test_export.obj", obj, &error);
+  ck_assert_int_eq(error, 0);
+  Obj* exported = parse_obj("test_export.obj");
+  ck_assert_ptr_ne(exported, NULL);
+
+  ck_assert_int_eq(exported->vertices->count, obj->vertices->count);
+  ck_assert_int_eq(memcmp(exported->vertices->vertices, obj->vertices->vertices,
+                          sizeof(Vertex) * obj->vertices->count),
+                   0);
+  ck_assert_int_eq(exported->textures->count, obj->textures->count);
+  ck_assert_int_eq(memcmp(exported->textures->textures, obj->textures->textures,
+                          sizeof(Texture) * obj->textures->count),
+                   0);
+  ck_assert_int_eq(exported->normals->count, obj->normals->count);
+  ck_assert_int_eq(memcmp(exported->normals->normals, obj->normals->normals,
+                          sizeof(Normal) * obj->normals->count),
+                   0);
+  const Faces* faces = obj->faces;
+  ck_assert_int_eq(exported->faces->count, faces->count);
+  ck_assert_int_eq(exported->faces->index_count, faces->index_count);
+  ck_assert_int_eq(memcmp(exported->faces->offsets, faces->offsets,
+                          sizeof(int) * (faces->count + 1)),
+                   0);
+  ck_assert_int_eq(memcmp(exported->faces->vertex_indices,
+                          faces->vertex_indices,
+                          sizeof(int) * faces->index_count),
+                   0);
+  ck_assert_int_eq(memcmp(exported->faces->texture_indices,
+                          faces->texture_indices,
+                          sizeof(int) * faces->index_count),
+                   0);
+  ck_assert_int_eq(memcmp(exported->faces->normal_indices,
+                          faces->normal_indices,
+                          sizeof(int) * faces->index_count),
+                   0);
+  destroy_obj(exported);
+  destroy_obj(obj);
+  remove("test_export.obj");
+}
+END_TEST
+
+START_TEST(test_export_obj_keeps_w_and_missing_indices) {
+  FILE* file = fopen("test_export_w.obj", "w");
+  ck_assert_ptr_ne(file, NULL);
+  fprintf(file,
+          "v 0 0 0 0.5\nv 1 0 0\nv 0 1 0\nv 1 1 0\nvt 0.25 0.75 -0\n"
+          "vt 1e-7 0\nvn 0 0 1\nf 1 2 3\nf 1/1 2/2 3/1\nf 2//1 4//1 3//1\n");
+  fclose(file);
+  Obj* obj = parse_obj("test_export_w.obj");
+  ck_assert_ptr_ne(obj, NULL);
+  int error = 0;
+  export_obj("test_export.obj", obj, &error);
+  ck_assert_int_eq(error, 0);
+
+  long size = 0;
+  char* text = read_file("test_export.obj", &size);
+  ck_assert_ptr_ne(text, NULL);
+  ck_assert_str_eq(text,
+                   "v 0 0 0 0.5\nv 1 0 0\nv 0 1 0\nv 1 1 0\nvt 0.25 0.75 -0\n"
+                   "vt 1e-7 0\nvn 0 0 1\nf 1 2 3\nf 1/1 2/2 3/1\n"
+                   "f 2//1 4//1 3//1\n");
+  free(text);
+  destroy_obj(obj);
+  remove("test_export.obj");
+  remove("test_export_w.obj");
+}
+END_TEST
+
+START_TEST(test_export_obj_buffer_round_trip) {
+  Obj* obj = parse_obj(model_path);
+  ck_assert_ptr_ne(obj, NULL);
+  int error = 0;
+  VertexBuffer buffer = build_buffer(obj, &error);
+  ck_assert_int_eq(error, 0);
+  export_obj_buffer("test_export.obj", &buffer, &error);
+  ck_assert_int_eq(error, 0);
+
+  Obj* exported = parse_obj("test_export.obj");
+  ck_assert_ptr_ne(exported, NULL);
+  ck_assert_int_eq(exported->vertices->count, buffer.count);
+  ck_assert_int_eq(exported->faces->count, buffer.count / 3);
+  VertexBuffer reloaded = build_buffer(exported, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(reloaded.count, buffer.count);
+  ck_assert_int_eq(
+      memcmp(reloaded.data, buffer.data, sizeof(VertexData) * buffer.count), 0);
+  safe_free(reloaded.data);
+  safe_free(buffer.data);
+  destroy_obj(exported);
+  destroy_obj(obj);
+  remove("test_export.obj");
+}
+END_TEST
+
+START_TEST(test_export_ply_layout) {
+  Obj* obj = parse_obj(model_path);
+  ck_assert_ptr_ne(obj, NULL);
+  int error = 0;
+  export_ply("test_export.ply", obj, &error);
+  ck_assert_int_eq(error, 0);
+
+  long size = 0;
+  char* data = read_file("test_export.ply", &size);
+  ck_assert_ptr_ne(data, NULL);
+  char header[256];
+  snprintf(header, sizeof(header),
+           "ply\nformat binary_little_endian 1.0\nelement vertex %d\n"
+           "property float x\nproperty float y\nproperty float z\n"
+           "element face %d\nproperty list uchar int vertex_indices\n"
+           "end_header\n",
+           obj->vertices->count, obj->faces->count);
+  size_t header_size = strlen(header);
+  ck_assert_int_eq(memcmp(data, header, header_size), 0);
+  const Faces* faces = obj->faces;
+  ck_assert_int_eq(size, (long)header_size + 12L * obj->vertices->count +
+                             faces->count + 4L * faces->index_count);
+
+  const char* ptr = data + header_size;
+  for (int i = 0; i < obj->vertices->count; i++, ptr += 12) {
+    ck_assert_float_eq(read_f32(ptr), obj->vertices->vertices[i].x);
+    ck_assert_float_eq(read_f32(ptr + 8), obj->vertices->vertices[i].z);
+  }
+  for (int i = 0; i < faces->count; i++) {
+    ck_assert_int_eq((unsigned char)*ptr++,
+                     faces->offsets[i + 1] - faces->offsets[i]);
+    for (int j = faces->offsets[i]; j < faces->offsets[i + 1]; j++, ptr += 4)
+      ck_assert_int_eq(read_u32(ptr), faces->vertex_indices[j] - 1);
+  }
+  free(data);
+  destroy_obj(obj);
+  remove("test_export.ply");
+}
+END_TEST
+
+START_TEST(test_export_stl_layout) {
+  VertexData data[4] = {0};
+  data[1].position.x = 2.0f;
+  data[2].position.y = 3.0f;
+  data[3].position.z = 1.0f;
+  VertexBuffer buffer = {data, 4};
+  int error = 0;
+  export_stl("test_export.stl", &buffer, &error);
+  ck_assert_int_eq(error, 0);
+
+  long size = 0;
+  char* stl = read_file("test_export.stl", &size);
+  ck_assert_ptr_ne(stl, NULL);
+  ck_assert_int_eq(size, 84 + 50);
+  ck_assert_int_ne(strncmp(stl, "solid", 5), 0);
+  ck_assert_int_eq(read_u32(stl + 80), 1);
+  const char* facet = stl + 84;
+  ck_assert_float_eq(read_f32(facet), 0.0f);
+  ck_assert_float_eq(read_f32(facet + 4), 0.0f);
+  ck_assert_float_eq(read_f32(facet + 8), 1.0f);
+  ck_assert_float_eq(read_f32(facet + 24), 2.0f);
+  ck_assert_float_eq(read_f32(facet + 40), 3.0f);
+  ck_assert_int_eq(facet[48] | facet[49], 0);
+  free(stl);
+  remove("test_export.stl");
+}
+END_TEST
+
+START_TEST(test_export_unwritable_path) {
+  Obj* obj = parse_obj("models/Cube.obj");
+  ck_assert_ptr_ne(obj, NULL);
+  int error = 0;
+  export_obj("does_not_exist/test_export.obj", obj, &error);
+  ck_assert_int_eq(error, 1);
+  error = 0;
+  export_ply("does_not_exist/test_export.ply", obj, &error);
+  ck_assert_int_eq(error, 1);
+  destroy_obj(obj);
+}
+END_TEST
+
+START_TEST(test_export_ply_rejects_missing_vertices) {
+  const char* text[] = {"v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 9\n",
+                        "v 0 0 0\nv 1 0 0\nv 0 1 0\nf 1 2 3\nf 1 -9 2\n"};
+  for (int i = 0; i < 2; i++) {
+    int error = 0;
+    Obj* obj = init_obj(&error);
+    parse_obj_data(text[i], strlen(text[i]), obj, &error);
+    ck_assert_int_eq(error, 0);
+    export_ply("test_export.ply", obj, &error);
+    ck_assert_int_eq(error, 1);
+    FILE* file = fopen("test_export.ply", "rb");
+    ck_assert_ptr_eq(file, NULL);
+    destroy_obj(obj);
+  }
+}
+END_TEST
+
+Suite*
+
+export_suite(void) {
+  Suite* s;
+  TCase* tc_pos;
+
+  s = suite_create("export");
+
+  tc_pos = tcase_create("positives");
+
+  tcase_add_test(tc_pos, test_export_obj_round_trip);
+  tcase_add_test(tc_pos, test_export_obj_keeps_w_and_missing_indices);
+  tcase_add_test(tc_pos, test_export_obj_buffer_round_trip);
+  tcase_add_test(tc_pos, test_export_ply_layout);
+  tcase_add_test(tc_pos, test_export_stl_layout);
+  tcase_add_test(tc_pos, test_export_unwritable_path);
+  tcase_add_test(tc_pos, test_export_ply_rejects_missing_vertices);
+  suite_add_tcase(s, tc_pos);
+
+  return s;
+}
+
+int test_export() {
+  int no_failed = 0;
+  Suite* s;
+  SRunner* sr;
+
+  s = export_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  no_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return no_failed;
+}
@@ -0,0 +1,13 @@
+#include "test_helpers.h"
+
+Mesh build_mesh(const char* path, int* error) {
+  Mesh mesh = {0};
+  Obj* obj = parse_obj(path);
+  if (obj == NULL) *error = 1;
+  Triangles triangles = {0};
+  if (!*error) triangles = triangulate(obj, error);
+  if (!*error) mesh = create_mesh(obj, triangles, error);
+  safe_free(triangles.triangles);
+  destroy_obj(obj);
+  return mesh;
+}
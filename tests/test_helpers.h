@@ -0,0 +1,12 @@
+#ifndef INC_3DT_TEST_HELPERS_H
+#define INC_3DT_TEST_HELPERS_H
+
+#include "../parser/s21_mesh.h"
+
+/// \brief Parse, triangulate and index a model file into a mesh.
+/// \param path The model file.
+/// \param error The error code.
+/// \return The mesh, empty on error.
+Mesh build_mesh(const char* path, int* error);
+
+#endif //INC_3DT_TEST_HELPERS_H
@@ -0,0 +1,146 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parser/s21_mesh.h"
+
+START_TEST(test_mesh_cube) {
+  Obj* cube = parse_obj("models/Cube.obj");
+  ck_assert_ptr_ne(cube, NULL);
+  int error = 0;
+  Triangles triangles = triangulate(cube, &error);
+  Mesh mesh = create_mesh(cube, triangles, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(mesh.vertex_count, 8);
+  ck_assert_int_eq(mesh.index_count, 36);
+  for (int i = 0; i < mesh.index_count; i++)
+    ck_assert_int_lt(mesh.indices[i], 8);
+  ck_assert_int_eq(mesh.edge_count, 12);
+  ck_assert_int_eq(mesh.point_count, 8);
+  ck_assert_float_eq(mesh.points[7 * 3 + 2], cube->vertices->vertices[7].z);
+  for (int i = 0; i < mesh.edge_count; i++) {
+    ck_assert_int_ne(mesh.edges[i * 2], mesh.edges[i * 2 + 1]);
+    for (int j = 0; j < i; j++)
+      ck_assert(!(mesh.edges[i * 2] == mesh.edges[j * 2 + 1] &&
+                  mesh.edges[i * 2 + 1] == mesh.edges[j * 2]));
+  }
+  ck_assert_ptr_eq(mesh.position_w, NULL);
+  ck_assert_ptr_eq(mesh.texture_w, NULL);
+  destroy_mesh(&mesh);
+  ck_assert_ptr_eq(mesh.positions, NULL);
+  safe_free(triangles.triangles);
+  destroy_obj(cube);
+}
+END_TEST
+
+static int compare_bytes(const void* a, const void* b) {
+  return memcmp(a, b, sizeof(float) * MESH_VERTEX_FLOATS * 3);
+}
+
+START_TEST(test_mesh_matches_vertex_buffer) {
+  Obj* obj = parse_obj("models/Mickey Mouse_2.obj");
+  ck_assert_ptr_ne(obj, NULL);
+  int error = 0;
+  Triangles triangles = triangulate(obj, &error);
+  VertexBuffer buffer = create_vertex_buffer(obj, triangles, &error);
+  Mesh mesh = create_mesh(obj, triangles, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(mesh.index_count, buffer.count);
+  ck_assert_int_lt(mesh.vertex_count, buffer.count / 3);
+  float* interleaved =
+      malloc(sizeof(float) * MESH_VERTEX_FLOATS * mesh.vertex_count);
+  interleave_vertices(&mesh, interleaved);
+  // both sides are compared as sorted lists of whole triangles, so the
+  // order the mesh keeps them in does not matter
+  int corner = MESH_VERTEX_FLOATS, triangle = corner * 3;
+  float* expected = malloc(sizeof(float) * corner * buffer.count);
+  float* actual = malloc(sizeof(float) * corner * mesh.index_count);
+  for (int i = 0; i < mesh.index_count; i++) {
+    const VertexData* data = &buffer.data[i];
+    memcpy(&expected[i * corner], &data->position, sizeof(float) * 3);
+    memcpy(&expected[i * corner + 3], &data->normal, sizeof(float) * 3);
+    memcpy(&expected[i * corner + 6], &data->texture, sizeof(float) * 2);
+    memcpy(&actual[i * corner],
+           &interleaved[mesh.indices[i] * MESH_VERTEX_FLOATS],
+           sizeof(float) * corner);
+    ck_assert_float_eq(data->position.w, 1.0f);
+    ck_assert_float_eq(data->texture.w, 0.0f);
+  }
+  qsort(expected, buffer.count / 3, sizeof(float) * triangle, compare_bytes);
+  qsort(actual, mesh.index_count / 3, sizeof(float) * triangle,
+        compare_bytes);
+  ck_assert_int_eq(
+      memcmp(expected, actual, sizeof(float) * corner * mesh.index_count), 0);
+  free(expected);
+  free(actual);
+  ck_assert_ptr_eq(mesh.position_w, NULL);
+  free(interleaved);
+  destroy_mesh(&mesh);
+  safe_free(buffer.data);
+  safe_free(triangles.triangles);
+  destroy_obj(obj);
+}
+END_TEST
+
+START_TEST(test_mesh_w_streams) {
+  FILE* file = fopen("w_streams.obj", "w");
+  ck_assert_ptr_ne(file, NULL);
+  fputs("v 0 0 0 2\nv 1 0 0\nv 0 1 0 0.5\nvt 0 0 0.25\nvt 1 0\n"
+        "f 1/1 2/2 3/1\n",
+        file);
+  fclose(file);
+  Obj* obj = parse_obj("w_streams.obj");
+  remove("w_streams.obj");
+  ck_assert_ptr_ne(obj, NULL);
+  int error = 0;
+  Triangles triangles = triangulate(obj, &error);
+  Mesh mesh = create_mesh(obj, triangles, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(mesh.vertex_count, 3);
+  ck_assert_ptr_ne(mesh.position_w, NULL);
+  ck_assert_ptr_ne(mesh.texture_w, NULL);
+  const float position_w[3] = {2.0f, 1.0f, 0.5f};
+  const float texture_w[3] = {0.25f, 0.0f, 0.25f};
+  for (int i = 0; i < 3; i++) {
+    ck_assert_float_eq(mesh.position_w[i], position_w[i]);
+    ck_assert_float_eq(mesh.texture_w[i], texture_w[i]);
+  }
+  destroy_mesh(&mesh);
+  safe_free(triangles.triangles);
+  destroy_obj(obj);
+}
+END_TEST
+
+Suite*
+
+mesh_suite(void) {
+  Suite* s;
+  TCase* tc_pos;
+
+  s = suite_create("mesh");
+
+  tc_pos = tcase_create("positives");
+
+  tcase_add_test(tc_pos, test_mesh_cube);
+  tcase_add_test(tc_pos, test_mesh_matches_vertex_buffer);
+  tcase_add_test(tc_pos, test_mesh_w_streams);
+  suite_add_tcase(s, tc_pos);
+
+  return s;
+}
+
+int test_mesh() {
+  int no_failed = 0;
+  Suite* s;
+  SRunner* sr;
+
+  s = mesh_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  no_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return no_failed;
+}
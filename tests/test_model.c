@@ -0,0 +1,273 @@
+#include <check.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parser/s21_export.h"
+#include "../parser/s21_model.h"
+
+static const ParseOptions serial = {1, NULL, NULL};
+
+static void write_file(const char* path, const void* data, size_t size) {
+  FILE* file = fopen(path, "wb");
+  ck_assert_ptr_ne(file, NULL);
+  ck_assert_int_eq(fwrite(data, 1, size, file), size);
+  fclose(file);
+}
+
+static size_t put_big_endian(unsigned char* out, const void* value,
+                             size_t size) {
+  for (size_t i = 0; i < size; i++)
+    out[i] = ((const unsigned char*)value)[size - 1 - i];
+  return size;
+}
+
+START_TEST(test_model_ply_round_trip) {
+  Obj* obj = parse_obj("models/Taurus.obj");
+  ck_assert_ptr_ne(obj, NULL);
+  int error = 0;
+  export_ply("test_model.ply", obj, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(model_file_format("test_model.ply"), MODEL_PLY);
+
+  Obj* loaded = parse_model("test_model.ply", serial);
+  ck_assert_ptr_ne(loaded, NULL);
+  ck_assert_int_eq(loaded->vertices->count, obj->vertices->count);
+  for (int i = 0; i < obj->vertices->count; i++) {
+    ck_assert_float_eq(loaded->vertices->vertices[i].x,
+                       obj->vertices->vertices[i].x);
+    ck_assert_float_eq(loaded->vertices->vertices[i].z,
+                       obj->vertices->vertices[i].z);
+    ck_assert_float_eq(loaded->vertices->vertices[i].w, 1.0f);
+  }
+  ck_assert_int_eq(loaded->normals->count, 0);
+  ck_assert_int_eq(loaded->textures->count, 0);
+  ck_assert_int_eq(loaded->faces->count, obj->faces->count);
+  ck_assert_int_eq(loaded->faces->index_count, obj->faces->index_count);
+  ck_assert_int_eq(memcmp(loaded->faces->offsets, obj->faces->offsets,
+                          sizeof(int) * (obj->faces->count + 1)),
+                   0);
+  ck_assert_int_eq(memcmp(loaded->faces->vertex_indices,
+                          obj->faces->vertex_indices,
+                          sizeof(int) * obj->faces->index_count),
+                   0);
+  ck_assert_int_eq(loaded->faces->faces[1].vertex_count,
+                   obj->faces->faces[1].vertex_count);
+  ck_assert_int_eq(loaded->faces->faces[1].texture_indices[0], 0);
+  destroy_obj(loaded);
+  destroy_obj(obj);
+  remove("test_model.ply");
+}
+END_TEST
+
+START_TEST(test_model_ply_big_endian_attributes) {
+  const char header[] =
+      "ply\r\nformat binary_big_endian 1.0\r\ncomment written by hand\r\n"
+      "element vertex 4\r\nproperty double x\r\nproperty double y\r\n"
+      "property double z\r\nproperty uchar red\r\nproperty float nx\r\n"
+      "property float ny\r\nproperty float nz\r\nproperty float s\r\n"
+      "property float t\r\nelement face 1\r\n"
+      "property list uchar float texcoord\r\n"
+      "property list ushort uint vertex_indices\r\n"
+      "element edge 1\r\nproperty int vertex1\r\nproperty int vertex2\r\n"
+      "end_header\r\n";
+  unsigned char data[1024];
+  size_t size = strlen(header);
+  memcpy(data, header, size);
+  for (int i = 0; i < 4; i++) {
+    double position[3] = {i, i * 0.5, -i};
+    float rest[5] = {0.0f, 0.0f, 1.0f, i * 0.25f, 1.0f - i * 0.25f};
+    for (int j = 0; j < 3; j++)
+      size += put_big_endian(data + size, &position[j], sizeof(double));
+    data[size++] = 255;
+    for (int j = 0; j < 5; j++)
+      size += put_big_endian(data + size, &rest[j], sizeof(float));
+  }
+  data[size++] = 1;
+  float texcoord = 0.5f;
+  size += put_big_endian(data + size, &texcoord, sizeof(float));
+  uint16_t corners = 4;
+  size += put_big_endian(data + size, &corners, sizeof(corners));
+  for (uint32_t i = 0; i < 4; i++)
+    size += put_big_endian(data + size, &i, sizeof(i));
+  int32_t edge[2] = {0, 1};
+  size += put_big_endian(data + size, &edge[0], sizeof(int32_t));
+  size += put_big_endian(data + size, &edge[1], sizeof(int32_t));
+
+  int error = 0;
+  Obj* obj = init_obj(&error);
+  parse_ply_data((const char*)data, size, obj, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(obj->vertices->count, 4);
+  ck_assert_float_eq(obj->vertices->vertices[3].x, 3.0f);
+  ck_assert_float_eq(obj->vertices->vertices[3].y, 1.5f);
+  ck_assert_float_eq(obj->vertices->vertices[3].z, -3.0f);
+  ck_assert_int_eq(obj->normals->count, 4);
+  ck_assert_float_eq(obj->normals->normals[2].z, 1.0f);
+  ck_assert_int_eq(obj->textures->count, 4);
+  ck_assert_float_eq(obj->textures->textures[1].u, 0.25f);
+  ck_assert_float_eq(obj->textures->textures[1].v, 0.75f);
+  ck_assert_int_eq(obj->faces->count, 1);
+  Face face = obj->faces->faces[0];
+  ck_assert_int_eq(face.vertex_count, 4);
+  for (int i = 0; i < 4; i++) {
+    ck_assert_int_eq(face.vertex_indices[i], i + 1);
+    ck_assert_int_eq(face.texture_indices[i], i + 1);
+    ck_assert_int_eq(face.normal_indices[i], i + 1);
+  }
+  destroy_obj(obj);
+
+  // one byte short of the last element
+  obj = init_obj(&error);
+  parse_ply_data((const char*)data, size - 1, obj, &error);
+  ck_assert_int_eq(error, 1);
+  destroy_obj(obj);
+}
+END_TEST
+
+START_TEST(test_model_ply_rejects_ascii) {
+  const char text[] =
+      "ply\nformat ascii 1.0\nelement vertex 3\nproperty float x\n"
+      "property float y\nproperty float z\nend_header\n0 0 0\n1 0 0\n0 1 0\n";
+  write_file("test_model.ply", text, strlen(text));
+  ck_assert_int_eq(model_file_format("test_model.ply"), MODEL_PLY);
+  ck_assert_ptr_eq(parse_model("test_model.ply", serial), NULL);
+  remove("test_model.ply");
+}
+END_TEST
+
+START_TEST(test_model_ply_rejects_huge_counts) {
+  // far more vertices than the body holds, with and without a list
+  const char* headers[] = {
+      "ply\nformat binary_little_endian 1.0\nelement vertex 2000000000\n"
+      "property float x\nproperty float y\nproperty float z\nend_header\n",
+      "ply\nformat binary_little_endian 1.0\nelement vertex 2000000000\n"
+      "property float x\nproperty list uchar int ids\nend_header\n"};
+  for (int i = 0; i < 2; i++) {
+    char data[256] = {0};
+    size_t size = strlen(headers[i]);
+    memcpy(data, headers[i], size);
+    int error = 0;
+    Obj* obj = init_obj(&error);
+    parse_ply_data(data, size + 24, obj, &error);
+    ck_assert_int_eq(error, 1);
+    ck_assert_ptr_eq(obj->vertices->vertices, NULL);
+    destroy_obj(obj);
+  }
+}
+END_TEST
+
+START_TEST(test_model_stl_rejects_ascii) {
+  const char text[] =
+      "solid part\n facet normal 0 0 1\n  outer loop\n   vertex 0 0 0\n"
+      "   vertex 1 0 0\n   vertex 0 1 0\n  endloop\n endfacet\n"
+      "endsolid part\n";
+  write_file("test_model.stl", text, strlen(text));
+  ck_assert_int_eq(model_file_format("test_model.stl"), MODEL_STL);
+  ck_assert_ptr_eq(parse_model("test_model.stl", serial), NULL);
+  remove("test_model.stl");
+}
+END_TEST
+
+START_TEST(test_model_stl_round_trip) {
+  Obj* obj = parse_obj("models/Taurus.obj");
+  ck_assert_ptr_ne(obj, NULL);
+  int error = 0;
+  Triangles triangles = triangulate(obj, &error);
+  VertexBuffer buffer = create_vertex_buffer(obj, triangles, &error);
+  ck_assert_int_eq(error, 0);
+  export_stl("test_model.stl", &buffer, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(model_file_format("test_model.stl"), MODEL_STL);
+
+  Obj* loaded = parse_model("test_model.stl", serial);
+  ck_assert_ptr_ne(loaded, NULL);
+  ck_assert_int_eq(loaded->faces->count, triangles.count);
+  ck_assert_int_eq(loaded->vertices->count, buffer.count);
+  ck_assert_int_eq(loaded->normals->count, triangles.count);
+  ck_assert_int_eq(loaded->textures->count, 0);
+  for (int i = 0; i < buffer.count; i++) {
+    ck_assert_int_eq(memcmp(&loaded->vertices->vertices[i],
+                            &buffer.data[i].position, sizeof(Vertex)),
+                     0);
+    ck_assert_int_eq(loaded->faces->vertex_indices[i], i + 1);
+    ck_assert_int_eq(loaded->faces->normal_indices[i], i / 3 + 1);
+  }
+  Face face = loaded->faces->faces[triangles.count - 1];
+  ck_assert_int_eq(face.vertex_count, 3);
+  ck_assert_int_eq(face.vertex_indices[0], buffer.count - 2);
+  safe_free(buffer.data);
+  safe_free(triangles.triangles);
+  destroy_obj(loaded);
+  destroy_obj(obj);
+  remove("test_model.stl");
+}
+END_TEST
+
+START_TEST(test_model_detects_signatures) {
+  // binary stl files from some tools start with "solid" as well
+  unsigned char stl[84 + 50] = "solid part";
+  stl[80] = 1;
+  ck_assert_int_eq(detect_model_format((const char*)stl, 84, sizeof(stl)),
+                   MODEL_STL);
+  // and are told from ascii ones by their size
+  ck_assert_int_eq(detect_model_format((const char*)stl, 84, sizeof(stl) + 1),
+                   MODEL_STL);
+  ck_assert_int_eq(detect_model_format("solidity", 8, 8), MODEL_OBJ);
+  ck_assert_int_eq(detect_model_format("ply\n", 4, 4), MODEL_PLY);
+  ck_assert_int_eq(detect_model_format("plyx", 4, 4), MODEL_OBJ);
+  ck_assert_int_eq(model_file_format("models/Cube.obj"), MODEL_OBJ);
+  Obj* obj = parse_model("models/Cube.obj", serial);
+  ck_assert_ptr_ne(obj, NULL);
+  ck_assert_int_gt(obj->faces->count, 0);
+  destroy_obj(obj);
+
+  write_file("test_model.stl", stl, sizeof(stl) - 1);
+  ck_assert_int_eq(model_file_format("test_model.stl"), MODEL_STL);
+  ck_assert_ptr_eq(parse_model("test_model.stl", serial), NULL);
+  int error = 0;
+  obj = init_obj(&error);
+  parse_stl_data((const char*)stl, sizeof(stl) - 1, obj, &error);
+  ck_assert_int_eq(error, 1);
+  destroy_obj(obj);
+  remove("test_model.stl");
+}
+END_TEST
+
+Suite*
+
+model_suite(void) {
+  Suite* s;
+  TCase* tc_pos;
+
+  s = suite_create("model");
+
+  tc_pos = tcase_create("positives");
+
+  tcase_add_test(tc_pos, test_model_ply_round_trip);
+  tcase_add_test(tc_pos, test_model_ply_big_endian_attributes);
+  tcase_add_test(tc_pos, test_model_ply_rejects_ascii);
+  tcase_add_test(tc_pos, test_model_ply_rejects_huge_counts);
+  tcase_add_test(tc_pos, test_model_stl_rejects_ascii);
+  tcase_add_test(tc_pos, test_model_stl_round_trip);
+  tcase_add_test(tc_pos, test_model_detects_signatures);
+  suite_add_tcase(s, tc_pos);
+
+  return s;
+}
+
+int test_model() {
+  int no_failed = 0;
+  Suite* s;
+  SRunner* sr;
+
+  s = model_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  no_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return no_failed;
+}
@@ -0,0 +1,227 @@
+#include <check.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parser/s21_number.h"
+
+static uint32_t next_random(uint32_t* state) {
+  *state = *state * 1664525u + 1013904223u;
+  return *state;
+}
+
+static int same_as_strtof(const char* text) {
+  float scanned = 0.0f;
+  const char* end = scan_float(text, &scanned);
+  char* expected_end = NULL;
+  float expected = strtof(text, &expected_end);
+  return end == expected_end && memcmp(&scanned, &expected, sizeof(float)) == 0;
+}
+
+// The digits of a written float without leading or trailing zeros.
+static int significant_digits(const char* text) {
+  const char* first = text;
+  while (*first == '-' || *first == '0' || *first == '.') first++;
+  const char* last = first + strcspn(first, "e");
+  while (last > first && (last[-1] == '0' || last[-1] == '.')) last--;
+  int digits = 0;
+  for (const char* c = first; c < last; c++) digits += *c != '.';
+  return digits;
+}
+
+START_TEST(test_scan_float_simple) {
+  float value = 0.0f;
+  const char* text = "-0.50000000 1.25";
+  const char* end = scan_float(text, &value);
+  ck_assert_ptr_eq(end, text + 11);
+  ck_assert_float_eq(value, -0.5f);
+  end = scan_float(end + 1, &value);
+  ck_assert_int_eq(*end, '\0');
+  ck_assert_float_eq(value, 1.25f);
+}
+END_TEST
+
+START_TEST(test_scan_float_forms) {
+  const char* texts[] = {"0",          "-0",          "+7",
+                         ".5",         "5.",          "1e3",
+                         "1E-3",       "-4.0280905e-18", "1e",
+                         "2e+",        "3.4028235e38", "3.4028236e38",
+                         "1e39",       "1e-38",        "1.4e-45",
+                         "1e-46",      "0.1",          "16777217",
+                         "0.00000000000000000000000000001234",
+                         "123456789012345678901234567890",
+                         "1.00000005960464477539062500001",
+                         "1.000000059604644775390625"};
+  for (size_t i = 0; i < sizeof(texts) / sizeof(texts[0]); i++)
+    ck_assert_msg(same_as_strtof(texts[i]), "%s", texts[i]);
+}
+END_TEST
+
+START_TEST(test_scan_float_not_a_number) {
+  float value = 0.0f;
+  ck_assert_ptr_eq(scan_float("", &value), NULL);
+  ck_assert_ptr_eq(scan_float("-", &value), NULL);
+  ck_assert_ptr_eq(scan_float(".", &value), NULL);
+  ck_assert_ptr_eq(scan_float("x1", &value), NULL);
+  ck_assert_ptr_eq(scan_float(" 1", &value), NULL);
+}
+END_TEST
+
+START_TEST(test_scan_float_round_trip) {
+  uint32_t state = 21;
+  char text[64];
+  for (int i = 0; i < 200000; i++) {
+    uint32_t bits = next_random(&state);
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    if (value != value || value - value != 0.0f) continue;
+    snprintf(text, sizeof(text), "%.9g", value);
+    ck_assert_msg(same_as_strtof(text), "%s", text);
+    snprintf(text, sizeof(text), "%.6g", value);
+    ck_assert_msg(same_as_strtof(text), "%s", text);
+  }
+}
+END_TEST
+
+START_TEST(test_scan_float_random_decimals) {
+  uint32_t state = 42;
+  char text[64];
+  for (int i = 0; i < 200000; i++) {
+    int whole = next_random(&state) % 100000;
+    int fraction = next_random(&state) % 100000000;
+    int exponent = (int)(next_random(&state) % 81) - 40;
+    snprintf(text, sizeof(text), "%s%d.%08de%d",
+             next_random(&state) % 2 ? "-" : "", whole, fraction, exponent);
+    ck_assert_msg(same_as_strtof(text), "%s", text);
+    snprintf(text, sizeof(text), "%d.%06d", whole, fraction % 1000000);
+    ck_assert_msg(same_as_strtof(text), "%s", text);
+  }
+}
+END_TEST
+
+START_TEST(test_scan_int) {
+  int value = 0;
+  const char* text = "42/-7//";
+  const char* end = scan_int(text, &value);
+  ck_assert_int_eq(value, 42);
+  ck_assert_int_eq(*end, '/');
+  end = scan_int(end + 1, &value);
+  ck_assert_int_eq(value, -7);
+  ck_assert_ptr_eq(scan_int(end + 1, &value), NULL);
+  ck_assert_ptr_eq(scan_int("99999999999", &value), NULL);
+  ck_assert_ptr_ne(scan_int("-2147483648", &value), NULL);
+  ck_assert_int_eq(value, -2147483647 - 1);
+}
+END_TEST
+
+START_TEST(test_format_float_shortest) {
+  const struct {
+    float value;
+    const char* text;
+  } cases[] = {{0.0f, "0"},
+               {-0.0f, "-0"},
+               {1.0f, "1"},
+               {-2.5f, "-2.5"},
+               {0.1f, "0.1"},
+               {0.3f, "0.3"},
+               {1e-4f, "0.0001"},
+               {0.000123f, "0.000123"},
+               {1e-5f, "1e-5"},
+               {1234.5f, "1234.5"},
+               {123456789.0f, "123456790"},
+               {16777216.0f, "16777216"},
+               {1e9f, "1e9"},
+               {3.14159265f, "3.1415927"},
+               {1e-45f, "1e-45"},
+               {1.17549435e-38f, "1.1754944e-38"},
+               {3.4028235e38f, "3.4028235e38"},
+               {1.0f / 0.0f, "inf"},
+               {-1.0f / 0.0f, "-inf"}};
+  char text[NUMBER_TEXT_MAX + 1];
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+    *format_float(cases[i].value, text) = '\0';
+    ck_assert_str_eq(text, cases[i].text);
+  }
+  *format_float(0.0f / 0.0f, text) = '\0';
+  ck_assert_str_eq(text, "nan");
+}
+END_TEST
+
+START_TEST(test_format_float_round_trip) {
+  uint32_t state = 23;
+  char text[NUMBER_TEXT_MAX + 1];
+  char shorter[64];
+  for (int i = 0; i < 200000; i++) {
+    uint32_t bits = next_random(&state);
+    if (i < 1000) bits = i;
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    if (value != value || value - value != 0.0f) continue;
+    char* end = format_float(value, text);
+    ck_assert_int_le(end - text, NUMBER_TEXT_MAX - 1);
+    *end = '\0';
+    float scanned = 0.0f;
+    ck_assert_ptr_eq(scan_float(text, &scanned), end);
+    ck_assert_msg(memcmp(&scanned, &value, sizeof(float)) == 0, "%s", text);
+    // no decimal with one digit less reads back to the same float
+    int digits = significant_digits(text);
+    if (digits > 1) {
+      snprintf(shorter, sizeof(shorter), "%.*e", digits - 2, value);
+      ck_assert_msg(strtof(shorter, NULL) != value, "%s %s", text, shorter);
+    }
+  }
+}
+END_TEST
+
+START_TEST(test_format_int) {
+  char text[NUMBER_TEXT_MAX + 1];
+  *format_int(0, text) = '\0';
+  ck_assert_str_eq(text, "0");
+  *format_int(-7, text) = '\0';
+  ck_assert_str_eq(text, "-7");
+  *format_int(1234567890, text) = '\0';
+  ck_assert_str_eq(text, "1234567890");
+  *format_int(-2147483647 - 1, text) = '\0';
+  ck_assert_str_eq(text, "-2147483648");
+}
+END_TEST
+
+Suite*
+
+number_suite(void) {
+  Suite* s;
+  TCase* tc_pos;
+
+  s = suite_create("number");
+
+  tc_pos = tcase_create("positives");
+
+  tcase_add_test(tc_pos, test_scan_float_simple);
+  tcase_add_test(tc_pos, test_scan_float_forms);
+  tcase_add_test(tc_pos, test_scan_float_not_a_number);
+  tcase_add_test(tc_pos, test_scan_float_round_trip);
+  tcase_add_test(tc_pos, test_scan_float_random_decimals);
+  tcase_add_test(tc_pos, test_scan_int);
+  tcase_add_test(tc_pos, test_format_float_shortest);
+  tcase_add_test(tc_pos, test_format_float_round_trip);
+  tcase_add_test(tc_pos, test_format_int);
+  suite_add_tcase(s, tc_pos);
+
+  return s;
+}
+
+int test_number() {
+  int no_failed = 0;
+  Suite* s;
+  SRunner* sr;
+
+  s = number_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  no_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return no_failed;
+}
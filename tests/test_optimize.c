@@ -0,0 +1,177 @@
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parser/s21_mesh.h"
+
+static int compare_triangles(const void *a, const void *b) {
+  return memcmp(a, b, sizeof(uint32_t) * 3);
+}
+
+// Rotates every triangle to start at its smallest corner and sorts them, so
+// two lists hold the same triangles with the same winding when these match.
+static uint32_t *canonical_triangles(const uint32_t *indices, int count) {
+  uint32_t *sorted = malloc(sizeof(uint32_t) * (count + 1));
+  for (int i = 0; i < count; i += 3) {
+    int first = i;
+    for (int j = i + 1; j < i + 3; j++)
+      if (indices[j] < indices[first]) first = j;
+    for (int j = 0; j < 3; j++)
+      sorted[i + j] = indices[i + (first - i + j) % 3];
+  }
+  qsort(sorted, count / 3, sizeof(uint32_t) * 3, compare_triangles);
+  return sorted;
+}
+
+static uint32_t *file_order(Triangles triangles) {
+  uint32_t *indices = malloc(sizeof(uint32_t) * (triangles.count * 3 + 1));
+  for (int i = 0; i < triangles.count * 3; i++)
+    indices[i] = triangles.triangles[i / 3].vertex_indices[i % 3] - 1;
+  return indices;
+}
+
+START_TEST(test_optimize_measure) {
+  // two triangles sharing an edge miss four vertices
+  uint32_t quad[6] = {0, 1, 2, 2, 1, 3};
+  CacheStats stats = measure_vertex_cache(quad, 6, 4);
+  ck_assert_float_eq(stats.acmr, 2.0f);
+  ck_assert_float_eq(stats.atvr, 1.0f);
+  stats = measure_vertex_cache(quad, 0, 0);
+  ck_assert_float_eq(stats.acmr, 0.0f);
+  ck_assert_float_eq(stats.atvr, 0.0f);
+}
+END_TEST
+
+START_TEST(test_optimize_lines) {
+  // a path whose lines are drawn in a scattered order
+  enum { LINES = 1000 };
+  uint32_t indices[LINES * 2];
+  int drawn[LINES] = {0};
+  for (int i = 0; i < LINES; i++) {
+    int line = i * 37 % LINES;
+    indices[i * 2] = line;
+    indices[i * 2 + 1] = line + 1;
+  }
+  CacheStats before = measure_line_cache(indices, LINES * 2, LINES + 1);
+  ck_assert_float_eq_tol(before.acmr, 2.0f, 0.01f);
+  int error = 0;
+  optimize_line_cache(indices, LINES * 2, LINES + 1, &error);
+  ck_assert_int_eq(error, 0);
+  CacheStats after = measure_line_cache(indices, LINES * 2, LINES + 1);
+  ck_assert(after.acmr < 1.01f);
+  for (int i = 0; i < LINES; i++) {
+    ck_assert_uint_eq(indices[i * 2 + 1], indices[i * 2] + 1);
+    drawn[indices[i * 2]]++;
+  }
+  for (int i = 0; i < LINES; i++) ck_assert_int_eq(drawn[i], 1);
+}
+END_TEST
+
+START_TEST(test_optimize_cache) {
+  Obj *obj = parse_obj("models/Mickey Mouse_2.obj");
+  ck_assert_ptr_ne(obj, NULL);
+  int error = 0;
+  Triangles triangles = triangulate(obj, &error);
+  ck_assert_int_eq(error, 0);
+  int index_count = triangles.count * 3;
+  int vertex_count = obj->vertices->count;
+  uint32_t *source = file_order(triangles);
+  uint32_t *expected = canonical_triangles(source, index_count);
+  CacheStats before = measure_vertex_cache(source, index_count, vertex_count);
+
+  for (int overdraw = 0; overdraw <= 1; overdraw++) {
+    uint32_t *indices = malloc(sizeof(uint32_t) * index_count);
+    memcpy(indices, source, sizeof(uint32_t) * index_count);
+    optimize_vertex_cache(&obj->vertices->vertices[0].x, indices, index_count,
+                          vertex_count, overdraw, &error);
+    ck_assert_int_eq(error, 0);
+    CacheStats after = measure_vertex_cache(indices, index_count,
+                                            vertex_count);
+    ck_assert(after.acmr < before.acmr);
+    ck_assert(after.acmr < 0.8f);
+    uint32_t *actual = canonical_triangles(indices, index_count);
+    ck_assert_int_eq(memcmp(actual, expected, sizeof(uint32_t) * index_count),
+                     0);
+    safe_free(actual);
+    safe_free(indices);
+  }
+  safe_free(expected);
+  safe_free(source);
+  safe_free(triangles.triangles);
+  destroy_obj(obj);
+}
+END_TEST
+
+START_TEST(test_optimize_fetch) {
+  // vertices 2 and 4 are never used and go last
+  uint32_t indices[6] = {3, 1, 5, 5, 1, 0};
+  uint32_t remap[6];
+  optimize_vertex_fetch(indices, 6, 6, remap);
+  const uint32_t expected[6] = {0, 1, 2, 2, 1, 3};
+  for (int i = 0; i < 6; i++) ck_assert_int_eq(indices[i], expected[i]);
+  const uint32_t expected_remap[6] = {3, 1, 4, 0, 5, 2};
+  for (int i = 0; i < 6; i++) ck_assert_int_eq(remap[i], expected_remap[i]);
+}
+END_TEST
+
+START_TEST(test_optimize_mesh) {
+  Obj *obj = parse_obj("models/Cow.obj");
+  ck_assert_ptr_ne(obj, NULL);
+  int error = 0;
+  Triangles triangles = triangulate(obj, &error);
+  Mesh mesh = create_mesh(obj, triangles, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert(mesh.original_cache.acmr > 0.0f);
+  ck_assert(mesh.optimized_cache.acmr < mesh.original_cache.acmr);
+  ck_assert(mesh.optimized_cache.atvr < mesh.original_cache.atvr);
+  CacheStats stats = measure_line_cache(mesh.edges, mesh.edge_count * 2,
+                                        mesh.vertex_count);
+  ck_assert_float_eq(stats.acmr, mesh.optimized_cache.acmr);
+
+  // every vertex is first used in the order the edges are drawn
+  uint32_t next = 0;
+  for (int i = 0; i < mesh.edge_count * 2; i++) {
+    ck_assert(mesh.edges[i] <= next);
+    if (mesh.edges[i] == next) next++;
+  }
+  destroy_mesh(&mesh);
+  safe_free(triangles.triangles);
+  destroy_obj(obj);
+}
+END_TEST
+
+Suite*
+
+optimize_suite(void) {
+  Suite* s;
+  TCase* tc_pos;
+
+  s = suite_create("optimize");
+
+  tc_pos = tcase_create("positives");
+
+  tcase_add_test(tc_pos, test_optimize_measure);
+  tcase_add_test(tc_pos, test_optimize_cache);
+  tcase_add_test(tc_pos, test_optimize_lines);
+  tcase_add_test(tc_pos, test_optimize_fetch);
+  tcase_add_test(tc_pos, test_optimize_mesh);
+  suite_add_tcase(s, tc_pos);
+
+  return s;
+}
+
+int test_optimize() {
+  int no_failed = 0;
+  Suite* s;
+  SRunner* sr;
+
+  s = optimize_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  no_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return no_failed;
+}
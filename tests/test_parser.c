@@ -6,7 +6,7 @@
 #include "../parser/s21_parser.h"
 
 START_TEST(test_load_destroy_cube) {
-  Obj* cube = parse_obj("models/cube.obj");
+  Obj* cube = parse_obj("models/Cube.obj");
   ck_assert_ptr_ne(cube, NULL);
   ck_assert_ptr_ne(cube->vertices, NULL);
   ck_assert_ptr_ne(cube->faces, NULL);
@@ -52,6 +52,204 @@ START_TEST(test_load_complex_obj) {
 }
 END_TEST
 
+START_TEST(test_parse_face_formats) {
+  int error = 0;
+  Faces faces = {0};
+  Face face = parse_face("f 1// 12//3 7/2 \r\n", &faces, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(face.vertex_count, 3);
+  ck_assert_int_eq(face.vertex_indices[1], 12);
+  ck_assert_int_eq(face.texture_indices[0], 0);
+  ck_assert_int_eq(face.normal_indices[1], 3);
+  ck_assert_int_eq(face.texture_indices[2], 2);
+
+  parse_face("f 1 2 x\n", &faces, &error);
+  ck_assert_int_eq(error, 1);
+  ck_assert_int_eq(faces.count, 1);
+  ck_assert_int_eq(faces.index_count, 3);
+  safe_free(faces.faces);
+  safe_free(faces.offsets);
+  safe_free(faces.vertex_indices);
+}
+END_TEST
+
+START_TEST(test_faces_share_index_pool) {
+  Obj* cube = parse_obj("models/Cube.obj");
+  ck_assert_ptr_ne(cube, NULL);
+  Faces* faces = cube->faces;
+  ck_assert_int_eq(faces->index_count, 24);
+  ck_assert_int_eq(faces->offsets[0], 0);
+  ck_assert_int_eq(faces->offsets[6], 24);
+  for (int i = 0; i < faces->count; i++) {
+    ck_assert_ptr_eq(faces->faces[i].vertex_indices,
+                     faces->vertex_indices + faces->offsets[i]);
+    ck_assert_int_eq(faces->faces[i].vertex_count, 4);
+  }
+  ck_assert_int_eq(faces->faces[5].vertex_indices[3], 6);
+  destroy_obj(cube);
+}
+END_TEST
+
+START_TEST(test_parse_vertex_components) {
+  int error = 0;
+  Vertex vertex = parse_vertex("v 1.5 -2 3e1\n", &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_float_eq(vertex.z, 30.0f);
+  ck_assert_float_eq(vertex.w, 1.0f);
+  Texture texture = parse_texture("vt -0.307129 0.29541 0", &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_float_eq(texture.u, -0.307129f);
+  parse_normal("vn 1 2\n", &error);
+  ck_assert_int_eq(error, 1);
+}
+END_TEST
+
+START_TEST(test_parse_long_lines) {
+  const char* path = "test_long_lines.obj";
+  FILE* file = fopen(path, "w");
+  ck_assert_ptr_ne(file, NULL);
+  fprintf(file, "# %0*d\n", 4000, 0);
+  for (int i = 1; i <= 1000; i++) fprintf(file, "v %d 0.5 -%d\n", i, i);
+  // the last coordinate of a vertex several KB into its line
+  fprintf(file, "v 7 %*s8 %*s9\n", 2000, "", 2000, "");
+  fprintf(file, "f");
+  for (int i = 1; i <= 1000; i++) fprintf(file, " %d", i);
+  fprintf(file, "\nf 1 2 1001");
+  fclose(file);
+
+  Obj* obj = parse_obj(path);
+  remove(path);
+  ck_assert_ptr_ne(obj, NULL);
+  ck_assert_int_eq(obj->vertices->count, 1001);
+  ck_assert_float_eq(obj->vertices->vertices[999].z, -1000.0f);
+  ck_assert_float_eq(obj->vertices->vertices[1000].y, 8.0f);
+  ck_assert_float_eq(obj->vertices->vertices[1000].z, 9.0f);
+  ck_assert_int_eq(obj->faces->count, 2);
+  ck_assert_int_eq(obj->faces->faces[0].vertex_count, 1000);
+  ck_assert_int_eq(obj->faces->faces[0].vertex_indices[999], 1000);
+  ck_assert_int_eq(obj->faces->faces[1].vertex_count, 3);
+  ck_assert_int_eq(obj->faces->faces[1].vertex_indices[2], 1001);
+  destroy_obj(obj);
+}
+END_TEST
+
+static int same_obj(Obj* a, Obj* b) {
+  int same = a->vertices->count == b->vertices->count &&
+             a->textures->count == b->textures->count &&
+             a->normals->count == b->normals->count &&
+             a->faces->count == b->faces->count;
+  for (int i = 0; same && i < a->vertices->count; i++)
+    same = !memcmp(&a->vertices->vertices[i], &b->vertices->vertices[i],
+                   sizeof(Vertex));
+  for (int i = 0; same && i < a->textures->count; i++)
+    same = !memcmp(&a->textures->textures[i], &b->textures->textures[i],
+                   sizeof(Texture));
+  for (int i = 0; same && i < a->normals->count; i++)
+    same = !memcmp(&a->normals->normals[i], &b->normals->normals[i],
+                   sizeof(Normal));
+  for (int i = 0; same && i < a->faces->count; i++) {
+    Face* x = &a->faces->faces[i];
+    Face* y = &b->faces->faces[i];
+    same = x->vertex_count == y->vertex_count;
+    for (int j = 0; same && j < x->vertex_count; j++)
+      same = x->vertex_indices[j] == y->vertex_indices[j] &&
+             x->texture_indices[j] == y->texture_indices[j] &&
+             x->normal_indices[j] == y->normal_indices[j];
+  }
+  return same;
+}
+
+START_TEST(test_parallel_matches_serial) {
+  const char* paths[] = {"models/Mickey Mouse_2.obj", "models/Girl.obj",
+                         "models/Cactus.obj", "models/Cube.obj"};
+  for (int i = 0; i < 4; i++) {
+    Obj* serial = parse_obj(paths[i]);
+    Obj* parallel = parse_obj_parallel(paths[i], 4);
+    ck_assert_ptr_ne(serial, NULL);
+    ck_assert_ptr_ne(parallel, NULL);
+    ck_assert_int_eq(same_obj(serial, parallel), 1);
+    destroy_obj(serial);
+    destroy_obj(parallel);
+  }
+}
+END_TEST
+
+START_TEST(test_parallel_relative_indices) {
+  const char* path = "test_relative.obj";
+  FILE* file = fopen(path, "w");
+  ck_assert_ptr_ne(file, NULL);
+  for (int i = 0; i < 40000; i++) {
+    fprintf(file, "v %d.5 %d -%d\nvn 0 0 1\n", i, i % 7, i % 3);
+    if (i >= 2) fprintf(file, "f -3//-1 -2//-2 -1//-3\n");
+  }
+  fclose(file);
+
+  Obj* serial = parse_obj(path);
+  Obj* parallel = parse_obj_parallel(path, 3);
+  remove(path);
+  ck_assert_ptr_ne(serial, NULL);
+  ck_assert_ptr_ne(parallel, NULL);
+  ck_assert_int_eq(serial->faces->count, 39998);
+  ck_assert_int_eq(serial->faces->faces[39997].vertex_indices[0], 39998);
+  ck_assert_int_eq(serial->faces->faces[39997].normal_indices[0], 40000);
+  ck_assert_int_eq(same_obj(serial, parallel), 1);
+  destroy_obj(serial);
+  destroy_obj(parallel);
+}
+END_TEST
+
+START_TEST(test_parallel_without_faces) {
+  const char* path = "test_no_faces.obj";
+  const char* texts[] = {"v 0 0 0\nv 1 2 3\nvn 0 0 1\n", "# only a comment\n"};
+  for (int i = 0; i < 2; i++) {
+    FILE* file = fopen(path, "w");
+    ck_assert_ptr_ne(file, NULL);
+    fputs(texts[i], file);
+    fclose(file);
+    Obj* obj = parse_obj_parallel(path, 4);
+    ck_assert_ptr_ne(obj, NULL);
+    ck_assert_int_eq(obj->vertices->count, i == 0 ? 2 : 0);
+    ck_assert_int_eq(obj->faces->count, 0);
+    ck_assert_int_eq(obj->faces->index_count, 0);
+    destroy_obj(obj);
+  }
+  remove(path);
+}
+END_TEST
+
+// last[2] counts calls that went backwards or past the total
+static int record_progress(size_t done, size_t total, void* user) {
+  size_t* last = user;
+  if (done < last[0] || done > total) last[2]++;
+  last[0] = done;
+  last[1] = total;
+  return 0;
+}
+
+static int cancel_progress(size_t done, size_t total, void* user) {
+  (void)total;
+  *(int*)user += 1;
+  return done > 0;
+}
+
+START_TEST(test_parse_progress_and_cancel) {
+  const char* path = "models/Girl.obj";
+  size_t last[3] = {0};
+  ParseOptions options = {4, record_progress, last};
+  Obj* obj = parse_obj_ex(path, options);
+  ck_assert_ptr_ne(obj, NULL);
+  ck_assert_int_gt(last[1], 0);
+  ck_assert_uint_eq(last[0], last[1]);
+  ck_assert_uint_eq(last[2], 0);
+  destroy_obj(obj);
+
+  int calls = 0;
+  ParseOptions cancel = {4, cancel_progress, &calls};
+  ck_assert_ptr_eq(parse_obj_ex(path, cancel), NULL);
+  ck_assert_int_ge(calls, 2);
+}
+END_TEST
+
 Suite*
 
 parser_suite(void) {
@@ -66,6 +264,14 @@ parser_suite(void) {
   tcase_add_test(tc_pos, test_load_destroy_cube);
   tcase_add_test(tc_pos, test_load_wrong_file);
   tcase_add_test(tc_pos, test_load_complex_obj);
+  tcase_add_test(tc_pos, test_parse_face_formats);
+  tcase_add_test(tc_pos, test_faces_share_index_pool);
+  tcase_add_test(tc_pos, test_parse_vertex_components);
+  tcase_add_test(tc_pos, test_parse_long_lines);
+  tcase_add_test(tc_pos, test_parallel_matches_serial);
+  tcase_add_test(tc_pos, test_parallel_relative_indices);
+  tcase_add_test(tc_pos, test_parallel_without_faces);
+  tcase_add_test(tc_pos, test_parse_progress_and_cancel);
   suite_add_tcase(s, tc_pos);
 
   return s;
@@ -0,0 +1,143 @@
+#include <check.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parser/s21_quantize.h"
+
+START_TEST(test_quantize_half) {
+  const float exact[] = {0.0f, 1.0f, -2.5f, 65504.0f, 0x1p-14f, 0x1p-24f};
+  for (size_t i = 0; i < sizeof(exact) / sizeof(exact[0]); i++)
+    ck_assert(half_to_float(float_to_half(exact[i])) == exact[i]);
+  ck_assert_int_eq(float_to_half(1.0f), 0x3C00);
+  ck_assert_int_eq(float_to_half(-0.0f), 0x8000);
+  // ties go to the even mantissa
+  ck_assert_int_eq(float_to_half(1.0f + 0x1p-11f), 0x3C00);
+  ck_assert_int_eq(float_to_half(1.0f + 3 * 0x1p-11f), 0x3C02);
+  ck_assert_int_eq(float_to_half(65520.0f), 0x7C00);
+  ck_assert_int_eq(float_to_half(INFINITY), 0x7C00);
+  ck_assert(isnan(half_to_float(float_to_half(NAN))));
+  ck_assert_int_eq(float_to_half(0x1p-26f), 0);
+  for (int half = 0; half < 0x7C00; half++)
+    ck_assert_int_eq(float_to_half(half_to_float(half)), half);
+}
+END_TEST
+
+START_TEST(test_quantize_octahedral) {
+  const float normals[][3] = {{0, 0, 1},  {0, 0, -1}, {1, 0, 0},
+                              {0, -1, 0}, {1, 2, -3}, {-0.3f, 0.5f, 0.8f}};
+  for (size_t i = 0; i < sizeof(normals) / sizeof(normals[0]); i++) {
+    int16_t encoded[2];
+    float decoded[3];
+    encode_octahedral(normals[i], encoded);
+    decode_octahedral(encoded, decoded);
+    const float *n = normals[i];
+    float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+    for (int axis = 0; axis < 3; axis++)
+      ck_assert_float_eq_tol(decoded[axis], n[axis] / length, 1e-4);
+  }
+  const float zero[3] = {0, 0, 0};
+  int16_t encoded[2] = {1, 1};
+  encode_octahedral(zero, encoded);
+  ck_assert_int_eq(encoded[0], 0);
+  ck_assert_int_eq(encoded[1], 0);
+}
+END_TEST
+
+START_TEST(test_quantize_mesh) {
+  Obj* obj = parse_obj("models/Mickey Mouse_2.obj");
+  ck_assert_ptr_ne(obj, NULL);
+  int error = 0;
+  Triangles triangles = triangulate(obj, &error);
+  Mesh mesh = create_mesh(obj, triangles, &error);
+  ck_assert_int_eq(error, 0);
+  Bounds bounds = compute_bounds(mesh.points, 3, mesh.point_count);
+  QuantizedMesh quantized = quantize_mesh(&mesh, &bounds, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(sizeof(QuantizedVertex), 16);
+  ck_assert_int_eq(quantized.vertex_count, mesh.vertex_count);
+  ck_assert_int_eq(quantized.point_count, mesh.point_count);
+
+  float extent = 0.0f;
+  for (int axis = 0; axis < 3; axis++)
+    extent = fmaxf(extent, bounds.max[axis] - bounds.min[axis]);
+  ck_assert(quantized.error.position <= extent / 65534.0f);
+  ck_assert(quantized.error.normal < 0.01f);
+  ck_assert(quantized.error.texture <= 0x1p-11f);
+
+  // the matrix maps the grid back onto the source positions
+  for (int i = 0; i < mesh.vertex_count; i += 97) {
+    float position[3];
+    for (int axis = 0; axis < 3; axis++)
+      position[axis] = quantized.vertices[i].position[axis];
+    transform_positions(position, 3, 1, quantized.dequantize);
+    for (int axis = 0; axis < 3; axis++)
+      ck_assert_float_eq_tol(position[axis], mesh.positions[i * 3 + axis],
+                             quantized.error.position * 1.01f + 1e-6f);
+  }
+  destroy_quantized_mesh(&quantized);
+  ck_assert_ptr_eq(quantized.vertices, NULL);
+  destroy_mesh(&mesh);
+  safe_free(triangles.triangles);
+  destroy_obj(obj);
+}
+END_TEST
+
+START_TEST(test_quantize_flat_bounds) {
+  float positions[6] = {1.0f, 2.0f, 3.0f, 1.0f, 5.0f, 3.0f};
+  float normals[6] = {0};
+  float textures[4] = {0.5f, 0.25f, 1.0f, 0.0f};
+  Mesh mesh = {0};
+  mesh.positions = positions;
+  mesh.normals = normals;
+  mesh.textures = textures;
+  mesh.points = positions;
+  mesh.vertex_count = mesh.point_count = 2;
+  Bounds bounds = compute_bounds(positions, 3, 2);
+  int error = 0;
+  QuantizedMesh quantized = quantize_mesh(&mesh, &bounds, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert(quantized.error.position < 1e-6f);
+  ck_assert_float_eq(quantized.error.normal, 0.0f);
+  ck_assert_float_eq(quantized.error.texture, 0.0f);
+  ck_assert_int_eq(quantized.points[0], 0);
+  ck_assert_int_eq(quantized.points[5], 32767);
+  ck_assert_float_eq(quantized.dequantize[12], 1.0f);
+  destroy_quantized_mesh(&quantized);
+}
+END_TEST
+
+Suite*
+
+quantize_suite(void) {
+  Suite* s;
+  TCase* tc_pos;
+
+  s = suite_create("quantize");
+
+  tc_pos = tcase_create("positives");
+
+  tcase_add_test(tc_pos, test_quantize_half);
+  tcase_add_test(tc_pos, test_quantize_octahedral);
+  tcase_add_test(tc_pos, test_quantize_mesh);
+  tcase_add_test(tc_pos, test_quantize_flat_bounds);
+  suite_add_tcase(s, tc_pos);
+
+  return s;
+}
+
+int test_quantize() {
+  int no_failed = 0;
+  Suite* s;
+  SRunner* sr;
+
+  s = quantize_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  no_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return no_failed;
+}
@@ -0,0 +1,215 @@
+#include <check.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parser/s21_raster.h"
+
+#define SIDE 16
+#define BACKGROUND 0xFF000000u
+#define LINE 0xFFFFFFFFu
+#define POINT 0xFF00FF00u
+
+static const float identity[16] = {1, 0, 0, 0, 0, 1, 0, 0,
+                                   0, 0, 1, 0, 0, 0, 0, 1};
+
+static RasterStyle solid_style(void) {
+  RasterStyle style = {BACKGROUND, LINE,  1.0f, 0xFFFF,
+                       POINT,      1.0f, RASTER_POINT_NONE};
+  return style;
+}
+
+// Draws the wireframe into a SIDE x SIDE image.
+static void draw(const Wireframe *wireframe, const RasterStyle *style,
+                 int threads, uint32_t *pixels) {
+  int error = 0;
+  Rasterizer *rasterizer = create_rasterizer(threads, &error);
+  ck_assert_ptr_ne(rasterizer, NULL);
+  RasterImage image = {pixels, SIDE, SIDE, SIDE};
+  rasterize_wireframe(rasterizer, wireframe, style, image, &error);
+  ck_assert_int_eq(error, 0);
+  destroy_rasterizer(rasterizer);
+}
+
+static int count_color(const uint32_t *pixels, uint32_t color) {
+  int count = 0;
+  for (int i = 0; i < SIDE * SIDE; i++) count += pixels[i] == color;
+  return count;
+}
+
+// A line across the middle, from window x 2 to 14 on row 8.
+static const float line[6] = {-0.75f, 0.0f, 0.0f, 0.75f, 0.0f, 0.0f};
+static const uint32_t line_edge[2] = {0, 1};
+
+START_TEST(test_raster_line) {
+  Wireframe wireframe = {line, 2, line_edge, 1, NULL, 0, identity};
+  RasterStyle style = solid_style();
+  uint32_t pixels[SIDE * SIDE];
+  draw(&wireframe, &style, 1, pixels);
+  for (int y = 0; y < SIDE; y++)
+    for (int x = 0; x < SIDE; x++)
+      ck_assert_uint_eq(pixels[y * SIDE + x],
+                        y == 8 && x >= 2 && x < 14 ? LINE : BACKGROUND);
+
+  // three rows wide, centered on the line
+  style.line_width = 3.0f;
+  draw(&wireframe, &style, 1, pixels);
+  ck_assert_int_eq(count_color(pixels, LINE), 36);
+  for (int x = 2; x < 14; x++)
+    for (int y = 7; y <= 9; y++) ck_assert_uint_eq(pixels[y * SIDE + x], LINE);
+}
+END_TEST
+
+START_TEST(test_raster_stipple) {
+  Wireframe wireframe = {line, 2, line_edge, 1, NULL, 0, identity};
+  RasterStyle style = solid_style();
+  style.line_stipple = 0x0101;
+  uint32_t pixels[SIDE * SIDE];
+  draw(&wireframe, &style, 1, pixels);
+  // every eighth pixel from the first vertex
+  ck_assert_int_eq(count_color(pixels, LINE), 2);
+  ck_assert_uint_eq(pixels[8 * SIDE + 2], LINE);
+  ck_assert_uint_eq(pixels[8 * SIDE + 10], LINE);
+
+  // the same pixels counted from the other end
+  const uint32_t reversed[2] = {1, 0};
+  wireframe.edges = reversed;
+  draw(&wireframe, &style, 1, pixels);
+  ck_assert_int_eq(count_color(pixels, LINE), 2);
+  ck_assert_uint_eq(pixels[8 * SIDE + 13], LINE);
+  ck_assert_uint_eq(pixels[8 * SIDE + 5], LINE);
+}
+END_TEST
+
+START_TEST(test_raster_points) {
+  // the second point is outside the view volume
+  const float points[6] = {0.0f, 0.0f, 0.0f, 2.0f, 0.0f, 0.0f};
+  Wireframe wireframe = {line, 2, line_edge, 1, points, 2, identity};
+  RasterStyle style = solid_style();
+  style.point_size = 3.0f;
+  uint32_t pixels[SIDE * SIDE];
+  draw(&wireframe, &style, 1, pixels);
+  ck_assert_int_eq(count_color(pixels, POINT), 0);
+
+  // points are drawn over the edges
+  style.point_shape = RASTER_POINT_SQUARE;
+  draw(&wireframe, &style, 1, pixels);
+  ck_assert_int_eq(count_color(pixels, POINT), 9);
+  for (int y = 7; y <= 9; y++)
+    for (int x = 7; x <= 9; x++)
+      ck_assert_uint_eq(pixels[y * SIDE + x], POINT);
+  ck_assert_int_eq(count_color(pixels, LINE), 9);
+
+  style.point_shape = RASTER_POINT_CIRCLE;
+  style.point_size = 6.0f;
+  draw(&wireframe, &style, 1, pixels);
+  ck_assert_int_eq(count_color(pixels, POINT), 32);
+  ck_assert_uint_eq(pixels[8 * SIDE + 8], POINT);
+  ck_assert_uint_eq(pixels[5 * SIDE + 5], BACKGROUND);
+}
+END_TEST
+
+START_TEST(test_raster_clip) {
+  // a perspective matrix looking down -z, near 0.1 and far 100
+  const float perspective[16] = {1, 0, 0,       0,  0, 1, 0, 0,
+                                 0, 0, -1.002f, -1, 0, 0, -0.2002f, 0};
+  // from in front of the camera to behind it, and wholly behind it
+  const float positions[12] = {0.0f, 0.0f, -2.0f, 0.0f, 0.0f, 5.0f,
+                               0.0f, 0.5f, 1.0f,  0.5f, 0.5f, 3.0f};
+  const uint32_t edges[4] = {0, 1, 2, 3};
+  Wireframe wireframe = {positions, 4, edges, 2, NULL, 0, perspective};
+  RasterStyle style = solid_style();
+  uint32_t pixels[SIDE * SIDE];
+  draw(&wireframe, &style, 1, pixels);
+  // the first edge shrinks to the pixel at the vanishing point
+  ck_assert_int_le(count_color(pixels, LINE), 1);
+
+  const float across[6] = {-4.0f, -1.0f, -2.0f, 4.0f, 1.0f, -2.0f};
+  wireframe.positions = across;
+  wireframe.vertex_count = 2;
+  wireframe.edge_count = 1;
+  draw(&wireframe, &style, 1, pixels);
+  // clipped to the sides, one pixel per column
+  ck_assert_int_eq(count_color(pixels, LINE), SIDE);
+}
+END_TEST
+
+START_TEST(test_raster_threads) {
+  const int count = 3000, width = 301, height = 203;
+  float *positions = malloc(sizeof(float) * 3 * count);
+  uint32_t *edges = malloc(sizeof(uint32_t) * 2 * count);
+  srand(21);
+  for (int i = 0; i < count * 3; i++)
+    positions[i] = (float)rand() / RAND_MAX * 2.4f - 1.2f;
+  for (int i = 0; i < count * 2; i++) edges[i] = rand() % count;
+  Wireframe wireframe = {positions, count, edges, count,
+                         positions, count, identity};
+  RasterStyle style = solid_style();
+  style.line_width = 2.0f;
+  style.line_stipple = 0x00FF;
+  style.point_size = 4.0f;
+  style.point_shape = RASTER_POINT_CIRCLE;
+
+  size_t size = sizeof(uint32_t) * width * height;
+  uint32_t *expected = malloc(size), *pixels = malloc(size);
+  int error = 0;
+  Rasterizer *single = create_rasterizer(1, &error);
+  ck_assert_int_eq(rasterizer_threads(single), 1);
+  RasterImage image = {expected, width, height, width};
+  rasterize_wireframe(single, &wireframe, &style, image, &error);
+  destroy_rasterizer(single);
+  ck_assert_int_ne(count_color(expected, LINE), 0);
+
+  // every thread count draws the same pixels, also when reused
+  for (int threads = 2; threads <= 5; threads += 3) {
+    Rasterizer *rasterizer = create_rasterizer(threads, &error);
+    for (int frame = 0; frame < 2; frame++) {
+      memset(pixels, 0, size);
+      image.pixels = pixels;
+      rasterize_wireframe(rasterizer, &wireframe, &style, image, &error);
+      ck_assert_int_eq(memcmp(pixels, expected, size), 0);
+    }
+    destroy_rasterizer(rasterizer);
+  }
+  ck_assert_int_eq(error, 0);
+  free(positions);
+  free(edges);
+  free(expected);
+  free(pixels);
+}
+END_TEST
+
+Suite*
+
+raster_suite(void) {
+  Suite* s;
+  TCase* tc_pos;
+
+  s = suite_create("raster");
+
+  tc_pos = tcase_create("positives");
+
+  tcase_add_test(tc_pos, test_raster_line);
+  tcase_add_test(tc_pos, test_raster_stipple);
+  tcase_add_test(tc_pos, test_raster_points);
+  tcase_add_test(tc_pos, test_raster_clip);
+  tcase_add_test(tc_pos, test_raster_threads);
+  suite_add_tcase(s, tc_pos);
+
+  return s;
+}
+
+int test_raster() {
+  int no_failed = 0;
+  Suite* s;
+  SRunner* sr;
+
+  s = raster_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  no_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return no_failed;
+}
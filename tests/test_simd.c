@@ -0,0 +1,198 @@
+#include <check.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parser/s21_mesh.h"
+#include "../parser/s21_simd.h"
+
+#define SIMD_COUNT 1001
+#define MARKER -7.0f
+
+static const size_t strides[] = {3, 4, sizeof(VertexData) / sizeof(float)};
+
+// Positions in [-50, 50) with a marker in every float after them.
+static float* random_positions(size_t stride, int count) {
+  float* positions = malloc(sizeof(float) * stride * (count > 0 ? count : 1));
+  srand(21);
+  for (int i = 0; i < count; i++)
+    for (size_t j = 0; j < stride; j++)
+      positions[i * stride + j] =
+          j < 3 ? (float)rand() / RAND_MAX * 100.0f - 50.0f : MARKER;
+  return positions;
+}
+
+static SimdLevel best_level(void) {
+  limit_simd(SIMD_AVX2);
+  return simd_level();
+}
+
+START_TEST(test_simd_bounds_levels) {
+  SimdLevel best = best_level();
+  for (int s = 0; s < 3; s++) {
+    // short arrays end in the scalar tails
+    for (int count = 0; count <= 5; count++) {
+      int n = count == 5 ? SIMD_COUNT : count;
+      float* positions = random_positions(strides[s], n);
+      limit_simd(SIMD_SCALAR);
+      Bounds expected = compute_bounds(positions, strides[s], n);
+      for (int level = SIMD_SSE2; level <= (int)best; level++) {
+        limit_simd((SimdLevel)level);
+        Bounds bounds = compute_bounds(positions, strides[s], n);
+        ck_assert_int_eq(memcmp(bounds.min, expected.min, sizeof(bounds.min)),
+                         0);
+        ck_assert_int_eq(memcmp(bounds.max, expected.max, sizeof(bounds.max)),
+                         0);
+        for (int axis = 0; axis < 3; axis++)
+          ck_assert_float_eq_tol(bounds.centroid[axis],
+                                 expected.centroid[axis], 1e-4);
+      }
+      free(positions);
+    }
+  }
+  limit_simd(SIMD_AVX2);
+}
+END_TEST
+
+START_TEST(test_simd_transform_levels) {
+  const float matrix[16] = {0.5f, 0.1f, -0.2f, 0.0f, 0.3f,  2.0f,
+                            0.7f, 0.0f, -1.0f, 0.4f, 1.5f,  0.0f,
+                            3.0f, -4.0f, 5.0f, 1.0f};
+  SimdLevel best = best_level();
+  for (int s = 0; s < 3; s++) {
+    for (int count = 0; count <= 5; count++) {
+      int n = count == 5 ? SIMD_COUNT : count;
+      size_t size = sizeof(float) * strides[s] * n;
+      float* expected = random_positions(strides[s], n);
+      limit_simd(SIMD_SCALAR);
+      transform_positions(expected, strides[s], n, matrix);
+      for (int i = 0; i < n; i++)
+        for (size_t j = 3; j < strides[s]; j++)
+          ck_assert(expected[i * strides[s] + j] == MARKER);
+      for (int level = SIMD_SSE2; level <= (int)best; level++) {
+        limit_simd((SimdLevel)level);
+        float* positions = random_positions(strides[s], n);
+        transform_positions(positions, strides[s], n, matrix);
+        ck_assert_int_eq(memcmp(positions, expected, size), 0);
+        free(positions);
+      }
+      free(expected);
+    }
+  }
+  limit_simd(SIMD_AVX2);
+}
+END_TEST
+
+START_TEST(test_simd_project_levels) {
+  const float matrix[16] = {0.5f, 0.1f, -0.2f, 0.3f, 0.3f,  2.0f,
+                            0.7f, -0.1f, -1.0f, 0.4f, 1.5f,  -1.0f,
+                            3.0f, -4.0f, 5.0f, 0.2f};
+  SimdLevel best = best_level();
+  for (int s = 0; s < 3; s++) {
+    for (int count = 0; count <= 5; count++) {
+      int n = count == 5 ? SIMD_COUNT : count;
+      size_t size = sizeof(float) * 4 * (n > 0 ? n : 1);
+      float* positions = random_positions(strides[s], n);
+      float* expected = malloc(size);
+      limit_simd(SIMD_SCALAR);
+      project_positions(positions, strides[s], n, matrix, expected);
+      for (int i = 0; i < n; i++) {
+        const float* p = &positions[i * strides[s]];
+        for (int axis = 0; axis < 4; axis++)
+          ck_assert_float_eq_tol(
+              expected[i * 4 + axis],
+              matrix[axis] * p[0] + matrix[4 + axis] * p[1] +
+                  matrix[8 + axis] * p[2] + matrix[12 + axis],
+              1e-3);
+      }
+      for (int level = SIMD_SSE2; level <= (int)best; level++) {
+        limit_simd((SimdLevel)level);
+        float* clip = malloc(size);
+        project_positions(positions, strides[s], n, matrix, clip);
+        ck_assert_int_eq(memcmp(clip, expected, sizeof(float) * 4 * n), 0);
+        free(clip);
+      }
+      free(expected);
+      free(positions);
+    }
+  }
+  limit_simd(SIMD_AVX2);
+}
+END_TEST
+
+START_TEST(test_simd_fit_bounds) {
+  Bounds bounds = {{-1.0f, 2.0f, 10.0f}, {3.0f, 4.0f, 11.0f}, {0}};
+  float matrix[16];
+  fit_bounds(&bounds, matrix);
+  float corners[6] = {-1.0f, 2.0f, 10.0f, 3.0f, 4.0f, 11.0f};
+  transform_positions(corners, 3, 2, matrix);
+  const float fitted[6] = {-1.0f, -0.5f, -0.25f, 1.0f, 0.5f, 0.25f};
+  for (int i = 0; i < 6; i++)
+    ck_assert_float_eq_tol(corners[i], fitted[i], 1e-6);
+
+  // no positions, no change
+  bounds = compute_bounds(corners, 3, 0);
+  ck_assert(bounds.min[0] > bounds.max[0]);
+  fit_bounds(&bounds, matrix);
+  for (int i = 0; i < 16; i++)
+    ck_assert_float_eq(matrix[i], i % 5 == 0 ? 1.0f : 0.0f);
+}
+END_TEST
+
+START_TEST(test_simd_normalize_model) {
+  Obj* obj = parse_obj("models/Mickey Mouse_2.obj");
+  ck_assert_ptr_ne(obj, NULL);
+  float* positions = &obj->vertices->vertices[0].x;
+  size_t stride = sizeof(Vertex) / sizeof(float);
+  int count = obj->vertices->count;
+  normalize_positions(positions, stride, count);
+
+  Bounds bounds = compute_bounds(positions, stride, count);
+  float longest = 0.0f;
+  for (int axis = 0; axis < 3; axis++) {
+    ck_assert(bounds.min[axis] >= -1.0f - 1e-5f);
+    ck_assert(bounds.max[axis] <= 1.0f + 1e-5f);
+    ck_assert_float_eq_tol(bounds.min[axis] + bounds.max[axis], 0.0f, 1e-5);
+    if (bounds.max[axis] - bounds.min[axis] > longest)
+      longest = bounds.max[axis] - bounds.min[axis];
+  }
+  ck_assert_float_eq_tol(longest, 2.0f, 1e-5);
+  destroy_obj(obj);
+}
+END_TEST
+
+Suite*
+
+simd_suite(void) {
+  Suite* s;
+  TCase* tc_pos;
+
+  s = suite_create("simd");
+
+  tc_pos = tcase_create("positives");
+
+  tcase_add_test(tc_pos, test_simd_bounds_levels);
+  tcase_add_test(tc_pos, test_simd_transform_levels);
+  tcase_add_test(tc_pos, test_simd_project_levels);
+  tcase_add_test(tc_pos, test_simd_fit_bounds);
+  tcase_add_test(tc_pos, test_simd_normalize_model);
+  suite_add_tcase(s, tc_pos);
+
+  return s;
+}
+
+int test_simd() {
+  int no_failed = 0;
+  Suite* s;
+  SRunner* sr;
+
+  s = simd_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  no_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return no_failed;
+}
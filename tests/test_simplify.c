@@ -0,0 +1,134 @@
+#include <check.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parser/s21_mesh.h"
+#include "../parser/s21_simplify.h"
+#include "test_helpers.h"
+
+#define GRID_SIZE 40
+
+// A flat square of GRID_SIZE x GRID_SIZE quads split into triangles that
+// face +z.
+static int create_grid(float* positions, uint32_t* indices) {
+  int side = GRID_SIZE + 1;
+  for (int y = 0; y < side; y++) {
+    for (int x = 0; x < side; x++) {
+      float* position = &positions[(y * side + x) * 3];
+      position[0] = (float)x;
+      position[1] = (float)y;
+      position[2] = 0.0f;
+    }
+  }
+  int count = 0;
+  for (int y = 0; y < GRID_SIZE; y++) {
+    for (int x = 0; x < GRID_SIZE; x++) {
+      uint32_t corner = y * side + x;
+      uint32_t quad[6] = {corner,        corner + 1, corner + side + 1,
+                          corner, corner + side + 1, corner + side};
+      memcpy(&indices[count], quad, sizeof(quad));
+      count += 6;
+    }
+  }
+  return count;
+}
+
+START_TEST(test_simplify_grid) {
+  int side = GRID_SIZE + 1;
+  float* positions = malloc(sizeof(float) * 3 * side * side);
+  uint32_t* indices = malloc(sizeof(uint32_t) * 6 * GRID_SIZE * GRID_SIZE);
+  int index_count = create_grid(positions, indices);
+  int error = 0;
+  int target = index_count / 3 / 8;
+  int count = simplify_triangles(positions, side * side, indices, index_count,
+                                 target, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(count % 3, 0);
+  ck_assert_int_le(count / 3, target);
+  ck_assert_int_gt(count, 0);
+
+  // no triangle flips or degenerates, the corners stay and the covered
+  // area is the whole square
+  float area = 0.0f;
+  int corners = 0;
+  for (int i = 0; i < count; i += 3) {
+    const float* a = &positions[indices[i] * 3];
+    const float* b = &positions[indices[i + 1] * 3];
+    const float* c = &positions[indices[i + 2] * 3];
+    float cross =
+        (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+    ck_assert(cross > 0.0f);
+    area += cross * 0.5f;
+    for (int j = 0; j < 3; j++) {
+      const uint32_t grid_corners[4] = {0, GRID_SIZE, side * GRID_SIZE,
+                                        side * side - 1};
+      for (int k = 0; k < 4; k++)
+        if (indices[i + j] == grid_corners[k]) corners |= 1 << k;
+    }
+  }
+  ck_assert_int_eq(corners, 15);
+  ck_assert_float_eq_tol(area, GRID_SIZE * GRID_SIZE, 1e-3);
+
+  free(positions);
+  free(indices);
+}
+END_TEST
+
+START_TEST(test_simplify_mesh_lods) {
+  int error = 0;
+  Mesh mesh = build_mesh("models/Mickey Mouse_2.obj", &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_gt(mesh.lod_count, 0);
+  int edge_count = mesh.edge_count;
+  for (int i = 0; i < mesh.lod_count; i++) {
+    MeshLod* lod = &mesh.lods[i];
+    ck_assert_int_gt(lod->edge_count, 0);
+    ck_assert_int_lt(lod->edge_count, edge_count);
+    ck_assert_int_eq(is_valid_bvh(&lod->bvh, lod->edge_count), 1);
+    for (int j = 0; j < lod->edge_count * 2; j++)
+      ck_assert(lod->edges[j] < (uint32_t)mesh.vertex_count);
+    edge_count = lod->edge_count;
+  }
+  destroy_mesh(&mesh);
+  ck_assert_int_eq(mesh.lod_count, 0);
+
+  // too few triangles for a coarser level
+  mesh = build_mesh("models/Cube.obj", &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(mesh.lod_count, 0);
+  destroy_mesh(&mesh);
+}
+END_TEST
+
+Suite*
+
+simplify_suite(void) {
+  Suite* s;
+  TCase* tc_pos;
+
+  s = suite_create("simplify");
+
+  tc_pos = tcase_create("positives");
+
+  tcase_add_test(tc_pos, test_simplify_grid);
+  tcase_add_test(tc_pos, test_simplify_mesh_lods);
+  suite_add_tcase(s, tc_pos);
+
+  return s;
+}
+
+int test_simplify() {
+  int no_failed = 0;
+  Suite* s;
+  SRunner* sr;
+
+  s = simplify_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  no_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return no_failed;
+}
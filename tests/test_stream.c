@@ -0,0 +1,207 @@
+#include <check.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parser/s21_stream.h"
+
+static int compare_keys(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+  return x < y ? -1 : x > y;
+}
+
+// Sorts the keys and drops repeats, returns the number left.
+static int unique_keys(uint64_t *keys, int count) {
+  qsort(keys, count, sizeof(uint64_t), compare_keys);
+  int unique = 0;
+  for (int i = 0; i < count; i++)
+    if (unique == 0 || keys[unique - 1] != keys[i]) keys[unique++] = keys[i];
+  return unique;
+}
+
+static uint64_t edge_key(uint32_t a, uint32_t b) {
+  return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+typedef struct StreamResult {
+  float *positions;
+  int vertex_count;
+  uint64_t *edges;
+  int edge_count;
+  int batches;
+  size_t peak_memory;
+} StreamResult;
+
+static StreamResult read_all(const char *path, StreamOptions options,
+                             int *error) {
+  StreamResult result = {0};
+  ObjStream *stream = open_obj_stream(path, options, error);
+  StreamBatch batch;
+  while (stream != NULL && read_obj_stream(stream, &batch, error)) {
+    if (batch.first_vertex != result.vertex_count) *error = 1;
+    int vertices = result.vertex_count + batch.vertex_count;
+    result.positions =
+        realloc(result.positions, sizeof(float) * 3 * (vertices + 1));
+    memcpy(&result.positions[result.vertex_count * 3], batch.positions,
+           sizeof(float) * 3 * batch.vertex_count);
+    result.vertex_count = vertices;
+    result.edges = realloc(result.edges, sizeof(uint64_t) *
+                                             (result.edge_count +
+                                              batch.edge_count + 1));
+    for (int i = 0; i < batch.edge_count; i++)
+      result.edges[result.edge_count++] =
+          edge_key(batch.edges[i * 2], batch.edges[i * 2 + 1]);
+    size_t memory = obj_stream_memory(stream);
+    if (memory > result.peak_memory) result.peak_memory = memory;
+    result.batches++;
+  }
+  close_obj_stream(stream);
+  return result;
+}
+
+START_TEST(test_stream_matches_parser) {
+  const char *path = "models/Mickey Mouse_2.obj";
+  Obj *obj = parse_obj(path);
+  ck_assert_ptr_ne(obj, NULL);
+  StreamOptions options = {64 * 1024, 0, NULL, NULL};
+  int error = 0;
+  StreamResult result = read_all(path, options, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_gt(result.batches, 1);
+  ck_assert_int_eq(result.vertex_count, obj->vertices->count);
+  for (int i = 0; i < result.vertex_count; i++) {
+    ck_assert_float_eq(result.positions[i * 3], obj->vertices->vertices[i].x);
+    ck_assert_float_eq(result.positions[i * 3 + 2],
+                       obj->vertices->vertices[i].z);
+  }
+
+  Faces *faces = obj->faces;
+  uint64_t *expected = malloc(sizeof(uint64_t) * faces->index_count);
+  int expected_count = 0;
+  for (int i = 0; i < faces->count; i++) {
+    Face *face = &faces->faces[i];
+    for (int j = 0; j < face->vertex_count; j++) {
+      int a = face->vertex_indices[j];
+      int b = face->vertex_indices[(j + 1) % face->vertex_count];
+      if (a != b) expected[expected_count++] = edge_key(a - 1, b - 1);
+    }
+  }
+  expected_count = unique_keys(expected, expected_count);
+  int edge_count = unique_keys(result.edges, result.edge_count);
+  ck_assert_int_eq(edge_count, expected_count);
+  ck_assert_int_eq(
+      memcmp(result.edges, expected, sizeof(uint64_t) * edge_count), 0);
+  free(expected);
+  free(result.positions);
+  free(result.edges);
+  destroy_obj(obj);
+}
+END_TEST
+
+START_TEST(test_stream_memory_budget) {
+  const char *path = "models/Mickey Mouse_2.obj";
+  size_t budget = 256 * 1024;
+  StreamOptions options = {0, budget, NULL, NULL};
+  int error = 0;
+  StreamResult unbounded = read_all(path, (StreamOptions){0}, &error);
+  StreamResult bounded = read_all(path, options, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(unbounded.batches, 1);
+  ck_assert_int_gt(bounded.batches, unbounded.batches);
+  ck_assert_uint_eq(bounded.peak_memory <= budget, 1);
+  ck_assert_int_eq(bounded.vertex_count, unbounded.vertex_count);
+  ck_assert_int_eq(memcmp(bounded.positions, unbounded.positions,
+                          sizeof(float) * 3 * bounded.vertex_count),
+                   0);
+  free(unbounded.positions);
+  free(unbounded.edges);
+  free(bounded.positions);
+  free(bounded.edges);
+}
+END_TEST
+
+START_TEST(test_stream_long_lines) {
+  FILE *file = fopen("stream_lines.obj", "w");
+  ck_assert_ptr_ne(file, NULL);
+  fputc('#', file);
+  for (int i = 0; i < 10000; i++) fputc('x', file);
+  fputs("\nv 0 0 0\nv 1 0 0\nvt 0 0\nv 0 1 0\nf -3/1 -2/1 -1/1\nv 1 1 0\n"
+        "f 2 4 3",
+        file);
+  fclose(file);
+  StreamOptions options = {1, 0, NULL, NULL};
+  int error = 0;
+  StreamResult result = read_all("stream_lines.obj", options, &error);
+  remove("stream_lines.obj");
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(result.vertex_count, 4);
+  ck_assert_float_eq(result.positions[10], 1.0f);
+  int edge_count = unique_keys(result.edges, result.edge_count);
+  ck_assert_int_eq(edge_count, 5);
+  ck_assert_uint_eq(result.edges[0], edge_key(0, 1));
+  ck_assert_uint_eq(result.edges[4], edge_key(2, 3));
+  free(result.positions);
+  free(result.edges);
+}
+END_TEST
+
+static int cancel_after_first(size_t done, size_t total, void *user) {
+  (void)total;
+  *(size_t *)user = done;
+  return 1;
+}
+
+START_TEST(test_stream_cancel) {
+  size_t done = 0;
+  StreamOptions options = {64 * 1024, 0, cancel_after_first, &done};
+  int error = 0;
+  StreamResult result =
+      read_all("models/Mickey Mouse_2.obj", options, &error);
+  ck_assert_int_eq(error, 1);
+  ck_assert_int_eq(result.batches, 0);
+  ck_assert_uint_eq(done > 0 && done <= 64 * 1024, 1);
+  free(result.positions);
+  free(result.edges);
+
+  error = 0;
+  ck_assert_ptr_eq(open_obj_stream("models/does_not_exist.obj",
+                                   (StreamOptions){0}, &error),
+                   NULL);
+  ck_assert_int_eq(error, 1);
+}
+END_TEST
+
+Suite*
+
+stream_suite(void) {
+  Suite* s;
+  TCase* tc_pos;
+
+  s = suite_create("stream");
+
+  tc_pos = tcase_create("positives");
+
+  tcase_add_test(tc_pos, test_stream_matches_parser);
+  tcase_add_test(tc_pos, test_stream_memory_budget);
+  tcase_add_test(tc_pos, test_stream_long_lines);
+  tcase_add_test(tc_pos, test_stream_cancel);
+  suite_add_tcase(s, tc_pos);
+
+  return s;
+}
+
+int test_stream() {
+  int no_failed = 0;
+  Suite* s;
+  SRunner* sr;
+
+  s = stream_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  no_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return no_failed;
+}
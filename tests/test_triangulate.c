@@ -0,0 +1,227 @@
+#include <check.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../parser/s21_triangulate.h"
+
+static Obj* obj_from_text(const char* text) {
+  int error = 0;
+  Obj* obj = init_obj(&error);
+  if (!error) parse_obj_data(text, strlen(text), obj, &error);
+  if (error) {
+    destroy_obj(obj);
+    obj = NULL;
+  }
+  return obj;
+}
+
+static void edge_cross(const Vertex* a, const Vertex* b, const Vertex* c,
+                       double* out) {
+  double u[3] = {b->x - a->x, b->y - a->y, b->z - a->z};
+  double v[3] = {c->x - a->x, c->y - a->y, c->z - a->z};
+  out[0] = u[1] * v[2] - u[2] * v[1];
+  out[1] = u[2] * v[0] - u[0] * v[2];
+  out[2] = u[0] * v[1] - u[1] * v[0];
+}
+
+// every triangle of a planar face has to face the way the face does and
+// together they have to cover exactly its area
+static void check_cover(Obj* obj, Triangles triangles, double normal_x,
+                        double normal_y, double normal_z, double area) {
+  double sum = 0.0;
+  for (int i = 0; i < triangles.count; i++) {
+    const int* indices = triangles.triangles[i].vertex_indices;
+    const Vertex* v = obj->vertices->vertices;
+    double cross[3];
+    edge_cross(&v[indices[0] - 1], &v[indices[1] - 1], &v[indices[2] - 1],
+               cross);
+    double facing =
+        cross[0] * normal_x + cross[1] * normal_y + cross[2] * normal_z;
+    ck_assert_double_gt(facing, 0.0);
+    sum += facing / 2.0;
+  }
+  ck_assert_double_eq_tol(sum, area, 1e-9);
+}
+
+START_TEST(test_triangulate_concave_face) {
+  // an L whose first corner is the reflex one, a fan would fold over
+  Obj* obj = obj_from_text(
+      "v 0 0 0\nv 2 0 0\nv 2 1 0\nv 1 1 0\nv 1 2 0\nv 0 2 0\n"
+      "vt 0 0\nvn 0 0 1\n"
+      "f 4/1/1 5 6 1 2 3\n");
+  ck_assert_ptr_ne(obj, NULL);
+  int error = 0;
+  Triangles triangles = triangulate(obj, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(triangles.count, 4);
+  check_cover(obj, triangles, 0.0, 0.0, 1.0, 3.0);
+  // the attributes travel with their corner
+  for (int i = 0; i < triangles.count; i++)
+    for (int k = 0; k < 3; k++) {
+      int corner = triangles.triangles[i].vertex_indices[k];
+      ck_assert_int_eq(triangles.triangles[i].texture_indices[k],
+                       corner == 4);
+      ck_assert_int_eq(triangles.triangles[i].normal_indices[k],
+                       corner == 4);
+    }
+  safe_free(triangles.triangles);
+  destroy_obj(obj);
+}
+END_TEST
+
+START_TEST(test_triangulate_concave_quad) {
+  // an arrowhead whose reflex corner is the last one
+  Obj* obj = obj_from_text("v 0 0 0\nv 2 1 0\nv 0 2 0\nv 0.5 1 0\nf 1 2 3 4\n");
+  ck_assert_ptr_ne(obj, NULL);
+  int error = 0;
+  Triangles triangles = triangulate(obj, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(triangles.count, 2);
+  check_cover(obj, triangles, 0.0, 0.0, 1.0, 1.5);
+  safe_free(triangles.triangles);
+  destroy_obj(obj);
+}
+END_TEST
+
+START_TEST(test_triangulate_keeps_winding_in_any_plane) {
+  // a comb in the xz plane that faces -y
+  Obj* obj = obj_from_text(
+      "v 0 0 0\nv 0 0 3\nv 1 0 3\nv 1 0 1\nv 2 0 1\nv 2 0 3\nv 3 0 3\n"
+      "v 3 0 0\n"
+      "f 8 7 6 5 4 3 2 1\n");
+  ck_assert_ptr_ne(obj, NULL);
+  int error = 0;
+  Triangles triangles = triangulate(obj, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(triangles.count, 6);
+  check_cover(obj, triangles, 0.0, -1.0, 0.0, 7.0);
+  safe_free(triangles.triangles);
+  destroy_obj(obj);
+}
+END_TEST
+
+START_TEST(test_triangulate_fans_convex_faces) {
+  Obj* obj = obj_from_text(
+      "v 0 0 0\nv 1 0 0\nv 2 1 0\nv 1 2 0\nv 0 1 0\nv 5 5 5\n"
+      "f 1 2 3 4 5\nf 1 2 6\nf 3 4 5 9\n");
+  ck_assert_ptr_ne(obj, NULL);
+  int error = 0;
+  Triangles triangles = triangulate(obj, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(triangles.count, count_triangles(obj->faces));
+  ck_assert_int_eq(triangles.count, 6);
+  for (int i = 0; i < obj->faces->count; i++) {
+    Face face = obj->faces->faces[i];
+    for (int j = 0; j < face.vertex_count - 2; j++) {
+      Triangle triangle =
+          triangles.triangles[first_triangle(obj->faces, i) + j];
+      ck_assert_int_eq(triangle.vertex_indices[0], face.vertex_indices[0]);
+      ck_assert_int_eq(triangle.vertex_indices[1],
+                       face.vertex_indices[j + 1]);
+      ck_assert_int_eq(triangle.vertex_indices[2],
+                       face.vertex_indices[j + 2]);
+    }
+  }
+  safe_free(triangles.triangles);
+  destroy_obj(obj);
+}
+END_TEST
+
+START_TEST(test_triangulate_degenerate_faces) {
+  Obj* obj = obj_from_text(
+      "v 0 0 0\nv 1 0 0\nv 2 0 0\nv 3 0 0\nv 1 1 0\n"
+      // collinear, and a bow tie that has no ear once it is cut
+      "f 1 2 3 4\nf 1 3 5 2 4 5\n");
+  ck_assert_ptr_ne(obj, NULL);
+  int error = 0;
+  Triangles triangles = triangulate(obj, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(triangles.count, 6);
+  for (int i = 0; i < triangles.count; i++)
+    for (int k = 0; k < 3; k++)
+      ck_assert_int_gt(triangles.triangles[i].vertex_indices[k], 0);
+  safe_free(triangles.triangles);
+  destroy_obj(obj);
+}
+END_TEST
+
+START_TEST(test_triangulate_threads_agree) {
+  int faces = 3 * TRIANGULATE_MIN_FACES + 5;
+  size_t size = 64 + (size_t)faces * 32;
+  char* text = malloc(size);
+  ck_assert_ptr_ne(text, NULL);
+  int length = sprintf(text,
+                       "v 0 0 0\nv 2 0 0\nv 2 1 0\nv 1 1 0\nv 1 2 0\n"
+                       "v 0 2 0\n");
+  for (int i = 0; i < faces; i++) {
+    int r = i % 6;
+    if (i % 5 == 0)
+      length += sprintf(text + length, "f %d %d %d\n", r + 1, (r + 1) % 6 + 1,
+                        (r + 2) % 6 + 1);
+    else
+      length += sprintf(text + length, "f %d %d %d %d %d %d\n", r + 1,
+                        (r + 1) % 6 + 1, (r + 2) % 6 + 1, (r + 3) % 6 + 1,
+                        (r + 4) % 6 + 1, (r + 5) % 6 + 1);
+  }
+  Obj* obj = obj_from_text(text);
+  ck_assert_ptr_ne(obj, NULL);
+  free(text);
+  int count = count_triangles(obj->faces);
+  Triangle* serial = malloc(sizeof(Triangle) * count);
+  Triangle* parallel = malloc(sizeof(Triangle) * count);
+  ck_assert_ptr_ne(serial, NULL);
+  ck_assert_ptr_ne(parallel, NULL);
+  int error = 0;
+  triangulate_faces(obj->faces, obj->vertices, serial, 1, &error);
+  triangulate_faces(obj->faces, obj->vertices, parallel, 4, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(memcmp(serial, parallel, sizeof(Triangle) * count), 0);
+  Triangles triangles = triangulate_ex(obj, 1, &error);
+  ck_assert_int_eq(error, 0);
+  ck_assert_int_eq(triangles.count, count);
+  ck_assert_int_eq(
+      memcmp(serial, triangles.triangles, sizeof(Triangle) * count), 0);
+  safe_free(triangles.triangles);
+  safe_free(serial);
+  safe_free(parallel);
+  destroy_obj(obj);
+}
+END_TEST
+
+Suite*
+
+triangulate_suite(void) {
+  Suite* s;
+  TCase* tc_pos;
+
+  s = suite_create("triangulate");
+
+  tc_pos = tcase_create("positives");
+
+  tcase_add_test(tc_pos, test_triangulate_concave_face);
+  tcase_add_test(tc_pos, test_triangulate_concave_quad);
+  tcase_add_test(tc_pos, test_triangulate_keeps_winding_in_any_plane);
+  tcase_add_test(tc_pos, test_triangulate_fans_convex_faces);
+  tcase_add_test(tc_pos, test_triangulate_degenerate_faces);
+  tcase_add_test(tc_pos, test_triangulate_threads_agree);
+  suite_add_tcase(s, tc_pos);
+
+  return s;
+}
+
+int test_triangulate() {
+  int no_failed = 0;
+  Suite* s;
+  SRunner* sr;
+
+  s = triangulate_suite();
+  sr = srunner_create(s);
+
+  srunner_run_all(sr, CK_NORMAL);
+  no_failed = srunner_ntests_failed(sr);
+  srunner_free(sr);
+
+  return no_failed;
+}
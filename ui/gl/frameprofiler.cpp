@@ -0,0 +1,172 @@
+#include "frameprofiler.h"
+
+#include <QFile>
+#include <QFontDatabase>
+#include <QOpenGLContext>
+#include <QPainter>
+#include <QTextStream>
+#include <algorithm>
+#include <cmath>
+
+#ifndef QT_OPENGL_ES_2
+#include <QOpenGLTimerQuery>
+#endif
+
+using namespace std::chrono;
+
+FrameProfiler::FrameProfiler() : m_history(HistorySize) {
+  for (Row &row : m_history) row.fill(-1);
+}
+
+qint64 FrameProfiler::beginFrame() {
+  Clock::time_point now = Clock::now();
+  qint64 delta = m_frames > 0
+                     ? duration_cast<nanoseconds>(now - m_frameStart).count()
+                     : 0;
+  m_frameStart = now;
+  m_lapStart = now;
+  m_current.fill(0);
+  m_current[Gpu] = -1;
+  return delta;
+}
+
+void FrameProfiler::lap(Phase phase) {
+  Clock::time_point now = Clock::now();
+  m_current[phase] += duration_cast<nanoseconds>(now - m_lapStart).count();
+  m_lapStart = now;
+}
+
+void FrameProfiler::endFrame() {
+  m_current[Frame] =
+      duration_cast<nanoseconds>(Clock::now() - m_frameStart).count();
+  m_history[m_frames % HistorySize] = m_current;
+  m_frames++;
+}
+
+// Queries rotate over QueryCount frames, so a result is read a few frames
+// after it was issued and never stalls the pipeline. A frame whose slot is
+// still busy goes without a GPU sample.
+void FrameProfiler::beginGpu() {
+#ifndef QT_OPENGL_ES_2
+  m_activeQuery = -1;
+  if (!m_gpuSupported) return;
+  int slot = m_frames % QueryCount;
+  if (m_queries[slot] == nullptr) {
+    m_queries[slot] = new QOpenGLTimerQuery(QOpenGLContext::currentContext());
+    m_gpuSupported = m_queries[slot]->create();
+    if (!m_gpuSupported) return;
+  }
+  collectGpu(slot);
+  if (m_queryPending[slot]) return;
+  m_queries[slot]->begin();
+  m_queryFrames[slot] = m_frames;
+  m_activeQuery = slot;
+#endif
+}
+
+void FrameProfiler::endGpu() {
+#ifndef QT_OPENGL_ES_2
+  if (m_activeQuery < 0) return;
+  m_queries[m_activeQuery]->end();
+  m_queryPending[m_activeQuery] = true;
+  m_activeQuery = -1;
+#endif
+}
+
+void FrameProfiler::collectGpu(int slot) {
+#ifndef QT_OPENGL_ES_2
+  if (!m_queryPending[slot] || !m_queries[slot]->isResultAvailable()) return;
+  m_queryPending[slot] = false;
+  qint64 frame = m_queryFrames[slot];
+  if (frame > m_frames - HistorySize)
+    m_history[frame % HistorySize][Gpu] = m_queries[slot]->waitForResult();
+#else
+  Q_UNUSED(slot);
+#endif
+}
+
+void FrameProfiler::destroyGpu() {
+#ifndef QT_OPENGL_ES_2
+  for (int i = 0; i < QueryCount; i++) {
+    if (m_queries[i] != nullptr) m_queries[i]->destroy();
+    delete m_queries[i];
+    m_queries[i] = nullptr;
+    m_queryPending[i] = false;
+  }
+#endif
+}
+
+double FrameProfiler::percentile(int column, double p) const {
+  std::vector<qint64> samples;
+  samples.reserve(HistorySize);
+  for (const Row &row : m_history)
+    if (row[column] >= 0) samples.push_back(row[column]);
+  if (samples.empty()) return -1;
+  size_t rank = (size_t)std::ceil(p / 100.0 * samples.size());
+  size_t index = rank > 0 ? rank - 1 : 0;
+  std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+  return samples[index] / 1e6;
+}
+
+const char *FrameProfiler::columnName(int column) {
+  static const char *names[ColumnCount] = {
+      "view", "model", "upload", "lines", "points",
+      "overlay", "swap", "frame", "gpu"};
+  return names[column];
+}
+
+void FrameProfiler::drawOverlay(QPainter *painter) const {
+  QFont font = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+  painter->setFont(font);
+  QFontMetrics metrics(font);
+  int lineHeight = metrics.height();
+
+  QStringList lines;
+  lines << QString("%1 %2 %3 %4 ms")
+               .arg("", -8)
+               .arg("p50", 7)
+               .arg("p95", 7)
+               .arg("p99", 7);
+  for (int column = 0; column < ColumnCount; column++) {
+    double p50 = percentile(column, 50);
+    if (p50 < 0) continue;
+    lines << QString("%1 %2 %3 %4")
+                 .arg(columnName(column), -8)
+                 .arg(p50, 7, 'f', 3)
+                 .arg(percentile(column, 95), 7, 'f', 3)
+                 .arg(percentile(column, 99), 7, 'f', 3);
+  }
+
+  int width = 0;
+  for (const QString &line : lines)
+    width = std::max(width, metrics.horizontalAdvance(line));
+  painter->fillRect(8, 8, width + 16, lineHeight * lines.size() + 12,
+                    QColor(0, 0, 0, 160));
+  painter->setPen(Qt::white);
+  for (int i = 0; i < lines.size(); i++)
+    painter->drawText(16, 14 + metrics.ascent() + i * lineHeight, lines[i]);
+}
+
+// One row per retained frame, oldest first, times in milliseconds.
+bool FrameProfiler::exportCsv(const QString &path) const {
+  QFile file(path);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) return false;
+  QTextStream out(&file);
+  out << "frame";
+  for (int column = 0; column < ColumnCount; column++)
+    out << "," << columnName(column) << "_ms";
+  out << "\n";
+
+  qint64 first = std::max<qint64>(0, m_frames - HistorySize);
+  for (qint64 frame = first; frame < m_frames; frame++) {
+    const Row &row = m_history[frame % HistorySize];
+    out << frame;
+    for (int column = 0; column < ColumnCount; column++) {
+      out << ",";
+      if (row[column] >= 0) out << QString::number(row[column] / 1e6, 'f', 6);
+    }
+    out << "\n";
+  }
+  out.flush();
+  return file.error() == QFile::NoError;
+}
@@ -0,0 +1,85 @@
+#ifndef FRAMEPROFILER_H
+#define FRAMEPROFILER_H
+
+#include <QString>
+#include <array>
+#include <chrono>
+#include <vector>
+
+QT_BEGIN_NAMESPACE
+class QPainter;
+class QOpenGLTimerQuery;
+QT_END_NAMESPACE
+
+// Steady-clock CPU time per frame phase and GPU time from timer queries,
+// kept for the last HistorySize frames.
+class FrameProfiler {
+public:
+    enum Phase {
+        View,
+        Model,
+        Upload,
+        Lines,
+        Points,
+        Overlay,
+        Swap,
+        PhaseCount
+    };
+
+    // the columns after the phases
+    enum Total {
+        Frame = PhaseCount,
+        Gpu,
+        ColumnCount
+    };
+
+    static const int HistorySize = 1000;
+    static const int QueryCount = 4;
+
+    FrameProfiler();
+
+    // Starts a frame and returns the nanoseconds since the previous one
+    qint64 beginFrame();
+
+    // Charges the time since the previous lap to phase
+    void lap(Phase phase);
+
+    void endFrame();
+
+    // GPU timing of the frame, needs the current context
+    void beginGpu();
+    void endGpu();
+
+    // Releases the timer queries, needs the current context. Queries that are
+    // not released go with the context, they are parented to it
+    void destroyGpu();
+
+    // Nearest-rank percentile in milliseconds, -1 without samples
+    double percentile(int column, double p) const;
+
+    void drawOverlay(QPainter *painter) const;
+
+    bool exportCsv(const QString &path) const;
+
+    static const char *columnName(int column);
+
+private:
+    using Clock = std::chrono::steady_clock;
+    using Row = std::array<qint64, ColumnCount>;
+
+    void collectGpu(int slot);
+
+    Clock::time_point m_frameStart;
+    Clock::time_point m_lapStart;
+    Row m_current = {};
+    std::vector<Row> m_history;
+    qint64 m_frames = 0;
+
+    bool m_gpuSupported = true;
+    QOpenGLTimerQuery *m_queries[QueryCount] = {};
+    qint64 m_queryFrames[QueryCount] = {};
+    bool m_queryPending[QueryCount] = {};
+    int m_activeQuery = -1;
+};
+
+#endif // FRAMEPROFILER_H
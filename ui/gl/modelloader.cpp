@@ -0,0 +1,231 @@
+#include "modelloader.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSemaphore>
+#include <QStandardPaths>
+#include <QtConcurrent/QtConcurrentRun>
+#include <atomic>
+
+#include "viewerwindow.h"
+
+struct LoadJob {
+  ModelLoader *loader = nullptr;
+  std::atomic<bool> cancelled{false};
+  int percent = -1;  // only touched by the serialized progress callback
+  // free places in the queue of streamed batches
+  QSemaphore batches;
+  qint64 bytes = 0;
+  bool streamStarted = false;  // only touched on the GUI thread
+};
+
+ModelLoader::ModelLoader(ViewerWindow *viewer, QObject *parent)
+    : QObject(parent), m_viewer(viewer) {}
+
+ModelLoader::~ModelLoader() {
+  // the workers post to this object, so they have to stop before it goes
+  cancel();
+  for (QFutureWatcher<LoadedModel> *watcher : m_watchers) {
+    watcher->waitForFinished();
+    LoadedModel result = watcher->result();
+    destroy_mesh(&result.mesh);
+    destroy_quantized_mesh(&result.compact);
+  }
+}
+
+void ModelLoader::load(const QString &path) {
+  cancel();
+  auto job = std::make_shared<LoadJob>();
+  job->loader = this;
+  m_job = job;
+
+  auto *watcher = new QFutureWatcher<LoadedModel>(this);
+  m_watchers.append(watcher);
+  connect(watcher, &QFutureWatcherBase::finished, this,
+          [this, watcher, job, path]() { finish(watcher, job, path); });
+  QFileInfo info(path);
+  QByteArray file = QFile::encodeName(info.absoluteFilePath());
+  QByteArray cache = QFile::encodeName(cacheDir());
+  bool compact = m_viewer->compactVertices;
+  // only obj text is streamed, binary files are read in place anyway
+  bool stream = info.size() > m_viewer->streamAbove &&
+                model_file_format(file.constData()) == MODEL_OBJ;
+  size_t budget = m_viewer->streamBudget;
+  job->bytes = info.size();
+  job->batches.release(StreamQueueDepth);
+  watcher->setFuture(
+      QtConcurrent::run([file, cache, compact, stream, budget, job]() {
+        return stream ? streamModel(file, budget, job)
+                      : loadModel(file, cache, compact, job.get());
+      }));
+  emit progress(0);
+}
+
+bool ModelLoader::isLoading() const { return m_job != nullptr; }
+
+void ModelLoader::cancel() {
+  if (m_job) m_job->cancelled = true;
+}
+
+QString ModelLoader::cacheDir() {
+  QString dir =
+      QStandardPaths::writableLocation(QStandardPaths::CacheLocation) +
+      "/meshes";
+  QDir().mkpath(dir);
+  return dir;
+}
+
+int ModelLoader::reportProgress(size_t done, size_t total, void *user) {
+  LoadJob *job = static_cast<LoadJob *>(user);
+  int percent = total > 0 ? (int)(done * 100 / total) : 100;
+  if (percent != job->percent) {
+    job->percent = percent;
+    ModelLoader *loader = job->loader;
+    QMetaObject::invokeMethod(
+        loader,
+        [loader, job, percent]() {
+          if (loader->m_job.get() == job) emit loader->progress(percent);
+        },
+        Qt::QueuedConnection);
+  }
+  return job->cancelled;
+}
+
+void ModelLoader::packModel(LoadedModel *result, const QByteArray &path) {
+  int err = 0;
+  result->compact = quantize_mesh(&result->mesh, &result->bounds, &err);
+  if (err) return;
+  const QuantizeError &error = result->compact.error;
+  printf("Compact vertices of %s: position error %g, normal error %g "
+         "degrees, texture error %g\n",
+         path.constData(), error.position, error.normal, error.texture);
+}
+
+LoadedModel ModelLoader::loadModel(const QByteArray &path,
+                                   const QByteArray &cache, bool compact,
+                                   LoadJob *job) {
+  LoadedModel result = {};
+  if (load_mesh_cache(cache.constData(), path.constData(), &result.mesh)) {
+    printf("Mesh loaded from cache: %s\n", path.constData());
+    reportProgress(1, 1, job);
+    result.pointCount = result.mesh.point_count;
+    result.bounds = compute_bounds(result.mesh.points, 3,
+                                   result.mesh.point_count);
+    if (compact) packModel(&result, path);
+    result.ok = true;
+    return result;
+  }
+
+  ParseOptions options = {0, reportProgress, job};
+  printf("Loading model file: %s\n", path.constData());
+  Obj *obj = parse_model(path.constData(), options);
+  if (obj == NULL) return result;
+
+  int err = 0;
+  Triangles triangles = {};
+  if (!job->cancelled) triangles = triangulate_ex(obj, options.threads, &err);
+  if (!err && !job->cancelled) result.mesh = create_mesh(obj, triangles, &err);
+  result.pointCount = obj->vertices->count;
+  result.ok = !err && !job->cancelled;
+  safe_free(triangles.triangles);
+  destroy_obj(obj);
+  if (err)
+    printf("Error: failed to create mesh from model file: %s\n",
+           path.constData());
+
+  if (!result.ok) return result;
+  result.bounds =
+      compute_bounds(result.mesh.points, 3, result.mesh.point_count);
+
+  // a failed write only costs the next load a parse
+  int cache_err = 0;
+  save_mesh_cache(cache.constData(), path.constData(), &result.mesh,
+                  &cache_err);
+  if (compact) packModel(&result, path);
+  return result;
+}
+
+LoadedModel ModelLoader::streamModel(const QByteArray &path, size_t budget,
+                                     std::shared_ptr<LoadJob> job) {
+  LoadedModel result = {};
+  result.streamed = true;
+  // every queued batch is a copy of one the stream held, so the stream
+  // gets its share of the budget
+  StreamOptions options = {0, budget / (StreamQueueDepth + 1), reportProgress,
+                           job.get()};
+  printf("Streaming obj file: %s\n", path.constData());
+  int err = 0;
+  ObjStream *stream = open_obj_stream(path.constData(), options, &err);
+  StreamBatch batch;
+  while (stream != nullptr && read_obj_stream(stream, &batch, &err)) {
+    while (!job->cancelled && !job->batches.tryAcquire(1, 50)) {
+    }
+    if (job->cancelled) break;
+    auto positions = std::make_shared<std::vector<float>>(
+        batch.positions, batch.positions + batch.vertex_count * 3);
+    auto edges = std::make_shared<std::vector<uint32_t>>(
+        batch.edges, batch.edges + batch.edge_count * 2);
+    result.pointCount += batch.vertex_count;
+    ModelLoader *loader = job->loader;
+    QMetaObject::invokeMethod(
+        loader,
+        [loader, job, positions, edges]() {
+          loader->appendBatch(job.get(), *positions, *edges);
+          job->batches.release();
+        },
+        Qt::QueuedConnection);
+  }
+  close_obj_stream(stream);
+  result.ok = !err && !job->cancelled;
+  return result;
+}
+
+void ModelLoader::appendBatch(LoadJob *job,
+                              const std::vector<float> &positions,
+                              const std::vector<uint32_t> &edges) {
+  if (m_job.get() != job) return;
+  if (!job->streamStarted) m_viewer->begin_stream(job->bytes);
+  job->streamStarted = true;
+  m_viewer->append_stream(positions.data(), (int)positions.size() / 3,
+                          edges.data(), (int)edges.size() / 2);
+}
+
+void ModelLoader::finish(QFutureWatcher<LoadedModel> *watcher,
+                         std::shared_ptr<LoadJob> job, const QString &path) {
+  LoadedModel result = watcher->result();
+  m_watchers.removeOne(watcher);
+  watcher->deleteLater();
+
+  // a load replaced by a newer one is dropped without a signal
+  bool current = m_job == job;
+  if (current) m_job.reset();
+  // a streamed model stays as far as it got
+  if (!current || !result.ok) {
+    destroy_mesh(&result.mesh);
+    destroy_quantized_mesh(&result.compact);
+    if (current && job->cancelled)
+      emit cancelled(path);
+    else if (current)
+      emit failed(path);
+    return;
+  }
+
+  if (result.streamed) {
+    // a file without vertices still replaces the previous model
+    if (!job->streamStarted) m_viewer->begin_stream(0);
+    printf("Mesh streamed from obj file: %s, %d vertices\n",
+           path.toLocal8Bit().constData(), result.pointCount);
+    emit loaded(path, result.pointCount);
+    return;
+  }
+  m_viewer->set_mesh(result.mesh, result.compact, result.pointCount,
+                     result.bounds);
+  printf("Mesh created from model file: %s, %d vertices, %d edges\n",
+         path.toLocal8Bit().constData(), result.mesh.vertex_count,
+         result.mesh.edge_count);
+  printf("Edge vertex cache: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n",
+         result.mesh.original_cache.acmr, result.mesh.optimized_cache.acmr,
+         result.mesh.original_cache.atvr, result.mesh.optimized_cache.atvr);
+  emit loaded(path, result.pointCount);
+}
@@ -0,0 +1,93 @@
+#ifndef MODELLOADER_H
+#define MODELLOADER_H
+
+#include <QFutureWatcher>
+#include <QList>
+#include <QObject>
+#include <QString>
+#include <memory>
+#include <vector>
+
+extern "C" {
+#include "../../parser/s21_cache.h"
+#include "../../parser/s21_mesh.h"
+#include "../../parser/s21_model.h"
+#include "../../parser/s21_quantize.h"
+#include "../../parser/s21_simd.h"
+#include "../../parser/s21_stream.h"
+}
+
+class ViewerWindow;
+
+// Result of a background load, the meshes are freed unless they are handed
+// over. The bounds are those of the source positions, the compact mesh is
+// only packed when the viewer asks for it. A streamed model has no mesh, it
+// was handed to the viewer batch by batch.
+struct LoadedModel {
+    Mesh mesh;
+    QuantizedMesh compact;
+    int pointCount;
+    Bounds bounds;
+    bool streamed;
+    bool ok;
+};
+
+struct LoadJob;
+
+// Parses, triangulates and indexes a model on a worker thread, or maps it
+// from the mesh cache, and swaps the finished mesh into the viewer on the GUI
+// thread. The viewer keeps drawing the previous model until then. Files above
+// the viewer's streamAbove are streamed instead, the viewer shows every batch
+// as it arrives and the worker waits while StreamQueueDepth batches are on
+// their way.
+class ModelLoader : public QObject {
+    Q_OBJECT
+public:
+    explicit ModelLoader(ViewerWindow *viewer, QObject *parent = nullptr);
+    ~ModelLoader();
+
+    // Starts loading path, a load that is still running is cancelled
+    void load(const QString &path);
+
+    bool isLoading() const;
+
+public slots:
+    void cancel();
+
+signals:
+    void progress(int percent);
+    void loaded(const QString &path, int pointCount);
+    void failed(const QString &path);
+    void cancelled(const QString &path);
+
+private:
+    static int reportProgress(size_t done, size_t total, void *user);
+
+    // directory of the binary mesh cache, created on first use
+    static QString cacheDir();
+
+    static LoadedModel loadModel(const QByteArray &path,
+                                 const QByteArray &cache, bool compact,
+                                 LoadJob *job);
+
+    static LoadedModel streamModel(const QByteArray &path, size_t budget,
+                                   std::shared_ptr<LoadJob> job);
+
+    // hands a streamed batch to the viewer unless the load was replaced
+    void appendBatch(LoadJob *job, const std::vector<float> &positions,
+                     const std::vector<uint32_t> &edges);
+
+    // packs the compact vertices and reports their error
+    static void packModel(LoadedModel *result, const QByteArray &path);
+
+    void finish(QFutureWatcher<LoadedModel> *watcher,
+                std::shared_ptr<LoadJob> job, const QString &path);
+
+    static constexpr int StreamQueueDepth = 2;
+
+    ViewerWindow *m_viewer;
+    std::shared_ptr<LoadJob> m_job;
+    QList<QFutureWatcher<LoadedModel> *> m_watchers;
+};
+
+#endif // MODELLOADER_H
@@ -1,25 +1,39 @@
 #include "openglwindow.h"
 
+#include <QBackingStore>
 #include <QOpenGLContext>
 #include <QOpenGLPaintDevice>
 #include <QPainter>
+#include <algorithm>
 
 using namespace std::chrono;
 //! [1]
-OpenGLWindow::OpenGLWindow(QWindow *parent) : QWindow(parent) {
-  setSurfaceType(QWindow::OpenGLSurface);
-  connect(&m_timer, SIGNAL(timeout()), this, SLOT(renderNow()));
-
-  if (format().swapInterval() == -1) {
-    m_timer.setInterval(17);  // no vsync
+// Frames are only drawn on expose and on renderLater, a window that is not
+// animating and gets no input draws nothing.
+OpenGLWindow::OpenGLWindow(QWindow *parent)
+    : QWindow(parent), m_software(softwareRequested()) {
+  if (m_software) {
+    setSurfaceType(QWindow::RasterSurface);
+    m_backingStore = new QBackingStore(this);
   } else {
-    m_timer.setInterval(0);
+    setSurfaceType(QWindow::OpenGLSurface);
   }
-  m_timer.start();
 }
 //! [1]
 
-OpenGLWindow::~OpenGLWindow() { delete m_device; }
+OpenGLWindow::~OpenGLWindow() {
+  if (makeContextCurrent()) m_profiler.destroyGpu();
+  delete m_device;
+  delete m_backingStore;
+}
+
+bool OpenGLWindow::softwareRequested() {
+  if (qgetenv("VIEWER_BACKEND") == "cpu") return true;
+  QOpenGLContext probe;
+  return !probe.create();
+}
+
+bool OpenGLWindow::isSoftware() const { return m_software; }
 
 //! [2]
 void OpenGLWindow::render(QPainter *painter) { Q_UNUSED(painter); }
@@ -57,12 +71,33 @@ void OpenGLWindow::exposeEvent(QExposeEvent *event) {
 
   if (isExposed()) renderNow();
 }
+
 //! [3]
 
 //! [4]
 void OpenGLWindow::renderNow() {
   if (!isExposed()) return;
 
+  if (m_software) {
+    if (!m_initialized) initialize();
+    m_initialized = true;
+    startFrame();
+
+    QRect rect(QPoint(0, 0), size());
+    if (m_backingStore->size() != size()) m_backingStore->resize(size());
+    m_backingStore->beginPaint(rect);
+    QPainter painter(m_backingStore->paintDevice());
+    render(&painter);
+    painter.end();
+    m_backingStore->endPaint();
+    m_backingStore->flush(rect);
+    m_profiler.lap(FrameProfiler::Swap);
+    m_profiler.endFrame();
+
+    if (m_animating) renderLater();
+    return;
+  }
+
   bool needsInitialize = false;
 
   if (!m_context) {
@@ -80,20 +115,32 @@ void OpenGLWindow::renderNow() {
     initialize();
   }
 
-  uint64_t millis =
-      duration_cast<milliseconds>(system_clock::now().time_since_epoch())
-          .count();
-  m_delta = millis - m_lastFrame;
-  m_lastFrame = millis;
+  startFrame();
+  m_profiler.beginGpu();
 
   render();
 
+  m_profiler.endGpu();
   m_context->swapBuffers(this);
+  m_profiler.lap(FrameProfiler::Swap);
+  m_profiler.endFrame();
 
   if (m_animating) renderLater();
 }
 //! [4]
 
+void OpenGLWindow::startFrame() {
+  // the first frame after an idle period must not jump the animation
+  m_delta = std::min(m_profiler.beginFrame() / 1e6, MaxDelta);
+  m_lastFrame =
+      duration_cast<nanoseconds>(steady_clock::now().time_since_epoch())
+          .count();
+}
+
+bool OpenGLWindow::makeContextCurrent() {
+  return m_context && m_context->makeCurrent(this);
+}
+
 //! [5]
 void OpenGLWindow::setAnimating(bool animating) {
   m_animating = animating;
@@ -104,4 +151,4 @@ void OpenGLWindow::setAnimating(bool animating) {
 
 uint64_t OpenGLWindow::lastFrame() { return m_lastFrame; }
 
-uint64_t OpenGLWindow::delta() { return m_delta; }
+double OpenGLWindow::delta() { return m_delta; }
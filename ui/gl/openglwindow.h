@@ -1,17 +1,21 @@
 #ifndef OPENGLWINDOW_H
 #define OPENGLWINDOW_H
 
-#include <QTimer>
 #include <QWindow>
 #include <QOpenGLFunctions>
 
+#include "frameprofiler.h"
+
 QT_BEGIN_NAMESPACE
+class QBackingStore;
 class QPainter;
 class QOpenGLContext;
 class QOpenGLPaintDevice;
 QT_END_NAMESPACE
 
 //! [1]
+// Without OpenGL, or with VIEWER_BACKEND=cpu set, the window is a raster
+// surface and render(QPainter *) draws each frame into its backing store.
 class OpenGLWindow : public QWindow, protected QOpenGLFunctions
 {
     Q_OBJECT
@@ -24,9 +28,14 @@ public:
 
     virtual void initialize();
 
+    // frames are drawn by the CPU instead of OpenGL
+    bool isSoftware() const;
+
     void setAnimating(bool animating);
+    // steady clock time of the last frame in nanoseconds
     uint64_t lastFrame();
-    uint64_t delta();
+    // milliseconds since the previous frame, at most MaxDelta
+    double delta();
 
 public slots:
     void renderLater();
@@ -35,15 +44,29 @@ public slots:
 protected:
     bool event(QEvent *event) override;
 
+    bool makeContextCurrent();
+
+    static constexpr double MaxDelta = 50.0;
+
+    FrameProfiler m_profiler;
+
     void exposeEvent(QExposeEvent *event) override;
 
 private:
+    // OpenGL is missing or the CPU backend was asked for
+    static bool softwareRequested();
+
+    void startFrame();
+
     bool m_animating = false;
+    bool m_software = false;
+    bool m_initialized = false;
+    QBackingStore *m_backingStore = nullptr;
 
     QOpenGLContext *m_context = nullptr;
     QOpenGLPaintDevice *m_device = nullptr;
-    QTimer m_timer;
-    uint64_t m_lastFrame, m_delta;
+    uint64_t m_lastFrame = 0;
+    double m_delta = 0;
 };
 
 #endif // OPENGLWINDOW_H
@@ -0,0 +1,125 @@
+#include "rendersettings.h"
+
+#define GL_SILENCE_DEPRECATION
+
+#include <qopengl.h>
+
+void RenderSettings::load_settings(const QSettings &settings) {
+  backgroundColor = QColor(settings.value("bgcolor", "#000000").toString());
+  projectionType = settings.value("projectionCentral", false).toBool()
+                       ? ProjectionType::Orthographic
+                       : ProjectionType::Perspective;
+  lineColor = QColor(settings.value("linecolor", "#FFFFFF").toString());
+  lineWidth = settings.value("linewidth", lineWidth).toFloat();
+  switch (settings.value("linetype", 0).toInt()) {
+    case 0:
+      lineType = LineType::Solid;
+      break;
+    case 1:
+      lineType = LineType::Dashed;
+      break;
+    default:
+      lineType = LineType::Dotted;
+      break;
+  }
+  pointColor = QColor(settings.value("pointcolor", "#FFFFFF").toString());
+  pointSize = settings.value("pointsize", pointSize).toFloat();
+  switch (settings.value("pointtype", 0).toInt()) {
+    case 0:
+      pointType = PointType::None;
+      break;
+    case 1:
+      pointType = PointType::Square;
+      break;
+    default:
+      pointType = PointType::Circle;
+      break;
+  }
+}
+
+QMatrix4x4 RenderSettings::model_matrix(float angle,
+                                        const QMatrix4x4 &fit) const {
+  QMatrix4x4 model;
+  model.translate(position);
+  model.rotate(rotation.y() + angle, 0.f, 1.f, 0.f);
+  model.rotate(rotation.x(), 1.f, 0.f, 0.f);
+  model.rotate(rotation.z(), 0.f, 0.f, 1.f);
+  model.scale(scale);
+  return model * fit;
+}
+
+QMatrix4x4 RenderSettings::view_matrix() const {
+  QMatrix4x4 view;
+  view.rotate(camPitch, 1.f, 0.f, 0.f);
+  view.rotate(camYaw, 0.f, 1.f, 0.f);
+  view.translate(camPosition);
+  return view;
+}
+
+QMatrix4x4 RenderSettings::projection_matrix(float aspect) const {
+  QMatrix4x4 projection;
+  if (projectionType == ProjectionType::Orthographic)
+    projection.ortho(-parallelWidth / 2.f, parallelWidth / 2.f,
+                     -parallelHeight / 2.f, parallelHeight / 2.f, 0.1f,
+                     100.0f);
+  else
+    projection.perspective(90.0f, aspect, 0.1f, 100.0f);
+  return projection;
+}
+
+void RenderSettings::apply_line_style() const {
+  glColor4f(lineColor.redF(), lineColor.greenF(), lineColor.blueF(),
+            lineColor.alphaF());
+  glLineWidth(lineWidth);
+  if (lineType == LineType::Solid) {
+    glDisable(GL_LINE_STIPPLE);
+  } else {
+    glEnable(GL_LINE_STIPPLE);
+    glLineStipple(1, line_stipple());
+  }
+}
+
+void RenderSettings::apply_point_style() const {
+  glColor4f(pointColor.redF(), pointColor.greenF(), pointColor.blueF(),
+            pointColor.alphaF());
+  glPointSize(pointSize);
+  if (pointType == PointType::Circle) {
+    glEnable(GL_POINT_SMOOTH);
+    glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
+  } else {
+    glDisable(GL_POINT_SMOOTH);
+  }
+}
+
+RasterStyle RenderSettings::raster_style() const {
+  RasterStyle style;
+  style.background = backgroundColor.rgba();
+  style.line_color = lineColor.rgba();
+  style.line_width = lineWidth;
+  style.line_stipple = line_stipple();
+  style.point_color = pointColor.rgba();
+  style.point_size = pointSize;
+  switch (pointType) {
+    case PointType::Square:
+      style.point_shape = RASTER_POINT_SQUARE;
+      break;
+    case PointType::Circle:
+      style.point_shape = RASTER_POINT_CIRCLE;
+      break;
+    default:
+      style.point_shape = RASTER_POINT_NONE;
+      break;
+  }
+  return style;
+}
+
+uint16_t RenderSettings::line_stipple() const {
+  switch (lineType) {
+    case LineType::Dashed:
+      return 0x00FF;
+    case LineType::Dotted:
+      return 0x0101;
+    default:
+      return 0xFFFF;
+  }
+}
@@ -0,0 +1,81 @@
+#ifndef RENDERSETTINGS_H
+#define RENDERSETTINGS_H
+
+#include <QColor>
+#include <QMatrix4x4>
+#include <QSettings>
+#include <QVector3D>
+
+extern "C" {
+#include "../../parser/s21_raster.h"
+}
+
+enum ProjectionType {
+    Orthographic,
+    Perspective
+};
+
+enum LineType {
+    Solid,
+    Dashed,
+    Dotted
+};
+
+enum PointType {
+    Square,
+    Circle,
+    None
+};
+
+// How a model is placed, looked at and drawn, shared by the viewer window
+// and the offscreen thumbnail renderer
+struct RenderSettings {
+    // model
+    QVector3D position = QVector3D(0.0f, 0.0f, 0.0f);
+    QVector3D rotation = QVector3D(0.1f, 0.5f, 0.0f);
+    QVector3D scale = QVector3D(0.5f, 0.5f, 0.5f);
+
+    // customization settings
+    QColor backgroundColor = QColor(0, 0, 0, 255);
+    QColor lineColor = QColor(255, 255, 255, 255);
+    QColor pointColor = QColor(255, 255, 255, 255);
+
+    ProjectionType projectionType = ProjectionType::Orthographic;
+
+    float lineWidth = 1.0f;
+    float pointSize = 5.0f;
+    LineType lineType = LineType::Solid;
+    PointType pointType = PointType::None;
+
+    // camera
+    float parallelWidth = 5.0f;
+    float parallelHeight = 2.5f;
+
+    float camYaw = 0.f;
+    float camPitch = 0.f;
+    QVector3D camPosition = {0.0f, 0.0f, -4.0f};
+
+    // reads the display settings the main window saves
+    void load_settings(const QSettings &settings);
+
+    // the model turned by the showcase angle, fit maps it into [-1, 1]
+    QMatrix4x4 model_matrix(float angle, const QMatrix4x4 &fit) const;
+
+    QMatrix4x4 view_matrix() const;
+
+    QMatrix4x4 projection_matrix(float aspect) const;
+
+    // sets the fixed-function color, width and stipple of the edges
+    void apply_line_style() const;
+
+    // sets the fixed-function color, size and shape of the points
+    void apply_point_style() const;
+
+    // the same colors, sizes and stipple for the software rasterizer
+    RasterStyle raster_style() const;
+
+private:
+    uint16_t line_stipple() const;
+};
+
+#endif // RENDERSETTINGS_H
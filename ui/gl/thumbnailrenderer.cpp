@@ -0,0 +1,113 @@
+#include "thumbnailrenderer.h"
+
+#define GL_SILENCE_DEPRECATION
+
+#include <qopengl.h>
+
+ThumbnailRenderer::ThumbnailRenderer(const RenderSettings &settings,
+                                     const QSize &size, RenderBackend backend)
+    : m_settings(settings), m_size(size), m_backend(backend) {
+  // the viewer sizes the parallel projection for its window, a thumbnail
+  // keeps the height and is not stretched
+  m_settings.parallelWidth =
+      m_settings.parallelHeight * size.width() / size.height();
+  if (backend == SoftwareBackend) {
+    int error = 0;
+    m_rasterizer = create_rasterizer(0, &error);
+    return;
+  }
+
+  QSurfaceFormat format;
+  format.setRenderableType(QSurfaceFormat::OpenGL);
+  format.setProfile(QSurfaceFormat::CompatibilityProfile);
+  m_surface.setFormat(format);
+  m_surface.create();
+  m_context.setFormat(format);
+  if (!m_context.create() || !m_context.makeCurrent(&m_surface)) {
+    printf("Error: failed to create an offscreen OpenGL context\n");
+    return;
+  }
+  QOpenGLFramebufferObjectFormat fboFormat;
+  fboFormat.setSamples(Samples);
+  m_fbo = std::make_unique<QOpenGLFramebufferObject>(size, fboFormat);
+  if (!m_fbo->isValid())
+    printf("Error: failed to create a %dx%d framebuffer object\n",
+           size.width(), size.height());
+  m_context.doneCurrent();
+}
+
+ThumbnailRenderer::~ThumbnailRenderer() {
+  destroy_rasterizer(m_rasterizer);
+  // the framebuffer object is deleted in its context
+  if (m_fbo && m_context.makeCurrent(&m_surface)) {
+    m_fbo.reset();
+    m_context.doneCurrent();
+  }
+}
+
+bool ThumbnailRenderer::isValid() const {
+  if (m_backend == SoftwareBackend) return m_rasterizer != nullptr;
+  return m_fbo && m_fbo->isValid();
+}
+
+QMatrix4x4 ThumbnailRenderer::mvp(const Bounds &bounds) const {
+  // QMatrix4x4 takes its floats row by row
+  float fit[16];
+  fit_bounds(&bounds, fit);
+  return m_settings.projection_matrix((float)m_size.width() /
+                                      m_size.height()) *
+         m_settings.view_matrix() *
+         m_settings.model_matrix(0.f, QMatrix4x4(fit).transposed());
+}
+
+QImage ThumbnailRenderer::rasterize(const Mesh &mesh, const Bounds &bounds) {
+  QImage image(m_size, QImage::Format_ARGB32);
+  QMatrix4x4 MVP = mvp(bounds);
+  Wireframe wireframe = {mesh.positions, mesh.vertex_count, mesh.edges,
+                         mesh.edge_count, mesh.points,      mesh.point_count,
+                         MVP.constData()};
+  RasterStyle style = m_settings.raster_style();
+  RasterImage pixels = {reinterpret_cast<uint32_t *>(image.bits()),
+                        image.width(), image.height(),
+                        (int)(image.bytesPerLine() / sizeof(uint32_t))};
+  int error = 0;
+  rasterize_wireframe(m_rasterizer, &wireframe, &style, pixels, &error);
+  return error ? QImage() : image;
+}
+
+QImage ThumbnailRenderer::render(const Mesh &mesh, const Bounds &bounds) {
+  if (!isValid()) return QImage();
+  if (m_backend == SoftwareBackend) return rasterize(mesh, bounds);
+  if (!m_context.makeCurrent(&m_surface)) return QImage();
+  m_fbo->bind();
+
+  const QColor &background = m_settings.backgroundColor;
+  glViewport(0, 0, m_size.width(), m_size.height());
+  glClearColor(background.redF(), background.greenF(), background.blueF(),
+               background.alphaF());
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  QMatrix4x4 MVP = mvp(bounds);
+  glMatrixMode(GL_PROJECTION);
+  glLoadIdentity();
+  glMatrixMode(GL_MODELVIEW);
+  glLoadMatrixf(MVP.constData());
+
+  // each model is drawn once, client arrays save the buffer uploads
+  glEnableClientState(GL_VERTEX_ARRAY);
+  m_settings.apply_line_style();
+  glVertexPointer(3, GL_FLOAT, 0, mesh.positions);
+  glDrawElements(GL_LINES, mesh.edge_count * 2, GL_UNSIGNED_INT, mesh.edges);
+  if (m_settings.pointType != PointType::None) {
+    m_settings.apply_point_style();
+    glVertexPointer(3, GL_FLOAT, 0, mesh.points);
+    glDrawArrays(GL_POINTS, 0, mesh.point_count);
+  }
+  glDisableClientState(GL_VERTEX_ARRAY);
+
+  m_fbo->release();
+  // resolves the samples into a plain image
+  QImage image = m_fbo->toImage();
+  m_context.doneCurrent();
+  return image;
+}
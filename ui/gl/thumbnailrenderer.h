@@ -0,0 +1,57 @@
+#ifndef THUMBNAILRENDERER_H
+#define THUMBNAILRENDERER_H
+
+#include <QImage>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QSize>
+#include <memory>
+
+#include "rendersettings.h"
+
+extern "C" {
+#include "../../parser/s21_mesh.h"
+#include "../../parser/s21_simd.h"
+}
+
+enum RenderBackend {
+    OpenGLBackend,
+    SoftwareBackend
+};
+
+// Draws models the way the viewer draws them at rest, into a multisampled
+// framebuffer object of an offscreen context or with the software
+// rasterizer on every core. Needs no window or display, for OpenGL a
+// software rasterizer like Mesa llvmpipe is enough. Create and use it on
+// the GUI thread.
+class ThumbnailRenderer {
+public:
+    ThumbnailRenderer(const RenderSettings &settings, const QSize &size,
+                      RenderBackend backend = OpenGLBackend);
+    ~ThumbnailRenderer();
+
+    // the context and the framebuffer object or the rasterizer were created
+    bool isValid() const;
+
+    // edges and points of mesh, whose positions have the given bounds,
+    // a null image when the context can not be made current
+    QImage render(const Mesh &mesh, const Bounds &bounds);
+
+private:
+    QMatrix4x4 mvp(const Bounds &bounds) const;
+
+    QImage rasterize(const Mesh &mesh, const Bounds &bounds);
+
+    static constexpr int Samples = 4;
+
+    RenderSettings m_settings;
+    QSize m_size;
+    RenderBackend m_backend;
+    Rasterizer *m_rasterizer = nullptr;
+    QOffscreenSurface m_surface;
+    QOpenGLContext m_context;
+    std::unique_ptr<QOpenGLFramebufferObject> m_fbo;
+};
+
+#endif // THUMBNAILRENDERER_H
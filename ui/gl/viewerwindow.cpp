@@ -1,52 +1,183 @@
 #include "viewerwindow.h"
 
+#include <QDateTime>
+#include <QDir>
 #include <QGuiApplication>
 #include <QMainWindow>
 #include <QMatrix4x4>
 #include <QMouseEvent>
+#include <QOpenGLContext>
+#include <QOpenGLExtraFunctions>
+#include <QOpenGLPaintDevice>
 #include <QOpenGLShaderProgram>
+#include <QPainter>
 #include <QScreen>
 #include <QtMath>
+#include <algorithm>
+#include <limits>
 
 #define GL_SILENCE_DEPRECATION
 
-ViewerWindow::ViewerWindow(QWindow *parent) : OpenGLWindow(parent) {}
+#ifndef GL_COPY_READ_BUFFER
+#define GL_COPY_READ_BUFFER 0x8F36
+#endif
+
+ViewerWindow::ViewerWindow(QWindow *parent) : OpenGLWindow(parent) {
+  // the rasterizer reads float positions
+  if (isSoftware()) compactVertices = false;
+}
+
+ViewerWindow::~ViewerWindow() {
+  if (makeContextCurrent()) {
+    m_vao.destroy();
+    m_pointVao.destroy();
+    m_vertexBuffer.destroy();
+    m_edgeBuffer.destroy();
+    m_pointBuffer.destroy();
+    destroy_edge_pages();
+  }
+  destroy_mesh(&mesh);
+  destroy_quantized_mesh(&m_compact);
+  destroy_rasterizer(m_rasterizer);
+}
 
 void ViewerWindow::initialize() { load_default_square(); }
 
-void ViewerWindow::load_model(QString path) {
+void ViewerWindow::set_mesh(Mesh loaded, QuantizedMesh compact,
+                            int point_count, const Bounds &bounds) {
+  // QMatrix4x4 takes its floats row by row
+  float fit[16];
+  fit_bounds(&bounds, fit);
+  m_fit = QMatrix4x4(fit).transposed();
   set_view();
   set_projection();
-  char *obj_path = (char *)path.toLatin1().data();
-  printf("Loading obj file: %s\n", obj_path);
-  Obj *obj = parse_obj(obj_path);
-  printf("Obj file loaded: %s, %p\n", obj_path, obj);
-  if (obj == NULL) {
-    printf("Error: failed to load obj file: %s\n", obj_path);
-    load_default_square();
-  } else {
-    int point_count = obj->vertices->count;
-    int err = 0;
-    Triangles triangles = triangulate(obj, &err);
-    if (!err) {
-      printf("Creating vertex buffer from obj file: %s\n", obj_path);
-      if (vertex_buffer.data != NULL) safe_free(vertex_buffer.data);
-      vertex_buffer = create_vertex_buffer(obj, triangles, &err);
+  // the buffers still hold the previous model until the next frame uploads
+  destroy_mesh(&mesh);
+  destroy_quantized_mesh(&m_compact);
+  mesh = loaded;
+  m_compact = compact;
+  m_meshDirty = true;
+  this->setTitle(QString("Vertices count: %1").arg(point_count));
+  renderLater();
+}
+
+void ViewerWindow::begin_stream(qint64 bytes) {
+  destroy_mesh(&mesh);
+  destroy_quantized_mesh(&m_compact);
+  m_meshDirty = false;
+  m_streamed = true;
+  m_pointCount = 0;
+  m_edgeLevels.assign(1, EdgeLevel{0, 0, {}});
+  m_pointNodes.clear();
+  m_compactUploaded = false;
+  m_dequantize = QMatrix4x4();
+  m_streamBounds = compute_bounds(nullptr, 3, 0);
+  m_streamCapacity = 0;
+  m_meshUploaded = makeContextCurrent() &&
+                   (m_pointBuffer.isCreated() || m_pointBuffer.create());
+  if (m_meshUploaded) {
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    m_copyBuffers = context->format().version() >=
+                        (context->isOpenGLES() ? qMakePair(3, 0)
+                                               : qMakePair(3, 1)) ||
+                    context->hasExtension("GL_ARB_copy_buffer");
+    // the vertex arrays recorded the layout of the previous mesh, the
+    // buffers are created again by the next upload
+    m_vao.destroy();
+    m_pointVao.destroy();
+    m_vertexBuffer.destroy();
+    m_edgeBuffer.destroy();
+    destroy_edge_pages();
+    // a vertex line takes about 30 bytes, so the buffer rarely grows. A
+    // buffer that cannot be copied on the GPU is sized for the shortest
+    // line, "v 0 0 0\n", so it never has to grow.
+    qint64 lineBytes = m_copyBuffers ? 32 : 8;
+    reserve_stream((int)std::min<qint64>(
+        std::max<qint64>(bytes / lineBytes, 1024),
+        std::numeric_limits<int>::max()));
+  } else if (!isSoftware()) {
+    printf("Buffer objects are not supported, drawing client arrays\n");
+  }
+  this->setTitle(QString("Vertices count: %1").arg(0));
+  update_MVP();
+  renderLater();
+}
+
+void ViewerWindow::append_stream(const float *positions, int vertexCount,
+                                 const uint32_t *edges, int edgeCount) {
+  // the model is refitted as its bounds grow
+  Bounds bounds = compute_bounds(positions, 3, vertexCount);
+  for (int axis = 0; axis < 3 && vertexCount > 0; axis++) {
+    m_streamBounds.min[axis] = std::min(m_streamBounds.min[axis],
+                                        bounds.min[axis]);
+    m_streamBounds.max[axis] = std::max(m_streamBounds.max[axis],
+                                        bounds.max[axis]);
+    m_streamBounds.centroid[axis] +=
+        (bounds.centroid[axis] - m_streamBounds.centroid[axis]) *
+        vertexCount / (m_pointCount + vertexCount);
+  }
+  float fit[16];
+  fit_bounds(&m_streamBounds, fit);
+  m_fit = QMatrix4x4(fit).transposed();
+
+  EdgeLevel &level = m_edgeLevels[0];
+  if (m_meshUploaded && makeContextCurrent()) {
+    while (glGetError() != GL_NO_ERROR) {
+    }
+    reserve_stream(m_pointCount + vertexCount);
+    if (m_pointCount + vertexCount > m_streamCapacity) {
+      printf("Error: streamed model does not fit into a buffer object\n");
+      return;
     }
-    if (!err) printf("Vertex buffer created from obj file: %s\n", obj_path);
-    safe_free(triangles.triangles);
-    if (obj) {
-      destroy_obj(obj);
-      printf("Obj file destroyed: %s, %p\n", obj_path, obj);
+    m_pointBuffer.bind();
+    m_pointBuffer.write(m_pointCount * 3 * (int)sizeof(float), positions,
+                        vertexCount * 3 * (int)sizeof(float));
+    m_pointBuffer.release();
+    for (int written = 0; written < edgeCount;) {
+      if (m_edgePages.empty() || m_edgePages.back().count == EdgePageSize) {
+        EdgePage page = {QOpenGLBuffer(QOpenGLBuffer::IndexBuffer), 0};
+        page.buffer.create();
+        page.buffer.bind();
+        page.buffer.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+        page.buffer.allocate(EdgePageSize * 2 * (int)sizeof(uint32_t));
+        page.buffer.release();
+        m_edgePages.push_back(page);
+      }
+      EdgePage &page = m_edgePages.back();
+      int count = std::min(edgeCount - written, EdgePageSize - page.count);
+      page.buffer.bind();
+      page.buffer.write(page.count * 2 * (int)sizeof(uint32_t),
+                        edges + written * 2,
+                        count * 2 * (int)sizeof(uint32_t));
+      page.buffer.release();
+      page.count += count;
+      written += count;
     }
-    if (err) {
-      printf("Error: failed to create vertex buffer from obj file: %s\n",
-             obj_path);
-      load_default_square();
-    } else {
-      this->setTitle(QString("Vertices count: %1").arg(point_count));
+    if (glGetError() != GL_NO_ERROR)
+      printf("Error: failed to upload a streamed batch\n");
+  } else {
+    // the host arrays grow by a batch at a time
+    float *points = (float *)realloc(
+        mesh.points, sizeof(float) * 3 * (m_pointCount + vertexCount + 1));
+    uint32_t *hostEdges = (uint32_t *)realloc(
+        mesh.edges, sizeof(uint32_t) * 2 * (level.count + edgeCount + 1));
+    if (points != nullptr) mesh.points = points;
+    if (hostEdges != nullptr) mesh.edges = hostEdges;
+    if (points == nullptr || hostEdges == nullptr) {
+      printf("Error: Could not allocate memory for streamed batch\n");
+      return;
     }
+    memcpy(mesh.points + m_pointCount * 3, positions,
+           sizeof(float) * 3 * vertexCount);
+    memcpy(mesh.edges + level.count * 2, edges,
+           sizeof(uint32_t) * 2 * edgeCount);
+    mesh.point_count = m_pointCount + vertexCount;
+    mesh.edge_count = level.count + edgeCount;
   }
+  m_pointCount += vertexCount;
+  level.count += edgeCount;
+  this->setTitle(QString("Vertices count: %1").arg(m_pointCount));
+  renderLater();
 }
 
 void ViewerWindow::mousePressEvent(QMouseEvent *event) {
@@ -58,17 +189,20 @@ void ViewerWindow::mousePressEvent(QMouseEvent *event) {
 void ViewerWindow::mouseMoveEvent(QMouseEvent *event) {
   if ((event->buttons() & Qt::RightButton) && dragging) {
     QPoint pos = event->pos();  // ition().toPoint()
-    camYaw += (pos.x() - lastMousePos.x()) * rotationAlpha * delta();
-    camPitch += (pos.y() - lastMousePos.y()) * rotationAlpha * delta();
+    camYaw += (pos.x() - lastMousePos.x()) * rotationAlpha;
+    camPitch += (pos.y() - lastMousePos.y()) * rotationAlpha;
     if (camPitch > 90.f) camPitch = 90.f;
     if (camPitch < -90.f) camPitch = -90.f;
     camYaw = fmod(camYaw, 360.f);
     lastMousePos = pos;
+    renderLater();
   }
 }
 void ViewerWindow::mouseReleaseEvent(QMouseEvent *event) {
   if (event->button() == Qt::RightButton) {
     dragging = false;
+    // back to full detail
+    renderLater();
   }
 }
 
@@ -96,12 +230,29 @@ void ViewerWindow::keyPressEvent(QKeyEvent *event) {
     case Qt::Key_R:
       showcaseRotate = !showcaseRotate;
       break;
+    case Qt::Key_F3:
+      showProfiler = !showProfiler;
+      break;
+    case Qt::Key_F4:
+      export_profile();
+      break;
+    case Qt::Key_L:
+      coarseWhileMoving = !coarseWhileMoving;
+      break;
+    case Qt::Key_V:
+      compactVertices = !compactVertices;
+      printf("Compact vertices %s from the next load\n",
+             compactVertices ? "on" : "off");
+      break;
     default:
       event->ignore();
   }
+  renderLater();
 }
 
 void ViewerWindow::keyReleaseEvent(QKeyEvent *event) {
+  // a held key sends release and press pairs, the movement keeps going
+  if (event->isAutoRepeat()) return;
   int key = event->key();
   switch (key) {
     case Qt::Key_W:
@@ -125,6 +276,7 @@ void ViewerWindow::keyReleaseEvent(QKeyEvent *event) {
     default:
       event->ignore();
   }
+  renderLater();
 }
 
 void ViewerWindow::render() {
@@ -135,66 +287,186 @@ void ViewerWindow::render() {
   glClear(GL_COLOR_BUFFER_BIT);
 
   update_view();
+  m_profiler.lap(FrameProfiler::View);
   update_model();
+  m_profiler.lap(FrameProfiler::Model);
 
-  int polygonCount = vertex_buffer.count + 1;
-
-  glEnableClientState(GL_VERTEX_ARRAY);
-  glVertexPointer(3, GL_FLOAT, sizeof(VertexData), vertex_buffer.data);
+  if (m_meshDirty) upload_mesh();
+  m_profiler.lap(FrameProfiler::Upload);
+  bind_mesh();
 
   glPointSize(pointSize);
+  apply_line_style();
+  int lod = select_lod();
+  const EdgeLevel &level = m_edgeLevels[lod];
+  // without buffer objects the host copy is drawn
+  const uint32_t *hostEdges =
+      lod == 0 ? mesh.edges : mesh.lods[lod - 1].edges;
+  int edgeRanges = cull(level.nodes, level.count, m_edgeRanges);
+  // the pages of a streamed model are drawn whole
+  if (m_streamed && m_meshUploaded) edgeRanges = 0;
+  for (EdgePage &page : m_edgePages) {
+    page.buffer.bind();
+    glDrawElements(GL_LINES, page.count * 2, GL_UNSIGNED_INT, nullptr);
+    page.buffer.release();
+  }
+  for (int i = 0; i < edgeRanges; i++) {
+    const BvhRange &range = m_edgeRanges[i];
+    const void *first =
+        m_meshUploaded
+            ? reinterpret_cast<const void *>(sizeof(uint32_t) * 2 *
+                                             (level.offset + range.first))
+            : hostEdges + range.first * 2;
+    glDrawElements(GL_LINES, range.count * 2, GL_UNSIGNED_INT, first);
+  }
+  release_mesh();
+  m_profiler.lap(FrameProfiler::Lines);
 
-  glColor4f(lineColor.redF(), lineColor.greenF(), lineColor.blueF(),
-            lineColor.alphaF());
-  glLineWidth(lineWidth);
-  if (lineType == LineType::Solid) {
-    glDisable(GL_LINE_STIPPLE);
-  } else {
-    glEnable(GL_LINE_STIPPLE);
-    if (lineType == LineType::Dashed)
-      glLineStipple(1, 0x00FF);
-    else
-      glLineStipple(1, 0x0101);
+  if (pointType != PointType::None) {
+    apply_point_style();
+    bind_points();
+    int pointRanges = cull(m_pointNodes, m_pointCount, m_pointRanges);
+    for (int i = 0; i < pointRanges; i++)
+      glDrawArrays(GL_POINTS, m_pointRanges[i].first, m_pointRanges[i].count);
+    release_points();
   }
-  glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-  glDrawArrays(GL_TRIANGLES, 0, polygonCount);
+  m_profiler.lap(FrameProfiler::Points);
 
-  glColor4f(pointColor.redF(), pointColor.greenF(), pointColor.blueF(),
-            pointColor.alphaF());
-  glPointSize(pointSize);
+  if (showProfiler) draw_profiler();
+  m_profiler.lap(FrameProfiler::Overlay);
 
-  if (pointType != PointType::None) {
-    if (pointType == PointType::Circle) {
-      glEnable(GL_POINT_SMOOTH);
-      glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
-    } else {
-      glDisable(GL_POINT_SMOOTH);
-    }
-    glPolygonMode(GL_FRONT_AND_BACK, GL_POINT);
-    glDrawArrays(GL_POINTS, 0, polygonCount);
+  m_frame++;
+  setAnimating(is_moving());
+}
+
+void ViewerWindow::render(QPainter *painter) {
+  update_view();
+  m_profiler.lap(FrameProfiler::View);
+  update_model();
+  m_profiler.lap(FrameProfiler::Model);
+
+  // nothing to upload, the rasterizer reads the host mesh every frame
+  if (m_meshDirty) {
+    m_meshDirty = false;
+    m_streamed = false;
+    m_pointCount = mesh.point_count;
+    destroy_quantized_mesh(&m_compact);
+  }
+  m_profiler.lap(FrameProfiler::Upload);
+
+  int error = 0;
+  if (m_rasterizer == nullptr) m_rasterizer = create_rasterizer(0, &error);
+  QSize pixels = size() * devicePixelRatio();
+  if (m_frameImage.size() != pixels)
+    m_frameImage = QImage(pixels, QImage::Format_ARGB32);
+  if (m_rasterizer != nullptr && !m_frameImage.isNull()) {
+    // a streamed model has its edges between the points, the levels of
+    // detail stand in for culling while moving
+    int lod = coarseWhileMoving && is_navigating() ? mesh.lod_count : 0;
+    const MeshLod *coarse = lod > 0 ? &mesh.lods[lod - 1] : nullptr;
+    Wireframe wireframe = {
+        m_streamed ? mesh.points : mesh.positions,
+        m_streamed ? mesh.point_count : mesh.vertex_count,
+        coarse ? coarse->edges : mesh.edges,
+        coarse ? coarse->edge_count : mesh.edge_count,
+        mesh.points,
+        mesh.point_count,
+        m_MVP.constData()};
+    RasterStyle style = raster_style();
+    RasterImage image = {
+        reinterpret_cast<uint32_t *>(m_frameImage.bits()),
+        m_frameImage.width(), m_frameImage.height(),
+        (int)(m_frameImage.bytesPerLine() / sizeof(uint32_t))};
+    rasterize_wireframe(m_rasterizer, &wireframe, &style, image, &error);
   }
+  // the rasterizer draws the points with the edges
+  m_profiler.lap(FrameProfiler::Lines);
+  painter->drawImage(QRect(QPoint(0, 0), size()), m_frameImage);
+  m_profiler.lap(FrameProfiler::Points);
 
-  glDisableClientState(GL_VERTEX_ARRAY);
+  if (showProfiler) m_profiler.drawOverlay(painter);
+  m_profiler.lap(FrameProfiler::Overlay);
 
   m_frame++;
+  setAnimating(is_moving());
 }
 
-void ViewerWindow::set_model() {
-  m_model.setToIdentity();
+int ViewerWindow::cull(const std::vector<BvhNode> &nodes, int count,
+                       std::vector<BvhRange> &ranges) const {
+  if (nodes.empty()) {
+    ranges[0] = {0, count};
+    return count > 0 ? 1 : 0;
+  }
+  Bvh bvh = {const_cast<BvhNode *>(nodes.data()), (int)nodes.size()};
+  return cull_bvh(&bvh, m_MVP.constData(), ranges.data(), (int)ranges.size());
+}
+
+bool ViewerWindow::is_moving() const {
+  return showcaseRotate || controls.any();
+}
+
+bool ViewerWindow::is_navigating() const {
+  return dragging || controls.any();
+}
+
+int ViewerWindow::select_lod() const {
+  int coarsest = (int)m_edgeLevels.size() - 1;
+  if (coarsest == 0 || m_edgeLevels[0].nodes.empty()) return 0;
+  if (coarseWhileMoving && is_navigating()) return coarsest;
+  float radius = projected_radius();
+  float area = (float)M_PI * radius * radius;
+  int lod = 0;
+  while (lod < coarsest && m_edgeLevels[lod].count > area * LodEdgesPerPixel)
+    lod++;
+  return lod;
+}
+
+float ViewerWindow::projected_radius() const {
+  const BvhNode &root = m_edgeLevels[0].nodes[0];
+  QVector3D low(root.min[0], root.min[1], root.min[2]);
+  QVector3D high(root.max[0], root.max[1], root.max[2]);
+  float radius = (scale * (high - low)).length() / 2.f * m_fit(0, 0);
+  // m_projection(1, 1) maps a unit at unit distance to half the viewport
+  float pixels =
+      radius * m_projection(1, 1) * height() * devicePixelRatio() / 2.f;
+  if (projectionType == ProjectionType::Orthographic) return pixels;
+  float distance = -(m_view * m_model).map((low + high) / 2.f).z();
+  if (distance <= radius) return std::numeric_limits<float>::infinity();
+  return pixels / distance;
+}
+
+void ViewerWindow::draw_profiler() {
+  QOpenGLPaintDevice device(size() * devicePixelRatio());
+  device.setDevicePixelRatio(devicePixelRatio());
+  QPainter painter(&device);
+  m_profiler.drawOverlay(&painter);
+  painter.end();
+  // QPainter leaves its program and generic attribute arrays enabled, and
+  // attribute 0 aliases the fixed-function vertex array
+  glUseProgram(0);
+  for (int i = 0; i < 3; i++) glDisableVertexAttribArray(i);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void ViewerWindow::export_profile() {
+  QString path =
+      QDir::homePath() + "/frame_profile_" +
+      QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss") + ".csv";
+  if (m_profiler.exportCsv(path))
+    printf("Frame profile written to %s\n", path.toLocal8Bit().constData());
+  else
+    printf("Error: could not write frame profile %s\n",
+           path.toLocal8Bit().constData());
+}
 
+void ViewerWindow::set_model() {
   if (showcaseRotate) angle += angleSpeed * delta();
   angle = fmod(angle, 360.f);
 
-  m_model.translate(position);
-  m_model.rotate(rotation.y() + angle, 0.f, 1.f, 0.f);
-  m_model.rotate(rotation.x(), 1.f, 0.f, 0.f);
-  m_model.rotate(rotation.z(), 0.f, 0.f, 1.f);
-  m_model.scale(scale);
+  m_model = model_matrix(angle, m_fit);
 }
 
 void ViewerWindow::set_view() {
-  m_view.setToIdentity();
-
   float dx = 0.f, dy = 0.f, dz = 0.f;
 
   if (controls.W) dz += 1;
@@ -210,21 +482,11 @@ void ViewerWindow::set_view() {
 
   camPosition += QVector3D(dx, dy, dz) * rot * (positionSpeed * delta());
 
-  m_view.rotate(camPitch, 1.f, 0.f, 0.f);
-  m_view.rotate(camYaw, 0.f, 1.f, 0.f);
-
-  m_view.translate(camPosition);
+  m_view = view_matrix();
 }
 
 void ViewerWindow::set_projection() {
-  m_projection.setToIdentity();
-  if (projectionType == ProjectionType::Orthographic)
-    m_projection.ortho(-parallelWidth / 2.f, parallelWidth / 2.f,
-                       -parallelHeight / 2.f, parallelHeight / 2.f, 0.1f,
-                       100.0f);
-  else
-    m_projection.perspective(90.0f, (GLfloat)width() / (GLfloat)height(), 0.1f,
-                             100.0f);
+  m_projection = projection_matrix((GLfloat)width() / (GLfloat)height());
 }
 
 void ViewerWindow::update_model() {
@@ -244,35 +506,234 @@ void ViewerWindow::update_projection() {
 
 void ViewerWindow::update_MVP() {
   m_MVP = m_projection * m_view * m_model;
-  glLoadMatrixf(m_MVP.data());
+  if (!isSoftware()) glLoadMatrixf((m_MVP * m_dequantize).constData());
 }
 
 void ViewerWindow::load_default_square() {
-  // set default vertex buffer triangle
+  // set default square mesh
   printf("load_default_square\n");
-  vertex_buffer.count = 6;
-  safe_free(vertex_buffer.data);
-  printf("load_default_square 2\n");
-  vertex_buffer.data =
-      (VertexData *)calloc(sizeof(VertexData), vertex_buffer.count);
-  printf("load_default_square 3\n");
-  vertex_buffer.data[0] = {.position = {0.5f, 0.5f, 0.5f, 1.0f},
-                           .texture = {0.0f, 0.0f, 0.0f},
-                           .normal = {0.0f, 0.0f, 0.0f}};
-  vertex_buffer.data[1] = {.position = {0.5f, -0.5f, 0.5f, 1.0f},
-                           .texture = {0.0f, 0.0f, 0.0f},
-                           .normal = {0.0f, 0.0f, 0.0f}};
-  vertex_buffer.data[2] = {.position = {-0.5f, -0.5f, 0.5f, 1.0f},
-                           .texture = {0.0f, 0.0f, 0.0f},
-                           .normal = {0.0f, 0.0f, 0.0f}};
-  vertex_buffer.data[3] = {.position = {0.5f, 0.5f, 0.5f, 1.0f},
-                           .texture = {0.0f, 0.0f, 0.0f},
-                           .normal = {0.0f, 0.0f, 0.0f}};
-  vertex_buffer.data[4] = {.position = {-0.5f, -0.5f, 0.5f, 1.0f},
-                           .texture = {0.0f, 0.0f, 0.0f},
-                           .normal = {0.0f, 0.0f, 0.0f}};
-  vertex_buffer.data[5] = {.position = {-0.5f, 0.5f, 0.5f, 1.0f},
-                           .texture = {0.0f, 0.0f, 0.0f},
-                           .normal = {0.0f, 0.0f, 0.0f}};
+  destroy_mesh(&mesh);
+  mesh.vertex_count = 4;
+  mesh.index_count = 6;
+  mesh.edge_count = 4;
+  mesh.point_count = 4;
+  mesh.positions = (float *)calloc(sizeof(float), mesh.vertex_count * 3);
+  mesh.normals = (float *)calloc(sizeof(float), mesh.vertex_count * 3);
+  mesh.textures = (float *)calloc(sizeof(float), mesh.vertex_count * 2);
+  mesh.indices = (uint32_t *)calloc(sizeof(uint32_t), mesh.index_count);
+  mesh.edges = (uint32_t *)calloc(sizeof(uint32_t), mesh.edge_count * 2);
+  mesh.points = (float *)calloc(sizeof(float), mesh.point_count * 3);
+  const float positions[] = {0.5f,  0.5f,  0.5f, 0.5f,  -0.5f, 0.5f,
+                             -0.5f, -0.5f, 0.5f, -0.5f, 0.5f,  0.5f};
+  const uint32_t indices[] = {0, 1, 2, 0, 2, 3};
+  const uint32_t edges[] = {0, 1, 1, 2, 2, 3, 3, 0};
+  memcpy(mesh.positions, positions, sizeof(positions));
+  memcpy(mesh.points, positions, sizeof(positions));
+  memcpy(mesh.indices, indices, sizeof(indices));
+  memcpy(mesh.edges, edges, sizeof(edges));
+  m_meshDirty = true;
   printf("load_default_square end\n");
 }
+
+void ViewerWindow::upload_mesh() {
+  m_meshDirty = false;
+  m_streamed = false;
+  destroy_edge_pages();
+  m_pointCount = mesh.point_count;
+  // the hierarchies outlive the host copy, culling runs every frame
+  m_edgeLevels.resize(mesh.lod_count + 1);
+  int edgeTotal = 0, edgeCapacity = 1;
+  for (int i = 0; i <= mesh.lod_count; i++) {
+    const Bvh &bvh = i == 0 ? mesh.edge_bvh : mesh.lods[i - 1].bvh;
+    EdgeLevel &level = m_edgeLevels[i];
+    level.offset = edgeTotal;
+    level.count = i == 0 ? mesh.edge_count : mesh.lods[i - 1].edge_count;
+    level.nodes.assign(bvh.nodes, bvh.nodes + bvh.node_count);
+    edgeTotal += level.count;
+    edgeCapacity = std::max(edgeCapacity, bvh_range_capacity(&bvh));
+  }
+  m_edgeRanges.resize(edgeCapacity);
+  m_pointRanges.resize(std::max(1, bvh_range_capacity(&mesh.point_bvh)));
+
+  if (!m_vertexBuffer.isCreated()) m_vertexBuffer.create();
+  if (!m_edgeBuffer.isCreated()) m_edgeBuffer.create();
+  if (!m_pointBuffer.isCreated()) m_pointBuffer.create();
+  m_meshUploaded = m_vertexBuffer.isCreated() && m_edgeBuffer.isCreated() &&
+                   m_pointBuffer.isCreated();
+  m_compactUploaded = false;
+  m_dequantize = QMatrix4x4();
+  if (!m_meshUploaded) {
+    printf("Buffer objects are not supported, drawing client arrays\n");
+    destroy_quantized_mesh(&m_compact);
+    update_MVP();
+    return;
+  }
+
+  while (glGetError() != GL_NO_ERROR) {
+  }
+  m_compactUploaded = m_compact.vertices != nullptr;
+  m_vertexBuffer.bind();
+  m_vertexBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+  if (m_compactUploaded) {
+    m_vertexBuffer.allocate(
+        m_compact.vertices,
+        m_compact.vertex_count * (int)sizeof(QuantizedVertex));
+  } else {
+    // the streams are interleaved only for the upload
+    std::vector<float> vertices((size_t)mesh.vertex_count *
+                                MESH_VERTEX_FLOATS);
+    interleave_vertices(&mesh, vertices.data());
+    m_vertexBuffer.allocate(vertices.data(),
+                            (int)(vertices.size() * sizeof(float)));
+  }
+  m_edgeBuffer.bind();
+  m_edgeBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+  m_edgeBuffer.allocate(edgeTotal * 2 * (int)sizeof(uint32_t));
+  for (int i = 0; i <= mesh.lod_count; i++) {
+    const EdgeLevel &level = m_edgeLevels[i];
+    m_edgeBuffer.write(level.offset * 2 * (int)sizeof(uint32_t),
+                       i == 0 ? mesh.edges : mesh.lods[i - 1].edges,
+                       level.count * 2 * (int)sizeof(uint32_t));
+  }
+  m_pointBuffer.bind();
+  m_pointBuffer.setUsagePattern(QOpenGLBuffer::StaticDraw);
+  if (m_compactUploaded)
+    m_pointBuffer.allocate(m_compact.points,
+                           m_compact.point_count * 4 * (int)sizeof(int16_t));
+  else
+    m_pointBuffer.allocate(mesh.points,
+                           mesh.point_count * 3 * (int)sizeof(float));
+  m_meshUploaded = glGetError() == GL_NO_ERROR;
+
+  // the vertex array objects record the client state and the bindings
+  if (m_meshUploaded && (m_vao.isCreated() || m_vao.create())) {
+    m_vao.bind();
+    m_vertexBuffer.bind();
+    m_edgeBuffer.bind();
+    glEnableClientState(GL_VERTEX_ARRAY);
+    buffer_vertex_pointer(false);
+    m_vao.release();
+  }
+  if (m_meshUploaded && (m_pointVao.isCreated() || m_pointVao.create())) {
+    m_pointVao.bind();
+    m_pointBuffer.bind();
+    glEnableClientState(GL_VERTEX_ARRAY);
+    buffer_vertex_pointer(true);
+    m_pointVao.release();
+  }
+  m_vertexBuffer.release();
+  m_edgeBuffer.release();
+  m_pointBuffer.release();
+
+  if (m_meshUploaded) {
+    destroy_mesh(&mesh);
+  } else {
+    printf("Error: failed to upload mesh, drawing client arrays\n");
+    m_compactUploaded = false;
+  }
+  if (m_compactUploaded)
+    m_dequantize = QMatrix4x4(m_compact.dequantize).transposed();
+  destroy_quantized_mesh(&m_compact);
+  update_MVP();
+}
+
+void ViewerWindow::buffer_vertex_pointer(bool points) {
+  if (m_compactUploaded)
+    glVertexPointer(3, GL_SHORT,
+                    points ? 4 * (int)sizeof(int16_t)
+                           : (int)sizeof(QuantizedVertex),
+                    nullptr);
+  else
+    glVertexPointer(3, GL_FLOAT, points ? 0 : VertexStride, nullptr);
+}
+
+void ViewerWindow::reserve_stream(int count) {
+  // buffer sizes are ints
+  const int limit =
+      std::numeric_limits<int>::max() / (3 * (int)sizeof(float));
+  if (count <= m_streamCapacity || m_streamCapacity == limit) return;
+  int capacity = std::min(std::max(count, m_streamCapacity * 2), limit);
+  int bytes = m_pointCount * 3 * (int)sizeof(float);
+  // the positions so far are copied on the GPU, they never come back to
+  // host memory, which would stall the frame and break streamBudget
+  if (bytes > 0 && !m_copyBuffers) return;
+  QOpenGLBuffer grown(QOpenGLBuffer::VertexBuffer);
+  if (!grown.create()) return;
+  grown.bind();
+  grown.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+  grown.allocate(capacity * 3 * (int)sizeof(float));
+  if (bytes > 0) {
+    glBindBuffer(GL_COPY_READ_BUFFER, m_pointBuffer.bufferId());
+    QOpenGLContext::currentContext()->extraFunctions()->glCopyBufferSubData(
+        GL_COPY_READ_BUFFER, GL_ARRAY_BUFFER, 0, 0, bytes);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+  }
+  grown.release();
+  m_pointBuffer.destroy();
+  m_pointBuffer = grown;
+  m_streamCapacity = capacity;
+}
+
+void ViewerWindow::destroy_edge_pages() {
+  for (EdgePage &page : m_edgePages) page.buffer.destroy();
+  m_edgePages.clear();
+}
+
+void ViewerWindow::bind_mesh() {
+  // a streamed model draws its edges over the point buffer
+  if (m_streamed) {
+    bind_points();
+    return;
+  }
+  if (m_meshUploaded && m_vao.isCreated()) {
+    m_vao.bind();
+    return;
+  }
+  glEnableClientState(GL_VERTEX_ARRAY);
+  if (m_meshUploaded) {
+    m_vertexBuffer.bind();
+    m_edgeBuffer.bind();
+    buffer_vertex_pointer(false);
+  } else {
+    glVertexPointer(3, GL_FLOAT, 0, mesh.positions);
+  }
+}
+
+void ViewerWindow::release_mesh() {
+  if (m_streamed) {
+    release_points();
+    return;
+  }
+  if (m_meshUploaded && m_vao.isCreated()) {
+    m_vao.release();
+    return;
+  }
+  glDisableClientState(GL_VERTEX_ARRAY);
+  if (m_meshUploaded) {
+    m_vertexBuffer.release();
+    m_edgeBuffer.release();
+  }
+}
+
+void ViewerWindow::bind_points() {
+  if (m_meshUploaded && m_pointVao.isCreated()) {
+    m_pointVao.bind();
+    return;
+  }
+  glEnableClientState(GL_VERTEX_ARRAY);
+  if (m_meshUploaded) {
+    m_pointBuffer.bind();
+    buffer_vertex_pointer(true);
+  } else {
+    glVertexPointer(3, GL_FLOAT, 0, mesh.points);
+  }
+}
+
+void ViewerWindow::release_points() {
+  if (m_meshUploaded && m_pointVao.isCreated()) {
+    m_pointVao.release();
+    return;
+  }
+  glDisableClientState(GL_VERTEX_ARRAY);
+  if (m_meshUploaded) m_pointBuffer.release();
+}
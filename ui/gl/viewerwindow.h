@@ -1,31 +1,22 @@
 #ifndef VIEWERWINDOW_H
 #define VIEWERWINDOW_H
 
+#include <QImage>
 #include <QMatrix4x4>
+#include <QOpenGLBuffer>
+#include <QOpenGLVertexArrayObject>
+#include <vector>
 
 #include "openglwindow.h"
+#include "rendersettings.h"
 
 extern "C" {
+#include "../../parser/s21_mesh.h"
 #include "../../parser/s21_parser.h"
+#include "../../parser/s21_quantize.h"
+#include "../../parser/s21_simd.h"
 }
 
-enum ProjectionType {
-    Orthographic,
-    Perspective
-};
-
-enum LineType {
-    Solid,
-    Dashed,
-    Dotted
-};
-
-enum PointType {
-    Square,
-    Circle,
-    None
-};
-
 enum DisplayMethod {
     DisplayTriangles,
     DisplayQuads,
@@ -35,58 +26,67 @@ enum DisplayMethod {
 
 struct Controls {
     bool W,A,S,D,Up,Down;
+
+    bool any() const { return W || A || S || D || Up || Down; }
 };
 
-class ViewerWindow : public OpenGLWindow {
+class ViewerWindow : public OpenGLWindow, public RenderSettings {
 public:
     explicit ViewerWindow(QWindow *parent = nullptr);
+    ~ViewerWindow();
     using OpenGLWindow::OpenGLWindow;
 
     void initialize() override;
 
     void render() override;
 
+    // the frame drawn by the software rasterizer, without OpenGL
+    void render(QPainter *painter) override;
+
     void update_model();
 
     void update_view();
 
     void update_projection();
 
-    void load_model(QString path);
+    // takes ownership of a mesh built off the GUI thread and of its compact
+    // copy, which is uploaded instead when it has vertices. The bounds of
+    // its positions fit it into [-1, 1] before the model transform
+    void set_mesh(Mesh loaded, QuantizedMesh compact, int point_count,
+                  const Bounds &bounds);
+
+    // drops the current model for one that is streamed in batch by batch,
+    // the buffers are first sized for a file of bytes
+    void begin_stream(qint64 bytes);
+
+    // appends the positions of vertexCount new vertices and edges between
+    // any vertices streamed so far, they are drawn from the next frame on
+    void append_stream(const float *positions, int vertexCount,
+                       const uint32_t *edges, int edgeCount);
 
     // model
-    QVector3D position = QVector3D(0.0f, 0.0f, 0.0f);
-    QVector3D rotation = QVector3D(0.1f, 0.5f, 0.0f);
-    QVector3D scale = QVector3D(0.5f, 0.5f, 0.5f);
     float angle = 0.0f;
     float angleSpeed = 12.f / 1000.f;
     bool showcaseRotate = false;
-
-    // customization settings
-    QColor backgroundColor = QColor(0, 0, 0, 255);
-    QColor lineColor = QColor(255, 255, 255, 255);
-    QColor pointColor = QColor(255, 255, 255, 255);
-
-    ProjectionType projectionType = ProjectionType::Orthographic;
-
-    float lineWidth = 1.0f;
-    float pointSize = 5.0f;
-    LineType lineType = LineType::Solid;
-    PointType pointType = PointType::None;
-
-    // camera & controls
+    // frame time percentiles, toggled with F3, F4 exports them as CSV
+    bool showProfiler = false;
+    // draw the coarsest level of detail while dragging or walking, L toggles
+    bool coarseWhileMoving = true;
+    // upload 16-byte quantized vertices from the next load on, V toggles
+    bool compactVertices = true;
+    // larger files are streamed in and drawn while they load, without
+    // levels of detail, culling or the mesh cache
+    qint64 streamAbove = 512LL * 1024 * 1024;
+    // host memory a streamed load may hold
+    size_t streamBudget = 256u * 1024 * 1024;
+
+    // controls
     float positionSpeed = 1.f / 1000.f;
-    float rotationAlpha = 1.f / 50.f; // mouse rotation coefficient
-    float parallelWidth = 5.0f;
-    float parallelHeight = 2.5f;
-
-    float camYaw = 0.f;
-    float camPitch = 0.f;
-    QVector3D camPosition = {0.0f, 0.0f, -4.0f};
+    float rotationAlpha = 1.f / 3.f; // mouse rotation, degrees per pixel
 
     bool dragging = false;
     QPoint lastMousePos;
-    Controls controls;
+    Controls controls = {};
 
 protected:
     void mousePressEvent(QMouseEvent *event) override;
@@ -106,14 +106,103 @@ private:
 
     void load_default_square();
 
+    // Visible ranges of the primitives under nodes for the current m_MVP,
+    // a single range of all count primitives without a hierarchy
+    int cull(const std::vector<BvhNode> &nodes, int count,
+             std::vector<BvhRange> &ranges) const;
+
+    // showcase rotation or a held movement key needs frames without input
+    bool is_moving() const;
+
+    // the camera is being dragged or walked
+    bool is_navigating() const;
+
+    // Level of detail to draw, the finest whose edges are not denser than
+    // LodEdgesPerPixel over the projected model bounds
+    int select_lod() const;
+
+    // Radius of the model bounds on screen in pixels, infinite with the
+    // camera inside them
+    float projected_radius() const;
+
+    void draw_profiler();
+
+    void export_profile();
+
+    void upload_mesh();
+
+    // points to the bound vertex or point buffer in its format
+    void buffer_vertex_pointer(bool points);
+
+    // grows the point buffer of a streamed model to hold count positions,
+    // a new buffer gets the old contents by glCopyBufferSubData and without
+    // that it stays as it is
+    void reserve_stream(int count);
+
+    void destroy_edge_pages();
+
+    void bind_mesh();
+
+    void release_mesh();
+
+    void bind_points();
+
+    void release_points();
+
     int m_frame = 0;
     QMatrix4x4 m_model = QMatrix4x4();
+    QMatrix4x4 m_fit = QMatrix4x4();
     QMatrix4x4 m_view = QMatrix4x4();
     QMatrix4x4 m_projection = QMatrix4x4();
     QMatrix4x4 m_MVP = QMatrix4x4();
 
     const char *default_obj_path = "/Users/yuehbell/dev/C8_3DViewer_v1.0-0/src/models/Female.obj";
-    VertexBuffer vertex_buffer = {};
+    // host copy of the mesh, released once it is uploaded
+    Mesh mesh = {};
+    bool m_meshDirty = false;
+    bool m_meshUploaded = false;
+    // released after the upload like the host mesh
+    QuantizedMesh m_compact = {};
+    bool m_compactUploaded = false;
+    // maps compact positions to model space, folded into the loaded matrix
+    // only, m_MVP stays in model space for culling
+    QMatrix4x4 m_dequantize = QMatrix4x4();
+    int m_pointCount = 0;
+    QOpenGLBuffer m_vertexBuffer = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    // interleaved by interleave_vertices, positions come first
+    static constexpr int VertexStride = MESH_VERTEX_FLOATS * sizeof(float);
+    QOpenGLBuffer m_edgeBuffer = QOpenGLBuffer(QOpenGLBuffer::IndexBuffer);
+    QOpenGLBuffer m_pointBuffer = QOpenGLBuffer(QOpenGLBuffer::VertexBuffer);
+    QOpenGLVertexArrayObject m_vao;
+    QOpenGLVertexArrayObject m_pointVao;
+    // level 0 is the full mesh, the levels share the edge buffer
+    struct EdgeLevel {
+        int offset;
+        int count;
+        std::vector<BvhNode> nodes;
+    };
+    static constexpr float LodEdgesPerPixel = 0.5f;
+    std::vector<EdgeLevel> m_edgeLevels = std::vector<EdgeLevel>(1);
+    std::vector<BvhNode> m_pointNodes;
+    std::vector<BvhRange> m_edgeRanges = std::vector<BvhRange>(1);
+    std::vector<BvhRange> m_pointRanges = std::vector<BvhRange>(1);
+    // a streamed model keeps its positions in the point buffer and its
+    // edges in pages that are filled one after the other, the host copy
+    // grows instead without buffer objects
+    bool m_streamed = false;
+    int m_streamCapacity = 0;
+    // glCopyBufferSubData is available, from OpenGL 3.1 or ES 3.0
+    bool m_copyBuffers = false;
+    Bounds m_streamBounds = {};
+    struct EdgePage {
+        QOpenGLBuffer buffer;
+        int count;
+    };
+    static constexpr int EdgePageSize = 1 << 20;
+    std::vector<EdgePage> m_edgePages;
+    // the software backend keeps the host mesh and draws it into the frame
+    Rasterizer *m_rasterizer = nullptr;
+    QImage m_frameImage;
 };
 
 #endif // VIEWERWINDOW_H
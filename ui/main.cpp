@@ -1,8 +1,77 @@
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QGuiApplication>
+#include <QSettings>
+#include <QThread>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 
 #include "main/mainwindow.h"
+#include "main/thumbnailbatch.h"
+
+// --thumbnails renders a directory of models without showing a window
+static bool thumbnailMode(int argc, char *argv[]) {
+  for (int i = 1; i < argc; i++)
+    if (strncmp(argv[i], "--thumbnails", strlen("--thumbnails")) == 0)
+      return true;
+  return false;
+}
+
+static int renderThumbnails(int argc, char *argv[]) {
+#ifdef Q_OS_LINUX
+  // a build server has no display to connect to
+  if (qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM") &&
+      qEnvironmentVariableIsEmpty("DISPLAY") &&
+      qEnvironmentVariableIsEmpty("WAYLAND_DISPLAY"))
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+#endif
+  QGuiApplication a(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+      "Renders a PNG thumbnail of every model file under a directory.");
+  parser.addHelpOption();
+  QCommandLineOption thumbnails("thumbnails", "Directory of model files.",
+                                "dir");
+  QCommandLineOption out("out", "Directory the PNG files are written to.",
+                         "dir", "thumbnails");
+  QCommandLineOption size("size", "Width and height in pixels.", "px", "256");
+  QCommandLineOption backend("backend", "Draw with gl or cpu.", "name", "gl");
+  QCommandLineOption jobs(
+      "jobs", "Threads that load models and write images.", "n",
+      QString::number(std::max(1, QThread::idealThreadCount())));
+  parser.addOptions({thumbnails, out, size, backend, jobs});
+  parser.process(a);
+
+  int px = parser.value(size).toInt();
+  int threads = parser.value(jobs).toInt();
+  if (px <= 0 || threads <= 0) {
+    printf("Error: --size and --jobs take a positive number\n");
+    return 1;
+  }
+  QString name = parser.value(backend);
+  if (name != "gl" && name != "cpu") {
+    printf("Error: --backend takes gl or cpu\n");
+    return 1;
+  }
+
+  // drawn with the display settings the viewer saved
+  RenderSettings settings;
+  settings.load_settings(QSettings());
+  ThumbnailBatch batch(settings, QSize(px, px), threads,
+                       name == "cpu" ? SoftwareBackend : OpenGLBackend);
+  return batch.run(parser.value(thumbnails), parser.value(out));
+}
 
 int main(int argc, char *argv[]) {
+  // Set up some values for QSettings
+  QCoreApplication::setOrganizationName("3DBiber");
+  QCoreApplication::setApplicationName("3D Viewer");
+  QCoreApplication::setOrganizationDomain("3dviewer");
+
+  if (thumbnailMode(argc, argv)) return renderThumbnails(argc, argv);
+
   QApplication a(argc, argv);
 
   QSurfaceFormat format;
@@ -63,13 +63,9 @@ MainWindow::MainWindow(QWidget *parent)
   ui->comboPointType->addItem("Square");
   ui->comboPointType->addItem("Circle");
 
-  // Set up some values for QSettings
-  QCoreApplication::setOrganizationName("3DBiber");
-  QCoreApplication::setApplicationName("3D Viewer");
-  QCoreApplication::setOrganizationDomain("3dviewer");
-
   loadSettings();
   spawnViewer();
+  setupLoader();
   loadModel();
 }
 
@@ -83,6 +79,8 @@ void MainWindow::spawnViewer() {
   viewerWin = new ViewerWindow(this->windowHandle());
   viewerWin->resize(920, 640);
   viewerWin->show();
+  if (viewerWin->isSoftware())
+    ui->statusbar->showMessage("Drawing with the software rasterizer");
 
   // Call all updates
   updateModelPosition();
@@ -102,31 +100,80 @@ void MainWindow::spawnViewer() {
                                   : ProjectionType::Perspective;
 }
 
+void MainWindow::setupLoader() {
+  loader = new ModelLoader(viewerWin, this);
+  loadProgress = new QProgressBar(this);
+  loadProgress->setRange(0, 100);
+  buttonCancelLoad = new QPushButton("Cancel", this);
+  ui->statusbar->addPermanentWidget(loadProgress);
+  ui->statusbar->addPermanentWidget(buttonCancelLoad);
+  showLoading(false);
+
+  connect(buttonCancelLoad, SIGNAL(clicked()), loader, SLOT(cancel()));
+  connect(loader, SIGNAL(progress(int)), this, SLOT(updateLoadProgress(int)));
+  connect(loader, SIGNAL(loaded(QString, int)), this,
+          SLOT(modelLoaded(QString, int)));
+  connect(loader, SIGNAL(failed(QString)), this,
+          SLOT(modelLoadFailed(QString)));
+  connect(loader, SIGNAL(cancelled(QString)), this,
+          SLOT(modelLoadCancelled(QString)));
+}
+
+void MainWindow::showLoading(bool loading) {
+  loadProgress->setVisible(loading);
+  buttonCancelLoad->setVisible(loading);
+}
+
 void MainWindow::updateModelPosition() {
   viewerWin->position.setX(ui->spinPosX->value());
   viewerWin->position.setY(ui->spinPosY->value());
   viewerWin->position.setZ(ui->spinPosZ->value());
+  viewerWin->renderLater();
 }
 void MainWindow::updateModelRotation() {
   viewerWin->rotation.setX(ui->spinRotX->value());
   viewerWin->rotation.setY(ui->spinRotY->value());
   viewerWin->rotation.setZ(ui->spinRotZ->value());
+  viewerWin->renderLater();
 }
 void MainWindow::updateModelScale() {
   viewerWin->scale.setX(ui->spinScX->value());
   viewerWin->scale.setY(ui->spinScY->value());
   viewerWin->scale.setZ(ui->spinScZ->value());
+  viewerWin->renderLater();
 }
 
 void MainWindow::loadModel() {
   QString path = ui->editPath->text();
   if (!viewerWin) spawnViewer();
   if (!viewerWin->isExposed()) viewerWin->show();
-  viewerWin->load_model(path);
+  ui->statusbar->showMessage("Loading " + path);
+  showLoading(true);
+  loader->load(path);
+}
+
+void MainWindow::updateLoadProgress(int percent) {
+  loadProgress->setValue(percent);
+}
+
+void MainWindow::modelLoaded(const QString &path, int pointCount) {
+  showLoading(false);
+  ui->statusbar->showMessage(
+      QString("Loaded %1, %2 vertices").arg(path).arg(pointCount));
+}
+
+void MainWindow::modelLoadFailed(const QString &path) {
+  showLoading(false);
+  ui->statusbar->showMessage("Failed to load " + path);
+}
+
+void MainWindow::modelLoadCancelled(const QString &path) {
+  showLoading(false);
+  ui->statusbar->showMessage("Cancelled loading " + path);
 }
 void MainWindow::browsePath() {
   QString filePath = QFileDialog::getOpenFileName(
-      this, "Choose model", QDir::homePath(), "Model files (*.obj)");
+      this, "Choose model", QDir::homePath(), "Model files (*.obj *.ply *.stl)");
   ui->editPath->setText(filePath);
 }
 
@@ -135,6 +182,7 @@ void MainWindow::updateProjection() {
                                   ? ProjectionType::Orthographic
                                   : ProjectionType::Perspective;
   viewerWin->update_projection();
+  viewerWin->renderLater();
 }
 
 void MainWindow::browseBgColor() {
@@ -143,11 +191,13 @@ void MainWindow::browseBgColor() {
                                         QColorDialog::ColorDialogOptions(0));
   ui->editBgColor->setText(color.name());
   viewerWin->backgroundColor = color;
+  viewerWin->renderLater();
 }
 
 void MainWindow::updateBgColor() {
   QColor color = QColor(ui->editBgColor->text());
   viewerWin->backgroundColor = color;
+  viewerWin->renderLater();
 }
 
 void MainWindow::browseLineColor() {
@@ -156,11 +206,13 @@ void MainWindow::browseLineColor() {
                                         QColorDialog::ColorDialogOptions(0));
   ui->editLineColor->setText(color.name());
   viewerWin->lineColor = color;
+  viewerWin->renderLater();
 }
 
 void MainWindow::updateLineColor() {
   QColor color = QColor(ui->editLineColor->text());
   viewerWin->lineColor = color;
+  viewerWin->renderLater();
 }
 
 void MainWindow::browsePointColor() {
@@ -169,11 +221,13 @@ void MainWindow::browsePointColor() {
                                         QColorDialog::ColorDialogOptions(0));
   ui->editPointColor->setText(color.name());
   viewerWin->pointColor = color;
+  viewerWin->renderLater();
 }
 
 void MainWindow::updatePointColor() {
   QColor color = QColor(ui->editPointColor->text());
   viewerWin->pointColor = color;
+  viewerWin->renderLater();
 }
 
 void MainWindow::updateLineType() {
@@ -188,10 +242,12 @@ void MainWindow::updateLineType() {
       viewerWin->lineType = LineType::Dotted;
       break;
   }
+  viewerWin->renderLater();
 }
 
 void MainWindow::updateLineThick() {
   viewerWin->lineWidth = (float)ui->spinLineThick->value();
+  viewerWin->renderLater();
 }
 
 void MainWindow::updatePointType() {
@@ -206,10 +262,12 @@ void MainWindow::updatePointType() {
       viewerWin->pointType = PointType::Circle;
       break;
   }
+  viewerWin->renderLater();
 }
 
 void MainWindow::updatePointSize() {
   viewerWin->pointSize = (float)ui->spinPointSize->value();
+  viewerWin->renderLater();
 }
 
 void MainWindow::saveSettings() {
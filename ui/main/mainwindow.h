@@ -3,7 +3,10 @@
 
 #include <exception>
 #include "ui/gl/viewerwindow.h"
+#include "ui/gl/modelloader.h"
 #include <QMainWindow>
+#include <QProgressBar>
+#include <QPushButton>
 #include <QVector3D>
 #include <QFileDialog>
 #include <QColorDialog>
@@ -30,6 +33,11 @@ private slots:
     void loadModel();
     void browsePath();
 
+    void updateLoadProgress(int percent);
+    void modelLoaded(const QString &path, int pointCount);
+    void modelLoadFailed(const QString &path);
+    void modelLoadCancelled(const QString &path);
+
     void updateProjection();
 
     void browseBgColor();
@@ -49,10 +57,15 @@ private:
     void saveSettings();
     void loadSettings();
     void spawnViewer();
+    void setupLoader();
+    void showLoading(bool loading);
 
     Ui::MainWindow *ui;
     QString *modelPath = new QString("/Users/yuehbell/dev/C8_3DViewer_v1.0-0/src/models/Female.obj");
     ViewerWindow *viewerWin;
+    ModelLoader *loader;
+    QProgressBar *loadProgress;
+    QPushButton *buttonCancelLoad;
     QString settings_path = QApplication::applicationDirPath().append("/settings.ini");
 };
 #endif // MAINWINDOW_H
@@ -0,0 +1,126 @@
+#include "thumbnailbatch.h"
+
+#include <QDir>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QImage>
+#include <QThreadPool>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+ThumbnailBatch::ThumbnailBatch(const RenderSettings &settings,
+                               const QSize &size, int jobs,
+                               RenderBackend backend)
+    : m_settings(settings), m_size(size), m_jobs(jobs), m_backend(backend) {}
+
+ThumbnailModel ThumbnailBatch::loadModel(const QString &path) {
+  ThumbnailModel model = {path, {}, {}, false};
+  QByteArray file = QFile::encodeName(path);
+  // the pool already keeps every core busy with a file of its own
+  ParseOptions options = {1, nullptr, nullptr};
+  Obj *obj = parse_model(file.constData(), options);
+  if (obj == NULL) return model;
+
+  int err = 0;
+  Triangles triangles = triangulate_ex(obj, options.threads, &err);
+  if (!err) model.mesh = create_mesh(obj, triangles, &err);
+  safe_free(triangles.triangles);
+  destroy_obj(obj);
+  if (err) {
+    printf("Error: failed to create mesh from model file: %s\n",
+           file.constData());
+    destroy_mesh(&model.mesh);
+    return model;
+  }
+  model.bounds = compute_bounds(model.mesh.points, 3, model.mesh.point_count);
+  model.ok = true;
+  return model;
+}
+
+int ThumbnailBatch::run(const QString &dir, const QString &out) {
+  QStringList files;
+  QDirIterator it(dir, {"*.obj", "*.OBJ", "*.ply", "*.PLY", "*.stl", "*.STL"},
+                  QDir::Files, QDirIterator::Subdirectories);
+  while (it.hasNext()) files.append(it.next());
+  files.sort();
+  if (files.isEmpty()) {
+    printf("Error: no model files in %s\n", qPrintable(dir));
+    return 1;
+  }
+
+  ThumbnailRenderer renderer(m_settings, m_size, m_backend);
+  if (!renderer.isValid()) return 1;
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(m_jobs);
+  std::mutex mutex;
+  std::condition_variable ready;
+  std::deque<ThumbnailModel> loaded;
+  std::atomic<int> failed{0};
+
+  QDir root(dir);
+  int next = 0, pending = 0, drawn = 0;
+  qint64 drawing = 0;
+  for (int i = 0; i < files.size(); i++) {
+    while (next < files.size() && pending < m_jobs * 2) {
+      QString path = files[next++];
+      pending++;
+      pool.start([path, &mutex, &ready, &loaded]() {
+        ThumbnailModel model = loadModel(path);
+        std::lock_guard<std::mutex> lock(mutex);
+        loaded.push_back(model);
+        ready.notify_one();
+      });
+    }
+
+    ThumbnailModel model = {};
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      ready.wait(lock, [&loaded]() { return !loaded.empty(); });
+      model = loaded.front();
+      loaded.pop_front();
+    }
+    pending--;
+
+    QImage image;
+    if (model.ok) {
+      QElapsedTimer timer;
+      timer.start();
+      image = renderer.render(model.mesh, model.bounds);
+      drawing += timer.nsecsElapsed();
+      drawn++;
+    }
+    destroy_mesh(&model.mesh);
+    printf("[%d/%d] %s\n", i + 1, (int)files.size(), qPrintable(model.path));
+    if (image.isNull()) {
+      printf("Error: failed to render %s\n", qPrintable(model.path));
+      failed++;
+      continue;
+    }
+
+    QFileInfo source(root.relativeFilePath(model.path));
+    QString target = QDir(out).filePath(source.path() + "/" +
+                                        source.completeBaseName() + ".png");
+    QDir().mkpath(QFileInfo(target).absolutePath());
+    // encoding is left to the pool, the next model can be drawn meanwhile
+    pool.start([image, target, &failed]() {
+      if (!image.save(target, "PNG")) {
+        printf("Error: failed to write %s\n", qPrintable(target));
+        failed++;
+      }
+    });
+  }
+  pool.waitForDone();
+
+  printf("Thumbnails: %d of %d written to %s\n",
+         (int)files.size() - failed.load(), (int)files.size(),
+         qPrintable(out));
+  printf("Drawing: %.3f ms per model with %s\n",
+         drawn > 0 ? drawing / 1e6 / drawn : 0.0,
+         m_backend == SoftwareBackend ? "the software rasterizer" : "OpenGL");
+  return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,47 @@
+#ifndef THUMBNAILBATCH_H
+#define THUMBNAILBATCH_H
+
+#include <QSize>
+#include <QString>
+
+#include "ui/gl/thumbnailrenderer.h"
+
+extern "C" {
+#include "../../parser/s21_mesh.h"
+#include "../../parser/s21_model.h"
+#include "../../parser/s21_simd.h"
+}
+
+// A model parsed and indexed on a worker thread
+struct ThumbnailModel {
+    QString path;
+    Mesh mesh;
+    Bounds bounds;
+    bool ok;
+};
+
+// Renders a PNG of every obj file under a directory. A pool of jobs threads
+// parses and indexes the models and encodes the images, while the GUI
+// thread draws them one after the other on a single offscreen context. At
+// most two models per thread wait to be drawn, so the memory stays bounded
+// however many files there are. The time spent drawing is reported per
+// model, so the backends can be compared over the same directory.
+class ThumbnailBatch {
+public:
+    ThumbnailBatch(const RenderSettings &settings, const QSize &size,
+                   int jobs, RenderBackend backend = OpenGLBackend);
+
+    // writes dir/a/b.obj to out/a/b.png, returns the exit code of the run,
+    // 1 when a model could not be found, loaded, drawn or written
+    int run(const QString &dir, const QString &out);
+
+private:
+    static ThumbnailModel loadModel(const QString &path);
+
+    RenderSettings m_settings;
+    QSize m_size;
+    int m_jobs;
+    RenderBackend m_backend;
+};
+
+#endif // THUMBNAILBATCH_H